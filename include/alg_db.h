@@ -0,0 +1,83 @@
+#ifndef _ALG_DB_H_
+#define _ALG_DB_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALG_DB_MAGIC   "RCAD"
+#define ALG_DB_VERSION 1
+
+// Binary algorithm database, the file is mapped into memory and used without parsing.
+// All sections are arrays in native byte order, offsets are counted from the start of the file.
+//
+//  header
+//  offsets[algorithm_count + 1]    start of every algorithm in moves[], algorithms are sorted by their moves
+//  moves[move_count]               moves packed with move_pack()
+//  nodes[node_count]               prefix trie, node 0 is the empty prefix
+//  entries[entry_count]            states the algorithms solve, sorted by hash
+//  buckets[(1 << bucket_bits) + 1] first entry of every range of hashes with the same top bits
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t n;
+    uint32_t algorithm_count;
+    uint32_t move_count;
+    uint32_t node_count;
+    uint32_t entry_count;
+    uint32_t bucket_bits;
+
+    uint64_t offsets_offset;
+    uint64_t moves_offset;
+    uint64_t nodes_offset;
+    uint64_t entries_offset;
+    uint64_t buckets_offset;
+} Alg_Db_Header;
+
+// Since algorithms are sorted, the algorithms starting with the prefix of a node are a range.
+// The children of a node are stored next to each other and sorted by their move.
+typedef struct {
+    uint32_t move;
+    uint32_t children;
+    uint32_t child_count;
+    uint32_t first;
+    uint32_t count;
+} Alg_Db_Node;
+
+// Every algorithm is stored for each turn of the up layer before and after it,
+// so it is found no matter how the case is turned.
+typedef struct {
+    uint64_t hash;          // cube_state_hash() of the state the moves solve
+    uint32_t algorithm;
+    uint8_t  pre_auf;       // clockwise quarter turns of the up layer before the algorithm
+    uint8_t  post_auf;      // and after it
+    uint16_t reserved;
+} Alg_Db_Entry;
+
+typedef struct {
+    const Alg_Db_Header *header;
+    const uint32_t *offsets;
+    const uint32_t *moves;
+    const Alg_Db_Node *nodes;
+    const Alg_Db_Entry *entries;
+    const uint32_t *buckets;
+
+    void *data;
+    size_t size;
+    int mapped;
+} Alg_Db;
+
+int alg_db_build(const char *path, uint64_t n, Rubiks_Cube_Move **algorithms, const size_t *lengths, size_t count);
+Alg_Db *alg_db_open(const char *path);
+void alg_db_close(Alg_Db *db);
+
+size_t alg_db_length(const Alg_Db *db, uint32_t algorithm);
+size_t alg_db_moves(const Alg_Db *db, uint32_t algorithm, Rubiks_Cube_Move *moves, size_t capacity);
+size_t alg_db_format(const Alg_Db *db, uint32_t algorithm, char *str, size_t size);
+int    alg_db_prefix(const Alg_Db *db, const Rubiks_Cube_Move *prefix, size_t count, uint32_t *first, uint32_t *found);
+size_t alg_db_find(const Alg_Db *db, uint64_t hash, const Alg_Db_Entry **entries);
+size_t alg_db_solving(const Alg_Db *db, const Cube_State *s, const Alg_Db_Entry **entries);
+
+#endif // _ALG_DB_H_
\ No newline at end of file
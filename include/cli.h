@@ -0,0 +1,7 @@
+#ifndef _CLI_H_
+#define _CLI_H_
+
+// runs the command given on the command line instead of the window, returns the exit code
+int cli_main(int argc, char **argv);
+
+#endif // _CLI_H_
\ No newline at end of file
@@ -54,6 +54,18 @@ typedef enum {
     KEY_ROTATE_S_CW,
     KEY_ROTATE_S_180,
     KEY_ROTATE_S_CCW,
+    // solver controls
+    KEY_SOLVE,
+    KEY_IMPORT_STATE,
+    KEY_SAVE_STATE,
+    KEY_LOAD_STATE,
+    // history controls
+    KEY_UNDO,
+    KEY_REDO,
+    KEY_UNDO_ALL,
+    KEY_REDO_ALL,
+    // debug controls
+    KEY_TOGGLE_CAPTURE,
 
     KEY_CONTROLS_COUNT,
 } Key_Controls;
@@ -87,6 +99,13 @@ typedef struct {
     float cam_anim_duration;        // camera animation duration, includes position and orientation animation
     easing_func *cam_anim_efunc;    // camera easing function for animations, includes position and orientation animation
 
+    char *alg_db_path;              // algorithm database to look up the algorithms for the current state, see alg_db.h
+    char *snapshot_path;            // file for saving and loading the state of the cube, see snapshot.h
+    int resume_snapshot;            // load the snapshot at the start and save it at exit
+    char *session_path;             // records every move to this file, nothing is recorded if NULL, see session.h
+    uint32_t session_checkpoint_interval;   // moves between two full states in the recording, seeking replays at most this many moves
+    char *render_capture_path;      // rendered frames are captured to this file while the capture is toggled on, see render_queue.h
+
     Rubiks_Cube_Config rcconf;  // all configurations specific to the rubiks cube, look at cube_config.h for more information 
 } Config;
 
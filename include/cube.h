@@ -3,27 +3,34 @@
 
 #include "animation.h"
 #include "cube_config.h"
+#include "cube_state.h"
 #include "cubie.h"
+#include "hint.h"
+#include "last_layer.h"
 #include "mat.h"
+#include "move.h"
+#include "session.h"
 #include "shader.h"
+#include "sticker_mesh.h"
 #include "vec.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
-typedef enum {
-    FACE_FRONT,
-    FACE_UP,
-    FACE_LEFT,
-    FACE_BACK,
-    FACE_DOWN,
-    FACE_RIGHT,
-} Rubiks_Cube_Face;
-
-typedef enum {
-    ROTATION_CCW,
-    ROTATION_180,
-    ROTATION_CW,
-} Rubiks_Cube_Rotation;
+// cubie positions along every axis of a chunk of the static mesh
+#ifndef CUBE_CHUNK_SIZE
+#   define CUBE_CHUNK_SIZE 16
+#endif
+
+// Block of positions with a fixed range of the static mesh. A move keeps every kind of cubie (corner, edge,
+// center) on positions of the same kind, so the cubies of a chunk always need as many vertices as at the start.
+typedef struct {
+    uint64_t first_position, position_count;    // in Rubiks_Cube.chunk_positions
+    uint64_t first_vertex, vertex_count;
+    uint64_t first_index, index_count;
+    int dirty;
+    int moving;     // a cubie was left out because it was moving when the chunk was baked
+} Cube_Chunk;
 
 typedef struct {
     uint64_t w, h, d;
@@ -36,6 +43,62 @@ typedef struct {
     uint64_t cubie_count;
     Cubie *cubies;
 
+    // indices of the cubies with a running animation, the only ones updated and drawn one by one
+    uint64_t *moving_cubies;
+    uint64_t moving_count;
+
+    // cubies with the same colored faces share a mesh, only the used color masks have one
+    Cubie_Mesh meshes[1 << COLOR_MASK_COUNT];
+
+    // Every cubie that is not moving, baked into one mesh in cube space with the colors resolved.
+    // The chunks of the positions a move touches are baked again, the moving cubies are drawn one by one.
+    Cube_Chunk *chunks;
+    uint64_t chunk_count;
+    uint64_t chunks_w, chunks_h;    // chunks along the width and height, to find the chunk of a position
+    uint64_t *chunk_positions;      // positions holding a cubie, grouped by chunk
+    int static_dirty;               // at least one chunk is dirty
+    float static_scale;             // like vertex_scale, for the whole cube
+    Cube_Vertex *static_verts;
+    void *static_indices;           // of static_index_type
+    GLsizei static_index_count;
+    GLenum static_index_type;
+    GLuint static_vao, static_vbo, static_ebo;
+
+    // While no cubie moves the faces are drawn from the sticker state with same colored stickers merged
+    // instead of the static mesh. NULL program if merging is disabled or the cube is not a cube.
+    Sticker_Mesh stickers;
+    Shader_Program *sticker_prog;
+    Shader_Uniform sticker_model_uniform;
+
+    // border color + 6 face colors, the palette of every draw, the vertices only store indices
+    Color face_colors[CUBE_COLOR_COUNT];
+
+    // logical sticker state, only available if all side lengths are equal
+    Cube_State *state;
+
+    // background solver for the next move hint, NULL if hints are disabled
+    Hint_Solver *hint;
+
+    // case of the last layer, updated after every move if recognizing cases is enabled
+    int recognize_last_layer;
+    Last_Layer_Case last_layer;
+
+    // every move as move_pack(), the first history_count can be undone and the rest up to history_length redone
+    uint32_t *history;
+    size_t history_count;
+    size_t history_length;
+    size_t history_capacity;
+
+    // records every move and replaced state if not NULL, owned by the caller
+    Session_Writer *recorder;
+    double time;    // seconds since the cube was created, timestamps of the recorded moves
+
+    // moves waiting to be played, one is started whenever the cooldown is over
+    Rubiks_Cube_Move *queue;
+    size_t queue_start;
+    size_t queue_count;
+    size_t queue_capacity;
+
     // move cooldown
     float mcooldown;
     float mc;
@@ -51,6 +114,9 @@ typedef struct {
     Animation wobble_anim;
 
     Shader_Program *prog;
+    Shader_Uniform model_uniform;
+    Shader_Uniform faces_uniform;   // Cubie.face_colors
+    float vertex_scale;             // vertex positions are divided by it, see cube_vertex()
 } Rubiks_Cube;
 
 Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf);
@@ -58,10 +124,21 @@ void rubiks_cube_set_move_duration(Rubiks_Cube *rc, float duration);
 void rubiks_cube_set_move_cooldownn(Rubiks_Cube *rc, float cooldown);
 void rubiks_cube_set_move_easing_func(Rubiks_Cube *rc, easing_func efunc);
 void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice);
+int  rubiks_cube_queue_moves(Rubiks_Cube *rc, const Rubiks_Cube_Move *moves, size_t count);
+void rubiks_cube_clear_queue(Rubiks_Cube *rc);
+int  rubiks_cube_solve(Rubiks_Cube *rc);
+size_t rubiks_cube_undo(Rubiks_Cube *rc, size_t count);
+size_t rubiks_cube_redo(Rubiks_Cube *rc, size_t count);
+void rubiks_cube_clear_history(Rubiks_Cube *rc);
+int  rubiks_cube_set_state(Rubiks_Cube *rc, const Cube_State *s);
+int  rubiks_cube_import_facelets(Rubiks_Cube *rc, const char *facelets);
+int  rubiks_cube_save_state(Rubiks_Cube *rc, const char *path);
+int  rubiks_cube_load_state(Rubiks_Cube *rc, const char *path);
 void rubiks_cube_rotate(Rubiks_Cube *rc, Vec3 axis, float angle);
 void rubiks_cube_scale(Rubiks_Cube *rc, float scale);
+void rubiks_cube_set_face_colors(Rubiks_Cube *rc, const Color *colors);
 void rubiks_cube_update(Rubiks_Cube *rc, float dt);
-void rubiks_cube_draw(Rubiks_Cube *rc, Mat4 view_proj);
+void rubiks_cube_draw(Rubiks_Cube *rc);
 void rubiks_cube_free(Rubiks_Cube *rc);
 
 #endif // _CUBE_H_
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef _CUBE2_H_
+#define _CUBE2_H_
+
+#include "cube3.h"
+#include "move.h"
+
+// corner states of the 2x2x2 with the DBL corner solved, 7! permutations and 3^6 twists
+#define CUBE2_STATE_COUNT (5040 * 729)
+
+// every state can be solved in this many moves
+#define CUBE2_MAX_LENGTH 11
+
+void cube2_init(void);
+int  cube2_solve(const Cube3 *c, Rubiks_Cube_Move *moves);
+
+#endif // _CUBE2_H_
\ No newline at end of file
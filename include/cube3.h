@@ -0,0 +1,66 @@
+#ifndef _CUBE3_H_
+#define _CUBE3_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stdint.h>
+
+// corner and edge positions, the first sticker of a corner or edge is its reference sticker
+// and the remaining corner stickers follow in clockwise order
+typedef enum {
+    CORNER_URF,
+    CORNER_UFL,
+    CORNER_ULB,
+    CORNER_UBR,
+    CORNER_DFR,
+    CORNER_DLF,
+    CORNER_DBL,
+    CORNER_DRB,
+
+    CORNER_COUNT,
+} Cube3_Corner;
+
+typedef enum {
+    EDGE_UR,
+    EDGE_UF,
+    EDGE_UL,
+    EDGE_UB,
+    EDGE_DR,
+    EDGE_DF,
+    EDGE_DL,
+    EDGE_DB,
+    EDGE_FR,
+    EDGE_FL,
+    EDGE_BL,
+    EDGE_BR,
+
+    EDGE_COUNT,
+} Cube3_Edge;
+
+// the 18 outer layer moves are indexed by face * ROTATION_COUNT + rotation
+#define CUBE3_MOVE_COUNT (FACE_COUNT * ROTATION_COUNT)
+
+// Cubie level representation of the 3x3x3 cube (corners and edges, the centers are fixed).
+// cp[i] is the corner that sits at position i and co[i] its clockwise twist,
+// ep[i] is the edge that sits at position i and eo[i] its flip.
+typedef struct {
+    uint8_t cp[CORNER_COUNT];
+    uint8_t co[CORNER_COUNT];
+    uint8_t ep[EDGE_COUNT];
+    uint8_t eo[EDGE_COUNT];
+} Cube3;
+
+void  cube3_init(void);
+Cube3 cube3_solved(void);
+Cube3 cube3_multiply(Cube3 a, Cube3 b);
+Cube3 cube3_apply_move(Cube3 c, int move);
+int   cube3_is_solved(const Cube3 *c);
+int   cube3_corner_parity(const Cube3 *c);
+int   cube3_edge_parity(const Cube3 *c);
+int   cube3_is_valid(const Cube3 *c);
+int   cube3_from_state(const Cube_State *s, Cube3 *c);
+void  cube3_to_state(const Cube3 *c, Cube_State *s);
+Rubiks_Cube_Move cube3_move(int move);
+
+#endif // _CUBE3_H_
\ No newline at end of file
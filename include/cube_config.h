@@ -13,6 +13,8 @@ typedef struct {
     // shader paths
     char *vertex_path;
     char *fragment_path;
+    char *sticker_vertex_path;
+    char *sticker_fragment_path;
 
     // cube dimensions in cubies
     uint64_t width, height, depth;
@@ -37,6 +39,10 @@ typedef struct {
     float move_duration;            // duration of one move
     float move_cooldown;            // cooldown between moves, set this to move_duration to do them sequentially
     easing_func *move_easing_func;  // easing function of the move animation
+
+    int hints;  // solve the cube in the background after every move to show the next move
+    int last_layer_cases;   // recognize the OLL, ZBLL and PLL case of a 3x3x3 cube after every move
+    int merge_stickers;     // draw an idle cube with same colored stickers merged, see sticker_mesh.h
 } Rubiks_Cube_Config;
 
 #endif // _CUBE_CONFIG_H_
\ No newline at end of file
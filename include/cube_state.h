@@ -0,0 +1,47 @@
+#ifndef _CUBE_STATE_H_
+#define _CUBE_STATE_H_
+
+#include "move.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Logical sticker state of a NxNxN cube, independent of the renderer.
+// Stickers are stored face by face in the order of Rubiks_Cube_Face, each face row by row as seen
+// from outside the cube. Up is viewed with the back face on top, down with the front face on top,
+// all other faces with the up face on top. A sticker stores the face it belongs to in the solved state.
+typedef struct {
+    uint64_t n;
+    uint8_t *stickers;
+
+    // scratch memory for moves, holds the indices and colors of every sticker of one slice
+    uint64_t *scratch;
+    uint8_t  *scratch_colors;
+} Cube_State;
+
+Cube_State *cube_state(uint64_t n);
+Cube_State *cube_state_copy(const Cube_State *s);
+Cube_State *cube_state_from_facelets(const char *facelets);
+char *cube_state_to_facelets(const Cube_State *s);
+void cube_state_reset(Cube_State *s);
+int  cube_state_is_solved(const Cube_State *s);
+uint64_t cube_state_hash(const Cube_State *s);
+uint64_t cube_state_packed_size(uint64_t n);
+void cube_state_pack(const Cube_State *s, uint8_t *packed);
+int  cube_state_unpack(Cube_State *s, const uint8_t *packed);
+void cube_state_rotate_slice(Cube_State *s, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice);
+void cube_state_apply_move(Cube_State *s, Rubiks_Cube_Move m);
+void cube_state_apply_moves(Cube_State *s, const Rubiks_Cube_Move *moves, size_t count);
+void cube_state_free(Cube_State *s);
+
+// sticker geometry, cubie coordinates go from left to right (x), down to up (y) and back to front (z)
+uint64_t cube_state_sticker_index(uint64_t n, Rubiks_Cube_Face face, uint64_t row, uint64_t col);
+uint64_t cube_state_sticker_at(uint64_t n, Rubiks_Cube_Face face, uint64_t x, uint64_t y, uint64_t z);
+void     cube_state_sticker_cubie(uint64_t n, uint64_t sticker, uint64_t *x, uint64_t *y, uint64_t *z);
+uint64_t cube_state_move_sticker(uint64_t n, uint64_t sticker, Rubiks_Cube_Move m);
+uint64_t cube_state_slice_stickers(uint64_t n, Rubiks_Cube_Face face, uint64_t slice, uint64_t *stickers);
+uint64_t cube_state_slice_sticker(uint64_t n, Rubiks_Cube_Face face, uint64_t slice, Rubiks_Cube_Face side, uint64_t i);
+void     cube_state_face_normal(Rubiks_Cube_Face face, int64_t normal[3]);
+Rubiks_Cube_Face cube_state_face_from_normal(const int64_t normal[3]);
+
+#endif // _CUBE_STATE_H_
\ No newline at end of file
@@ -10,24 +10,49 @@
 
 #include <stdint.h>
 
+// 8 corners and 4 vertices per colored face, 12 triangles and 2 per colored face
+#define CUBIE_MAX_VERTICES (8 + 4 * COLOR_MASK_COUNT)
+#define CUBIE_MAX_INDICES  (36 + 6 * COLOR_MASK_COUNT)
+
+// face colors of a cubie in its home position, every face has the color of its side
+#define CUBIE_HOME_FACE_COLORS \
+    (COLOR_FRONT | COLOR_UP << 3 | COLOR_LEFT << 6 | COLOR_BACK << 9 | COLOR_DOWN << 12 | COLOR_RIGHT << 15)
+
+// Geometry of every cubie with the same colored faces, relative to the top left corner of the cubie.
+// The vertices of the faces follow the cubie vertices in the order of Cube_Color_Mask and store the
+// face color of the unturned cube, which the shader maps to the actual color of the cubie.
 typedef struct {
-    Cube_Vertex *verts;
-    uint64_t vertex_count;
+    uint8_t color_mask;
 
-    uint32_t *indices;
-    uint64_t index_count;
+    // kept after uploading to bake cubies into bigger meshes
+    Cube_Vertex verts[CUBIE_MAX_VERTICES];
+    uint8_t indices[CUBIE_MAX_INDICES];
+    GLsizei vertex_count;
+    GLsizei index_count;    // 8 bit indices
+
+    GLuint vao, vbo, ebo;
+} Cubie_Mesh;
+
+typedef struct {
+    const Cubie_Mesh *mesh;
+    Vec3 origin;            // top left corner in the cube
+
+    // Cube_Color of every face, 3 bits each in the order of Cube_Color_Mask
+    uint32_t face_colors;
 
     Quat ori;
     Animation a;
-
-    GLuint vao, vbo, ebo;
 } Cubie;
 
-Cubie cubie(Cubie_Config *cconf);
+int  cubie_mesh(Cubie_Mesh *m, Cubie_Config *cconf);
+void cubie_mesh_free(Cubie_Mesh *m);
+Cubie cubie(const Cubie_Mesh *mesh, Vec3 origin);
 void cubie_set_animation_duration(Cubie *c, float duration);
 void cubie_set_animation_easing_func(Cubie *c, easing_func efunc);
 void cubie_rotation_add(Cubie *c, Vec3 axis, float angle);
+void cubie_reset_rotation(Cubie *c);
+void cubie_set_face_color(Cubie *c, Cube_Color_Mask face, Cube_Color col);
+Cube_Color cubie_vertex_color(const Cubie *c, uint8_t col);
 void cubie_update(Cubie *c, float dt);
-void cubie_free(Cubie c);
 
 #endif // _CUBIE_H_
\ No newline at end of file
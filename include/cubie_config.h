@@ -30,13 +30,13 @@ typedef enum {
     CUBE_COLOR_COUNT,
 } Cube_Color;
 
+// describes the mesh of a cubie, the cubies themselves are placed by the model matrix
 typedef struct {
-    Vec3 origin;        // origin of cubie in world, top left corner, coordinates are offset directly by origin instead of a translation matrix
     float side_length;  // side length of cubie
 
     uint8_t color_mask; // mask to determine the colored faces of a cubie, combination of Cube_Color_Mask enum
 
-    Color face_colors[CUBE_COLOR_COUNT];    // border color + 6 face colors
+    float vertex_scale;                     // largest coordinate of any vertex of the cubie, see cube_vertex()
     float face_length_multiplier;           // face length relative to cubie length [0...1]
     float face_offset_from_cubie;           // offset from cubie to face to prevent visual glitches, small value like 1e-3f should do
 } Cubie_Config;
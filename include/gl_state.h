@@ -0,0 +1,77 @@
+#ifndef _GL_STATE_H_
+#define _GL_STATE_H_
+
+#include "glad/gl.h"
+
+#include <stdint.h>
+
+#ifndef GL_STATE_TEXTURE_UNITS
+#   define GL_STATE_TEXTURE_UNITS 16
+#endif
+
+#ifndef GL_STATE_UNIFORM_BINDINGS
+#   define GL_STATE_UNIFORM_BINDINGS 16
+#endif
+
+// Kinds of state changes that are counted
+typedef enum {
+    GL_STATE_PROGRAM,
+    GL_STATE_VERTEX_ARRAY,
+    GL_STATE_BUFFER,
+    GL_STATE_TEXTURE,
+    GL_STATE_ENABLE,
+    GL_STATE_BLEND_FUNC,
+    GL_STATE_DEPTH,
+
+    GL_STATE_CALL_COUNT,
+} Gl_State_Call;
+
+// Shadow copy of the GL state, a change only reaches the driver if it differs from the copy.
+// Everything that binds or enables something has to go through here, otherwise the copy is wrong.
+typedef struct {
+    GLuint program;
+    GLuint vertex_array;
+    GLuint array_buffer;
+    GLuint element_buffer;  // part of the vertex array state, unknown after the vertex array changed
+    GLuint uniform_buffer;
+    GLuint uniform_bindings[GL_STATE_UNIFORM_BINDINGS];
+    GLintptr uniform_offsets[GL_STATE_UNIFORM_BINDINGS];
+    GLsizeiptr uniform_sizes[GL_STATE_UNIFORM_BINDINGS];
+
+    GLenum active_texture;
+    GLuint textures[GL_STATE_TEXTURE_UNITS];
+
+    int cull_face;
+    int depth_test;
+    int blend;
+    GLenum blend_src, blend_dst;
+    GLenum depth_func;
+    int depth_mask;
+
+    // calls made through this module and how many of them changed something
+    uint64_t requested[GL_STATE_CALL_COUNT];
+    uint64_t issued[GL_STATE_CALL_COUNT];
+    uint64_t frames;
+} Gl_State;
+
+void gl_state_invalidate(void);
+void gl_state_use_program(GLuint program);
+void gl_state_bind_vertex_array(GLuint vertex_array);
+void gl_state_bind_buffer(GLenum target, GLuint buffer);
+void gl_state_bind_buffer_range(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void gl_state_bind_texture(GLuint unit, GLuint texture);
+void gl_state_enable(GLenum cap, int enabled);
+void gl_state_blend_func(GLenum src, GLenum dst);
+void gl_state_depth_func(GLenum func);
+void gl_state_depth_mask(GLboolean mask);
+
+void gl_state_delete_program(GLuint program);
+void gl_state_delete_vertex_array(GLuint vertex_array);
+void gl_state_delete_buffer(GLuint buffer);
+void gl_state_delete_texture(GLuint texture);
+
+void gl_state_end_frame(void);
+const Gl_State *gl_state_get(void);
+void gl_state_report(void);
+
+#endif // _GL_STATE_H_
\ No newline at end of file
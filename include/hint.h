@@ -0,0 +1,54 @@
+#ifndef _HINT_H_
+#define _HINT_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+typedef enum {
+    HINT_SEARCHING,
+    HINT_SOLVED,
+    HINT_FOUND,
+    HINT_FAILED,
+
+    HINT_STATUS_COUNT,
+} Hint_Status;
+
+typedef struct {
+    Hint_Status status;
+    Rubiks_Cube_Move next;  // first move of the solution, only valid if status is HINT_FOUND
+    uint64_t length;        // number of moves to solve the cube
+} Hint;
+
+// Solves the cube on a background thread. Every submitted state cancels the running search and
+// restarts it on a copy of the state, the render thread reads the latest hint without locking.
+typedef struct {
+    pthread_t thread;
+
+    // protects everything below up to result
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    Cube_State *pending;    // latest submitted state, only read if has_pending is set
+    int has_pending;
+    uint16_t generation;
+    int quit;
+
+    // state the search runs on, only touched by the thread
+    Cube_State *work;
+
+    // set when a newer state was submitted
+    atomic_int cancel;
+
+    // packed hint of the latest generation, see pack_hint() in hint.c
+    _Atomic uint64_t result;
+} Hint_Solver;
+
+Hint_Solver *hint_solver(const Cube_State *s);
+void hint_solver_submit(Hint_Solver *hs, const Cube_State *s);
+Hint hint_solver_get(Hint_Solver *hs);
+void hint_solver_free(Hint_Solver *hs);
+
+#endif // _HINT_H_
\ No newline at end of file
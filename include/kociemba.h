@@ -0,0 +1,17 @@
+#ifndef _KOCIEMBA_H_
+#define _KOCIEMBA_H_
+
+#include "cube3.h"
+#include "move.h"
+
+// upper bound for the length of a solution, every cube can be solved in this many moves
+#define KOCIEMBA_MAX_LENGTH 31
+
+#ifndef KOCIEMBA_DEFAULT_LENGTH
+#   define KOCIEMBA_DEFAULT_LENGTH 24
+#endif
+
+void kociemba_init(void);
+int  kociemba_solve(const Cube3 *c, int max_length, Rubiks_Cube_Move *moves);
+
+#endif // _KOCIEMBA_H_
\ No newline at end of file
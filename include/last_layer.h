@@ -0,0 +1,40 @@
+#ifndef _LAST_LAYER_H_
+#define _LAST_LAYER_H_
+
+#include "cube3.h"
+#include "cube_state.h"
+
+#include <stdint.h>
+
+// corner orientations of the up layer pieces (the last one follows from the others) and edge flips
+#define LAST_LAYER_ORIENTATION_COUNT (27 * 8)
+// corner permutation, corner orientation and edge permutation of the up layer pieces
+#define LAST_LAYER_PERMUTATION_COUNT (24 * 27 * 24)
+
+// Cases of the up layer once the first two layers are solved. Edges that are not oriented give
+// an OLL case, oriented edges a ZBLL case and a completely oriented layer a PLL case.
+typedef enum {
+    LAST_LAYER_NONE,
+    LAST_LAYER_OLL,
+    LAST_LAYER_ZBLL,
+    LAST_LAYER_PLL,
+
+    LAST_LAYER_STAGE_COUNT,
+} Last_Layer_Stage;
+
+// Cases are the same no matter how the up layer is turned before and after the algorithm,
+// index is the number of the case within its stage.
+typedef struct {
+    Last_Layer_Stage stage;
+    uint16_t index;
+} Last_Layer_Case;
+
+void last_layer_init(void);
+Last_Layer_Case last_layer_recognize(const Cube_State *s);
+const char *last_layer_case_name(Last_Layer_Case c);
+
+// perfect hashes of the up layer pieces, the first two layers have to be solved
+int last_layer_orientation_index(const Cube3 *c);
+int last_layer_permutation_index(const Cube3 *c);
+
+#endif // _LAST_LAYER_H_
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef _MOVE_H_
+#define _MOVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// longest string of a single move, a slice number with up to 10 digits, the face and the rotation
+#define MOVE_STRING_LENGTH 16
+
+// the opposite face of face f is always (f + 3) % FACE_COUNT
+typedef enum {
+    FACE_FRONT,
+    FACE_UP,
+    FACE_LEFT,
+    FACE_BACK,
+    FACE_DOWN,
+    FACE_RIGHT,
+
+    FACE_COUNT,
+} Rubiks_Cube_Face;
+
+// rotations are seen from the face that is rotated, the inverse of rot is always 2 - rot
+typedef enum {
+    ROTATION_CCW,
+    ROTATION_180,
+    ROTATION_CW,
+
+    ROTATION_COUNT,
+} Rubiks_Cube_Rotation;
+
+// a single slice move, same parameters as rubiks_cube_rotate_slice()
+typedef struct {
+    uint8_t  face;  // Rubiks_Cube_Face
+    uint8_t  rot;   // Rubiks_Cube_Rotation
+    uint32_t slice; // slice index counted from face, 0 is the outer layer of face
+} Rubiks_Cube_Move;
+
+Rubiks_Cube_Move rubiks_cube_move(Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice);
+Rubiks_Cube_Move move_inverse(Rubiks_Cube_Move m);
+uint64_t move_pack(Rubiks_Cube_Move m);
+Rubiks_Cube_Move move_unpack(uint64_t code);
+Rubiks_Cube_Face face_opposite(Rubiks_Cube_Face face);
+void moves_invert(Rubiks_Cube_Move *moves, size_t count);
+size_t moves_optimize(Rubiks_Cube_Move *moves, size_t count, uint64_t n);
+int  move_to_string(Rubiks_Cube_Move m, char *buf, size_t length);
+int  move_from_string(const char *str, Rubiks_Cube_Move *m);
+char *moves_to_string(const Rubiks_Cube_Move *moves, size_t count);
+int  moves_from_string(const char *str, Rubiks_Cube_Move **moves, size_t *count);
+
+#endif // _MOVE_H_
\ No newline at end of file
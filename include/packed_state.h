@@ -0,0 +1,54 @@
+#ifndef _PACKED_STATE_H_
+#define _PACKED_STATE_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PACKED_STATE_MAGIC   "RCPS"
+#define PACKED_STATE_VERSION 1
+
+// stickers per word, 3 bits each
+#define PACKED_STATE_STICKERS_PER_WORD 21
+
+// Sticker state for cubes too big for a byte per sticker, a 10000x10000x10000 takes 229 MB instead of 600 MB.
+// Stickers are ordered like in Cube_State, every row of a face starts at a new word so rows can be
+// unpacked and packed a word at a time. The upper bit of every word is unused.
+typedef struct {
+    uint64_t n;
+    uint64_t row_words; // words per row of a face
+    uint64_t *words;    // FACE_COUNT * n * row_words
+
+    // scratch memory for moves, the four rows of a slice and one more row
+    uint8_t *ring;
+    uint8_t *line;
+
+    // set if words is mapped from a file, see packed_state_map()
+    void *mapping;
+    size_t mapping_size;
+} Packed_State;
+
+// header of files used by packed_state_map(), the words follow at offset sizeof (Packed_State_Header)
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t n;
+    uint64_t row_words;
+    uint64_t reserved[5];
+} Packed_State_Header;
+
+Packed_State *packed_state(uint64_t n);
+Packed_State *packed_state_map(const char *path, uint64_t n);
+void packed_state_free(Packed_State *p);
+void packed_state_reset(Packed_State *p);
+int  packed_state_is_solved(const Packed_State *p);
+uint8_t packed_state_get(const Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint64_t col);
+void packed_state_set(Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint64_t col, uint8_t sticker);
+void packed_state_rotate_slice(Packed_State *p, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice);
+void packed_state_apply_move(Packed_State *p, Rubiks_Cube_Move m);
+int  packed_state_to_state(const Packed_State *p, Cube_State *s);
+int  packed_state_from_state(Packed_State *p, const Cube_State *s);
+
+#endif // _PACKED_STATE_H_
\ No newline at end of file
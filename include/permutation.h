@@ -0,0 +1,38 @@
+#ifndef _PERMUTATION_H_
+#define _PERMUTATION_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A move sequence compiled into one permutation of the stickers of a NxNxN cube.
+// Sticker permutations include the orientation of the cubies, a twisted corner moves its stickers to
+// other faces. Applying it is a single pass over the stickers no matter how long the sequence was.
+typedef struct {
+    uint64_t n;
+    uint64_t size;      // number of stickers, 6*n*n
+
+    // the sticker at position i is taken from position src[i]
+    uint64_t *src;
+
+    // scratch memory, big enough for a whole permutation or the positions and sources of one slice
+    uint64_t *scratch;
+    uint8_t  *scratch_colors;
+} Permutation;
+
+Permutation *permutation(uint64_t n);
+Permutation *permutation_copy(const Permutation *p);
+Permutation *permutation_compile(uint64_t n, const Rubiks_Cube_Move *moves, size_t count);
+void permutation_apply_move(Permutation *p, Rubiks_Cube_Move m);
+void permutation_compose(Permutation *p, const Permutation *q);
+void permutation_invert(Permutation *p);
+int  permutation_power(Permutation *p, int64_t k);
+void permutation_apply(Permutation *p, Cube_State *s);
+int  permutation_is_identity(const Permutation *p);
+uint64_t permutation_cycles(const Permutation *p, uint64_t *lengths);
+uint64_t permutation_order(const Permutation *p);
+void permutation_free(Permutation *p);
+
+#endif // _PERMUTATION_H_
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include <stdint.h>
+
+// xoshiro256** by David Blackman and Sebastiano Vigna, fast and good enough for everything but cryptography.
+// Every thread should use its own generator, random_jump() gives streams that never overlap.
+typedef struct {
+    uint64_t s[4];
+} Random;
+
+void     random_seed(Random *r, uint64_t seed);
+uint64_t random_next(Random *r);
+uint64_t random_below(Random *r, uint64_t bound);
+void     random_jump(Random *r);
+
+#endif // _RANDOM_H_
\ No newline at end of file
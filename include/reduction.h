@@ -0,0 +1,14 @@
+#ifndef _REDUCTION_H_
+#define _REDUCTION_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+void reduction_init(void);
+int  reduction_solve(const Cube_State *s, Rubiks_Cube_Move **moves, size_t *count);
+int  reduction_solve_cancellable(const Cube_State *s, Rubiks_Cube_Move **moves, size_t *count, const atomic_int *cancel);
+
+#endif // _REDUCTION_H_
\ No newline at end of file
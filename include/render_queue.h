@@ -0,0 +1,164 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include "color.h"
+#include "glad/gl.h"
+#include "shader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RENDER_CAPTURE_MAGIC   "RCRQ"
+#define RENDER_CAPTURE_VERSION 4
+
+// most bytes a frame can stream, commands and uniform buffer updates beyond it are dropped
+#ifndef RENDER_STREAM_REGION_SIZE
+#   define RENDER_STREAM_REGION_SIZE (1u << 20)
+#endif
+
+// Passes are executed in this order, each one sets the depth, culling and blending state it needs
+typedef enum {
+    RENDER_PASS_OPAQUE,     // depth tested, back faces culled, front to back
+    RENDER_PASS_OVERLAY,    // blended on top of everything without depth, commands should not overlap
+    RENDER_PASS_COUNT,
+} Render_Pass;
+
+// Draw call submitted by a subsystem. Commands are executed sorted by their key, which orders them by
+// pass, program, texture and depth, so consecutive commands share as much state as possible.
+typedef struct {
+    uint64_t key;
+    uint32_t sequence;      // submission order, commands with the same key keep it
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint texture;         // bound to texture unit 0, nothing is bound if 0
+    GLenum mode;
+    GLsizei count;          // vertices, or indices if index_type is set
+    GLenum index_type;      // type of the indices in the element buffer of the vertex array, 0 to draw vertices
+
+    uint32_t uniforms;      // uniform block from render_queue_begin_uniforms(), 0 if none
+
+    // vertices built for this frame, written to the stream buffer before drawing, see render_queue_stream_buffer()
+    uint32_t stream_offset;
+    uint32_t stream_size;
+    GLsizei stream_stride;  // bytes per vertex
+} Render_Command;
+
+typedef struct {
+    GLint location;
+    GLenum type;            // GL_FLOAT_MAT4, GL_FLOAT_VEC4 or GL_UNSIGNED_INT
+    uint32_t offset;        // first float in the uniform data of the frame, unsigned ints are stored bitwise
+} Render_Uniform;
+
+// Uniforms of one program set together, before the first command using the block
+typedef struct {
+    GLuint program;
+    uint32_t first;
+    uint32_t count;
+} Render_Uniform_Block;
+
+// Uniform block contents of the frame, written to the stream buffer and bound to the binding point before the first command
+typedef struct {
+    GLuint binding;
+    uint32_t offset;        // first byte in the stream of the frame
+    uint32_t size;
+} Render_Buffer_Update;
+
+// Everything needed to execute the commands of a frame, captures store it as it is.
+typedef struct {
+    Render_Command *commands;
+    size_t command_count, command_capacity;
+
+    Render_Uniform *uniforms;
+    size_t uniform_count, uniform_capacity;
+    Render_Uniform_Block *blocks;
+    size_t block_count, block_capacity;
+    float *uniform_data;
+    size_t uniform_data_count, uniform_data_capacity;
+
+    Render_Buffer_Update *buffer_updates;
+    size_t buffer_update_count, buffer_update_capacity;
+
+    uint8_t *stream;
+    size_t stream_size, stream_capacity;
+} Render_Frame;
+
+// GL object referenced by a capture, sorted by kind, scope and id
+typedef struct {
+    uint32_t kind;
+    uint32_t scope;         // program of a uniform, 0 otherwise
+    uint32_t id;            // name or uniform location when captured
+    uint32_t replay;        // name or uniform location in the replay
+} Render_Object;
+
+typedef struct {
+    Render_Object *objects;
+    size_t count, capacity;
+} Render_Object_Map;
+
+// A capture starts with this header, followed by chunks. Every GL object is stored in a chunk before
+// the first frame using it: programs with their shader sources, uniform values and uniform block bindings,
+// buffers with their contents at that time, vertex arrays with their attributes and textures with their pixels.
+// A buffer is stored again before the next frame whenever render_queue_buffer_changed() was called for it.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t viewport[4];
+    uint32_t stream_buffer; // stands for the stream buffer of the replay in vertex arrays, its contents are not stored
+    uint32_t reserved;
+} Render_Capture_Header;
+
+typedef enum {
+    RENDER_CHUNK_PROGRAM,
+    RENDER_CHUNK_BUFFER,
+    RENDER_CHUNK_VERTEX_ARRAY,
+    RENDER_CHUNK_TEXTURE,
+    RENDER_CHUNK_FRAME,
+} Render_Chunk_Type;
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t size;          // bytes following the chunk header
+} Render_Chunk;
+
+// contents of a buffer chunk, uploaded before the frame following the chunk is replayed
+typedef struct {
+    GLuint buffer;
+    GLenum usage;
+    size_t frame;
+    uint64_t size;
+    void *data;
+} Render_Buffer_Upload;
+
+// Captured frames with the GL objects recreated for them, replaying needs no simulation.
+typedef struct {
+    Render_Frame *frames;
+    size_t frame_count, frame_capacity;
+    Render_Buffer_Upload *uploads;      // in the order of their frames
+    size_t upload_count, upload_capacity;
+    int32_t viewport[4];
+    Render_Object_Map objects;
+} Render_Capture;
+
+uint32_t render_queue_begin_uniforms(Shader_Program *prog);
+void render_queue_uniform_mat4(Shader_Uniform u, const float *val);
+void render_queue_uniform_color(Shader_Uniform u, Color col);
+void render_queue_uniform_uint(Shader_Uniform u, uint32_t val);
+void render_queue_submit(Render_Pass pass, float depth, Render_Command cmd);
+void render_queue_submit_stream(Render_Pass pass, float depth, Render_Command cmd, const void *vertices, uint32_t size);
+void render_queue_update_buffer(GLuint binding, const void *data, uint32_t size);
+GLuint render_queue_stream_buffer(void);
+void render_queue_buffer_changed(GLuint buffer);
+void render_queue_flush(void);
+void render_queue_free(void);
+
+int  render_queue_capture_begin(const char *path);
+void render_queue_capture_end(void);
+int  render_queue_is_capturing(void);
+
+Render_Capture *render_capture_load(const char *path);
+void render_capture_benchmark(Render_Capture *c, uint64_t repeats);
+void render_capture_free(Render_Capture *c);
+
+#endif // _RENDER_QUEUE_H_
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef _SCRAMBLE_H_
+#define _SCRAMBLE_H_
+
+#include "move.h"
+#include "random.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+int      scramble(Random *r, uint64_t n, Rubiks_Cube_Move **moves, size_t *count);
+int      scramble_random_state(Random *r, uint64_t n, Rubiks_Cube_Move **moves, size_t *count);
+size_t   scramble_random_moves(Random *r, uint64_t n, size_t length, Rubiks_Cube_Move *moves);
+uint64_t scramble_length(uint64_t n);
+int      scramble_bulk(FILE *out, uint64_t n, uint64_t count, uint64_t seed, int thread_count);
+
+#endif // _SCRAMBLE_H_
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SESSION_MAGIC         "RCSR"
+#define SESSION_FOOTER_MAGIC  "RCSI"
+#define SESSION_VERSION       1
+
+// Recording of the moves of a session, written as a stream and read back through a memory mapping.
+//
+//  header
+//  records                     moves and checkpoints, every record starts with varint(delta time << 1 | is checkpoint)
+//                                  move:       varint(move_pack(move))
+//                                  checkpoint: the stickers of the state, two per byte, low nibble first
+//  checkpoints[count]          index of all checkpoints, starts at the next multiple of 8
+//  footer
+//
+// Times are in milliseconds and stored relative to the previous record. A checkpoint is written at the
+// start, every checkpoint_interval moves and whenever the state is replaced without a move. If the footer
+// is missing, because the recording was not closed, the reader rebuilds the index from the records.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t n;
+    uint32_t checkpoint_interval;
+    uint32_t reserved;
+} Session_Header;
+
+typedef struct {
+    uint64_t offset;    // first byte of the stickers
+    uint64_t time;
+    uint64_t move;      // number of moves before the checkpoint
+} Session_Checkpoint;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t checkpoint_count;
+    uint64_t move_count;
+    uint64_t duration;  // time of the last record
+    uint64_t records_end;
+    char magic[4];
+    uint32_t reserved;
+} Session_Footer;
+
+typedef struct {
+    FILE *f;
+    uint64_t offset;    // bytes written so far
+
+    Cube_State *state;  // state after the last record, stored at checkpoints
+    uint8_t *packed;    // scratch memory for packing the stickers
+    uint32_t interval;
+    uint64_t since_checkpoint;
+
+    uint64_t time;
+    uint64_t move_count;
+
+    Session_Checkpoint *checkpoints;
+    size_t checkpoint_count;
+    size_t checkpoint_capacity;
+} Session_Writer;
+
+// position in the records, time and move are the ones of the last record read
+typedef struct {
+    uint64_t offset;
+    uint64_t time;
+    uint64_t move;
+} Session_Cursor;
+
+typedef struct {
+    const Session_Header *header;
+    const uint8_t *data;
+    uint64_t end;       // end of the records
+
+    const Session_Checkpoint *checkpoints;
+    uint64_t checkpoint_count;
+    uint64_t move_count;
+    uint64_t duration;
+
+    Session_Checkpoint *recovered;  // index rebuilt from the records if the footer is missing
+    size_t size;
+    int mapped;
+} Session_Reader;
+
+Session_Writer *session_writer(const char *path, const Cube_State *start, uint64_t time, uint32_t checkpoint_interval);
+int  session_writer_move(Session_Writer *w, Rubiks_Cube_Move m, uint64_t time);
+int  session_writer_checkpoint(Session_Writer *w, const Cube_State *s, uint64_t time);
+int  session_writer_close(Session_Writer *w);
+
+Session_Reader *session_reader_open(const char *path);
+void session_reader_close(Session_Reader *r);
+int  session_reader_seek(const Session_Reader *r, uint64_t time, Cube_State *s, Session_Cursor *c);
+int  session_reader_next(const Session_Reader *r, Session_Cursor *c, Cube_State *s, Rubiks_Cube_Move *m);
+
+#endif // _SESSION_H_
\ No newline at end of file
@@ -3,33 +3,61 @@
 
 #include "glad/gl.h"
 #include "color.h"
+#include "mat.h"
 
 #include <stddef.h>
 
-#ifndef SHADER_MAX_UNIFORMS
-#   define SHADER_MAX_UNIFORMS 10
-#endif 
+// Uniform handle, resolved once by shader_register_uniform() so setting a uniform needs no lookup.
+// A location of -1 is a uniform the program does not use, setting it does nothing.
+typedef struct {
+    GLint location;
+    GLenum type;
+} Shader_Uniform;
+
+// Uniform blocks shared by every program, the value is the binding point of the block.
+// shader_new() binds the blocks a program declares, so their data is set once for all programs.
+typedef enum {
+    SHADER_BLOCK_CAMERA,    // "Camera", see Shader_Camera
+    SHADER_BLOCK_PALETTE,   // "Palette", see Shader_Palette
 
-#ifndef SHADER_MAX_UNIFORM_NAME_LENGTH
-#   define SHADER_MAX_UNIFORM_NAME_LENGTH 128
-#endif
+    SHADER_BLOCK_COUNT,
+} Shader_Block;
+
+// std140 layout of the Camera block, matrices are stored like they are passed to glUniformMatrix4fv()
+typedef struct {
+    Mat4 view;
+    Mat4 proj;
+    Mat4 screen;            // orthographic projection in pixels, for text
+    float time;             // seconds since the start
+    float padding[3];
+} Shader_Camera;
 
-// TODO: dynamically allocate uniforms ?
+#define SHADER_PALETTE_SIZE 8
+
+// std140 layout of the Palette block, colors the vertices refer to by index
+typedef struct {
+    Color colors[SHADER_PALETTE_SIZE];
+} Shader_Palette;
 
 typedef struct {
     GLuint id;
-    GLuint uniform_locations[SHADER_MAX_UNIFORMS];
-    char uniform_strings[SHADER_MAX_UNIFORMS][SHADER_MAX_UNIFORM_NAME_LENGTH];
+
+    // every registered uniform, only used for registering and error messages
+    Shader_Uniform *uniforms;
+    char **uniform_names;
     size_t uniform_count;
+    size_t uniform_capacity;
 } Shader_Program;
 
 Shader_Program *shader_new(const char *vertex_path, const char *fragment_path);
-void shader_register_uniform(Shader_Program *prog, const char *name);
-void shader_set_uniform_mat4(Shader_Program *prog, const char *name, float *val, GLboolean transpose);
-void shader_set_uniform_color(Shader_Program *prog, const char *name, Color col);
-void shader_set_uniform_sampler2D(Shader_Program *prog, const char *name, unsigned int textureID);
+Shader_Uniform shader_register_uniform(Shader_Program *prog, const char *name, GLenum type);
+void shader_set_uniform_mat4(Shader_Program *prog, Shader_Uniform u, const float *val, GLboolean transpose);
+void shader_set_uniform_float(Shader_Program *prog, Shader_Uniform u, float val);
+void shader_set_uniform_color(Shader_Program *prog, Shader_Uniform u, Color col);
+void shader_set_uniform_sampler2D(Shader_Program *prog, Shader_Uniform u, GLint texture_unit);
 void shader_bind(Shader_Program *prog);
 void shader_unbind(Shader_Program *prog);
 void shader_free(Shader_Program *prog);
+void shader_update_block(Shader_Block block, const void *data, size_t size);
 
 #endif // _SHADER_H_
\ No newline at end of file
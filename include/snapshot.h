@@ -0,0 +1,24 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "cube_state.h"
+
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC   "RCSS"
+#define SNAPSHOT_VERSION 1
+
+// Logical state of a cube stored in a file, the header is followed by the stickers packed with cube_state_pack().
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t n;
+    uint64_t size;      // bytes of packed stickers
+    uint32_t checksum;  // CRC-32 of the packed stickers
+    uint32_t reserved;
+} Snapshot_Header;
+
+int snapshot_save(const char *path, const Cube_State *s);
+Cube_State *snapshot_load(const char *path);
+
+#endif // _SNAPSHOT_H_
\ No newline at end of file
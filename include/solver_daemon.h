@@ -0,0 +1,24 @@
+#ifndef _SOLVER_DAEMON_H_
+#define _SOLVER_DAEMON_H_
+
+// Line based protocol, every request is answered with one line starting with the id of the request.
+// Requests may be sent in batches without waiting, responses are sent as soon as a worker finishes,
+// so they can arrive in a different order.
+//
+//  <id> SOLVE <facelets>           solve a cube given as facelet string (see cube_state_from_facelets())
+//  <id> SCRAMBLE <n> <moves...>    solve a NxNxN cube scrambled with the given moves
+//  <id> STATS                      solve counters, latency and throughput
+//
+//  <id> OK <move count> <moves...>
+//  <id> OK solved=<count> failed=<count> pending=<count> avg_ms=<latency> max_ms=<latency> solves_per_sec=<throughput>
+//  <id> ERR <message>
+//
+// Cubes larger than SOLVER_DAEMON_MAX_N are rejected, so a single request cannot take all memory.
+
+#ifndef SOLVER_DAEMON_MAX_N
+#   define SOLVER_DAEMON_MAX_N 64
+#endif
+
+int solver_daemon_run(const char *socket_path, int worker_count);
+
+#endif // _SOLVER_DAEMON_H_
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef _STICKER_MESH_H_
+#define _STICKER_MESH_H_
+
+#include "cube_state.h"
+#include "glad/gl.h"
+#include "move.h"
+#include "vertex.h"
+
+#include <stdint.h>
+
+// stickers along both sides of a tile of a face
+#ifndef STICKER_TILE_SIZE
+#   define STICKER_TILE_SIZE 16
+#endif
+
+// Square of stickers of one face, meshed on its own so a move only meshes the tiles it touches again.
+typedef struct {
+    uint64_t face, row, col;    // first sticker, see cube_state_sticker_index()
+    uint64_t rows, cols;
+    uint64_t first_quad;        // in Sticker_Mesh.verts, there is room for one quad per sticker
+    uint64_t packed_quad;       // in Sticker_Mesh.packed and the vertex buffer
+    uint64_t quad_count;
+    int dirty;
+} Sticker_Tile;
+
+// Every face of an idle cube with same colored stickers merged into as few rectangles as possible,
+// in cube space like the static mesh of the cube. The borders are drawn by the fragment shader, so a
+// solved face only needs one quad per tile. Quads are not merged across tiles.
+typedef struct {
+    uint64_t n;
+    float half;     // distance of the faces from the center of the cube
+    float pitch;    // distance between the stickers of neighbouring cubies
+    float scale;    // vertex positions are divided by it, see sticker_vertex()
+
+    Sticker_Tile *tiles;
+    uint64_t tile_count;
+    uint64_t tiles_per_side;    // tiles along a side of a face
+    int dirty;                  // at least one tile is dirty
+
+    Sticker_Vertex *verts;      // 4 per quad, in the ranges of the tiles
+    Sticker_Vertex *packed;     // the quads of every tile one after another, like in the vertex buffer
+    uint8_t *merged;            // scratch, stickers of a tile that are already part of a quad
+    uint64_t quad_count;        // of every tile
+    uint64_t quad_capacity;     // quads packed and the vertex and index buffers hold
+    GLsizei index_count;
+    GLenum index_type;
+    GLuint vao, vbo, ebo;
+} Sticker_Mesh;
+
+int  sticker_mesh(Sticker_Mesh *m, uint64_t n, float half, float pitch, float scale);
+void sticker_mesh_mark_slice(Sticker_Mesh *m, Rubiks_Cube_Face face, uint64_t slice);
+void sticker_mesh_mark_all(Sticker_Mesh *m);
+void sticker_mesh_update(Sticker_Mesh *m, const Cube_State *s);
+void sticker_mesh_free(Sticker_Mesh *m);
+
+#endif // _STICKER_MESH_H_
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef _STREAM_BUFFER_H_
+#define _STREAM_BUFFER_H_
+
+#include "glad/gl.h"
+
+#include <stdint.h>
+
+#define STREAM_BUFFER_REGIONS 3
+#define STREAM_BUFFER_FULL    UINT32_MAX
+
+// Buffer for data the CPU writes every frame. With GL 4.4 or ARB_buffer_storage it stays mapped and is split
+// into regions used one frame after the other. A region is only written again once the fence of the frame
+// that used it is signaled, so writing never waits for draws that still read the buffer.
+// Without persistent mapping the writes of a frame are collected and stream_buffer_commit() uploads them
+// into freshly orphaned storage, the driver then keeps the old storage alive for pending draws.
+typedef struct {
+    GLuint buffer;
+    uint32_t region_size;
+    uint32_t region;        // region of the current frame
+    uint32_t offset;        // next free byte in the region
+    GLsync fences[STREAM_BUFFER_REGIONS];
+
+    uint8_t *mapped;        // whole buffer, NULL if it could not be mapped persistently
+    uint8_t *staging;       // writes of the frame if the buffer is not mapped
+} Stream_Buffer;
+
+int  stream_buffer(Stream_Buffer *sb, uint32_t region_size);
+uint32_t stream_buffer_write(Stream_Buffer *sb, const void *data, uint32_t size, uint32_t alignment);
+void stream_buffer_commit(Stream_Buffer *sb);
+void stream_buffer_end_frame(Stream_Buffer *sb);
+void stream_buffer_free(Stream_Buffer *sb);
+
+#endif // _STREAM_BUFFER_H_
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef _SYMMETRY_H_
+#define _SYMMETRY_H_
+
+#include "cube_state.h"
+#include "move.h"
+
+#include <stdint.h>
+
+// 24 rotations and 24 reflections of the cube, symmetry 0 is the identity
+#define SYMMETRY_COUNT 48
+
+// Conjugation tables of a NxNxN cube for every symmetry. The state conjugated by symmetry s is the state
+// seen through s: every sticker moves to its mirrored/rotated position and gets the color of the mapped face.
+typedef struct {
+    uint64_t n;
+    uint64_t size;  // number of stickers, 6*n*n
+
+    // sticker i of the conjugated state is colors[s][stickers[src[s*size + i]]]
+    uint64_t *src;
+    uint8_t colors[SYMMETRY_COUNT][FACE_COUNT];
+
+    int8_t  matrix[SYMMETRY_COUNT][3][3];   // signed permutation matrix acting on x, y, z
+    uint8_t inverse[SYMMETRY_COUNT];
+    uint8_t mirror[SYMMETRY_COUNT];         // reflections reverse the direction of every turn
+} Cube_Symmetry;
+
+Cube_Symmetry *cube_symmetry(uint64_t n);
+void cube_symmetry_apply(const Cube_Symmetry *cs, int sym, const Cube_State *s, Cube_State *out);
+Rubiks_Cube_Move cube_symmetry_move(const Cube_Symmetry *cs, int sym, Rubiks_Cube_Move m);
+int  cube_symmetry_canonical(const Cube_Symmetry *cs, const Cube_State *s, Cube_State *out);
+void cube_symmetry_free(Cube_Symmetry *cs);
+
+#endif // _SYMMETRY_H_
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef _THISTLETHWAITE_H_
+#define _THISTLETHWAITE_H_
+
+#include "cube3.h"
+#include "move.h"
+
+#include <stdint.h>
+
+// upper bound for the length of a solution, the phases need at most 7, 10, 13 and 15 moves
+#define THISTLETHWAITE_MAX_LENGTH 45
+#define THISTLETHWAITE_PHASE_COUNT 4
+
+// number of coordinates of each phase
+#define THISTLETHWAITE_PHASE1_SIZE 2048                 // edge orientation
+#define THISTLETHWAITE_PHASE2_SIZE (2187 * 495)         // corner orientation, UD-slice edge positions
+#define THISTLETHWAITE_PHASE3_SIZE (40320 * 70)         // corner permutation, M-slice edge positions
+#define THISTLETHWAITE_PHASE4_SIZE (96 * 24 * 24 * 24)  // half turn corner permutation, edge permutation in every slice
+
+// Distance tables store the distance to the goal of the phase modulo 3, four coordinates per byte.
+// They are generated by tools/thistlethwaite_gen.c at build time and compiled into the binary.
+#define THISTLETHWAITE_TABLE_BYTES(size) (((size) + 3) / 4)
+
+extern const uint8_t thistlethwaite_table_phase1[THISTLETHWAITE_TABLE_BYTES(THISTLETHWAITE_PHASE1_SIZE)];
+extern const uint8_t thistlethwaite_table_phase2[THISTLETHWAITE_TABLE_BYTES(THISTLETHWAITE_PHASE2_SIZE)];
+extern const uint8_t thistlethwaite_table_phase3[THISTLETHWAITE_TABLE_BYTES(THISTLETHWAITE_PHASE3_SIZE)];
+extern const uint8_t thistlethwaite_table_phase4[THISTLETHWAITE_TABLE_BYTES(THISTLETHWAITE_PHASE4_SIZE)];
+
+void thistlethwaite_init(void);
+int  thistlethwaite_solve(const Cube3 *c, Rubiks_Cube_Move *moves);
+
+// phase description, shared with the table generator
+int  thistlethwaite_phase_size(int phase);
+int  thistlethwaite_phase_moves(int phase, const int **moves);
+int  thistlethwaite_coordinate(const Cube3 *c, int phase);
+int  thistlethwaite_is_goal(const Cube3 *c, int phase);
+int  thistlethwaite_corner_group_size(void);
+int  thistlethwaite_corner_group_perm(int index, uint8_t *cp);
+
+#endif // _THISTLETHWAITE_H_
\ No newline at end of file
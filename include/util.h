@@ -6,5 +6,8 @@
 char *read_file(const char *path);
 int  write_file(const char *path, const char *content, size_t length);
 int  append_file(const char *path, const char *content, size_t length);
+void *map_file(const char *path, size_t *size, int *mapped);
+void unmap_file(void *data, size_t size, int mapped);
+int  cpu_count(void);
 
 #endif // _UTIL_H_
\ No newline at end of file
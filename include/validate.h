@@ -0,0 +1,10 @@
+#ifndef _VALIDATE_H_
+#define _VALIDATE_H_
+
+#include "cube_state.h"
+
+// Checks that s can be reached from the solved state with moves, in time linear in the sticker count.
+// Returns 0 for impossible states and points reason (if not NULL) to a static description.
+int validate_state(const Cube_State *s, const char **reason);
+
+#endif // _VALIDATE_H_
\ No newline at end of file
@@ -2,19 +2,45 @@
 #define _VERTEX_H_
 
 #include "color.h"
+#include "glad/gl.h"
 #include "vec.h"
 
+#include <stdint.h>
+
 typedef enum {
     CUBE_VERTEX_POS,
     CUBE_VERTEX_COL,
 } Cube_Vertex_Attributes;
 
+// 8 bytes instead of a float position and color. The position is relative to the mesh and divided by
+// the scale given to cube_vertex(), the model matrix scales it back. The color is looked up in the palette block.
 typedef struct {
-    Vec3  pos;
-    Color col;
+    int16_t pos[3];     // normalized, -32767 and 32767 are -scale and scale
+    uint8_t col;        // Cube_Color, index into the palette
+    uint8_t padding;
 } Cube_Vertex;
 
-Cube_Vertex cube_vertex(Vec3 pos, Color col);
+Cube_Vertex cube_vertex(Vec3 pos, float scale, uint8_t col);
+Vec3 cube_vertex_position(Cube_Vertex v, float scale);
+void cube_vertex_attributes(void);
+
+typedef enum {
+    STICKER_VERTEX_POS,
+    STICKER_VERTEX_COL,
+    STICKER_VERTEX_CELL,
+} Sticker_Vertex_Attributes;
+
+// Corner of a quad covering several stickers, the position is stored like in Cube_Vertex.
+// The cell counts stickers along the face, the fragment shader draws a border around every whole cell.
+typedef struct {
+    int16_t pos[3];
+    uint8_t col;        // Cube_Color, index into the palette
+    uint8_t padding;
+    uint16_t cell[2];
+} Sticker_Vertex;
+
+Sticker_Vertex sticker_vertex(Vec3 pos, float scale, uint8_t col, uint16_t u, uint16_t v);
+void sticker_vertex_attributes(void);
 
 typedef enum {
     FONT_VERTEX_POS,
@@ -23,6 +23,7 @@ void  window_clear(void);
 void  window_main_loop(Render_Function render_frame);
 float window_get_frame_time(void);
 void  window_set_fps(int fps);
+const char *window_get_clipboard(void);
 void  window_close(void);
 
 
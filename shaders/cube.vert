@@ -1,14 +1,27 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec4 aColor;
+layout (location = 1) in uint aColor;
 
 out vec4 vertColor;
 
-uniform mat4 mvp;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 screen;
+    float time;
+};
+
+layout (std140) uniform Palette {
+    vec4 colors[8];
+};
+
+uniform mat4 model;
+uniform uint faces;     // color of every face of the cubie, 3 bits each
 
 void main()
 {
     // using row-column matrices
-    gl_Position = vec4(aPos, 1.0) * mvp;
-    vertColor   = aColor;
+    gl_Position = vec4(aPos, 1.0) * model * view * proj;
+    // the mesh stores the face a vertex belongs to, 0 is the border
+    vertColor   = colors[aColor == 0u ? 0u : (faces >> (3u * (aColor - 1u))) & 7u];
 }
\ No newline at end of file
@@ -4,10 +4,15 @@ layout (location = 1) in vec2 tex;
 
 out vec2 texCoords;
 
-uniform mat4 proj;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 screen;
+    float time;
+};
 
 void main()
 {
-    gl_Position = proj * vec4(pos, -1.0, 1.0);
+    gl_Position = screen * vec4(pos, -1.0, 1.0);
     texCoords = tex;
 } 
\ No newline at end of file
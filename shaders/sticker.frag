@@ -0,0 +1,21 @@
+#version 330 core
+
+layout(location = 0) out vec4 diffuseColor;
+
+in vec2 cell;
+flat in uint color;
+
+layout (std140) uniform Palette {
+    vec4 colors[8];
+};
+
+uniform float border;   // width of the border around every sticker, relative to a cubie
+
+void main()
+{
+    // a quad covers several stickers, every whole cell is one of them
+    vec2 f = fract(cell);
+    bool edge = any(lessThan(f, vec2(border))) || any(greaterThan(f, vec2(1.0 - border)));
+
+    diffuseColor = colors[edge ? 0u : color];
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in uint aColor;
+layout (location = 2) in vec2 aCell;
+
+out vec2 cell;
+flat out uint color;
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 screen;
+    float time;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    // using row-column matrices
+    gl_Position = vec4(aPos, 1.0) * model * view * proj;
+    cell        = aCell;
+    color       = aColor;
+}
\ No newline at end of file
@@ -0,0 +1,474 @@
+#include "alg_db.h"
+
+#include "logging.h"
+#include "util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const uint32_t *moves;
+    uint32_t length;
+} Sorted_Algorithm;
+
+static int  write_database(const char *path, uint64_t n, const Sorted_Algorithm *sorted, uint32_t count, size_t total);
+static uint32_t build_trie(const Sorted_Algorithm *sorted, uint32_t count, Alg_Db_Node *nodes, uint32_t *depths);
+static uint32_t build_entries(const Sorted_Algorithm *sorted, uint32_t count, Cube_State *s, Alg_Db_Entry *entries);
+static void apply_auf(Cube_State *s, int quarter_turns);
+static int  compare_algorithms(const void *a, const void *b);
+static int  compare_entries(const void *a, const void *b);
+static uint64_t align8(uint64_t offset);
+static int  valid_sections(const Alg_Db *db);
+
+// Writes the algorithms to a database for NxNxN cubes, duplicates are stored once.
+int alg_db_build(const char *path, uint64_t n, Rubiks_Cube_Move **algorithms, const size_t *lengths, size_t count)
+{
+    Sorted_Algorithm *sorted;
+    uint32_t *codes, unique;
+    size_t i, j, k, total;
+    int ok;
+
+    if (n == 0 || n >= (1u << 27)) {
+        log_error("Cannot build an algorithm database for side length %" PRIu64, n);
+        return 0;
+    }
+
+    total = 0;
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < lengths[i]; j++) {
+            if (algorithms[i][j].slice >= n) {
+                log_error("Algorithm %zu has a move outside of a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube", i + 1, n, n, n);
+                return 0;
+            }
+        }
+        total += lengths[i];
+    }
+
+    if (count >= UINT32_MAX || total >= UINT32_MAX) {
+        log_error("Too many algorithms for one database");
+        return 0;
+    }
+
+    codes  = (uint32_t *) malloc((total + 1) * sizeof (uint32_t));
+    sorted = (Sorted_Algorithm *) malloc((count + 1) * sizeof (Sorted_Algorithm));
+    if (codes == NULL || sorted == NULL) {
+        log_error("Failed to allocate memory for %zu algorithms", count);
+        if (codes != NULL) free(codes);
+        if (sorted != NULL) free(sorted);
+        return 0;
+    }
+
+    k = 0;
+    for (i = 0; i < count; i++) {
+        sorted[i].moves = &codes[k];
+        sorted[i].length = lengths[i];
+        for (j = 0; j < lengths[i]; j++)
+            codes[k++] = (uint32_t) move_pack(algorithms[i][j]);
+    }
+
+    qsort(sorted, count, sizeof (Sorted_Algorithm), compare_algorithms);
+
+    unique = 0;
+    for (i = 0; i < count; i++) {
+        if (unique > 0 && compare_algorithms(&sorted[unique-1], &sorted[i]) == 0) continue;
+        sorted[unique++] = sorted[i];
+    }
+
+    ok = write_database(path, n, sorted, unique, total);
+
+    free(codes);
+    free(sorted);
+    return ok;
+}
+
+// Maps the database into memory. Besides the header and the section bounds every index into another section
+// is checked once, so the lookups never read outside the file.
+Alg_Db *alg_db_open(const char *path)
+{
+    Alg_Db *db;
+    const Alg_Db_Header *h;
+    uint64_t end;
+
+    db = (Alg_Db *) calloc(1, sizeof (Alg_Db));
+    if (db == NULL) {
+        log_error("Failed to allocate memory for algorithm database");
+        return NULL;
+    }
+
+    db->data = map_file(path, &db->size, &db->mapped);
+    if (db->data == NULL) {
+        if (errno == ENOENT) log_info("No algorithm database at \'%s\'", path);
+        else log_error("Failed to map algorithm database \'%s\': %s", path, strerror(errno));
+        free(db);
+        return NULL;
+    }
+
+    h = (const Alg_Db_Header *) db->data;
+    if (db->size < sizeof (Alg_Db_Header) || memcmp(h->magic, ALG_DB_MAGIC, sizeof (h->magic)) != 0 || h->version != ALG_DB_VERSION) {
+        log_error("\'%s\' is not an algorithm database of version %d", path, ALG_DB_VERSION);
+        alg_db_close(db);
+        return NULL;
+    }
+
+    end = h->buckets_offset + (((uint64_t) 1 << h->bucket_bits) + 1) * sizeof (uint32_t);
+    if (h->bucket_bits > 30 || end > db->size ||
+        h->offsets_offset + (h->algorithm_count + 1) * sizeof (uint32_t) > h->moves_offset ||
+        h->moves_offset   + h->move_count  * sizeof (uint32_t)    > h->nodes_offset ||
+        h->nodes_offset   + h->node_count  * sizeof (Alg_Db_Node)  > h->entries_offset ||
+        h->entries_offset + h->entry_count * sizeof (Alg_Db_Entry) > h->buckets_offset ||
+        h->offsets_offset % 8 != 0 || h->moves_offset % 8 != 0 || h->nodes_offset % 8 != 0 ||
+        h->entries_offset % 8 != 0 || h->buckets_offset % 8 != 0 || h->node_count == 0) {
+        log_error("Algorithm database \'%s\' is corrupted", path);
+        alg_db_close(db);
+        return NULL;
+    }
+
+    db->header  = h;
+    db->offsets = (const uint32_t *)     ((const uint8_t *) db->data + h->offsets_offset);
+    db->moves   = (const uint32_t *)     ((const uint8_t *) db->data + h->moves_offset);
+    db->nodes   = (const Alg_Db_Node *)  ((const uint8_t *) db->data + h->nodes_offset);
+    db->entries = (const Alg_Db_Entry *) ((const uint8_t *) db->data + h->entries_offset);
+    db->buckets = (const uint32_t *)     ((const uint8_t *) db->data + h->buckets_offset);
+
+    if (!valid_sections(db)) {
+        log_error("Algorithm database \'%s\' is corrupted", path);
+        alg_db_close(db);
+        return NULL;
+    }
+
+    log_info("Loaded %" PRIu32 " algorithms for the %" PRIu32 "x%" PRIu32 "x%" PRIu32 " from \'%s\'", h->algorithm_count, h->n, h->n, h->n, path);
+
+    return db;
+}
+
+void alg_db_close(Alg_Db *db)
+{
+    if (db == NULL) return;
+
+    unmap_file(db->data, db->size, db->mapped);
+
+    free(db);
+}
+
+size_t alg_db_length(const Alg_Db *db, uint32_t algorithm)
+{
+    if (algorithm >= db->header->algorithm_count) return 0;
+    return db->offsets[algorithm + 1] - db->offsets[algorithm];
+}
+
+// copies at most capacity moves, returns the length of the algorithm
+size_t alg_db_moves(const Alg_Db *db, uint32_t algorithm, Rubiks_Cube_Move *moves, size_t capacity)
+{
+    size_t i, length;
+
+    length = alg_db_length(db, algorithm);
+    for (i = 0; i < length && i < capacity; i++)
+        moves[i] = move_unpack(db->moves[db->offsets[algorithm] + i]);
+
+    return length;
+}
+
+// Formats the algorithm like moves_to_string() without allocating, the string is cut off if it doesn't fit.
+size_t alg_db_format(const Alg_Db *db, uint32_t algorithm, char *str, size_t size)
+{
+    char buf[MOVE_STRING_LENGTH];
+    size_t i, length, written, l;
+
+    if (size == 0) return 0;
+
+    str[0] = '\0';
+    written = 0;
+    length = alg_db_length(db, algorithm);
+    for (i = 0; i < length; i++) {
+        l = move_to_string(move_unpack(db->moves[db->offsets[algorithm] + i]), buf, sizeof (buf));
+        if (written + (i > 0) + l + 1 > size) break;
+
+        if (i > 0) str[written++] = ' ';
+        memcpy(&str[written], buf, l + 1);
+        written += l;
+    }
+
+    return written;
+}
+
+// Walks the trie along the prefix, the algorithms starting with it are first..first+found-1.
+// Returns 0 if no algorithm starts with the prefix.
+int alg_db_prefix(const Alg_Db *db, const Rubiks_Cube_Move *prefix, size_t count, uint32_t *first, uint32_t *found)
+{
+    const Alg_Db_Node *node, *children;
+    uint32_t code, lo, hi, mid;
+    size_t i;
+
+    node = &db->nodes[0];
+    for (i = 0; i < count; i++) {
+        code = (uint32_t) move_pack(prefix[i]);
+        children = &db->nodes[node->children];
+
+        lo = 0;
+        hi = node->child_count;
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (children[mid].move < code) lo = mid + 1;
+            else hi = mid;
+        }
+
+        if (lo == node->child_count || children[lo].move != code) {
+            *first = 0;
+            *found = 0;
+            return 0;
+        }
+        node = &children[lo];
+    }
+
+    *first = node->first;
+    *found = node->count;
+    return node->count > 0;
+}
+
+// Returns the number of entries with the hash, *entries points to the first of them.
+size_t alg_db_find(const Alg_Db *db, uint64_t hash, const Alg_Db_Entry **entries)
+{
+    uint32_t bits, i, end;
+    uint64_t b;
+    size_t count;
+
+    bits = db->header->bucket_bits;
+    b = bits == 0 ? 0 : hash >> (64 - bits);
+
+    end = db->buckets[b + 1];
+    for (i = db->buckets[b]; i < end && db->entries[i].hash < hash; i++);
+
+    *entries = &db->entries[i];
+    for (count = 0; i < end && db->entries[i].hash == hash; i++) count++;
+
+    return count;
+}
+
+// algorithms that solve s, taking turns of the up layer before and after them into account
+size_t alg_db_solving(const Alg_Db *db, const Cube_State *s, const Alg_Db_Entry **entries)
+{
+    if (s->n != db->header->n) {
+        *entries = NULL;
+        return 0;
+    }
+
+    return alg_db_find(db, cube_state_hash(s), entries);
+}
+
+
+static int write_database(const char *path, uint64_t n, const Sorted_Algorithm *sorted, uint32_t count, size_t total)
+{
+    Alg_Db_Header header = {0};
+    Alg_Db_Node *nodes;
+    Alg_Db_Entry *entries;
+    Cube_State *s;
+    uint32_t *offsets, *depths, *buckets, node_count, entry_count, bucket_count, i;
+    uint64_t size, b, k;
+    uint8_t *data;
+    int ok;
+
+    offsets = (uint32_t *) malloc((count + 1) * sizeof (uint32_t));
+    nodes   = (Alg_Db_Node *) malloc((total + 1) * sizeof (Alg_Db_Node));
+    depths  = (uint32_t *) malloc((total + 1) * sizeof (uint32_t));
+    entries = (Alg_Db_Entry *) malloc(((size_t) count * 16 + 1) * sizeof (Alg_Db_Entry));
+    s = cube_state(n);
+
+    ok = offsets != NULL && nodes != NULL && depths != NULL && entries != NULL && s != NULL;
+    if (!ok) log_error("Failed to allocate memory for the algorithm database");
+
+    buckets = NULL;
+    data = NULL;
+    if (ok) {
+        // the moves are written in sorted order, so the algorithms can be read back without sorted[]
+        offsets[0] = 0;
+        for (i = 0; i < count; i++)
+            offsets[i+1] = offsets[i] + sorted[i].length;
+
+        node_count = build_trie(sorted, count, nodes, depths);
+        entry_count = build_entries(sorted, count, s, entries);
+
+        header.bucket_bits = 0;
+        while (header.bucket_bits < 30 && (1u << header.bucket_bits) < entry_count)
+            header.bucket_bits++;
+        bucket_count = 1u << header.bucket_bits;
+
+        memcpy(header.magic, ALG_DB_MAGIC, sizeof (header.magic));
+        header.version         = ALG_DB_VERSION;
+        header.n               = n;
+        header.algorithm_count = count;
+        header.move_count      = offsets[count];
+        header.node_count      = node_count;
+        header.entry_count     = entry_count;
+
+        header.offsets_offset  = align8(sizeof (Alg_Db_Header));
+        header.moves_offset    = align8(header.offsets_offset + (count + 1) * sizeof (uint32_t));
+        header.nodes_offset    = align8(header.moves_offset   + header.move_count * sizeof (uint32_t));
+        header.entries_offset  = align8(header.nodes_offset   + node_count * sizeof (Alg_Db_Node));
+        header.buckets_offset  = align8(header.entries_offset + entry_count * sizeof (Alg_Db_Entry));
+        size = header.buckets_offset + (bucket_count + 1) * sizeof (uint32_t);
+
+        data = (uint8_t *) calloc(size, 1);
+        if (data == NULL) {
+            log_error("Failed to allocate %" PRIu64 " bytes for the algorithm database", size);
+            ok = 0;
+        }
+    }
+
+    if (ok) {
+        memcpy(data, &header, sizeof (header));
+        memcpy(data + header.offsets_offset, offsets, (count + 1) * sizeof (uint32_t));
+        for (i = 0; i < count; i++)
+            memcpy(data + header.moves_offset + offsets[i] * sizeof (uint32_t), sorted[i].moves, sorted[i].length * sizeof (uint32_t));
+        memcpy(data + header.nodes_offset, nodes, node_count * sizeof (Alg_Db_Node));
+        memcpy(data + header.entries_offset, entries, entry_count * sizeof (Alg_Db_Entry));
+
+        // entries are sorted by hash, so the top bits of the hash split them into consecutive buckets
+        buckets = (uint32_t *) (data + header.buckets_offset);
+        k = 0;
+        for (b = 0; b <= bucket_count; b++) {
+            while (k < entry_count && (header.bucket_bits == 0 ? 0 : entries[k].hash >> (64 - header.bucket_bits)) < b) k++;
+            buckets[b] = k;
+        }
+
+        ok = write_file(path, (const char *) data, size);
+        if (ok) log_info("Stored %" PRIu32 " algorithms with %" PRIu32 " trie nodes and %" PRIu32 " states", count, node_count, entry_count);
+    }
+
+    if (data != NULL) free(data);
+    if (offsets != NULL) free(offsets);
+    if (nodes != NULL) free(nodes);
+    if (depths != NULL) free(depths);
+    if (entries != NULL) free(entries);
+    cube_state_free(s);
+
+    return ok;
+}
+
+// Prefix trie in breadth first order, the children of a node get the next free nodes. Returns the node count.
+static uint32_t build_trie(const Sorted_Algorithm *sorted, uint32_t count, Alg_Db_Node *nodes, uint32_t *depths)
+{
+    uint32_t node_count, i, j, k, first, end, d;
+
+    nodes[0] = (Alg_Db_Node) {0, 0, 0, 0, count};
+    depths[0] = 0;
+    node_count = 1;
+    for (i = 0; i < node_count; i++) {
+        first = nodes[i].first;
+        end = first + nodes[i].count;
+        d = depths[i];
+
+        // shorter algorithms come first, the ones that end here have no child
+        while (first < end && sorted[first].length == d) first++;
+
+        nodes[i].children = node_count;
+        for (j = first; j < end; j = k) {
+            for (k = j + 1; k < end && sorted[k].moves[d] == sorted[j].moves[d]; k++);
+
+            nodes[node_count] = (Alg_Db_Node) {sorted[j].moves[d], 0, 0, j, k - j};
+            depths[node_count] = d + 1;
+            node_count++;
+            nodes[i].child_count++;
+        }
+    }
+
+    return node_count;
+}
+
+// The state an algorithm solves is its inverse applied to the solved cube. Returns the entry count.
+static uint32_t build_entries(const Sorted_Algorithm *sorted, uint32_t count, Cube_State *s, Alg_Db_Entry *entries)
+{
+    uint32_t entry_count, first, i, j, k;
+    uint64_t hash;
+    int pre, post;
+
+    entry_count = 0;
+    for (i = 0; i < count; i++) {
+        first = entry_count;
+        for (pre = 0; pre < 4; pre++) {
+            for (post = 0; post < 4; post++) {
+                cube_state_reset(s);
+                apply_auf(s, 4 - post);
+                for (j = sorted[i].length; j > 0; j--)
+                    cube_state_apply_move(s, move_inverse(move_unpack(sorted[i].moves[j-1])));
+                apply_auf(s, 4 - pre);
+
+                // symmetric cases give the same state for different turns
+                hash = cube_state_hash(s);
+                for (k = first; k < entry_count && entries[k].hash != hash; k++);
+                if (k < entry_count) continue;
+
+                entries[entry_count++] = (Alg_Db_Entry) {hash, i, pre, post, 0};
+            }
+        }
+    }
+
+    qsort(entries, entry_count, sizeof (Alg_Db_Entry), compare_entries);
+
+    return entry_count;
+}
+
+static void apply_auf(Cube_State *s, int quarter_turns)
+{
+    quarter_turns %= 4;
+    if (quarter_turns > 0)
+        cube_state_rotate_slice(s, FACE_UP, ROTATION_CW - (quarter_turns - 1), 0);
+}
+
+// lexicographic order of the moves, a prefix comes before the longer algorithm
+static int compare_algorithms(const void *a, const void *b)
+{
+    const Sorted_Algorithm *x = a, *y = b;
+    uint32_t i;
+
+    for (i = 0; i < x->length && i < y->length; i++) {
+        if (x->moves[i] != y->moves[i]) return x->moves[i] < y->moves[i] ? -1 : 1;
+    }
+
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    const Alg_Db_Entry *x = a, *y = b;
+
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return (x->algorithm > y->algorithm) - (x->algorithm < y->algorithm);
+}
+
+static uint64_t align8(uint64_t offset)
+{
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+// offsets and buckets have to be ranges of moves and entries, nodes have to point to nodes and algorithms
+static int valid_sections(const Alg_Db *db)
+{
+    const Alg_Db_Header *h;
+    const Alg_Db_Node *node;
+    uint64_t i, buckets;
+
+    h = db->header;
+
+    for (i = 0; i < h->algorithm_count; i++) {
+        if (db->offsets[i] > db->offsets[i + 1]) return 0;
+    }
+    if (db->offsets[h->algorithm_count] > h->move_count) return 0;
+
+    for (i = 0; i < h->node_count; i++) {
+        node = &db->nodes[i];
+        if ((uint64_t) node->children + node->child_count > h->node_count) return 0;
+        if ((uint64_t) node->first + node->count > h->algorithm_count) return 0;
+    }
+
+    buckets = (uint64_t) 1 << h->bucket_bits;
+    for (i = 0; i < buckets; i++) {
+        if (db->buckets[i] > db->buckets[i + 1]) return 0;
+    }
+    if (db->buckets[buckets] > h->entry_count) return 0;
+
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,674 @@
+#include "cli.h"
+
+#include "alg_db.h"
+#include "logging.h"
+#include "move.h"
+#include "packed_state.h"
+#include "permutation.h"
+#include "scramble.h"
+#include "session.h"
+#include "solver_daemon.h"
+#include "symmetry.h"
+#include "validate.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    int (*run)(int argc, char **argv);
+} Cli_Command;
+
+static int cli_algdb(int argc, char **argv);
+static int algdb_build(const char *path, long n);
+static int algdb_prefix(const char *path, int argc, char **argv);
+static int algdb_solve(const char *path, const char *facelets);
+static int cli_canonical(int argc, char **argv);
+static int cli_daemon(int argc, char **argv);
+static int cli_optimize(int argc, char **argv);
+static int cli_order(int argc, char **argv);
+static int cli_packed(int argc, char **argv);
+static int cli_scramble(int argc, char **argv);
+static int cli_session(int argc, char **argv);
+static int session_record(const char *path, long n, long interval);
+static int session_info(const char *path);
+static int session_seek(const char *path, uint64_t time, int replay);
+static int cli_validate(int argc, char **argv);
+static void cli_usage(const char *program);
+static int  compare_descending(const void *a, const void *b);
+static char *read_line(FILE *f, char **line, size_t *capacity);
+
+static const Cli_Command COMMANDS[] = {
+    {"algdb",    "algdb <build|prefix|solve>   algorithm databases, build them from stdin and look up algorithms by prefix or state", cli_algdb},
+    {"canonical", "canonical                    symmetry reduced representative of every facelet string of stdin", cli_canonical},
+    {"daemon",   "daemon <socket> [workers]    solve requests from a unix socket, see solver_daemon.h", cli_daemon},
+    {"optimize", "optimize [n]                 remove redundant moves of every line of stdin for a NxNxN cube", cli_optimize},
+    {"order",    "order <n> <moves...>         how often the moves have to be repeated on a NxNxN cube and their cycles", cli_order},
+    {"packed",   "packed <n> [file]            apply the moves of stdin to a huge NxNxN cube, kept in the file if given", cli_packed},
+    {"scramble", "scramble <n> [count] [seed]  random state scrambles for the 2x2x2 and 3x3x3, random moves otherwise", cli_scramble},
+    {"session",  "session <record|seek|replay> recordings of moves, record them from stdin and restore the state at any time", cli_session},
+    {"validate", "validate                     check that every facelet string of stdin can be solved", cli_validate},
+};
+
+int cli_main(int argc, char **argv)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof (COMMANDS) / sizeof (COMMANDS[0]); i++) {
+        if (strcmp(argv[1], COMMANDS[i].name) == 0)
+            return COMMANDS[i].run(argc - 2, &argv[2]);
+    }
+
+    if (strcmp(argv[1], "help") != 0 && strcmp(argv[1], "--help") != 0)
+        log_error("Unknown command %s", argv[1]);
+
+    cli_usage(argv[0]);
+    return 1;
+}
+
+
+static int cli_algdb(int argc, char **argv)
+{
+    long n;
+
+    if (argc == 3 && strcmp(argv[0], "build") == 0 && (n = atol(argv[1])) > 0)
+        return algdb_build(argv[2], n);
+    if (argc >= 2 && strcmp(argv[0], "prefix") == 0)
+        return algdb_prefix(argv[1], argc - 2, &argv[2]);
+    if (argc == 3 && strcmp(argv[0], "solve") == 0)
+        return algdb_solve(argv[1], argv[2]);
+
+    fprintf(stderr, "Usage: rcs algdb build <n> <file>          store the algorithms of stdin, one per line\n");
+    fprintf(stderr, "       rcs algdb prefix <file> [moves...]  algorithms starting with the moves\n");
+    fprintf(stderr, "       rcs algdb solve <file> <facelets>   algorithms solving the state with the turns of the up layer around them\n");
+    return 1;
+}
+
+static int algdb_build(const char *path, long n)
+{
+    char *line;
+    size_t capacity, count, allocated, i;
+    Rubiks_Cube_Move **algorithms, **a;
+    size_t *lengths, *l;
+    int ok;
+
+    line = NULL;
+    capacity = 0;
+    algorithms = NULL;
+    lengths = NULL;
+    count = allocated = 0;
+    ok = 1;
+    while (ok && read_line(stdin, &line, &capacity) != NULL) {
+        if (count == allocated) {
+            allocated = allocated == 0 ? 1024 : allocated * 2;
+            a = (Rubiks_Cube_Move **) realloc(algorithms, allocated * sizeof (Rubiks_Cube_Move *));
+            l = (size_t *) realloc(lengths, allocated * sizeof (size_t));
+            if (a != NULL) algorithms = a;
+            if (l != NULL) lengths = l;
+            if (a == NULL || l == NULL) {
+                log_error("Failed to allocate memory for %zu algorithms", allocated);
+                ok = 0;
+                break;
+            }
+        }
+
+        if (!moves_from_string(line, &algorithms[count], &lengths[count])) ok = 0;
+        else count++;
+    }
+
+    if (ok) ok = alg_db_build(path, (uint64_t) n, algorithms, lengths, count);
+
+    for (i = 0; i < count; i++)
+        free(algorithms[i]);
+    if (algorithms != NULL) free(algorithms);
+    if (lengths != NULL) free(lengths);
+    if (line != NULL) free(line);
+
+    return ok ? 0 : 1;
+}
+
+static int algdb_prefix(const char *path, int argc, char **argv)
+{
+    Alg_Db *db;
+    Rubiks_Cube_Move *prefix, *m;
+    size_t count, c;
+    uint32_t first, found, i;
+    char str[1024];
+    int k;
+
+    prefix = NULL;
+    count = 0;
+    for (k = 0; k < argc; k++) {
+        if (!moves_from_string(argv[k], &m, &c)) {
+            if (prefix != NULL) free(prefix);
+            return 1;
+        }
+
+        prefix = (Rubiks_Cube_Move *) realloc(prefix, (count + c + 1) * sizeof (Rubiks_Cube_Move));
+        if (prefix == NULL) {
+            log_error("Failed to allocate memory for moves");
+            free(m);
+            return 1;
+        }
+        memcpy(&prefix[count], m, c * sizeof (Rubiks_Cube_Move));
+        count += c;
+        free(m);
+    }
+
+    db = alg_db_open(path);
+    if (db == NULL) {
+        if (prefix != NULL) free(prefix);
+        return 1;
+    }
+
+    alg_db_prefix(db, prefix, count, &first, &found);
+    for (i = first; i < first + found; i++) {
+        alg_db_format(db, i, str, sizeof (str));
+        printf("%s\n", str);
+    }
+
+    alg_db_close(db);
+    if (prefix != NULL) free(prefix);
+
+    return 0;
+}
+
+static int algdb_solve(const char *path, const char *facelets)
+{
+    static const char *PRE_AUF[4]  = {"", "U ", "U2 ", "U' "};
+    static const char *POST_AUF[4] = {"", " U", " U2", " U'"};
+    const Alg_Db_Entry *entries;
+    Cube_State *s;
+    Alg_Db *db;
+    size_t count, i;
+    char str[1024];
+
+    s = cube_state_from_facelets(facelets);
+    if (s == NULL) return 1;
+
+    db = alg_db_open(path);
+    if (db == NULL) {
+        cube_state_free(s);
+        return 1;
+    }
+
+    count = alg_db_solving(db, s, &entries);
+    for (i = 0; i < count; i++) {
+        alg_db_format(db, entries[i].algorithm, str, sizeof (str));
+        printf("%s%s%s\n", PRE_AUF[entries[i].pre_auf], str, POST_AUF[entries[i].post_auf]);
+    }
+
+    alg_db_close(db);
+    cube_state_free(s);
+
+    return 0;
+}
+
+// Filter from stdin to stdout, prints the canonical facelets and the symmetry that leads to them.
+// Symmetric states give the same line, so duplicates can be removed with sort -u.
+static int cli_canonical(int argc, char **argv)
+{
+    char *line, *facelets;
+    size_t capacity;
+    Cube_State *s, *canonical;
+    Cube_Symmetry *cs;
+    int sym, ok;
+
+    (void) argv;
+    if (argc != 0) {
+        fprintf(stderr, "Usage: rcs canonical\n");
+        return 1;
+    }
+
+    line = NULL;
+    capacity = 0;
+    cs = NULL;
+    sym = 0;
+    ok = 1;
+    while (ok && read_line(stdin, &line, &capacity) != NULL) {
+        s = cube_state_from_facelets(line);
+        if (s == NULL) {
+            ok = 0;
+            break;
+        }
+
+        // the tables only depend on the size, lines usually share it
+        if (cs == NULL || cs->n != s->n) {
+            cube_symmetry_free(cs);
+            cs = cube_symmetry(s->n);
+        }
+
+        canonical = cube_state(s->n);
+        facelets = NULL;
+        if (cs != NULL && canonical != NULL) {
+            sym = cube_symmetry_canonical(cs, s, canonical);
+            facelets = cube_state_to_facelets(canonical);
+        }
+
+        if (facelets != NULL)
+            printf("%s %d\n", facelets, sym);
+        else
+            ok = 0;
+
+        if (facelets != NULL) free(facelets);
+        cube_state_free(canonical);
+        cube_state_free(s);
+    }
+
+    if (line != NULL) free(line);
+    cube_symmetry_free(cs);
+
+    return ok ? 0 : 1;
+}
+
+static int cli_daemon(int argc, char **argv)
+{
+    if (argc < 1 || argc > 2) {
+        fprintf(stderr, "Usage: rcs daemon <socket> [workers]\n");
+        return 1;
+    }
+
+    return solver_daemon_run(argv[0], argc == 2 ? atoi(argv[1]) : 0);
+}
+
+// Filter from stdin to stdout, every line is a move sequence. Without n opposite faces are not merged.
+static int cli_optimize(int argc, char **argv)
+{
+    char *line, *str;
+    size_t capacity;
+    Rubiks_Cube_Move *moves;
+    size_t count, total, optimized;
+    long n;
+
+    n = 0;
+    if (argc > 1 || (argc == 1 && (n = atol(argv[0])) <= 0)) {
+        fprintf(stderr, "Usage: rcs optimize [n]\n");
+        return 1;
+    }
+
+    line = NULL;
+    capacity = 0;
+    total = optimized = 0;
+    while (read_line(stdin, &line, &capacity) != NULL) {
+        if (!moves_from_string(line, &moves, &count)) {
+            free(line);
+            return 1;
+        }
+
+        total += count;
+        count = moves_optimize(moves, count, (uint64_t) n);
+        optimized += count;
+
+        str = moves_to_string(moves, count);
+        free(moves);
+        if (str == NULL) {
+            free(line);
+            return 1;
+        }
+
+        printf("%s\n", str);
+        free(str);
+    }
+
+    if (line != NULL) free(line);
+
+    log_info("Optimized %zu moves to %zu moves", total, optimized);
+    return 0;
+}
+
+// prints the order of the sequence and the lengths of the sticker cycles as <length>x<count>
+static int cli_order(int argc, char **argv)
+{
+    Permutation *p;
+    Rubiks_Cube_Move *moves, *m;
+    uint64_t *lengths, count, order, i, same;
+    size_t move_count, c;
+    long n;
+    int k;
+
+    if (argc < 1 || (n = atol(argv[0])) <= 0) {
+        fprintf(stderr, "Usage: rcs order <n> <moves...>\n");
+        return 1;
+    }
+
+    moves = NULL;
+    move_count = 0;
+    for (k = 1; k < argc; k++) {
+        if (!moves_from_string(argv[k], &m, &c)) {
+            if (moves != NULL) free(moves);
+            return 1;
+        }
+
+        moves = (Rubiks_Cube_Move *) realloc(moves, (move_count + c + 1) * sizeof (Rubiks_Cube_Move));
+        if (moves == NULL) {
+            log_error("Failed to allocate memory for moves");
+            free(m);
+            return 1;
+        }
+        memcpy(&moves[move_count], m, c * sizeof (Rubiks_Cube_Move));
+        move_count += c;
+        free(m);
+    }
+
+    // permutation_compile() would only skip them, giving the order of different moves
+    for (c = 0; c < move_count; c++) {
+        if (moves[c].slice >= (uint64_t) n) {
+            log_error("Move outside of a %ldx%ldx%ld cube", n, n, n);
+            free(moves);
+            return 1;
+        }
+    }
+
+    p = permutation_compile((uint64_t) n, moves, move_count);
+    if (moves != NULL) free(moves);
+    if (p == NULL) return 1;
+
+    lengths = (uint64_t *) malloc((p->size / 2 + 1) * sizeof (uint64_t));
+    if (lengths == NULL) {
+        log_error("Failed to allocate memory for the cycle lengths");
+        permutation_free(p);
+        return 1;
+    }
+
+    order = permutation_order(p);
+    count = permutation_cycles(p, lengths);
+
+    printf("order %" PRIu64 "\n", order);
+
+    qsort(lengths, count, sizeof (uint64_t), compare_descending);
+    printf("cycles");
+    for (i = 0; i < count; i += same) {
+        for (same = 1; i + same < count && lengths[i + same] == lengths[i]; same++);
+        printf(" %" PRIu64 "x%" PRIu64, lengths[i], same);
+    }
+    printf("\n");
+
+    free(lengths);
+    permutation_free(p);
+
+    return 0;
+}
+
+// Stickers take 3 bits, so cubes with thousands of layers fit into memory. With a file the cube
+// is mapped from it and continued by the next call.
+static int cli_packed(int argc, char **argv)
+{
+    Packed_State *p;
+    Rubiks_Cube_Move *moves;
+    size_t capacity, count, total, i;
+    char *line;
+    clock_t start;
+    long n;
+    int ok;
+
+    if (argc < 1 || argc > 2 || (n = atol(argv[0])) <= 0) {
+        fprintf(stderr, "Usage: rcs packed <n> [file]\n");
+        return 1;
+    }
+
+    p = argc == 2 ? packed_state_map(argv[1], (uint64_t) n) : packed_state((uint64_t) n);
+    if (p == NULL) return 1;
+
+    line = NULL;
+    capacity = 0;
+    total = 0;
+    ok = 1;
+    start = clock();
+    while (ok && read_line(stdin, &line, &capacity) != NULL) {
+        ok = moves_from_string(line, &moves, &count);
+        for (i = 0; ok && i < count; i++) {
+            if (moves[i].slice >= (uint64_t) n) {
+                log_error("Move outside of a %ldx%ldx%ld cube", n, n, n);
+                ok = 0;
+            } else {
+                packed_state_apply_move(p, moves[i]);
+            }
+        }
+        if (moves != NULL) free(moves);
+        total += count;
+    }
+
+    if (ok) printf("%zu moves in %.3f s, %s\n", total, (double) (clock() - start) / CLOCKS_PER_SEC,
+                   packed_state_is_solved(p) ? "solved" : "not solved");
+
+    packed_state_free(p);
+    if (line != NULL) free(line);
+
+    return ok ? 0 : 1;
+}
+
+// writes the scrambles to stdout using every core
+static int cli_scramble(int argc, char **argv)
+{
+    long long n, count;
+    uint64_t seed;
+
+    if (argc < 1 || argc > 3 || (n = atoll(argv[0])) <= 0) {
+        fprintf(stderr, "Usage: rcs scramble <n> [count] [seed]\n");
+        return 1;
+    }
+
+    count = argc >= 2 ? atoll(argv[1]) : 1;
+    if (count < 0) {
+        fprintf(stderr, "Usage: rcs scramble <n> [count] [seed]\n");
+        return 1;
+    }
+
+    seed = argc == 3 ? strtoull(argv[2], NULL, 10) : (uint64_t) time(NULL) ^ (uint64_t) clock() << 32;
+
+    return scramble_bulk(stdout, (uint64_t) n, (uint64_t) count, seed, 0) ? 0 : 1;
+}
+
+static int cli_session(int argc, char **argv)
+{
+    long n;
+
+    if ((argc == 3 || argc == 4) && strcmp(argv[0], "record") == 0 && (n = atol(argv[1])) > 0)
+        return session_record(argv[2], n, argc == 4 ? atol(argv[3]) : 1024);
+    if (argc == 2 && strcmp(argv[0], "info") == 0)
+        return session_info(argv[1]);
+    if (argc == 3 && strcmp(argv[0], "seek") == 0)
+        return session_seek(argv[1], strtoull(argv[2], NULL, 10), 0);
+    if (argc == 3 && strcmp(argv[0], "replay") == 0)
+        return session_seek(argv[1], strtoull(argv[2], NULL, 10), 1);
+
+    fprintf(stderr, "Usage: rcs session record <n> <file> [interval]  record the lines of stdin, \'<milliseconds> <moves...>\'\n");
+    fprintf(stderr, "       rcs session info <file>                   length and checkpoints of a recording\n");
+    fprintf(stderr, "       rcs session seek <file> <milliseconds>    facelets of the state at the time\n");
+    fprintf(stderr, "       rcs session replay <file> <milliseconds>  every move after the time\n");
+    return 1;
+}
+
+static int session_record(const char *path, long n, long interval)
+{
+    Session_Writer *w;
+    Cube_State *s;
+    Rubiks_Cube_Move *moves;
+    size_t capacity, count, i;
+    uint64_t time;
+    char *line, *end;
+    int ok;
+
+    if (interval < 0 || interval > UINT32_MAX) {
+        log_error("Invalid checkpoint interval %ld", interval);
+        return 1;
+    }
+
+    s = cube_state((uint64_t) n);
+    if (s == NULL) return 1;
+
+    w = session_writer(path, s, 0, (uint32_t) interval);
+    cube_state_free(s);
+    if (w == NULL) return 1;
+
+    line = NULL;
+    capacity = 0;
+    ok = 1;
+    while (ok && read_line(stdin, &line, &capacity) != NULL) {
+        time = strtoull(line, &end, 10);
+        if (end == line) {
+            log_error("Line without time '%s'", line);
+            ok = 0;
+            break;
+        }
+
+        ok = moves_from_string(end, &moves, &count);
+        for (i = 0; ok && i < count; i++)
+            ok = session_writer_move(w, moves[i], time);
+        if (moves != NULL) free(moves);
+    }
+
+    if (!session_writer_close(w)) ok = 0;
+    if (line != NULL) free(line);
+
+    return ok ? 0 : 1;
+}
+
+static int session_info(const char *path)
+{
+    Session_Reader *r;
+
+    r = session_reader_open(path);
+    if (r == NULL) return 1;
+
+    printf("%" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube, %" PRIu64 " moves in %" PRIu64 " ms, %" PRIu64 " checkpoints, %zu bytes\n",
+           r->header->n, r->header->n, r->header->n, r->move_count, r->duration, r->checkpoint_count, r->size);
+
+    session_reader_close(r);
+    return 0;
+}
+
+static int session_seek(const char *path, uint64_t time, int replay)
+{
+    Session_Reader *r;
+    Session_Cursor c;
+    Cube_State *s;
+    Rubiks_Cube_Move m;
+    char *facelets, str[MOVE_STRING_LENGTH];
+    int ok;
+
+    r = session_reader_open(path);
+    if (r == NULL) return 1;
+
+    s = cube_state(r->header->n);
+    ok = s != NULL && session_reader_seek(r, time, s, &c);
+
+    if (ok && !replay) {
+        facelets = cube_state_to_facelets(s);
+        if (facelets != NULL) {
+            printf("%" PRIu64 " %s\n", c.move, facelets);
+            free(facelets);
+        }
+        ok = facelets != NULL;
+    }
+
+    while (ok && replay && session_reader_next(r, &c, s, &m)) {
+        move_to_string(m, str, sizeof (str));
+        printf("%" PRIu64 " %s\n", c.time, str);
+    }
+
+    cube_state_free(s);
+    session_reader_close(r);
+
+    return ok ? 0 : 1;
+}
+
+// Filter from stdin to stdout, prints OK or ERR with the reason for every facelet string.
+// Fails if any of the states is impossible.
+static int cli_validate(int argc, char **argv)
+{
+    char *line;
+    size_t capacity;
+    Cube_State *s;
+    const char *reason;
+    int ok;
+
+    (void) argv;
+    if (argc != 0) {
+        fprintf(stderr, "Usage: rcs validate\n");
+        return 1;
+    }
+
+    line = NULL;
+    capacity = 0;
+    ok = 1;
+    while (read_line(stdin, &line, &capacity) != NULL) {
+        s = cube_state_from_facelets(line);
+        if (s == NULL) {
+            printf("ERR invalid facelets\n");
+            ok = 0;
+            continue;
+        }
+
+        if (validate_state(s, &reason)) {
+            printf("OK\n");
+        } else {
+            printf("ERR %s\n", reason);
+            ok = 0;
+        }
+
+        cube_state_free(s);
+    }
+
+    if (line != NULL) free(line);
+
+    return ok ? 0 : 1;
+}
+
+static void cli_usage(const char *program)
+{
+    size_t i;
+
+    fprintf(stderr, "Usage: %s [command]\n", program);
+    fprintf(stderr, "Without a command the simulation window is opened.\n\nCommands:\n");
+    for (i = 0; i < sizeof (COMMANDS) / sizeof (COMMANDS[0]); i++)
+        fprintf(stderr, "    %s\n", COMMANDS[i].usage);
+    fprintf(stderr, "    replay <file> [repeats]      render the frames of a capture and time them, see render_queue.h\n");
+}
+
+static int compare_descending(const void *a, const void *b)
+{
+    uint64_t x, y;
+
+    x = *(const uint64_t *) a;
+    y = *(const uint64_t *) b;
+
+    return (x < y) - (x > y);
+}
+
+// Reads a line of any length without the line break into *line, which grows as needed and has to be freed by the caller.
+// Returns NULL at the end of the file.
+static char *read_line(FILE *f, char **line, size_t *capacity)
+{
+    char *l;
+    size_t length;
+
+    length = 0;
+    for (;;) {
+        if (*capacity - length < 2) {
+            l = (char *) realloc(*line, *capacity == 0 ? 256 : 2 * *capacity);
+            if (l == NULL) {
+                log_error("Failed to allocate memory for a line");
+                return NULL;
+            }
+            *line = l;
+            *capacity = *capacity == 0 ? 256 : 2 * *capacity;
+        }
+
+        if (fgets(&(*line)[length], (int) (*capacity - length), f) == NULL) {
+            if (length == 0) return NULL;
+            break;
+        }
+
+        length += strlen(&(*line)[length]);
+        if ((*line)[length-1] == '\n') break;
+    }
+
+    (*line)[strcspn(*line, "\r\n")] = '\0';
+
+    return *line;
+}
\ No newline at end of file
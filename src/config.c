@@ -42,6 +42,15 @@ Config config_default(void)
     conf.keys[KEY_ROTATE_S_CW]          = (Key_ShortCut){KEY_S,      0};
     conf.keys[KEY_ROTATE_S_180]         = (Key_ShortCut){KEY_S,      MOD_SHIFT};
     conf.keys[KEY_ROTATE_S_CCW]         = (Key_ShortCut){KEY_S,      MOD_CONTROL};
+    conf.keys[KEY_SOLVE]                = (Key_ShortCut){KEY_ENTER,  0};
+    conf.keys[KEY_IMPORT_STATE]         = (Key_ShortCut){KEY_V,      MOD_CONTROL};
+    conf.keys[KEY_SAVE_STATE]           = (Key_ShortCut){KEY_F5,     0};
+    conf.keys[KEY_LOAD_STATE]           = (Key_ShortCut){KEY_F9,     0};
+    conf.keys[KEY_UNDO]                 = (Key_ShortCut){KEY_Z,      MOD_CONTROL};
+    conf.keys[KEY_REDO]                 = (Key_ShortCut){KEY_Y,      MOD_CONTROL};
+    conf.keys[KEY_UNDO_ALL]             = (Key_ShortCut){KEY_Z,      MOD_CONTROL | MOD_SHIFT};
+    conf.keys[KEY_REDO_ALL]             = (Key_ShortCut){KEY_Y,      MOD_CONTROL | MOD_SHIFT};
+    conf.keys[KEY_TOGGLE_CAPTURE]       = (Key_ShortCut){KEY_F12,    0};
 
     conf.background_color = color_from_hex(0xDFD3C3FF);
 
@@ -62,11 +71,20 @@ Config config_default(void)
     conf.cam_anim_duration = 0.5f;
     conf.cam_anim_efunc    = ease_in_out_sine;
 
+    conf.alg_db_path = "algorithms.rcad";
+    conf.snapshot_path = "snapshot.rcss";
+    conf.resume_snapshot = 0;
+    conf.session_path = NULL;
+    conf.session_checkpoint_interval = 1024;
+    conf.render_capture_path = "capture.rcrq";
+
     conf.rcconf.cubie_spacer_multiplier   = 0.0f;
     conf.rcconf.face_length_multiplier    = 0.92f;
     conf.rcconf.face_offset_from_cubie    = 1e-3f;
     conf.rcconf.vertex_path               = "shaders/cube.vert";
     conf.rcconf.fragment_path             = "shaders/cube.frag";
+    conf.rcconf.sticker_vertex_path       = "shaders/sticker.vert";
+    conf.rcconf.sticker_fragment_path     = "shaders/sticker.frag";
     conf.rcconf.scale                     = 1.0f;
     conf.rcconf.origin                    = vec3(0.0f, 0.3f, 0.0f);
     conf.rcconf.width                     = 3;
@@ -82,6 +100,9 @@ Config config_default(void)
     conf.rcconf.move_duration             = 0.5f;
     conf.rcconf.move_cooldown             = 0.2f;
     conf.rcconf.move_easing_func          = ease_in_out_sine;
+    conf.rcconf.hints                     = 1;
+    conf.rcconf.last_layer_cases          = 1;
+    conf.rcconf.merge_stickers            = 1;
     conf.rcconf.face_colors[COLOR_BORDER] = color_from_hex(0x000000FF);
     conf.rcconf.face_colors[COLOR_FRONT]  = color_from_hex(0xB90000FF);
     conf.rcconf.face_colors[COLOR_UP]     = color_from_hex(0xFFD500FF);
@@ -1,21 +1,39 @@
 #include "cube.h"
 
+#include "gl_state.h"
 #include "logging.h"
+#include "reduction.h"
+#include "render_queue.h"
 #include "smath.h"
+#include "snapshot.h"
+#include "validate.h"
 
+#include <ctype.h>
 #include <inttypes.h>
+#include <malloc.h>
 #include <string.h>
 
 void rotate_matrix_cw (uint64_t *a, uint64_t dimension, uint64_t xstride, uint64_t ystride, uint64_t start_index);
 void rotate_matrix_ccw(uint64_t *a, uint64_t dimension, uint64_t xstride, uint64_t ystride, uint64_t start_index);
 void rotate_matrix_180(uint64_t *a, uint64_t dimension, uint64_t xstride, uint64_t ystride, uint64_t start_index);
+static void reset_cubie_indices(Rubiks_Cube *rc);
+static int  rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice);
+static int  push_history(Rubiks_Cube *rc, Rubiks_Cube_Move m);
+static size_t jump_history(Rubiks_Cube *rc, size_t count, int redo);
+static int  import_state(Rubiks_Cube *rc, const Cube_State *s);
+static int  create_static_mesh(Rubiks_Cube *rc);
+static uint64_t position_chunk(Rubiks_Cube *rc, uint64_t position);
+static void mark_chunks_dirty(Rubiks_Cube *rc, int moving_only);
+static void bake_static_mesh(Rubiks_Cube *rc);
+static void bake_chunk(Rubiks_Cube *rc, Cube_Chunk *chunk, int upload);
+static void set_static_index(Rubiks_Cube *rc, uint64_t i, uint32_t v);
 
 Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
 {
     Rubiks_Cube *rc;
-    uint64_t cw, ch, cd, w, h, d, ci, i;
+    uint64_t cw, ch, cd, w, h, d, ci;
     float cubie_spacer;
-    Vec3 model_origin;
+    Vec3 model_origin, origin;
     Cubie_Config cconf;
 
     log_info("Generating new rubiks cube with dimensions %" PRIu64 "x%" PRIu64 "x%" PRIu64 "...", rcconf->width, rcconf->height, rcconf->depth);
@@ -50,10 +68,27 @@ Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
     // TODO: when rotating width/height/depth changes layer-wise, so cube needs to store dimensions layer-wise
     if (rc->w != rc->h || rc->w != rc->d) {
         log_warning("Variable side lengths are only supported experimentally, rotating will not work as intended!");
+    } else {
+        rc->state = cube_state(rc->w);
+        if (rc->state == NULL) {
+            rubiks_cube_free(rc);
+            return NULL;
+        }
+
+        // the cube still works without hints, so a failure is not fatal
+        if (rcconf->hints)
+            rc->hint = hint_solver(rc->state);
+
+        // the cases only exist for the 3x3x3
+        if (rcconf->last_layer_cases && rc->w == 3) {
+            last_layer_init();
+            rc->recognize_last_layer = 1;
+        }
     }
 
     rc->cubies = (Cubie *) malloc(rc->cubie_count * sizeof (Cubie));
-    if (rc->cubies == NULL) {
+    rc->moving_cubies = (uint64_t *) malloc(rc->cubie_count * sizeof (uint64_t));
+    if (rc->cubies == NULL || rc->moving_cubies == NULL) {
         log_error("Failed to allocate memory for cubies");
         rubiks_cube_free(rc);
         return NULL;
@@ -84,7 +119,9 @@ Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
     }
 
     // TODO: maybe make uniforms configurable through config and allow custom shaders etc.
-    shader_register_uniform(rc->prog, "mvp");
+    // view and projection come from the camera block, see shader.h
+    rc->model_uniform = shader_register_uniform(rc->prog, "model", GL_FLOAT_MAT4);
+    rc->faces_uniform = shader_register_uniform(rc->prog, "faces", GL_UNSIGNED_INT);
 
     log_info("Generating cubies...");
 
@@ -96,15 +133,19 @@ Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
          (cconf.side_length * rc->h + cubie_spacer * (rc->h - 1)) * 0.5f,
          (cconf.side_length * rc->d + cubie_spacer * (rc->d - 1)) * 0.5f
     );
-    cconf.origin = model_origin;
+    origin = model_origin;
+
+    // the meshes start at the top left corner of the cubie and the faces stick out a bit
+    cconf.vertex_scale = cconf.side_length + rcconf->face_offset_from_cubie;
+    rc->vertex_scale = cconf.vertex_scale;
+    rc->static_scale = fmaxf(fabsf(model_origin.x), fmaxf(fabsf(model_origin.y), fabsf(model_origin.z))) + rcconf->face_offset_from_cubie;
 
     cconf.face_length_multiplier = rcconf->face_length_multiplier;
     cconf.face_offset_from_cubie = rcconf->face_offset_from_cubie;
 
-    memcpy(cconf.face_colors, rcconf->face_colors, CUBE_COLOR_COUNT * sizeof (Color));
+    memcpy(rc->face_colors, rcconf->face_colors, CUBE_COLOR_COUNT * sizeof (Color));
 
-    for (i = 0; i < rc->max_length*rc->max_length*rc->max_length; i++)
-        rc->cubie_indices[i] = rc->cubie_count;
+    reset_cubie_indices(rc);
 
     ci = 0;
     for (d = 0; d < rc->d; d++) {
@@ -116,12 +157,9 @@ Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
                     h > 0 && h < rc->h - 1 &&
                     d > 0 && d < rc->d - 1) {
                         
-                    cconf.origin.x += cconf.side_length + cubie_spacer;
+                    origin.x += cconf.side_length + cubie_spacer;
                     continue;
                 }
-                    
-                i = d*rc->h*rc->w + h*rc->w + w;
-                rc->cubie_indices[i] = ci;
 
                 cconf.color_mask = 0;
 
@@ -132,17 +170,42 @@ Rubiks_Cube *rubiks_cube(Rubiks_Cube_Config *rcconf)
                 if (h == rc->h - 1) cconf.color_mask |= COLOR_MASK_DOWN;
                 if (w == rc->w - 1) cconf.color_mask |= COLOR_MASK_RIGHT;
                 
-                rc->cubies[ci++] = cubie(&cconf);
+                if (rc->meshes[cconf.color_mask].vao == 0 && !cubie_mesh(&rc->meshes[cconf.color_mask], &cconf)) {
+                    rubiks_cube_free(rc);
+                    return NULL;
+                }
+                rc->cubies[ci++] = cubie(&rc->meshes[cconf.color_mask], origin);
 
-                cconf.origin.x += cconf.side_length + cubie_spacer;
+                origin.x += cconf.side_length + cubie_spacer;
             }
 
-            cconf.origin.x  = model_origin.x;
-            cconf.origin.y -= cconf.side_length + cubie_spacer;
+            origin.x  = model_origin.x;
+            origin.y -= cconf.side_length + cubie_spacer;
         }
 
-        cconf.origin.y  = model_origin.y;
-        cconf.origin.z -= cconf.side_length + cubie_spacer;
+        origin.y  = model_origin.y;
+        origin.z -= cconf.side_length + cubie_spacer;
+    }
+
+    if (!create_static_mesh(rc)) {
+        rubiks_cube_free(rc);
+        return NULL;
+    }
+
+    // the cube still works with the static mesh only, so a failure is not fatal
+    if (rcconf->merge_stickers && rc->state != NULL) {
+        rc->sticker_prog = shader_new(rcconf->sticker_vertex_path, rcconf->sticker_fragment_path);
+        if (rc->sticker_prog != NULL &&
+            sticker_mesh(&rc->stickers, rc->w, -model_origin.x, cconf.side_length + cubie_spacer, rc->static_scale)) {
+            rc->sticker_model_uniform = shader_register_uniform(rc->sticker_prog, "model", GL_FLOAT_MAT4);
+            // the air gap between cubies is drawn like the border
+            shader_set_uniform_float(rc->sticker_prog, shader_register_uniform(rc->sticker_prog, "border", GL_FLOAT),
+                                     0.5f * (1.0f - cconf.side_length * cconf.face_length_multiplier / (cconf.side_length + cubie_spacer)));
+        } else {
+            log_warning("Failed to create the sticker mesh, the stickers are not merged");
+            shader_free(rc->sticker_prog);
+            rc->sticker_prog = NULL;
+        }
     }
 
     rubiks_cube_set_move_duration(rc, rcconf->move_duration);
@@ -177,12 +240,19 @@ void rubiks_cube_set_move_easing_func(Rubiks_Cube *rc, easing_func efunc)
 }
 
 void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice)
+{
+    if (rotate_slice(rc, face, rot, slice))
+        push_history(rc, rubiks_cube_move(face, rot, slice));
+}
+
+// Starts the animation of a move, returns 0 if it was skipped because of the cooldown or an invalid move.
+static int rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice)
 {
     Vec3 a;
     float r;
     uint64_t start_index, width, height, x, y, xstride, ystride, ci;
 
-    if (rc->mc < rc->mcooldown) return;
+    if (rc->mc < rc->mcooldown) return 0;
     rc->mc = 0.0f;
 
     // 90 degrees is counterclock-wise etc.
@@ -192,7 +262,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_FRONT:
             if (slice >= rc->d) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Front rotation", slice, rc->d);
-                return;
+                return 0;
             }
             start_index = slice*rc->w*rc->h;
             a = vec3(0.0f, 0.0f, 1.0f);
@@ -205,7 +275,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_UP:
             if (slice >= rc->h) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Up rotation", slice, rc->h);
-                return;
+                return 0;
             }
             start_index = (rc->d-1)*rc->h*rc->w + slice*rc->w;
             a = vec3(0.0f, 1.0f, 0.0f);
@@ -218,7 +288,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_LEFT:
             if (slice >= rc->w) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Left rotation", slice, rc->w);
-                return;
+                return 0;
             }
             start_index = (rc->d-1)*rc->h*rc->w + slice;
             a = vec3(-1.0f, 0.0f, 0.0f);
@@ -231,7 +301,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_BACK:
             if (slice >= rc->d) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Back rotation", slice, rc->d);
-                return;
+                return 0;
             }
             start_index = (rc->d-1-slice)*rc->h*rc->w + (rc->w-1);
             a = vec3(0.0f, 0.0f, -1.0f);
@@ -244,7 +314,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_DOWN:
             if (slice >= rc->h) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Down rotation", slice, rc->h);
-                return;
+                return 0;
             }
             start_index = (rc->h-1-slice)*(rc->w);
             a = vec3(0.0f, -1.0f, 0.0f);
@@ -257,7 +327,7 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case FACE_RIGHT:
             if (slice >= rc->w) {
                 log_warning("Slice index is out of range %" PRIu64 " > %" PRIu64 ", skipping Right rotation", slice, rc->w);
-                return;
+                return 0;
             }
             start_index = (rc->w-1-slice);
             a = vec3(1.0f, 0.0f, 0.0f);
@@ -266,15 +336,39 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
             xstride = rc->w*rc->h;
             ystride = rc->w;
         break;
+
+        default:
+            log_warning("Invalid face %d, skipping rotation", (int) face);
+            return 0;
     }
 
+    if (rc->state != NULL)
+        cube_state_rotate_slice(rc->state, face, rot, slice);
+    if (rc->sticker_prog != NULL)
+        sticker_mesh_mark_slice(&rc->stickers, face, slice);
+    if (rc->hint != NULL)
+        hint_solver_submit(rc->hint, rc->state);
+    if (rc->recognize_last_layer)
+        rc->last_layer = last_layer_recognize(rc->state);
+    if (rc->recorder != NULL)
+        session_writer_move(rc->recorder, rubiks_cube_move(face, rot, slice), (uint64_t) (rc->time * 1000.0));
+
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
             ci = y * ystride + x * xstride + start_index;
 
+            // the slice maps onto itself, so its chunks are the only ones that change when the move ends
+            if (rc->cubie_indices[ci] != rc->cubie_count && ci < rc->w*rc->h*rc->d) {
+                rc->chunks[position_chunk(rc, ci)].dirty = 1;
+                rc->static_dirty = 1;
+            }
+
             ci = rc->cubie_indices[ci];
-            if (ci != rc->cubie_count)
-                cubie_rotation_add(&rc->cubies[ci], a, r);
+            if (ci == rc->cubie_count) continue;
+
+            // a cubie that is still running from the last move is in the list already
+            if (!rc->cubies[ci].a.running) rc->moving_cubies[rc->moving_count++] = ci;
+            cubie_rotation_add(&rc->cubies[ci], a, r);
         }
     }
 
@@ -314,6 +408,9 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
             xstride = rc->max_length*rc->max_length;
             ystride = rc->max_length;
         break;
+
+        default:
+            return 0;
     }
 
     switch (rot) {
@@ -328,7 +425,207 @@ void rubiks_cube_rotate_slice(Rubiks_Cube *rc, Rubiks_Cube_Face face, Rubiks_Cub
         case ROTATION_CW:
             rotate_matrix_cw (rc->cubie_indices, rc->max_length, xstride, ystride, start_index);
         break;
+
+        default:
+        break;
+    }
+
+    return 1;
+}
+
+// Appends moves to the queue, they are played one after another in rubiks_cube_update().
+// Redundant moves are removed first, so they are not animated.
+int rubiks_cube_queue_moves(Rubiks_Cube *rc, const Rubiks_Cube_Move *moves, size_t count)
+{
+    Rubiks_Cube_Move *queue;
+    size_t capacity;
+
+    // drop the moves that were already played
+    if (rc->queue_start > 0) {
+        memmove(rc->queue, &rc->queue[rc->queue_start], (rc->queue_count - rc->queue_start) * sizeof (Rubiks_Cube_Move));
+        rc->queue_count -= rc->queue_start;
+        rc->queue_start  = 0;
+    }
+
+    if (rc->queue_count + count > rc->queue_capacity) {
+        capacity = rc->queue_capacity == 0 ? 64 : rc->queue_capacity;
+        while (capacity < rc->queue_count + count)
+            capacity *= 2;
+
+        queue = (Rubiks_Cube_Move *) realloc(rc->queue, capacity * sizeof (Rubiks_Cube_Move));
+        if (queue == NULL) {
+            log_error("Failed to allocate memory for %zu queued moves", capacity);
+            return 0;
+        }
+
+        rc->queue = queue;
+        rc->queue_capacity = capacity;
     }
+
+    memcpy(&rc->queue[rc->queue_count], moves, count * sizeof (Rubiks_Cube_Move));
+    rc->queue_count += moves_optimize(&rc->queue[rc->queue_count], count, rc->state != NULL ? rc->state->n : 0);
+
+    return 1;
+}
+
+void rubiks_cube_clear_queue(Rubiks_Cube *rc)
+{
+    rc->queue_start = 0;
+    rc->queue_count = 0;
+}
+
+// queues the moves that solve the cube, moves that are still queued are taken into account
+int rubiks_cube_solve(Rubiks_Cube *rc)
+{
+    Cube_State *s;
+    Rubiks_Cube_Move *moves;
+    size_t count;
+    int ok;
+
+    if (rc->state == NULL) {
+        log_warning("Solving is only supported for cubes with equal side lengths");
+        return 0;
+    }
+
+    s = cube_state_copy(rc->state);
+    if (s == NULL) return 0;
+
+    if (rc->queue_start < rc->queue_count)
+        cube_state_apply_moves(s, &rc->queue[rc->queue_start], rc->queue_count - rc->queue_start);
+
+    if (cube_state_is_solved(s)) {
+        log_info("Cube is already solved");
+        cube_state_free(s);
+        return 1;
+    }
+
+    ok = reduction_solve(s, &moves, &count);
+    cube_state_free(s);
+    if (!ok) return 0;
+
+    log_info("Found solution with %zu moves", count);
+
+    ok = rubiks_cube_queue_moves(rc, moves, count);
+    free(moves);
+
+    return ok;
+}
+
+// Takes back the last count moves. A single move is animated like any other move, more moves are
+// applied to a copy of the state and shown at once with rubiks_cube_set_state().
+// Returns the number of moves that were undone.
+size_t rubiks_cube_undo(Rubiks_Cube *rc, size_t count)
+{
+    return jump_history(rc, count, 0);
+}
+
+// Plays the last count undone moves again, the same way as rubiks_cube_undo().
+size_t rubiks_cube_redo(Rubiks_Cube *rc, size_t count)
+{
+    return jump_history(rc, count, 1);
+}
+
+void rubiks_cube_clear_history(Rubiks_Cube *rc)
+{
+    rc->history_count  = 0;
+    rc->history_length = 0;
+}
+
+// Replaces the state without replaying moves, s has to be valid (see validate_state()).
+// Every cubie goes back to its home position and takes the colors of the stickers there,
+// so nothing is replayed no matter how far s is from the current state.
+int rubiks_cube_set_state(Rubiks_Cube *rc, const Cube_State *s)
+{
+    uint64_t n, i, x, y, z, ci;
+
+    if (rc->state == NULL || rc->state->n != s->n) {
+        log_error("Cannot set the state of a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube to a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state",
+                  rc->w, rc->h, rc->d, s->n, s->n, s->n);
+        return 0;
+    }
+
+    n = s->n;
+    rubiks_cube_clear_queue(rc);
+    memcpy(rc->state->stickers, s->stickers, FACE_COUNT * n * n * sizeof (uint8_t));
+
+    reset_cubie_indices(rc);
+    for (ci = 0; ci < rc->cubie_count; ci++)
+        cubie_reset_rotation(&rc->cubies[ci]);
+    mark_chunks_dirty(rc, 0);
+    if (rc->sticker_prog != NULL)
+        sticker_mesh_mark_all(&rc->stickers);
+    rc->moving_count = 0;
+
+    // the renderer counts depth from front to back and height from top to bottom
+    for (i = 0; i < FACE_COUNT * n * n; i++) {
+        cube_state_sticker_cubie(n, i, &x, &y, &z);
+        ci = rc->cubie_indices[(n-1-z)*n*n + (n-1-y)*n + x];
+        cubie_set_face_color(&rc->cubies[ci], 1 << (i / (n*n)), COLOR_FRONT + s->stickers[i]);
+    }
+
+    if (rc->hint != NULL)
+        hint_solver_submit(rc->hint, rc->state);
+    if (rc->recognize_last_layer)
+        rc->last_layer = last_layer_recognize(rc->state);
+    if (rc->recorder != NULL)
+        session_writer_checkpoint(rc->recorder, rc->state, (uint64_t) (rc->time * 1000.0));
+
+    return 1;
+}
+
+// Imports a facelet string (see cube_state_from_facelets()), trailing whitespace is ignored.
+// Impossible states are rejected and leave the cube unchanged.
+int rubiks_cube_import_facelets(Rubiks_Cube *rc, const char *facelets)
+{
+    Cube_State *s;
+    char *trimmed;
+    size_t length;
+    int ok;
+
+    length = strlen(facelets);
+    while (length > 0 && isspace((unsigned char) facelets[length-1])) length--;
+
+    trimmed = (char *) malloc(length + 1);
+    if (trimmed == NULL) {
+        log_error("Failed to allocate memory for facelets");
+        return 0;
+    }
+    memcpy(trimmed, facelets, length);
+    trimmed[length] = '\0';
+
+    s = cube_state_from_facelets(trimmed);
+    free(trimmed);
+    if (s == NULL) return 0;
+
+    ok = import_state(rc, s);
+
+    cube_state_free(s);
+    return ok;
+}
+
+int rubiks_cube_save_state(Rubiks_Cube *rc, const char *path)
+{
+    if (rc->state == NULL) {
+        log_warning("Saving is only supported for cubes with equal side lengths");
+        return 0;
+    }
+
+    return snapshot_save(path, rc->state);
+}
+
+// Loads a snapshot (see snapshot.h) of a cube with the same side length, the same way as an imported state.
+int rubiks_cube_load_state(Rubiks_Cube *rc, const char *path)
+{
+    Cube_State *s;
+    int ok;
+
+    s = snapshot_load(path);
+    if (s == NULL) return 0;
+
+    ok = import_state(rc, s);
+
+    cube_state_free(s);
+    return ok;
 }
 
 void rubiks_cube_rotate(Rubiks_Cube *rc, Vec3 axis, float angle)
@@ -351,15 +648,42 @@ void rubiks_cube_scale(Rubiks_Cube *rc, float scale)
     );
 }
 
+// takes CUBE_COLOR_COUNT colors, the vertices only store indices so nothing has to be uploaded again
+void rubiks_cube_set_face_colors(Rubiks_Cube *rc, const Color *colors)
+{
+    memcpy(rc->face_colors, colors, CUBE_COLOR_COUNT * sizeof (Color));
+}
+
 void rubiks_cube_update(Rubiks_Cube *rc, float dt)
 {
-    uint64_t ci;
-    for (ci = 0; ci < rc->cubie_count; ci++)
+    uint64_t i, k, ci;
+    Rubiks_Cube_Move m;
+    int finished;
+
+    rc->time += dt;
+    finished = 0;
+    for (i = k = 0; i < rc->moving_count; i++) {
+        ci = rc->moving_cubies[i];
         cubie_update(&rc->cubies[ci], dt);
-    
+        if (rc->cubies[ci].a.running) rc->moving_cubies[k++] = ci;
+        else finished = 1;
+    }
+    rc->moving_count = k;
+
+    // cubies that finished their move join the static mesh again
+    if (finished) mark_chunks_dirty(rc, 1);
+
     if (rc->mc < rc->mcooldown) rc->mc += dt;
     else rc->mc = rc->mcooldown;
 
+    if (rc->queue_start < rc->queue_count && rc->mc >= rc->mcooldown) {
+        m = rc->queue[rc->queue_start++];
+        rubiks_cube_rotate_slice(rc, m.face, m.rot, m.slice);
+
+        if (rc->queue_start == rc->queue_count)
+            rubiks_cube_clear_queue(rc);
+    }
+
     if (!animation_is_running(&rc->wobble_anim)) {
         rc->wobble_anim = animate_vector3(
             &rc->pos,
@@ -376,39 +700,87 @@ void rubiks_cube_update(Rubiks_Cube *rc, float dt)
     update_animation(&rc->scale_anim, dt);
 }
 
-void rubiks_cube_draw(Rubiks_Cube *rc, Mat4 view_proj)
+void rubiks_cube_draw(Rubiks_Cube *rc)
 {
+    Shader_Palette palette = {0};
+    const Cubie *c;
     uint64_t i;
-    Mat4 m, mvp;
+    uint32_t uniforms;
+    Mat4 m, model;
+
+    // a handful of colors, so uploading them every frame is cheaper than tracking changes
+    memcpy(palette.colors, rc->face_colors, CUBE_COLOR_COUNT * sizeof (Color));
+    shader_update_block(SHADER_BLOCK_PALETTE, &palette, sizeof (palette));
 
     m = mat4_translation(rc->pos);
     quat_rotatem4(&m, rc->ori);
     mat4_scale_s(&m, rc->scale);
 
-    m = mat4_mul(view_proj, m);
-
-    // 3D Options
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDepthMask(GL_TRUE);
-
-    shader_bind(rc->prog);
-
-    for (i = 0; i < rc->cubie_count; i++) {
-        mvp = mat4_copy(m);
-        quat_rotatem4(&mvp, rc->cubies[i].ori);
-        shader_set_uniform_mat4(rc->prog, "mvp", mvp.raw, GL_FALSE);
-
-        glBindVertexArray(rc->cubies[i].vao);
-        glDrawElements(GL_TRIANGLES, rc->cubies[i].index_count, GL_UNSIGNED_INT, NULL);
+    // the moves since the cube was idle the last time are only meshed now, the static mesh waits for the next move
+    if (rc->sticker_prog != NULL && rc->moving_count == 0) {
+        sticker_mesh_update(&rc->stickers, rc->state);
+        if (rc->stickers.index_count == 0) return;
+
+        model = mat4_copy(m);
+        mat4_scale_s(&model, rc->static_scale);
+
+        uniforms = render_queue_begin_uniforms(rc->sticker_prog);
+        render_queue_uniform_mat4(rc->sticker_model_uniform, model.raw);
+
+        render_queue_submit(RENDER_PASS_OPAQUE, 0.0f, (Render_Command) {
+            .program      = rc->sticker_prog->id,
+            .vertex_array = rc->stickers.vao,
+            .mode         = GL_TRIANGLES,
+            .count        = rc->stickers.index_count,
+            .index_type   = rc->stickers.index_type,
+            .uniforms     = uniforms,
+        });
+        return;
     }
 
-    glBindVertexArray(0);
-    shader_unbind(rc->prog);
+    if (rc->static_dirty) bake_static_mesh(rc);
+
+    if (rc->static_index_count > 0) {
+        model = mat4_copy(m);
+        mat4_scale_s(&model, rc->static_scale);
+
+        // the colors are baked into the vertices, so every face keeps its own
+        uniforms = render_queue_begin_uniforms(rc->prog);
+        render_queue_uniform_mat4(rc->model_uniform, model.raw);
+        render_queue_uniform_uint(rc->faces_uniform, CUBIE_HOME_FACE_COLORS);
+
+        render_queue_submit(RENDER_PASS_OPAQUE, 0.0f, (Render_Command) {
+            .program      = rc->prog->id,
+            .vertex_array = rc->static_vao,
+            .mode         = GL_TRIANGLES,
+            .count        = rc->static_index_count,
+            .index_type   = rc->static_index_type,
+            .uniforms     = uniforms,
+        });
+    }
 
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
+    // only the moving cubies are left, they share the transform of the cube, so they are not sorted by depth
+    for (i = 0; i < rc->moving_count; i++) {
+        c = &rc->cubies[rc->moving_cubies[i]];
+
+        model = mat4_copy(m);
+        quat_rotatem4(&model, c->ori);
+        mat4_translate(&model, c->origin);
+        mat4_scale_s(&model, rc->vertex_scale);
+
+        uniforms = render_queue_begin_uniforms(rc->prog);
+        render_queue_uniform_mat4(rc->model_uniform, model.raw);
+        render_queue_uniform_uint(rc->faces_uniform, c->face_colors);
+
+        render_queue_submit(RENDER_PASS_OPAQUE, 0.0f, (Render_Command) {
+            .program      = rc->prog->id,
+            .vertex_array = c->mesh->vao,
+            .mode         = GL_TRIANGLES,
+            .count        = c->mesh->index_count,
+            .index_type   = GL_UNSIGNED_BYTE,
+            .uniforms     = uniforms,
+        });
+    }
 }
 
 void rubiks_cube_free(Rubiks_Cube *rc)
@@ -420,17 +792,147 @@ void rubiks_cube_free(Rubiks_Cube *rc)
     if (rc->cubie_indices != NULL)
         free(rc->cubie_indices);
 
-    for (i = 0; i < rc->cubie_count; i++) {
-        cubie_free(rc->cubies[i]);
+    if (rc->queue != NULL)
+        free(rc->queue);
+
+    if (rc->history != NULL)
+        free(rc->history);
+
+    hint_solver_free(rc->hint);
+    cube_state_free(rc->state);
+
+    for (i = 0; i < ARRAY_LENGTH(rc->meshes); i++) {
+        if (rc->meshes[i].vao != 0)
+            cubie_mesh_free(&rc->meshes[i]);
     }
+
+    if (rc->static_vao != 0) gl_state_delete_vertex_array(rc->static_vao);
+    if (rc->static_vbo != 0) gl_state_delete_buffer(rc->static_vbo);
+    if (rc->static_ebo != 0) gl_state_delete_buffer(rc->static_ebo);
+    if (rc->static_verts != NULL)
+        free(rc->static_verts);
+    if (rc->static_indices != NULL)
+        free(rc->static_indices);
+    if (rc->chunks != NULL)
+        free(rc->chunks);
+    if (rc->chunk_positions != NULL)
+        free(rc->chunk_positions);
     shader_free(rc->prog);
+    if (rc->sticker_prog != NULL) {
+        sticker_mesh_free(&rc->stickers);
+        shader_free(rc->sticker_prog);
+    }
 
     if (rc->cubies != NULL)
         free(rc->cubies);
+    if (rc->moving_cubies != NULL)
+        free(rc->moving_cubies);
 
     free(rc);
 }
 
+// Adds a move to the history, all undone moves are dropped since they cannot be redone anymore.
+static int push_history(Rubiks_Cube *rc, Rubiks_Cube_Move m)
+{
+    uint32_t *history;
+    size_t capacity;
+
+    if (rc->history_count == rc->history_capacity) {
+        capacity = rc->history_capacity == 0 ? 256 : 2 * rc->history_capacity;
+        history = (uint32_t *) realloc(rc->history, capacity * sizeof (uint32_t));
+        if (history == NULL) {
+            log_error("Failed to allocate memory for %zu moves of history", capacity);
+            return 0;
+        }
+
+        rc->history = history;
+        rc->history_capacity = capacity;
+    }
+
+    // slices always fit, a cube with 2^27 layers could never be rendered
+    rc->history[rc->history_count++] = (uint32_t) move_pack(m);
+    rc->history_length = rc->history_count;
+
+    return 1;
+}
+
+static size_t jump_history(Rubiks_Cube *rc, size_t count, int redo)
+{
+    Cube_State *s;
+    Rubiks_Cube_Move m;
+    size_t i;
+
+    if (redo) count = count < rc->history_length - rc->history_count ? count : rc->history_length - rc->history_count;
+    else      count = count < rc->history_count ? count : rc->history_count;
+    if (count == 0) return 0;
+
+    rubiks_cube_clear_queue(rc);
+
+    if (count == 1 || rc->state == NULL) {
+        m = move_unpack(rc->history[redo ? rc->history_count : rc->history_count - 1]);
+        if (!redo) m = move_inverse(m);
+        if (!rotate_slice(rc, m.face, m.rot, m.slice)) return 0;
+
+        if (redo) rc->history_count++;
+        else      rc->history_count--;
+        return 1;
+    }
+
+    s = cube_state_copy(rc->state);
+    if (s == NULL) return 0;
+
+    for (i = 0; i < count; i++) {
+        if (redo) cube_state_apply_move(s, move_unpack(rc->history[rc->history_count + i]));
+        else      cube_state_apply_move(s, move_inverse(move_unpack(rc->history[rc->history_count - 1 - i])));
+    }
+
+    if (!rubiks_cube_set_state(rc, s)) count = 0;
+    else if (redo) rc->history_count += count;
+    else           rc->history_count -= count;
+
+    cube_state_free(s);
+    return count;
+}
+
+static int import_state(Rubiks_Cube *rc, const Cube_State *s)
+{
+    const char *reason;
+
+    if (!validate_state(s, &reason)) {
+        log_error("Cannot import impossible state: %s", reason);
+        return 0;
+    }
+    if (!rubiks_cube_set_state(rc, s)) return 0;
+
+    // the moves before the import do not lead to the new state
+    rubiks_cube_clear_history(rc);
+    log_info("Imported %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state", s->n, s->n, s->n);
+
+    return 1;
+}
+
+// indices of the cubies in their home positions, invisible cubies get the dummy index cubie_count
+static void reset_cubie_indices(Rubiks_Cube *rc)
+{
+    uint64_t w, h, d, i, ci;
+
+    for (i = 0; i < rc->max_length*rc->max_length*rc->max_length; i++)
+        rc->cubie_indices[i] = rc->cubie_count;
+
+    ci = 0;
+    for (d = 0; d < rc->d; d++) {
+        for (h = 0; h < rc->h; h++) {
+            for (w = 0; w < rc->w; w++) {
+                if (w > 0 && w < rc->w - 1 &&
+                    h > 0 && h < rc->h - 1 &&
+                    d > 0 && d < rc->d - 1) continue;
+
+                rc->cubie_indices[d*rc->h*rc->w + h*rc->w + w] = ci++;
+            }
+        }
+    }
+}
+
 void rotate_matrix_cw(uint64_t *a, uint64_t dimension, uint64_t xstride, uint64_t ystride, uint64_t start_index)
 {
     uint64_t x, y, tmp, i1, i2;
@@ -527,4 +1029,201 @@ void rotate_matrix_180(uint64_t *a, uint64_t dimension, uint64_t xstride, uint64
         a[i1] = a[i2];
         a[i2] = tmp;
     }
+}
+
+// Groups the positions into chunks and gives every chunk its range of the static mesh, which is sized
+// for the cubies in their home positions. Needs the cubie indices of the home positions.
+static int create_static_mesh(Rubiks_Cube *rc)
+{
+    Cube_Chunk *chunk;
+    uint64_t i, p, ci, position_count, vertex_count, index_count;
+
+    rc->chunks_w = (rc->w + CUBE_CHUNK_SIZE - 1) / CUBE_CHUNK_SIZE;
+    rc->chunks_h = (rc->h + CUBE_CHUNK_SIZE - 1) / CUBE_CHUNK_SIZE;
+    rc->chunk_count = rc->chunks_w * rc->chunks_h * ((rc->d + CUBE_CHUNK_SIZE - 1) / CUBE_CHUNK_SIZE);
+
+    rc->chunks = (Cube_Chunk *) calloc(rc->chunk_count, sizeof (Cube_Chunk));
+    rc->chunk_positions = (uint64_t *) malloc(rc->cubie_count * sizeof (uint64_t) + 1);
+    if (rc->chunks == NULL || rc->chunk_positions == NULL) {
+        log_error("Failed to allocate memory for the chunks of the cube");
+        return 0;
+    }
+
+    // count first, then every chunk gets the ranges following the previous chunk
+    for (p = 0; p < rc->w*rc->h*rc->d; p++) {
+        ci = rc->cubie_indices[p];
+        if (ci == rc->cubie_count) continue;
+
+        chunk = &rc->chunks[position_chunk(rc, p)];
+        chunk->position_count++;
+        chunk->vertex_count += rc->cubies[ci].mesh->vertex_count;
+        chunk->index_count  += rc->cubies[ci].mesh->index_count;
+    }
+
+    position_count = vertex_count = index_count = 0;
+    for (i = 0; i < rc->chunk_count; i++) {
+        chunk = &rc->chunks[i];
+        chunk->first_position = position_count;
+        chunk->first_vertex   = vertex_count;
+        chunk->first_index    = index_count;
+        position_count += chunk->position_count;
+        vertex_count   += chunk->vertex_count;
+        index_count    += chunk->index_count;
+
+        // filled again below
+        chunk->position_count = 0;
+        chunk->dirty = 1;
+    }
+
+    for (p = 0; p < rc->w*rc->h*rc->d; p++) {
+        if (rc->cubie_indices[p] == rc->cubie_count) continue;
+
+        chunk = &rc->chunks[position_chunk(rc, p)];
+        rc->chunk_positions[chunk->first_position + chunk->position_count++] = p;
+    }
+
+    // 16 bit indices are enough up to about 30x30x30
+    rc->static_index_type = vertex_count <= UINT16_MAX + 1 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    rc->static_index_count = (GLsizei) index_count;
+
+    rc->static_verts   = (Cube_Vertex *) malloc(vertex_count * sizeof (Cube_Vertex) + 1);
+    rc->static_indices = malloc(index_count * (rc->static_index_type == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t)) + 1);
+    if (rc->static_verts == NULL || rc->static_indices == NULL) {
+        log_error("Failed to allocate memory for the static mesh of the cube");
+        return 0;
+    }
+
+    glGenVertexArrays(1, &rc->static_vao);
+    glGenBuffers(1, &rc->static_vbo);
+    glGenBuffers(1, &rc->static_ebo);
+    if (rc->static_vao == 0 || rc->static_vbo == 0 || rc->static_ebo == 0) {
+        log_error("Failed to create buffers for the static mesh of the cube");
+        return 0;
+    }
+
+    gl_state_bind_vertex_array(rc->static_vao);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, rc->static_vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof (Cube_Vertex), NULL, GL_DYNAMIC_DRAW);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, rc->static_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * (rc->static_index_type == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t)),
+                 NULL, GL_DYNAMIC_DRAW);
+    cube_vertex_attributes();
+
+    log_debug("Split the static mesh into %" PRIu64 " chunks with %" PRIu64 " vertices", rc->chunk_count, vertex_count);
+
+    rc->static_dirty = 1;
+    return 1;
+}
+
+// index of the chunk containing a position of cubie_indices
+static uint64_t position_chunk(Rubiks_Cube *rc, uint64_t position)
+{
+    uint64_t w, h, d;
+
+    w = position % rc->w;
+    h = position / rc->w % rc->h;
+    d = position / (rc->w * rc->h);
+
+    return (d / CUBE_CHUNK_SIZE * rc->chunks_h + h / CUBE_CHUNK_SIZE) * rc->chunks_w + w / CUBE_CHUNK_SIZE;
+}
+
+static void mark_chunks_dirty(Rubiks_Cube *rc, int moving_only)
+{
+    uint64_t i;
+
+    for (i = 0; i < rc->chunk_count; i++) {
+        if (moving_only && !rc->chunks[i].moving) continue;
+
+        rc->chunks[i].dirty = 1;
+        rc->static_dirty = 1;
+    }
+}
+
+// After a reset or a load every chunk is dirty, then the whole mesh is baked first and uploaded with one call per buffer.
+static void bake_static_mesh(Rubiks_Cube *rc)
+{
+    const Cube_Chunk *last;
+    uint64_t i, dirty, index_size;
+
+    dirty = 0;
+    for (i = 0; i < rc->chunk_count; i++)
+        dirty += rc->chunks[i].dirty != 0;
+
+    for (i = 0; i < rc->chunk_count; i++) {
+        if (rc->chunks[i].dirty) bake_chunk(rc, &rc->chunks[i], dirty < rc->chunk_count);
+    }
+    rc->static_dirty = 0;
+
+    if (dirty < rc->chunk_count || rc->chunk_count == 0) return;
+
+    last = &rc->chunks[rc->chunk_count - 1];
+    index_size = rc->static_index_type == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t);
+
+    gl_state_bind_vertex_array(rc->static_vao);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, rc->static_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (last->first_vertex + last->vertex_count) * sizeof (Cube_Vertex), rc->static_verts);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, rc->static_index_count * index_size, rc->static_indices);
+    render_queue_buffer_changed(rc->static_vbo);
+    render_queue_buffer_changed(rc->static_ebo);
+}
+
+// Transforms the cubies of the chunk that are not moving into cube space and uploads the range of the chunk if upload is set.
+// The indices left over by moving cubies are degenerate triangles, so the whole mesh stays one draw.
+static void bake_chunk(Rubiks_Cube *rc, Cube_Chunk *chunk, int upload)
+{
+    const Cubie *c;
+    const Cubie_Mesh *mesh;
+    uint64_t i, ci, vc, ic, index_size;
+    GLsizei k;
+    Vec3 p;
+
+    chunk->dirty = 0;
+    chunk->moving = 0;
+    if (chunk->vertex_count == 0) return;
+
+    vc = chunk->first_vertex;
+    ic = chunk->first_index;
+    for (i = 0; i < chunk->position_count; i++) {
+        ci = rc->cubie_indices[rc->chunk_positions[chunk->first_position + i]];
+        c = &rc->cubies[ci];
+        mesh = c->mesh;
+
+        if (c->a.running) {
+            chunk->moving = 1;
+            continue;
+        }
+        // only possible if the cube is not a cube, moves mix the kinds of cubies then
+        if (vc + mesh->vertex_count > chunk->first_vertex + chunk->vertex_count ||
+            ic + mesh->index_count  > chunk->first_index  + chunk->index_count) continue;
+
+        for (k = 0; k < mesh->index_count; k++)
+            set_static_index(rc, ic++, (uint32_t) vc + mesh->indices[k]);
+
+        for (k = 0; k < mesh->vertex_count; k++) {
+            p = vec3_add(c->origin, cube_vertex_position(mesh->verts[k], rc->vertex_scale));
+            p = quat_rotatev3(p, c->ori);
+            rc->static_verts[vc++] = cube_vertex(p, rc->static_scale, cubie_vertex_color(c, mesh->verts[k].col));
+        }
+    }
+
+    while (ic < chunk->first_index + chunk->index_count)
+        set_static_index(rc, ic++, (uint32_t) chunk->first_vertex);
+    if (!upload) return;
+
+    index_size = rc->static_index_type == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t);
+
+    gl_state_bind_vertex_array(rc->static_vao);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, rc->static_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, chunk->first_vertex * sizeof (Cube_Vertex), (vc - chunk->first_vertex) * sizeof (Cube_Vertex),
+                    rc->static_verts + chunk->first_vertex);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, chunk->first_index * index_size, chunk->index_count * index_size,
+                    (uint8_t *) rc->static_indices + chunk->first_index * index_size);
+    render_queue_buffer_changed(rc->static_vbo);
+    render_queue_buffer_changed(rc->static_ebo);
+}
+
+static void set_static_index(Rubiks_Cube *rc, uint64_t i, uint32_t v)
+{
+    if (rc->static_index_type == GL_UNSIGNED_SHORT) ((uint16_t *) rc->static_indices)[i] = (uint16_t) v;
+    else                                            ((uint32_t *) rc->static_indices)[i] = v;
 }
\ No newline at end of file
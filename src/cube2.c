@@ -0,0 +1,203 @@
+#include "cube2.h"
+
+#include "logging.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// Optimal solver for the 2x2x2. U, R and F turns keep the DBL corner in place, so every state of the
+// other seven corners is reached with them. The distance of every state is kept in a table, a solution
+// always takes a move that brings the cube closer to solved.
+
+#define PERM_COUNT  5040
+#define TWIST_COUNT 729
+#define MOVE_COUNT  9
+
+static const int MOVES[MOVE_COUNT] = {
+    FACE_UP   * ROTATION_COUNT + ROTATION_CCW,
+    FACE_UP   * ROTATION_COUNT + ROTATION_180,
+    FACE_UP   * ROTATION_COUNT + ROTATION_CW,
+    FACE_RIGHT* ROTATION_COUNT + ROTATION_CCW,
+    FACE_RIGHT* ROTATION_COUNT + ROTATION_180,
+    FACE_RIGHT* ROTATION_COUNT + ROTATION_CW,
+    FACE_FRONT* ROTATION_COUNT + ROTATION_CCW,
+    FACE_FRONT* ROTATION_COUNT + ROTATION_180,
+    FACE_FRONT* ROTATION_COUNT + ROTATION_CW,
+};
+
+// the corner positions except DBL, the twist of the last one follows from the others
+static const int POSITIONS[CORNER_COUNT - 1] = {
+    CORNER_URF, CORNER_UFL, CORNER_ULB, CORNER_UBR, CORNER_DFR, CORNER_DLF, CORNER_DRB,
+};
+
+static uint16_t perm_move [PERM_COUNT  * MOVE_COUNT];
+static uint16_t twist_move[TWIST_COUNT * MOVE_COUNT];
+static uint8_t  distance[CUBE2_STATE_COUNT];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static int  get_perm(const Cube3 *c);
+static int  get_twist(const Cube3 *c);
+static void set_perm(Cube3 *c, int perm);
+static void set_twist(Cube3 *c, int twist);
+static void init_tables(void);
+
+// Generates the move and distance tables, safe to call from multiple threads.
+void cube2_init(void)
+{
+    pthread_once(&tables_once, init_tables);
+}
+
+// Finds a shortest solution of the corners of c, which has to have the DBL corner solved, and writes it into
+// moves, which has to hold CUBE2_MAX_LENGTH moves. The edges are ignored. Returns the length or -1 if c is invalid.
+int cube2_solve(const Cube3 *c, Rubiks_Cube_Move *moves)
+{
+    int perm, twist, length, m, p, t, i, sum;
+
+    if (c->cp[CORNER_DBL] != CORNER_DBL || c->co[CORNER_DBL] != 0) {
+        log_error("Cannot solve 2x2x2, the DBL corner has to be solved");
+        return -1;
+    }
+
+    for (i = 0, sum = 0; i < CORNER_COUNT; i++)
+        sum += c->co[i];
+    if (sum % 3 != 0) {
+        log_error("Cannot solve 2x2x2, the corners are twisted");
+        return -1;
+    }
+
+    cube2_init();
+
+    perm  = get_perm(c);
+    twist = get_twist(c);
+
+    length = 0;
+    while (distance[perm * TWIST_COUNT + twist] > 0) {
+        for (m = 0; m < MOVE_COUNT; m++) {
+            p = perm_move [perm  * MOVE_COUNT + m];
+            t = twist_move[twist * MOVE_COUNT + m];
+            if (distance[p * TWIST_COUNT + t] < distance[perm * TWIST_COUNT + twist]) break;
+        }
+
+        moves[length++] = cube3_move(MOVES[m]);
+        perm  = p;
+        twist = t;
+    }
+
+    return length;
+}
+
+
+// lehmer code of the corners at the positions except DBL, corner DRB is counted as the one after DLF
+static int get_perm(const Cube3 *c)
+{
+    int i, j, smaller, rank;
+
+    rank = 0;
+    for (i = 0; i < CORNER_COUNT - 1; i++) {
+        smaller = 0;
+        for (j = i+1; j < CORNER_COUNT - 1; j++) {
+            if (c->cp[POSITIONS[j]] < c->cp[POSITIONS[i]]) smaller++;
+        }
+        rank = rank * (CORNER_COUNT - 1 - i) + smaller;
+    }
+
+    return rank;
+}
+
+static int get_twist(const Cube3 *c)
+{
+    int i, twist;
+
+    twist = 0;
+    for (i = 0; i < CORNER_COUNT - 2; i++)
+        twist = 3*twist + c->co[POSITIONS[i]];
+
+    return twist;
+}
+
+static void set_perm(Cube3 *c, int perm)
+{
+    int digits[CORNER_COUNT - 1];
+    int used[CORNER_COUNT - 1] = {0};
+    int i, j, k;
+
+    for (i = CORNER_COUNT - 2; i >= 0; i--) {
+        digits[i] = perm % (CORNER_COUNT - 1 - i);
+        perm /= CORNER_COUNT - 1 - i;
+    }
+
+    // the digit is the number of smaller corners that are still left
+    for (i = 0; i < CORNER_COUNT - 1; i++) {
+        for (j = 0, k = digits[i]; used[j] || k > 0; j++) {
+            if (!used[j]) k--;
+        }
+        used[j] = 1;
+        c->cp[POSITIONS[i]] = POSITIONS[j];
+    }
+}
+
+static void set_twist(Cube3 *c, int twist)
+{
+    int i, sum;
+
+    sum = 0;
+    for (i = CORNER_COUNT - 3; i >= 0; i--) {
+        c->co[POSITIONS[i]] = twist % 3;
+        sum += c->co[POSITIONS[i]];
+        twist /= 3;
+    }
+    c->co[CORNER_DRB] = (3 - sum % 3) % 3;
+}
+
+// breadth first search from the solved state, one scan over the table per depth
+static void init_tables(void)
+{
+    Cube3 c, d;
+    int i, m, depth, p, t;
+    uint32_t s, next, found;
+
+    log_info("Generating 2x2x2 solver tables...");
+
+    cube3_init();
+
+    for (i = 0; i < PERM_COUNT; i++) {
+        c = cube3_solved();
+        set_perm(&c, i);
+        for (m = 0; m < MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, MOVES[m]);
+            perm_move[i * MOVE_COUNT + m] = (uint16_t) get_perm(&d);
+        }
+    }
+
+    for (i = 0; i < TWIST_COUNT; i++) {
+        c = cube3_solved();
+        set_twist(&c, i);
+        for (m = 0; m < MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, MOVES[m]);
+            twist_move[i * MOVE_COUNT + m] = (uint16_t) get_twist(&d);
+        }
+    }
+
+    memset(distance, 0xff, sizeof (distance));
+    distance[0] = 0;
+
+    found = 1;
+    for (depth = 0; found > 0; depth++) {
+        found = 0;
+        for (s = 0; s < CUBE2_STATE_COUNT; s++) {
+            if (distance[s] != depth) continue;
+
+            p = s / TWIST_COUNT;
+            t = s % TWIST_COUNT;
+            for (m = 0; m < MOVE_COUNT; m++) {
+                next = perm_move[p * MOVE_COUNT + m] * TWIST_COUNT + twist_move[t * MOVE_COUNT + m];
+                if (distance[next] != 0xff) continue;
+
+                distance[next] = (uint8_t) (depth + 1);
+                found++;
+            }
+        }
+    }
+
+    log_info("Finished generating 2x2x2 solver tables");
+}
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "cube3.h"
+
+#include "logging.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// coordinates of the cubies, 0 is the lower end of an axis, 1 the upper end and 2 the middle
+static const uint8_t CORNER_COORDS[CORNER_COUNT][3] = {
+    [CORNER_URF] = {1, 1, 1},
+    [CORNER_UFL] = {0, 1, 1},
+    [CORNER_ULB] = {0, 1, 0},
+    [CORNER_UBR] = {1, 1, 0},
+    [CORNER_DFR] = {1, 0, 1},
+    [CORNER_DLF] = {0, 0, 1},
+    [CORNER_DBL] = {0, 0, 0},
+    [CORNER_DRB] = {1, 0, 0},
+};
+
+static const uint8_t CORNER_FACES[CORNER_COUNT][3] = {
+    [CORNER_URF] = {FACE_UP,   FACE_RIGHT, FACE_FRONT},
+    [CORNER_UFL] = {FACE_UP,   FACE_FRONT, FACE_LEFT },
+    [CORNER_ULB] = {FACE_UP,   FACE_LEFT,  FACE_BACK },
+    [CORNER_UBR] = {FACE_UP,   FACE_BACK,  FACE_RIGHT},
+    [CORNER_DFR] = {FACE_DOWN, FACE_FRONT, FACE_RIGHT},
+    [CORNER_DLF] = {FACE_DOWN, FACE_LEFT,  FACE_FRONT},
+    [CORNER_DBL] = {FACE_DOWN, FACE_BACK,  FACE_LEFT },
+    [CORNER_DRB] = {FACE_DOWN, FACE_RIGHT, FACE_BACK },
+};
+
+static const uint8_t EDGE_COORDS[EDGE_COUNT][3] = {
+    [EDGE_UR] = {1, 1, 2},
+    [EDGE_UF] = {2, 1, 1},
+    [EDGE_UL] = {0, 1, 2},
+    [EDGE_UB] = {2, 1, 0},
+    [EDGE_DR] = {1, 0, 2},
+    [EDGE_DF] = {2, 0, 1},
+    [EDGE_DL] = {0, 0, 2},
+    [EDGE_DB] = {2, 0, 0},
+    [EDGE_FR] = {1, 2, 1},
+    [EDGE_FL] = {0, 2, 1},
+    [EDGE_BL] = {0, 2, 0},
+    [EDGE_BR] = {1, 2, 0},
+};
+
+static const uint8_t EDGE_FACES[EDGE_COUNT][2] = {
+    [EDGE_UR] = {FACE_UP,    FACE_RIGHT},
+    [EDGE_UF] = {FACE_UP,    FACE_FRONT},
+    [EDGE_UL] = {FACE_UP,    FACE_LEFT },
+    [EDGE_UB] = {FACE_UP,    FACE_BACK },
+    [EDGE_DR] = {FACE_DOWN,  FACE_RIGHT},
+    [EDGE_DF] = {FACE_DOWN,  FACE_FRONT},
+    [EDGE_DL] = {FACE_DOWN,  FACE_LEFT },
+    [EDGE_DB] = {FACE_DOWN,  FACE_BACK },
+    [EDGE_FR] = {FACE_FRONT, FACE_RIGHT},
+    [EDGE_FL] = {FACE_FRONT, FACE_LEFT },
+    [EDGE_BL] = {FACE_BACK,  FACE_LEFT },
+    [EDGE_BR] = {FACE_BACK,  FACE_RIGHT},
+};
+
+static Cube3 move_cubes[CUBE3_MOVE_COUNT];
+static pthread_once_t move_cubes_once = PTHREAD_ONCE_INIT;
+
+static uint64_t coordinate(uint64_t n, uint8_t c);
+static int permutation_parity(const uint8_t *p, int count);
+static void init_move_cubes(void);
+
+// Computes the cubie level effect of every outer layer move from the sticker model, safe to call from multiple threads.
+void cube3_init(void)
+{
+    pthread_once(&move_cubes_once, init_move_cubes);
+}
+
+Cube3 cube3_solved(void)
+{
+    Cube3 c;
+    int i;
+
+    for (i = 0; i < CORNER_COUNT; i++) {
+        c.cp[i] = i;
+        c.co[i] = 0;
+    }
+    for (i = 0; i < EDGE_COUNT; i++) {
+        c.ep[i] = i;
+        c.eo[i] = 0;
+    }
+
+    return c;
+}
+
+// the cube you get by first applying a and then b
+Cube3 cube3_multiply(Cube3 a, Cube3 b)
+{
+    Cube3 c;
+    int i;
+
+    for (i = 0; i < CORNER_COUNT; i++) {
+        c.cp[i] = a.cp[b.cp[i]];
+        c.co[i] = (a.co[b.cp[i]] + b.co[i]) % 3;
+    }
+    for (i = 0; i < EDGE_COUNT; i++) {
+        c.ep[i] = a.ep[b.ep[i]];
+        c.eo[i] = (a.eo[b.ep[i]] + b.eo[i]) % 2;
+    }
+
+    return c;
+}
+
+Cube3 cube3_apply_move(Cube3 c, int move)
+{
+    cube3_init();
+    return cube3_multiply(c, move_cubes[move]);
+}
+
+int cube3_is_solved(const Cube3 *c)
+{
+    Cube3 s;
+
+    s = cube3_solved();
+    return memcmp(c, &s, sizeof (Cube3)) == 0;
+}
+
+int cube3_corner_parity(const Cube3 *c)
+{
+    return permutation_parity(c->cp, CORNER_COUNT);
+}
+
+int cube3_edge_parity(const Cube3 *c)
+{
+    return permutation_parity(c->ep, EDGE_COUNT);
+}
+
+// checks if the cube could be solved by moves
+int cube3_is_valid(const Cube3 *c)
+{
+    int i, twist, flip, seen;
+
+    seen = 0;
+    twist = 0;
+    for (i = 0; i < CORNER_COUNT; i++) {
+        if (c->cp[i] >= CORNER_COUNT || c->co[i] > 2) return 0;
+        seen |= 1 << c->cp[i];
+        twist += c->co[i];
+    }
+    if (seen != (1 << CORNER_COUNT) - 1 || twist % 3 != 0) return 0;
+
+    seen = 0;
+    flip = 0;
+    for (i = 0; i < EDGE_COUNT; i++) {
+        if (c->ep[i] >= EDGE_COUNT || c->eo[i] > 1) return 0;
+        seen |= 1 << c->ep[i];
+        flip += c->eo[i];
+    }
+    if (seen != (1 << EDGE_COUNT) - 1 || flip % 2 != 0) return 0;
+
+    return cube3_corner_parity(c) == cube3_edge_parity(c);
+}
+
+// Reads the corners and, for odd side lengths, the middle edges of s. The centers have to be in
+// their home positions. For even side lengths the edges are set to solved. Returns 0 if a
+// corner or edge has a color combination that doesn't exist.
+int cube3_from_state(const Cube_State *s, Cube3 *c)
+{
+    uint64_t n, x, y, z;
+    uint8_t col[3];
+    int i, j, k, o;
+
+    n = s->n;
+    if (n < 2) return 0;
+
+    *c = cube3_solved();
+
+    for (i = 0; i < CORNER_COUNT; i++) {
+        x = coordinate(n, CORNER_COORDS[i][0]);
+        y = coordinate(n, CORNER_COORDS[i][1]);
+        z = coordinate(n, CORNER_COORDS[i][2]);
+        for (j = 0; j < 3; j++)
+            col[j] = s->stickers[cube_state_sticker_at(n, CORNER_FACES[i][j], x, y, z)];
+
+        for (o = 0; o < 3; o++) {
+            if (col[o] == FACE_UP || col[o] == FACE_DOWN) break;
+        }
+        if (o == 3) return 0;
+
+        for (k = 0; k < CORNER_COUNT; k++) {
+            if (CORNER_FACES[k][0] == col[o] &&
+                CORNER_FACES[k][1] == col[(o+1) % 3] &&
+                CORNER_FACES[k][2] == col[(o+2) % 3]) break;
+        }
+        if (k == CORNER_COUNT) return 0;
+
+        c->cp[i] = k;
+        c->co[i] = o;
+    }
+
+    if (n % 2 == 0) return 1;
+
+    for (i = 0; i < EDGE_COUNT; i++) {
+        x = coordinate(n, EDGE_COORDS[i][0]);
+        y = coordinate(n, EDGE_COORDS[i][1]);
+        z = coordinate(n, EDGE_COORDS[i][2]);
+        for (j = 0; j < 2; j++)
+            col[j] = s->stickers[cube_state_sticker_at(n, EDGE_FACES[i][j], x, y, z)];
+
+        for (k = 0; k < EDGE_COUNT; k++) {
+            if (EDGE_FACES[k][0] == col[0] && EDGE_FACES[k][1] == col[1]) { o = 0; break; }
+            if (EDGE_FACES[k][0] == col[1] && EDGE_FACES[k][1] == col[0]) { o = 1; break; }
+        }
+        if (k == EDGE_COUNT) return 0;
+
+        c->ep[i] = k;
+        c->eo[i] = o;
+    }
+
+    return 1;
+}
+
+// writes the corners and, for odd side lengths, the middle edges of c into s
+void cube3_to_state(const Cube3 *c, Cube_State *s)
+{
+    uint64_t n, x, y, z;
+    int i, j;
+
+    n = s->n;
+    if (n < 2) return;
+
+    for (i = 0; i < CORNER_COUNT; i++) {
+        x = coordinate(n, CORNER_COORDS[i][0]);
+        y = coordinate(n, CORNER_COORDS[i][1]);
+        z = coordinate(n, CORNER_COORDS[i][2]);
+        for (j = 0; j < 3; j++) {
+            s->stickers[cube_state_sticker_at(n, CORNER_FACES[i][(c->co[i] + j) % 3], x, y, z)] = CORNER_FACES[c->cp[i]][j];
+        }
+    }
+
+    if (n % 2 == 0) return;
+
+    for (i = 0; i < EDGE_COUNT; i++) {
+        x = coordinate(n, EDGE_COORDS[i][0]);
+        y = coordinate(n, EDGE_COORDS[i][1]);
+        z = coordinate(n, EDGE_COORDS[i][2]);
+        for (j = 0; j < 2; j++) {
+            s->stickers[cube_state_sticker_at(n, EDGE_FACES[i][(c->eo[i] + j) % 2], x, y, z)] = EDGE_FACES[c->ep[i]][j];
+        }
+    }
+}
+
+Rubiks_Cube_Move cube3_move(int move)
+{
+    return rubiks_cube_move(move / ROTATION_COUNT, move % ROTATION_COUNT, 0);
+}
+
+
+static uint64_t coordinate(uint64_t n, uint8_t c)
+{
+    if (c == 0) return 0;
+    if (c == 1) return n-1;
+    return (n-1) / 2;
+}
+
+static int permutation_parity(const uint8_t *p, int count)
+{
+    int i, j, parity;
+
+    parity = 0;
+    for (i = 0; i < count; i++) {
+        for (j = i+1; j < count; j++) {
+            if (p[i] > p[j]) parity ^= 1;
+        }
+    }
+
+    return parity;
+}
+
+static void init_move_cubes(void)
+{
+    Cube_State *s;
+    int m;
+
+    s = cube_state(3);
+    if (s == NULL) {
+        log_error_and_exit(1, "Failed to create cube state for 3x3x3 move tables");
+    }
+
+    for (m = 0; m < CUBE3_MOVE_COUNT; m++) {
+        cube_state_reset(s);
+        cube_state_apply_move(s, cube3_move(m));
+        cube3_from_state(s, &move_cubes[m]);
+    }
+
+    cube_state_free(s);
+}
\ No newline at end of file
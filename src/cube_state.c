@@ -0,0 +1,407 @@
+#include "cube_state.h"
+
+#include "logging.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+// faces in the order of a facelet string, see cube_state_from_facelets()
+static const Rubiks_Cube_Face FACELET_ORDER[FACE_COUNT] = {FACE_UP, FACE_RIGHT, FACE_FRONT, FACE_DOWN, FACE_LEFT, FACE_BACK};
+static const char FACELET_CHARS[FACE_COUNT] = {
+    [FACE_FRONT] = 'F',
+    [FACE_UP]    = 'U',
+    [FACE_LEFT]  = 'L',
+    [FACE_BACK]  = 'B',
+    [FACE_DOWN]  = 'D',
+    [FACE_RIGHT] = 'R',
+};
+
+// axis (0 = x, 1 = y, 2 = z) and direction of the outward normal of each face
+static const int FACE_AXIS[FACE_COUNT] = {2, 1, 0, 2, 1, 0};
+static const int FACE_SIGN[FACE_COUNT] = {1, 1, -1, -1, -1, 1};
+
+static void rotate_ccw(int64_t v[3], int axis, int sign);
+static uint64_t layer_coordinate(uint64_t n, Rubiks_Cube_Face face, uint64_t slice);
+
+Cube_State *cube_state(uint64_t n)
+{
+    Cube_State *s;
+
+    if (n == 0) {
+        log_error("Cannot create cube state with side length 0");
+        return NULL;
+    }
+
+    s = (Cube_State *) calloc(1, sizeof (Cube_State));
+    if (s == NULL) {
+        log_error("Failed to allocate memory for cube state");
+        return NULL;
+    }
+
+    s->n = n;
+
+    s->stickers = (uint8_t *) malloc(FACE_COUNT * n * n * sizeof (uint8_t));
+    if (s->stickers == NULL) {
+        log_error("Failed to allocate memory for %" PRIu64 " stickers", FACE_COUNT * n * n);
+        cube_state_free(s);
+        return NULL;
+    }
+
+    // a slice touches at most two complete faces and four rows
+    s->scratch = (uint64_t *) malloc((2*n*n + 4*n) * sizeof (uint64_t));
+    s->scratch_colors = (uint8_t *) malloc((2*n*n + 4*n) * sizeof (uint8_t));
+    if (s->scratch == NULL || s->scratch_colors == NULL) {
+        log_error("Failed to allocate scratch memory for cube state");
+        cube_state_free(s);
+        return NULL;
+    }
+
+    cube_state_reset(s);
+
+    return s;
+}
+
+Cube_State *cube_state_copy(const Cube_State *s)
+{
+    Cube_State *c;
+
+    c = cube_state(s->n);
+    if (c == NULL) return NULL;
+
+    memcpy(c->stickers, s->stickers, FACE_COUNT * s->n * s->n * sizeof (uint8_t));
+
+    return c;
+}
+
+// Parses a facelet string like the ones used by Kociemba's solver. The faces are given in the order
+// U, R, F, D, L, B with n*n stickers each, every sticker is the letter of the face it belongs to.
+Cube_State *cube_state_from_facelets(const char *facelets)
+{
+    Cube_State *s;
+    uint64_t length, n, f, i;
+    int c;
+
+    length = strlen(facelets);
+    for (n = 1; FACE_COUNT * n * n < length; n++);
+    if (FACE_COUNT * n * n != length) {
+        log_error("Facelet string has an invalid length of %" PRIu64 ", it needs 6*n*n stickers", length);
+        return NULL;
+    }
+
+    s = cube_state(n);
+    if (s == NULL) return NULL;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (i = 0; i < n*n; i++) {
+            for (c = 0; c < FACE_COUNT; c++) {
+                if (FACELET_CHARS[c] == facelets[f*n*n + i]) break;
+            }
+            if (c == FACE_COUNT) {
+                log_error("Invalid facelet '%c' at position %" PRIu64, facelets[f*n*n + i], f*n*n + i);
+                cube_state_free(s);
+                return NULL;
+            }
+
+            s->stickers[FACELET_ORDER[f]*n*n + i] = c;
+        }
+    }
+
+    return s;
+}
+
+// Formats s as facelet string in the format of cube_state_from_facelets(). The string has to be freed by the caller.
+char *cube_state_to_facelets(const Cube_State *s)
+{
+    char *facelets;
+    uint64_t nn, f, i;
+
+    nn = s->n * s->n;
+    facelets = (char *) malloc(FACE_COUNT * nn + 1);
+    if (facelets == NULL) {
+        log_error("Failed to allocate memory for %" PRIu64 " facelets", FACE_COUNT * nn);
+        return NULL;
+    }
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (i = 0; i < nn; i++)
+            facelets[f*nn + i] = FACELET_CHARS[s->stickers[FACELET_ORDER[f]*nn + i]];
+    }
+    facelets[FACE_COUNT * nn] = '\0';
+
+    return facelets;
+}
+
+void cube_state_reset(Cube_State *s)
+{
+    uint64_t f;
+
+    for (f = 0; f < FACE_COUNT; f++)
+        memset(&s->stickers[f * s->n * s->n], (int) f, s->n * s->n);
+}
+
+// a cube counts as solved if every face has a single color, no matter which
+int cube_state_is_solved(const Cube_State *s)
+{
+    uint64_t f, i, nn;
+
+    nn = s->n * s->n;
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (i = 1; i < nn; i++) {
+            if (s->stickers[f*nn + i] != s->stickers[f*nn]) return 0;
+        }
+    }
+
+    return 1;
+}
+
+// FNV-1a hash of the stickers, hash the canonical state (see cube_symmetry_canonical()) to treat symmetric states as equal
+uint64_t cube_state_hash(const Cube_State *s)
+{
+    uint64_t hash, i;
+
+    hash = 14695981039346656037ULL;
+    for (i = 0; i < FACE_COUNT * s->n * s->n; i++) {
+        hash ^= s->stickers[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Stickers packed for files, two per byte with the first one in the low nibble.
+uint64_t cube_state_packed_size(uint64_t n)
+{
+    return (FACE_COUNT * n * n + 1) / 2;
+}
+
+void cube_state_pack(const Cube_State *s, uint8_t *packed)
+{
+    uint64_t i, count;
+
+    count = FACE_COUNT * s->n * s->n;
+    for (i = 0; i + 1 < count; i += 2)
+        packed[i / 2] = s->stickers[i] | s->stickers[i+1] << 4;
+    if (count % 2 != 0)
+        packed[count / 2] = s->stickers[count-1];
+}
+
+// Returns 0 if a sticker does not belong to any face, s is partly overwritten then.
+int cube_state_unpack(Cube_State *s, const uint8_t *packed)
+{
+    uint64_t i, count;
+    uint8_t sticker;
+
+    count = FACE_COUNT * s->n * s->n;
+    for (i = 0; i < count; i++) {
+        sticker = (packed[i / 2] >> (4 * (i & 1))) & 0xf;
+        if (sticker >= FACE_COUNT) return 0;
+        s->stickers[i] = sticker;
+    }
+
+    return 1;
+}
+
+void cube_state_rotate_slice(Cube_State *s, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice)
+{
+    uint64_t n, count, i;
+
+    n = s->n;
+
+    if (face >= FACE_COUNT || rot >= ROTATION_COUNT) {
+        log_warning("Invalid move (face %d, rotation %d), skipping", (int) face, (int) rot);
+        return;
+    }
+    if (slice >= n) {
+        log_warning("Slice index is out of range %" PRIu64 " >= %" PRIu64 ", skipping move", slice, n);
+        return;
+    }
+
+    count = cube_state_slice_stickers(n, face, slice, s->scratch);
+
+    for (i = 0; i < count; i++)
+        s->scratch_colors[i] = s->stickers[s->scratch[i]];
+
+    for (i = 0; i < count; i++)
+        s->stickers[cube_state_move_sticker(n, s->scratch[i], rubiks_cube_move(face, rot, slice))] = s->scratch_colors[i];
+}
+
+void cube_state_apply_move(Cube_State *s, Rubiks_Cube_Move m)
+{
+    cube_state_rotate_slice(s, m.face, m.rot, m.slice);
+}
+
+void cube_state_apply_moves(Cube_State *s, const Rubiks_Cube_Move *moves, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+        cube_state_rotate_slice(s, moves[i].face, moves[i].rot, moves[i].slice);
+}
+
+void cube_state_free(Cube_State *s)
+{
+    if (s == NULL) return;
+
+    if (s->stickers != NULL)
+        free(s->stickers);
+
+    if (s->scratch != NULL)
+        free(s->scratch);
+
+    if (s->scratch_colors != NULL)
+        free(s->scratch_colors);
+
+    free(s);
+}
+
+uint64_t cube_state_sticker_index(uint64_t n, Rubiks_Cube_Face face, uint64_t row, uint64_t col)
+{
+    return face*n*n + row*n + col;
+}
+
+// index of the sticker on face of the cubie at x, y, z, the cubie has to lie on that face
+uint64_t cube_state_sticker_at(uint64_t n, Rubiks_Cube_Face face, uint64_t x, uint64_t y, uint64_t z)
+{
+    uint64_t r, c;
+
+    switch (face) {
+        case FACE_FRONT: r = n-1-y; c = x;     break;
+        case FACE_UP:    r = z;     c = x;     break;
+        case FACE_LEFT:  r = n-1-y; c = z;     break;
+        case FACE_BACK:  r = n-1-y; c = n-1-x; break;
+        case FACE_DOWN:  r = n-1-z; c = x;     break;
+        case FACE_RIGHT: r = n-1-y; c = n-1-z; break;
+        default: return 0;
+    }
+
+    return cube_state_sticker_index(n, face, r, c);
+}
+
+void cube_state_sticker_cubie(uint64_t n, uint64_t sticker, uint64_t *x, uint64_t *y, uint64_t *z)
+{
+    uint64_t f, r, c;
+
+    f = sticker / (n*n);
+    r = (sticker % (n*n)) / n;
+    c = sticker % n;
+
+    switch (f) {
+        case FACE_FRONT: *x = c;     *y = n-1-r; *z = n-1;   break;
+        case FACE_UP:    *x = c;     *y = n-1;   *z = r;     break;
+        case FACE_LEFT:  *x = 0;     *y = n-1-r; *z = c;     break;
+        case FACE_BACK:  *x = n-1-c; *y = n-1-r; *z = 0;     break;
+        case FACE_DOWN:  *x = c;     *y = 0;     *z = n-1-r; break;
+        case FACE_RIGHT: *x = n-1;   *y = n-1-r; *z = n-1-c; break;
+    }
+}
+
+// Writes the index of every sticker of the slice into stickers and returns their number.
+// A slice touches at most two complete faces and four rows, so stickers has to hold 2*n*n + 4*n indices.
+uint64_t cube_state_slice_stickers(uint64_t n, Rubiks_Cube_Face face, uint64_t slice, uint64_t *stickers)
+{
+    uint64_t layer, count, f, i;
+    int axis;
+
+    axis  = FACE_AXIS[face];
+    layer = layer_coordinate(n, face, slice);
+
+    count = 0;
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (FACE_AXIS[f] == axis) {
+            // face is parallel to the slice, it is only affected if it is part of the slice
+            if ((FACE_SIGN[f] > 0 ? n-1 : 0) != layer) continue;
+
+            for (i = 0; i < n*n; i++)
+                stickers[count++] = f*n*n + i;
+        } else {
+            for (i = 0; i < n; i++)
+                stickers[count++] = cube_state_slice_sticker(n, face, slice, f, i);
+        }
+    }
+
+    return count;
+}
+
+// The slice cuts through one row or column of every face side that is not parallel to it,
+// returns the i-th sticker of that row or column in the order of cube_state_slice_stickers().
+uint64_t cube_state_slice_sticker(uint64_t n, Rubiks_Cube_Face face, uint64_t slice, Rubiks_Cube_Face side, uint64_t i)
+{
+    uint64_t p[3];
+    int axis, other;
+
+    axis  = FACE_AXIS[face];
+    other = 3 - axis - FACE_AXIS[side];
+    p[FACE_AXIS[side]] = FACE_SIGN[side] > 0 ? n-1 : 0;
+    p[axis]  = layer_coordinate(n, face, slice);
+    p[other] = i;
+
+    return cube_state_sticker_at(n, side, p[0], p[1], p[2]);
+}
+
+// returns the index the sticker is moved to by m
+uint64_t cube_state_move_sticker(uint64_t n, uint64_t sticker, Rubiks_Cube_Move m)
+{
+    uint64_t p[3];
+    int64_t pos[3], normal[3];
+    int i, axis, sign, face;
+
+    cube_state_sticker_cubie(n, sticker, &p[0], &p[1], &p[2]);
+
+    axis = FACE_AXIS[m.face];
+    sign = FACE_SIGN[m.face];
+    if (p[axis] != layer_coordinate(n, m.face, m.slice)) return sticker;
+
+    // rotate around the center of the cube, coordinates are doubled to keep them integral
+    face = sticker / (n*n);
+    for (i = 0; i < 3; i++)
+        pos[i] = 2*(int64_t)p[i] - (int64_t)(n-1);
+    cube_state_face_normal(face, normal);
+
+    // ROTATION_CCW is a quarter turn, ROTATION_180 two and ROTATION_CW three
+    for (i = 0; i <= m.rot; i++) {
+        rotate_ccw(pos, axis, sign);
+        rotate_ccw(normal, axis, sign);
+    }
+
+    for (i = 0; i < 3; i++)
+        p[i] = (uint64_t)((pos[i] + (int64_t)(n-1)) / 2);
+
+    return cube_state_sticker_at(n, cube_state_face_from_normal(normal), p[0], p[1], p[2]);
+}
+
+// outward normal of face, a unit vector along one axis
+void cube_state_face_normal(Rubiks_Cube_Face face, int64_t normal[3])
+{
+    normal[0] = normal[1] = normal[2] = 0;
+    normal[FACE_AXIS[face]] = FACE_SIGN[face];
+}
+
+Rubiks_Cube_Face cube_state_face_from_normal(const int64_t normal[3])
+{
+    if (normal[0] > 0) return FACE_RIGHT;
+    if (normal[0] < 0) return FACE_LEFT;
+    if (normal[1] > 0) return FACE_UP;
+    if (normal[1] < 0) return FACE_DOWN;
+    if (normal[2] > 0) return FACE_FRONT;
+    return FACE_BACK;
+}
+
+// quarter turn counter-clockwise around the axis pointing in direction sign
+static void rotate_ccw(int64_t v[3], int axis, int sign)
+{
+    int64_t a, b;
+
+    // the two remaining axes in right-handed order
+    a = v[(axis+1) % 3];
+    b = v[(axis+2) % 3];
+
+    v[(axis+1) % 3] = -sign * b;
+    v[(axis+2) % 3] =  sign * a;
+}
+
+// coordinate along the axis of face that the slice lies at
+static uint64_t layer_coordinate(uint64_t n, Rubiks_Cube_Face face, uint64_t slice)
+{
+    if (FACE_SIGN[face] > 0) return n-1-slice;
+    return slice;
+}
\ No newline at end of file
@@ -1,11 +1,11 @@
 #include "cubie.h"
 
+#include "gl_state.h"
 #include "logging.h"
 #include "smath.h"
 
 #include <inttypes.h>
-#include <malloc.h>
-#include <stddef.h>
+#include <string.h>
 
 // unit cube, length = 1, origin at top left corner 
 const Vec3 cubie_coords[] = {
@@ -45,32 +45,19 @@ const uint8_t face_indices[] = {
     1 + ARRAY_LENGTH(cubie_coords), 3 + ARRAY_LENGTH(cubie_coords), 2 + ARRAY_LENGTH(cubie_coords),
 };
 
-Cubie cubie(Cubie_Config *cconf)
+// Generates the mesh for the color mask of the config. Returns 0 if the buffers could not be created.
+int cubie_mesh(Cubie_Mesh *m, Cubie_Config *cconf)
 {
-    Cubie c;
-    uint8_t i, face_count;
+    Cube_Vertex *verts;
+    uint8_t *indices;
+    uint8_t i;
     uint64_t vc, ic, face_indices_offset;
     Vec3 face_origin, scaled_face_coords[ARRAY_LENGTH(face_coords)];
     float face_length, border_width;
 
-    face_count = 0;
-    for (i = 0; i < COLOR_MASK_COUNT; i++) {
-        if (cconf->color_mask & (1 << i)) face_count++;
-    }
-
-    // allocate memory for vertices, division by 3 because face_coords[] packs the 3 different planes a face can be on
-    c.vertex_count = ARRAY_LENGTH(cubie_coords) + face_count * ARRAY_LENGTH(face_coords) / 3;
-    c.verts = (Cube_Vertex *) malloc(c.vertex_count * sizeof (Cube_Vertex));
-
-    // allocate memory for indices, division by 2 because face_indices[] packs counter- and clockwise rotated faces
-    c.index_count = ARRAY_LENGTH(cubie_indices) + face_count * ARRAY_LENGTH(face_indices) / 2;
-    c.indices = (uint32_t *) malloc(c.index_count * sizeof (uint32_t));
-
-    c.ori = quat_identity();
-
-    c.a = (Animation) {0};
-    c.a.efunc = linear;
-    c.a.data.q.end = c.ori;
+    m->color_mask = cconf->color_mask;
+    verts = m->verts;
+    indices = m->indices;
 
     face_length = cconf->side_length * cconf->face_length_multiplier;
 
@@ -81,18 +68,12 @@ Cubie cubie(Cubie_Config *cconf)
 
     // cubie_coords are the same for every cubie
     for (vc = 0; vc < ARRAY_LENGTH(cubie_coords); vc++) {
-        // scale and offset the vertices
-        c.verts[vc] = cube_vertex(
-            vec3_add(cconf->origin, vec3_scale(cubie_coords[vc], cconf->side_length)),
-            cconf->face_colors[COLOR_BORDER]
-        );
+        verts[vc] = cube_vertex(vec3_scale(cubie_coords[vc], cconf->side_length), cconf->vertex_scale, COLOR_BORDER);
     }
 
     // cubie_indices are the same for every cubie
-    // TODO: maybe use memcpy() ?
-    for (ic = 0; ic < ARRAY_LENGTH(cubie_indices); ic++) {
-        c.indices[ic] = cubie_indices[ic];
-    }
+    memcpy(indices, cubie_indices, sizeof (cubie_indices));
+    ic = ARRAY_LENGTH(cubie_indices);
 
     // dont allow negative border_width
     border_width = fabsf(cconf->side_length - face_length) / 2.0f;
@@ -103,22 +84,22 @@ Cubie cubie(Cubie_Config *cconf)
     // generate the coordinates of the faces
     if (cconf->color_mask & COLOR_MASK_FRONT) {
         face_origin = vec3(
-            cconf->origin.x + border_width,
-            cconf->origin.y - border_width,
-            cconf->origin.z + cconf->face_offset_from_cubie
+            border_width,
+            -border_width,
+            cconf->face_offset_from_cubie
         );
 
         // face is in xy-plane so use first 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i]),
-                cconf->face_colors[COLOR_FRONT]
+                cconf->vertex_scale, COLOR_FRONT
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i] + face_indices_offset;
+            indices[ic++] = face_indices[i] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -128,22 +109,22 @@ Cubie cubie(Cubie_Config *cconf)
 
     if (cconf->color_mask & COLOR_MASK_UP) {
         face_origin = vec3(
-            cconf->origin.x + border_width,
-            cconf->origin.y + cconf->face_offset_from_cubie,
-            cconf->origin.z - border_width
+            border_width,
+            cconf->face_offset_from_cubie,
+            -border_width
         );
 
         // face is in xz-plane so use second 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i + ARRAY_LENGTH(face_coords) / 3]),
-                cconf->face_colors[COLOR_UP]
+                cconf->vertex_scale, COLOR_UP
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i] + face_indices_offset;
+            indices[ic++] = face_indices[i] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -153,22 +134,22 @@ Cubie cubie(Cubie_Config *cconf)
 
     if (cconf->color_mask & COLOR_MASK_LEFT) {
         face_origin = vec3(
-            cconf->origin.x - cconf->face_offset_from_cubie,
-            cconf->origin.y - border_width,
-            cconf->origin.z - border_width
+            -cconf->face_offset_from_cubie,
+            -border_width,
+            -border_width
         );
 
         // face is in yz-plane so use third 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i + 2 * ARRAY_LENGTH(face_coords) / 3]),
-                cconf->face_colors[COLOR_LEFT]
+                cconf->vertex_scale, COLOR_LEFT
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i] + face_indices_offset;
+            indices[ic++] = face_indices[i] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -178,22 +159,22 @@ Cubie cubie(Cubie_Config *cconf)
 
     if (cconf->color_mask & COLOR_MASK_BACK) {
         face_origin = vec3(
-            cconf->origin.x + border_width,
-            cconf->origin.y - border_width,
-            cconf->origin.z - cconf->face_offset_from_cubie - cconf->side_length
+            border_width,
+            -border_width,
+            -cconf->face_offset_from_cubie - cconf->side_length
         );
 
         // face is in xy-plane so use first 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i]),
-                cconf->face_colors[COLOR_BACK]
+                cconf->vertex_scale, COLOR_BACK
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
+            indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -203,22 +184,22 @@ Cubie cubie(Cubie_Config *cconf)
 
     if (cconf->color_mask & COLOR_MASK_DOWN) {
         face_origin = vec3(
-            cconf->origin.x + border_width,
-            cconf->origin.y - cconf->face_offset_from_cubie - cconf->side_length,
-            cconf->origin.z - border_width
+            border_width,
+            -cconf->face_offset_from_cubie - cconf->side_length,
+            -border_width
         );
 
         // face is in xz-plane so use second 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i + ARRAY_LENGTH(face_coords) / 3]),
-                cconf->face_colors[COLOR_DOWN]
+                cconf->vertex_scale, COLOR_DOWN
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
+            indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -228,22 +209,22 @@ Cubie cubie(Cubie_Config *cconf)
 
     if (cconf->color_mask & COLOR_MASK_RIGHT) {
         face_origin = vec3(
-            cconf->origin.x + cconf->face_offset_from_cubie + cconf->side_length,
-            cconf->origin.y - border_width,
-            cconf->origin.z - border_width
+            cconf->face_offset_from_cubie + cconf->side_length,
+            -border_width,
+            -border_width
         );
 
         // face is in yz-plane so use third 4 coordinates in scaled_face_coords[]
         for (i = 0; i < ARRAY_LENGTH(face_coords) / 3; i++) {
-            c.verts[vc++] = cube_vertex(
+            verts[vc++] = cube_vertex(
                 vec3_add(face_origin, scaled_face_coords[i + 2 * ARRAY_LENGTH(face_coords) / 3]),
-                cconf->face_colors[COLOR_RIGHT]
+                cconf->vertex_scale, COLOR_RIGHT
             );
         }
 
         // offset indices by faces that where already added
         for (i = 0; i < ARRAY_LENGTH(face_indices) / 2; i++) {
-            c.indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
+            indices[ic++] = face_indices[i + ARRAY_LENGTH(face_indices) / 2] + face_indices_offset;
         }
 
         face_indices_offset += ARRAY_LENGTH(face_coords) / 3;
@@ -251,28 +232,57 @@ Cubie cubie(Cubie_Config *cconf)
         log_debug("Generated right face");
     }
 
-    log_debug("Generated %" PRIu64 "/%" PRIu64 " vertices", vc, c.vertex_count);
-    log_debug("Generated %" PRIu64 "/%" PRIu64 " indices", ic, c.index_count);
+    log_debug("Generated %" PRIu64 " vertices and %" PRIu64 " indices for color mask %d", vc, ic, m->color_mask);
 
+    m->vertex_count = (GLsizei) vc;
+    m->index_count = (GLsizei) ic;
 
     // Generate vertex array, vertex buffer, and element buffer
-    glGenVertexArrays(1, &c.vao);
-    glGenBuffers(1, &c.vbo);
-    glGenBuffers(1, &c.ebo);
+    glGenVertexArrays(1, &m->vao);
+    glGenBuffers(1, &m->vbo);
+    glGenBuffers(1, &m->ebo);
+    if (m->vao == 0 || m->vbo == 0 || m->ebo == 0) {
+        log_error("Failed to create buffers for cubie mesh");
+        cubie_mesh_free(m);
+        return 0;
+    }
+
+    gl_state_bind_vertex_array(m->vao);
+
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, m->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vc * sizeof (Cube_Vertex), verts, GL_STATIC_DRAW);
+
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, ic * sizeof (uint8_t), indices, GL_STATIC_DRAW);
 
-    glBindVertexArray(c.vao);
+    cube_vertex_attributes();
 
-    glBindBuffer(GL_ARRAY_BUFFER, c.vbo);
-    glBufferData(GL_ARRAY_BUFFER, c.vertex_count * sizeof (Cube_Vertex), c.verts, GL_STATIC_DRAW);
+    return 1;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, c.index_count * sizeof (uint32_t), c.indices, GL_STATIC_DRAW);
+void cubie_mesh_free(Cubie_Mesh *m)
+{
+    gl_state_delete_vertex_array(m->vao);
+    gl_state_delete_buffer(m->vbo);
+    gl_state_delete_buffer(m->ebo);
+    *m = (Cubie_Mesh) {0};
+}
 
-    glVertexAttribPointer(CUBE_VERTEX_POS, 3, GL_FLOAT, GL_FALSE, sizeof (Cube_Vertex), (void *) offsetof(Cube_Vertex, pos));
-    glEnableVertexAttribArray(CUBE_VERTEX_POS);
+// every face starts with the color of the side it is on
+Cubie cubie(const Cubie_Mesh *mesh, Vec3 origin)
+{
+    Cubie c;
 
-    glVertexAttribPointer(CUBE_VERTEX_COL, 4, GL_FLOAT, GL_FALSE, sizeof (Cube_Vertex), (void *) offsetof(Cube_Vertex, col));
-    glEnableVertexAttribArray(CUBE_VERTEX_COL);
+    c.mesh = mesh;
+    c.origin = origin;
+
+    c.face_colors = CUBIE_HOME_FACE_COLORS;
+
+    c.ori = quat_identity();
+
+    c.a = (Animation) {0};
+    c.a.efunc = linear;
+    c.a.data.q.end = c.ori;
 
     return c;
 }
@@ -298,21 +308,34 @@ void cubie_rotation_add(Cubie *c, Vec3 axis, float angle)
     );
 }
 
-void cubie_update(Cubie *c, float dt)
+// stops the animation and moves the cubie back to its home position
+void cubie_reset_rotation(Cubie *c)
 {
-    update_animation(&c->a, dt);
+    c->ori = quat_identity();
+    c->a.running = 0;
+    c->a.d = 0.0f;
+    c->a.data.q.end = c->ori;
+}
+
+void cubie_set_face_color(Cubie *c, Cube_Color_Mask face, Cube_Color col)
+{
+    uint8_t i;
+
+    for (i = 0; i < COLOR_MASK_COUNT && (1u << i) != (unsigned) face; i++);
+    if (i == COLOR_MASK_COUNT) return;
+
+    c->face_colors = (c->face_colors & ~(7u << (3 * i))) | ((uint32_t) col << (3 * i));
+}
+
+// Color a vertex of the mesh of c is drawn with, col is the color stored in the vertex. Same as the cube shader.
+Cube_Color cubie_vertex_color(const Cubie *c, uint8_t col)
+{
+    if (col == COLOR_BORDER) return COLOR_BORDER;
+
+    return (Cube_Color) ((c->face_colors >> (3 * (col - COLOR_FRONT))) & 7);
 }
 
-void cubie_free(Cubie c)
+void cubie_update(Cubie *c, float dt)
 {
-    if (c.verts != NULL)
-        free(c.verts);
-    
-    if (c.indices != NULL)
-        free(c.indices);
-
-    // TODO: maybe check if vao, vbo and ebo are valid?
-    glDeleteVertexArrays(1, &c.vao);
-    glDeleteBuffers(1, &c.vbo);
-    glDeleteBuffers(1, &c.ebo);
+    update_animation(&c->a, dt);
 }
\ No newline at end of file
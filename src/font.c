@@ -1,7 +1,9 @@
 #include "font.h"
 #include "ft2build.h"
 #include "freetype/freetype.h"
+#include "gl_state.h"
 #include "logging.h"
+#include "render_queue.h"
 #include "smath.h"
 #include "util.h"
 #include "vertex.h"
@@ -12,9 +14,10 @@ typedef struct {
     Font fonts[MAX_FONT_COUNT];
     size_t font_count;
     size_t active_font;
-    GLuint vao, vbo;
+    GLuint vao;
     Shader_Program *prog;
-    Mat4 proj;
+    Shader_Uniform text_uniform;
+    Shader_Uniform color_uniform;
 } TextRenderer;
 
 const size_t CHAR_COUNT = 128;
@@ -81,7 +84,7 @@ void font_load(const char *font_path)
         // generate the texture for rendering
         unsigned int texture;
         glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        gl_state_bind_texture(0, texture);
 
         glTexImage2D(
             GL_TEXTURE_2D,
@@ -126,7 +129,7 @@ void font_delete(size_t font_index)
     };
 
     for (size_t i = 0; i < CHAR_COUNT; i++) {
-        glDeleteTextures(1, &tr.fonts[font_index].glyphs[i].textureID);
+        gl_state_delete_texture(tr.fonts[font_index].glyphs[i].textureID);
     }
     free(tr.fonts[font_index].glyphs);
     tr.fonts[font_index].glyphs = 0;
@@ -145,12 +148,10 @@ void render_text(Vec2 pos, float size, Color col, char *fmt, ...)
         return;
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); 
-    
-    shader_bind(tr.prog);
-    shader_set_uniform_color(tr.prog, "textColor", col);
-    glBindVertexArray(tr.vao);
+    // every glyph of the text shares the uniforms
+    uint32_t uniforms;
+    uniforms = render_queue_begin_uniforms(tr.prog);
+    render_queue_uniform_color(tr.color_uniform, col);
 
 
     char buf[2048] = {0};
@@ -184,19 +185,19 @@ void render_text(Vec2 pos, float size, Color col, char *fmt, ...)
             {.pos = (Vec2) {xpos + w, ypos + h}, .tex = (Vec2) {1.0f, 0.0f}},
         };
         
-        shader_set_uniform_sampler2D(tr.prog, "text", g.textureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, tr.vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof (vertices), vertices); 
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // the quad is written to the stream buffer when the queue is flushed
+        render_queue_submit_stream(RENDER_PASS_OVERLAY, 0.0f, (Render_Command) {
+            .program       = tr.prog->id,
+            .vertex_array  = tr.vao,
+            .texture       = g.textureID,
+            .mode          = GL_TRIANGLES,
+            .count         = 6,
+            .uniforms      = uniforms,
+            .stream_stride = sizeof (Font_Vertex),
+        }, vertices, sizeof (vertices));
         // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
         pos.x += (g.advance >> 6) * size; // bitshift by 6 to get value in pixels (2^6 = 64):
     }
-
-    glBindVertexArray(0);
-    shader_unbind(tr.prog);
-    glDisable(GL_BLEND);
 }
 
 // TODO: this code uses a lot of copied code, refactoring is due
@@ -262,16 +263,6 @@ int get_text_height(float size, char *fmt, ...)
     return (int) height;
 }
 
-void text_set_projection_matrix(Mat4 proj)
-{
-    if (tr.prog == NULL)
-        init_text_renderer();
-    
-    log_debug("Set text projection matrix");
-    tr.proj = proj;
-    shader_set_uniform_mat4(tr.prog, "proj", tr.proj.raw, GL_FALSE);
-}
-
 void set_active_font(size_t font_index)
 {
     if (tr.prog == NULL)
@@ -289,15 +280,20 @@ void set_active_font(size_t font_index)
 
 void init_text_renderer(void)
 {
+    GLuint vbo;
+
     log_info("Initializing text renderer...");
 
     glGenVertexArrays(1, &tr.vao);
-    glGenBuffers(1, &tr.vbo);
 
-    glBindVertexArray(tr.vao);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, tr.vbo);
-    glBufferData(GL_ARRAY_BUFFER, 6 * sizeof (Font_Vertex), NULL, GL_DYNAMIC_DRAW);
+    gl_state_bind_vertex_array(tr.vao);
+
+    // the glyph quads are streamed, so the attributes read from the stream buffer of the render queue
+    vbo = render_queue_stream_buffer();
+    if (vbo == 0) {
+        log_error_and_exit(1, "Failed to create stream buffer for font rendering");
+    }
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, vbo);
 
     glVertexAttribPointer(FONT_VERTEX_POS, 2, GL_FLOAT, GL_FALSE, sizeof (Font_Vertex), (void *) offsetof(Font_Vertex, pos));
     glEnableVertexAttribArray(FONT_VERTEX_POS);
@@ -307,9 +303,8 @@ void init_text_renderer(void)
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    log_info("Created Vertex Array and Array Buffer for font rendering");
+    log_info("Created Vertex Array for font rendering");
 
-    tr.proj = mat4_ortho(0.0f, 800.0f, 0.0f, 600.0f, 0.01f, 100.0f);
     tr.font_count = 0;
     tr.active_font = 0;
     // TODO: set font shaders from config
@@ -318,7 +313,9 @@ void init_text_renderer(void)
         log_error_and_exit(1, "Failed to load font shaders");
     }
 
-    shader_register_uniform(tr.prog, "proj");
-    shader_register_uniform(tr.prog, "text");
-    shader_register_uniform(tr.prog, "textColor");
+    tr.text_uniform  = shader_register_uniform(tr.prog, "text",      GL_SAMPLER_2D);
+    tr.color_uniform = shader_register_uniform(tr.prog, "textColor", GL_FLOAT_VEC4);
+
+    // glyph textures are always bound to the first texture unit
+    shader_set_uniform_sampler2D(tr.prog, tr.text_uniform, 0);
 }
\ No newline at end of file
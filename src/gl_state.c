@@ -0,0 +1,275 @@
+#include "gl_state.h"
+
+#include "logging.h"
+
+#include <inttypes.h>
+
+// no object has this name, so the first bind of anything is always issued
+#define UNKNOWN_NAME ((GLuint) -1)
+#define UNKNOWN_ENUM ((GLenum) -1)
+
+static const char *CALL_NAMES[GL_STATE_CALL_COUNT] = {
+    [GL_STATE_PROGRAM]      = "program",
+    [GL_STATE_VERTEX_ARRAY] = "vertex array",
+    [GL_STATE_BUFFER]       = "buffer",
+    [GL_STATE_TEXTURE]      = "texture",
+    [GL_STATE_ENABLE]       = "enable",
+    [GL_STATE_BLEND_FUNC]   = "blend func",
+    [GL_STATE_DEPTH]        = "depth",
+};
+
+static Gl_State state;
+static int initialized = 0;
+
+static int *enable_flag(GLenum cap);
+
+// Forgets the shadow copy, needed if the state was changed without this module, like by a new context.
+void gl_state_invalidate(void)
+{
+    int i;
+
+    state.program        = UNKNOWN_NAME;
+    state.vertex_array   = UNKNOWN_NAME;
+    state.array_buffer   = UNKNOWN_NAME;
+    state.element_buffer = UNKNOWN_NAME;
+    state.uniform_buffer = UNKNOWN_NAME;
+    for (i = 0; i < GL_STATE_UNIFORM_BINDINGS; i++)
+        state.uniform_bindings[i] = UNKNOWN_NAME;
+
+    state.active_texture = UNKNOWN_ENUM;
+    for (i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+        state.textures[i] = UNKNOWN_NAME;
+
+    state.cull_face  = -1;
+    state.depth_test = -1;
+    state.blend      = -1;
+    state.blend_src  = UNKNOWN_ENUM;
+    state.blend_dst  = UNKNOWN_ENUM;
+    state.depth_func = UNKNOWN_ENUM;
+    state.depth_mask = -1;
+
+    initialized = 1;
+}
+
+void gl_state_use_program(GLuint program)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_PROGRAM]++;
+    if (state.program == program) return;
+
+    glUseProgram(program);
+    state.program = program;
+    state.issued[GL_STATE_PROGRAM]++;
+}
+
+void gl_state_bind_vertex_array(GLuint vertex_array)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_VERTEX_ARRAY]++;
+    if (state.vertex_array == vertex_array) return;
+
+    glBindVertexArray(vertex_array);
+    state.vertex_array = vertex_array;
+    state.element_buffer = UNKNOWN_NAME;
+    state.issued[GL_STATE_VERTEX_ARRAY]++;
+}
+
+// GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_UNIFORM_BUFFER are cached, other targets are always bound
+void gl_state_bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint *bound;
+
+    if (!initialized) gl_state_invalidate();
+
+    switch (target) {
+        case GL_ARRAY_BUFFER:         bound = &state.array_buffer;   break;
+        case GL_ELEMENT_ARRAY_BUFFER: bound = &state.element_buffer; break;
+        case GL_UNIFORM_BUFFER:       bound = &state.uniform_buffer; break;
+        default:                      bound = NULL;                  break;
+    }
+
+    state.requested[GL_STATE_BUFFER]++;
+    if (bound != NULL && *bound == buffer) return;
+
+    glBindBuffer(target, buffer);
+    if (bound != NULL) *bound = buffer;
+    state.issued[GL_STATE_BUFFER]++;
+}
+
+// Binds a range of a uniform buffer to a binding point of the uniform blocks, which binds it to GL_UNIFORM_BUFFER as well
+void gl_state_bind_buffer_range(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_BUFFER]++;
+    if (binding < GL_STATE_UNIFORM_BINDINGS && state.uniform_bindings[binding] == buffer &&
+        state.uniform_offsets[binding] == offset && state.uniform_sizes[binding] == size) return;
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    if (binding < GL_STATE_UNIFORM_BINDINGS) {
+        state.uniform_bindings[binding] = buffer;
+        state.uniform_offsets[binding] = offset;
+        state.uniform_sizes[binding] = size;
+    }
+    state.uniform_buffer = buffer;
+    state.issued[GL_STATE_BUFFER]++;
+}
+
+// Binds a 2D texture to a texture unit, the active unit is only switched if the texture changes.
+void gl_state_bind_texture(GLuint unit, GLuint texture)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_TEXTURE]++;
+    if (unit < GL_STATE_TEXTURE_UNITS && state.textures[unit] == texture) return;
+
+    // switching the unit is part of the same request, so it is not counted on its own
+    if (state.active_texture != GL_TEXTURE0 + unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state.active_texture = GL_TEXTURE0 + unit;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (unit < GL_STATE_TEXTURE_UNITS) state.textures[unit] = texture;
+    state.issued[GL_STATE_TEXTURE]++;
+}
+
+// GL_CULL_FACE, GL_DEPTH_TEST and GL_BLEND are cached, other capabilities are always set
+void gl_state_enable(GLenum cap, int enabled)
+{
+    int *flag;
+
+    if (!initialized) gl_state_invalidate();
+
+    enabled = enabled != 0;
+    flag = enable_flag(cap);
+
+    state.requested[GL_STATE_ENABLE]++;
+    if (flag != NULL && *flag == enabled) return;
+
+    if (enabled) glEnable(cap);
+    else         glDisable(cap);
+    if (flag != NULL) *flag = enabled;
+    state.issued[GL_STATE_ENABLE]++;
+}
+
+void gl_state_blend_func(GLenum src, GLenum dst)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_BLEND_FUNC]++;
+    if (state.blend_src == src && state.blend_dst == dst) return;
+
+    glBlendFunc(src, dst);
+    state.blend_src = src;
+    state.blend_dst = dst;
+    state.issued[GL_STATE_BLEND_FUNC]++;
+}
+
+void gl_state_depth_func(GLenum func)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_DEPTH]++;
+    if (state.depth_func == func) return;
+
+    glDepthFunc(func);
+    state.depth_func = func;
+    state.issued[GL_STATE_DEPTH]++;
+}
+
+void gl_state_depth_mask(GLboolean mask)
+{
+    if (!initialized) gl_state_invalidate();
+
+    state.requested[GL_STATE_DEPTH]++;
+    if (state.depth_mask == (mask != GL_FALSE)) return;
+
+    glDepthMask(mask);
+    state.depth_mask = mask != GL_FALSE;
+    state.issued[GL_STATE_DEPTH]++;
+}
+
+// Deleted objects are unbound by GL and their names can be given to new objects,
+// so they have to be removed from the copy as well.
+void gl_state_delete_program(GLuint program)
+{
+    if (state.program == program) state.program = UNKNOWN_NAME;
+    glDeleteProgram(program);
+}
+
+void gl_state_delete_vertex_array(GLuint vertex_array)
+{
+    if (state.vertex_array == vertex_array) {
+        state.vertex_array = UNKNOWN_NAME;
+        state.element_buffer = UNKNOWN_NAME;
+    }
+    glDeleteVertexArrays(1, &vertex_array);
+}
+
+void gl_state_delete_buffer(GLuint buffer)
+{
+    int i;
+
+    if (state.array_buffer   == buffer) state.array_buffer   = UNKNOWN_NAME;
+    if (state.element_buffer == buffer) state.element_buffer = UNKNOWN_NAME;
+    if (state.uniform_buffer == buffer) state.uniform_buffer = UNKNOWN_NAME;
+    for (i = 0; i < GL_STATE_UNIFORM_BINDINGS; i++) {
+        if (state.uniform_bindings[i] == buffer) state.uniform_bindings[i] = UNKNOWN_NAME;
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void gl_state_delete_texture(GLuint texture)
+{
+    int i;
+
+    for (i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+        if (state.textures[i] == texture) state.textures[i] = UNKNOWN_NAME;
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void gl_state_end_frame(void)
+{
+    state.frames++;
+}
+
+const Gl_State *gl_state_get(void)
+{
+    return &state;
+}
+
+// Logs how many state changes were requested and how many of them were redundant, in total and per frame.
+void gl_state_report(void)
+{
+    uint64_t frames, requested, issued;
+    int i;
+
+    frames = state.frames > 0 ? state.frames : 1;
+    requested = issued = 0;
+
+    log_info("GL state changes over %" PRIu64 " frames (requested / issued / redundant per frame):", state.frames);
+    for (i = 0; i < GL_STATE_CALL_COUNT; i++) {
+        log_info("    %-12s %10.1f %10.1f %10.1f", CALL_NAMES[i],
+                 (double) state.requested[i] / frames, (double) state.issued[i] / frames,
+                 (double) (state.requested[i] - state.issued[i]) / frames);
+        requested += state.requested[i];
+        issued    += state.issued[i];
+    }
+    log_info("    %-12s %10.1f %10.1f %10.1f", "total",
+             (double) requested / frames, (double) issued / frames, (double) (requested - issued) / frames);
+}
+
+
+static int *enable_flag(GLenum cap)
+{
+    switch (cap) {
+        case GL_CULL_FACE:  return &state.cull_face;
+        case GL_DEPTH_TEST: return &state.depth_test;
+        case GL_BLEND:      return &state.blend;
+        default:            return NULL;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "hint.h"
+
+#include "logging.h"
+#include "reduction.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+// A hint is packed into a single word so the render thread can read it with one atomic load:
+//  bits  0-15  generation of the state the hint belongs to
+//  bits 16-18  status
+//  bits 19-21  face of the next move
+//  bits 22-23  rotation of the next move
+//  bits 24-39  slice of the next move
+//  bits 40-63  number of moves
+#define HINT_MAX_SLICE  0xFFFF
+#define HINT_MAX_LENGTH 0xFFFFFF
+
+static void *hint_thread(void *arg);
+static void publish(Hint_Solver *hs, uint16_t generation, Hint h);
+static uint64_t pack_hint(uint16_t generation, Hint h);
+static Hint unpack_hint(uint64_t packed);
+
+// starts the thread and the search for s
+Hint_Solver *hint_solver(const Cube_State *s)
+{
+    Hint_Solver *hs;
+
+    hs = (Hint_Solver *) calloc(1, sizeof (Hint_Solver));
+    if (hs == NULL) {
+        log_error("Failed to allocate memory for the hint solver");
+        return NULL;
+    }
+
+    hs->pending = cube_state(s->n);
+    hs->work    = cube_state(s->n);
+    if (hs->pending == NULL || hs->work == NULL) {
+        cube_state_free(hs->pending);
+        cube_state_free(hs->work);
+        free(hs);
+        return NULL;
+    }
+
+    pthread_mutex_init(&hs->lock, NULL);
+    pthread_cond_init(&hs->wake, NULL);
+    atomic_init(&hs->cancel, 0);
+    atomic_init(&hs->result, pack_hint(0, (Hint) {HINT_SEARCHING, {0}, 0}));
+
+    if (pthread_create(&hs->thread, NULL, hint_thread, hs) != 0) {
+        log_error("Failed to start the hint solver thread");
+        pthread_cond_destroy(&hs->wake);
+        pthread_mutex_destroy(&hs->lock);
+        cube_state_free(hs->pending);
+        cube_state_free(hs->work);
+        free(hs);
+        return NULL;
+    }
+
+    hint_solver_submit(hs, s);
+
+    return hs;
+}
+
+// Restarts the search on a copy of s, a search that is still running is cancelled.
+// Only copies the stickers, so it is cheap enough to call after every move.
+void hint_solver_submit(Hint_Solver *hs, const Cube_State *s)
+{
+    uint16_t generation;
+
+    if (s->n != hs->pending->n) {
+        log_warning("Hint solver was created for a %" PRIu64 "x%" PRIu64 " cube, ignoring state", hs->pending->n, hs->pending->n);
+        return;
+    }
+
+    pthread_mutex_lock(&hs->lock);
+    memcpy(hs->pending->stickers, s->stickers, FACE_COUNT * s->n * s->n);
+    hs->has_pending = 1;
+    generation = ++hs->generation;
+    // stored before the thread can see the state, so its hint cannot be overwritten
+    atomic_store(&hs->result, pack_hint(generation, (Hint) {HINT_SEARCHING, {0}, 0}));
+    atomic_store(&hs->cancel, 1);
+    pthread_cond_signal(&hs->wake);
+    pthread_mutex_unlock(&hs->lock);
+}
+
+// latest hint, never blocks
+Hint hint_solver_get(Hint_Solver *hs)
+{
+    return unpack_hint(atomic_load(&hs->result));
+}
+
+void hint_solver_free(Hint_Solver *hs)
+{
+    if (hs == NULL) return;
+
+    pthread_mutex_lock(&hs->lock);
+    hs->quit = 1;
+    atomic_store(&hs->cancel, 1);
+    pthread_cond_signal(&hs->wake);
+    pthread_mutex_unlock(&hs->lock);
+
+    pthread_join(hs->thread, NULL);
+
+    pthread_cond_destroy(&hs->wake);
+    pthread_mutex_destroy(&hs->lock);
+    cube_state_free(hs->pending);
+    cube_state_free(hs->work);
+    free(hs);
+}
+
+
+static void *hint_thread(void *arg)
+{
+    Hint_Solver *hs;
+    Rubiks_Cube_Move *moves;
+    size_t count;
+    uint16_t generation;
+    Hint h;
+
+    hs = (Hint_Solver *) arg;
+
+    // generate the tables here instead of stalling the window
+    reduction_init();
+
+    for (;;) {
+        pthread_mutex_lock(&hs->lock);
+        while (!hs->has_pending && !hs->quit)
+            pthread_cond_wait(&hs->wake, &hs->lock);
+
+        if (hs->quit) {
+            pthread_mutex_unlock(&hs->lock);
+            break;
+        }
+
+        memcpy(hs->work->stickers, hs->pending->stickers, FACE_COUNT * hs->work->n * hs->work->n);
+        hs->has_pending = 0;
+        generation = hs->generation;
+        atomic_store(&hs->cancel, 0);
+        pthread_mutex_unlock(&hs->lock);
+
+        h = (Hint) {0};
+        if (cube_state_is_solved(hs->work)) {
+            h.status = HINT_SOLVED;
+        } else if (reduction_solve_cancellable(hs->work, &moves, &count, &hs->cancel)) {
+            h.status = HINT_FOUND;
+            h.next   = moves[0];
+            h.length = count;
+            free(moves);
+        } else if (atomic_load(&hs->cancel)) {
+            continue;
+        } else {
+            h.status = HINT_FAILED;
+        }
+
+        publish(hs, generation, h);
+    }
+
+    return NULL;
+}
+
+// the hint is only published if no newer state was submitted in the meantime
+static void publish(Hint_Solver *hs, uint16_t generation, Hint h)
+{
+    uint64_t expected;
+
+    expected = pack_hint(generation, (Hint) {HINT_SEARCHING, {0}, 0});
+    atomic_compare_exchange_strong(&hs->result, &expected, pack_hint(generation, h));
+}
+
+static uint64_t pack_hint(uint16_t generation, Hint h)
+{
+    uint64_t slice, length;
+
+    slice  = h.next.slice < HINT_MAX_SLICE  ? h.next.slice : HINT_MAX_SLICE;
+    length = h.length     < HINT_MAX_LENGTH ? h.length     : HINT_MAX_LENGTH;
+
+    return (uint64_t) generation
+         | (uint64_t) h.status    << 16
+         | (uint64_t) h.next.face << 19
+         | (uint64_t) h.next.rot  << 22
+         | slice                  << 24
+         | length                 << 40;
+}
+
+static Hint unpack_hint(uint64_t packed)
+{
+    Hint h;
+
+    h.status     = (Hint_Status) ((packed >> 16) & 0x7);
+    h.next.face  = (packed >> 19) & 0x7;
+    h.next.rot   = (packed >> 22) & 0x3;
+    h.next.slice = (packed >> 24) & HINT_MAX_SLICE;
+    h.length     = (packed >> 40) & HINT_MAX_LENGTH;
+
+    return h;
+}
\ No newline at end of file
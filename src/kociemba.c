@@ -0,0 +1,478 @@
+#include "kociemba.h"
+
+#include "logging.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+
+// Two-phase algorithm by Herbert Kociemba. Phase 1 brings the cube into the subgroup
+// <U, D, R2, L2, F2, B2> (corners and edges oriented, UD-slice edges in the UD-slice),
+// phase 2 solves the cube using only moves of that subgroup.
+
+#define TWIST_COUNT     2187    // 3^7 corner orientations
+#define FLIP_COUNT      2048    // 2^11 edge orientations
+#define SLICE_COUNT     495     // 12 choose 4 positions of the UD-slice edges
+#define CPERM_COUNT     40320   // 8! corner permutations
+#define EPERM_COUNT     40320   // 8! permutations of the U and D edges
+#define SPERM_COUNT     24      // 4! permutations of the UD-slice edges
+
+#define PHASE2_MOVE_COUNT 10
+#define SLICE_SOLVED      494
+#define UNVISITED         0xFF
+
+static const int PHASE2_MOVES[PHASE2_MOVE_COUNT] = {
+    FACE_UP   * ROTATION_COUNT + ROTATION_CCW,
+    FACE_UP   * ROTATION_COUNT + ROTATION_180,
+    FACE_UP   * ROTATION_COUNT + ROTATION_CW,
+    FACE_DOWN * ROTATION_COUNT + ROTATION_CCW,
+    FACE_DOWN * ROTATION_COUNT + ROTATION_180,
+    FACE_DOWN * ROTATION_COUNT + ROTATION_CW,
+    FACE_RIGHT* ROTATION_COUNT + ROTATION_180,
+    FACE_LEFT * ROTATION_COUNT + ROTATION_180,
+    FACE_FRONT* ROTATION_COUNT + ROTATION_180,
+    FACE_BACK * ROTATION_COUNT + ROTATION_180,
+};
+
+typedef struct {
+    // move tables, phase 1 tables use all 18 moves, phase 2 tables only PHASE2_MOVES
+    uint16_t *twist_move;
+    uint16_t *flip_move;
+    uint16_t *slice_move;
+    uint16_t *cperm_move;
+    uint16_t *eperm_move;
+    uint16_t *sperm_move;
+
+    // pruning tables, minimal number of moves to reach the goal of the phase
+    uint8_t *slice_twist_prune;
+    uint8_t *slice_flip_prune;
+    uint8_t *cperm_sperm_prune;
+    uint8_t *eperm_sperm_prune;
+
+    int is_phase2_move[CUBE3_MOVE_COUNT];
+} Kociemba_Tables;
+
+typedef struct {
+    Cube3 cube;
+    int max_length;
+    int moves[KOCIEMBA_MAX_LENGTH];
+} Kociemba_Search;
+
+static Kociemba_Tables kt = {0};
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static int get_twist(const Cube3 *c);
+static int get_flip(const Cube3 *c);
+static int get_slice(const Cube3 *c);
+static int get_perm(const uint8_t *p, int count);
+static void set_twist(Cube3 *c, int twist);
+static void set_flip(Cube3 *c, int flip);
+static void set_slice(Cube3 *c, int slice);
+static void set_perm(uint8_t *p, int count, int rank, int offset);
+static int binomial(int n, int k);
+static void build_pruning_table(uint8_t *table, int size1, int size2, const uint16_t *move1, const uint16_t *move2, int move_count, int goal);
+static int search_phase1(Kociemba_Search *s, int twist, int flip, int slice, int depth, int togo);
+static int search_phase2(Kociemba_Search *s, int cperm, int eperm, int sperm, int depth, int togo);
+static int start_phase2(Kociemba_Search *s, int depth);
+static int skip_move(const Kociemba_Search *s, int depth, int move);
+static void init_tables(void);
+
+// Generates the move and pruning tables, safe to call from multiple threads.
+void kociemba_init(void)
+{
+    pthread_once(&tables_once, init_tables);
+}
+
+// Searches a solution with at most max_length moves and writes it into moves, which has to hold max_length moves.
+// Returns the length of the solution or -1 if the cube is invalid or no solution was found.
+int kociemba_solve(const Cube3 *c, int max_length, Rubiks_Cube_Move *moves)
+{
+    Kociemba_Search s;
+    int twist, flip, slice, depth, length, i;
+
+    if (!cube3_is_valid(c)) {
+        log_error("Cannot solve cube, the cube is not solvable");
+        return -1;
+    }
+
+    kociemba_init();
+
+    if (max_length > KOCIEMBA_MAX_LENGTH) max_length = KOCIEMBA_MAX_LENGTH;
+
+    s.cube = *c;
+    s.max_length = max_length;
+
+    twist = get_twist(c);
+    flip  = get_flip(c);
+    slice = get_slice(c);
+
+    length = -1;
+    for (depth = 0; depth <= max_length; depth++) {
+        length = search_phase1(&s, twist, flip, slice, 0, depth);
+        if (length >= 0) break;
+    }
+
+    if (length < 0) {
+        log_warning("Could not find a solution with at most %d moves", max_length);
+        return -1;
+    }
+
+    for (i = 0; i < length; i++)
+        moves[i] = cube3_move(s.moves[i]);
+
+    return length;
+}
+
+
+static int get_twist(const Cube3 *c)
+{
+    int i, twist;
+
+    twist = 0;
+    for (i = 0; i < CORNER_COUNT - 1; i++)
+        twist = 3*twist + c->co[i];
+
+    return twist;
+}
+
+static int get_flip(const Cube3 *c)
+{
+    int i, flip;
+
+    flip = 0;
+    for (i = 0; i < EDGE_COUNT - 1; i++)
+        flip = 2*flip + c->eo[i];
+
+    return flip;
+}
+
+// rank of the positions of the UD-slice edges in the combinatorial number system
+static int get_slice(const Cube3 *c)
+{
+    int i, k, slice;
+
+    slice = 0;
+    k = 0;
+    for (i = 0; i < EDGE_COUNT; i++) {
+        if (c->ep[i] >= EDGE_FR) {
+            k++;
+            slice += binomial(i, k);
+        }
+    }
+
+    return slice;
+}
+
+// lehmer code of a permutation
+static int get_perm(const uint8_t *p, int count)
+{
+    int i, j, smaller, rank;
+
+    rank = 0;
+    for (i = 0; i < count; i++) {
+        smaller = 0;
+        for (j = i+1; j < count; j++) {
+            if (p[j] < p[i]) smaller++;
+        }
+        rank = rank * (count - i) + smaller;
+    }
+
+    return rank;
+}
+
+static void set_twist(Cube3 *c, int twist)
+{
+    int i, sum;
+
+    sum = 0;
+    for (i = CORNER_COUNT - 2; i >= 0; i--) {
+        c->co[i] = twist % 3;
+        sum += c->co[i];
+        twist /= 3;
+    }
+    c->co[CORNER_COUNT - 1] = (3 - sum % 3) % 3;
+}
+
+static void set_flip(Cube3 *c, int flip)
+{
+    int i, sum;
+
+    sum = 0;
+    for (i = EDGE_COUNT - 2; i >= 0; i--) {
+        c->eo[i] = flip % 2;
+        sum += c->eo[i];
+        flip /= 2;
+    }
+    c->eo[EDGE_COUNT - 1] = sum % 2;
+}
+
+static void set_slice(Cube3 *c, int slice)
+{
+    int i, k, other, occupied[EDGE_COUNT] = {0};
+
+    for (k = 4, i = EDGE_COUNT - 1; k > 0; i--) {
+        if (binomial(i, k) <= slice) {
+            slice -= binomial(i, k);
+            occupied[i] = 1;
+            k--;
+        }
+    }
+
+    other = 0;
+    k = EDGE_FR;
+    for (i = 0; i < EDGE_COUNT; i++)
+        c->ep[i] = occupied[i] ? k++ : other++;
+}
+
+static void set_perm(uint8_t *p, int count, int rank, int offset)
+{
+    int i, j, digits[EDGE_COUNT], used[EDGE_COUNT] = {0};
+
+    for (i = count - 1; i >= 0; i--) {
+        digits[i] = rank % (count - i);
+        rank /= count - i;
+    }
+
+    // the digit is the number of smaller elements that are not used yet
+    for (i = 0; i < count; i++) {
+        for (j = 0; used[j] || digits[i] > 0; j++) {
+            if (!used[j]) digits[i]--;
+        }
+        used[j] = 1;
+        p[i] = j + offset;
+    }
+}
+
+static int binomial(int n, int k)
+{
+    int i, r;
+
+    if (k > n) return 0;
+
+    r = 1;
+    for (i = 1; i <= k; i++)
+        r = r * (n - k + i) / i;
+
+    return r;
+}
+
+// breadth first search from goal, table is indexed by coordinate1 * size2 + coordinate2
+static void build_pruning_table(uint8_t *table, int size1, int size2, const uint16_t *move1, const uint16_t *move2, int move_count, int goal)
+{
+    int i, j, m, depth, filled, size;
+
+    size = size1 * size2;
+    memset(table, UNVISITED, size);
+
+    table[goal] = 0;
+    filled = 1;
+
+    for (depth = 0; filled < size; depth++) {
+        for (i = 0; i < size; i++) {
+            if (table[i] != depth) continue;
+
+            for (m = 0; m < move_count; m++) {
+                j = move1[(i / size2) * move_count + m] * size2 + move2[(i % size2) * move_count + m];
+                if (table[j] == UNVISITED) {
+                    table[j] = depth + 1;
+                    filled++;
+                }
+            }
+        }
+    }
+
+    log_debug("Generated pruning table with %d entries and depth %d", size, depth);
+}
+
+static int search_phase1(Kociemba_Search *s, int twist, int flip, int slice, int depth, int togo)
+{
+    int m, t, f, sl, length;
+
+    if (togo == 0) {
+        if (twist != 0 || flip != 0 || slice != SLICE_SOLVED) return -1;
+
+        // a phase 2 move at the end means a shorter phase 1 solution was already tried
+        if (depth > 0 && kt.is_phase2_move[s->moves[depth-1]]) return -1;
+
+        return start_phase2(s, depth);
+    }
+
+    for (m = 0; m < CUBE3_MOVE_COUNT; m++) {
+        if (skip_move(s, depth, m)) continue;
+
+        t  = kt.twist_move[twist * CUBE3_MOVE_COUNT + m];
+        f  = kt.flip_move [flip  * CUBE3_MOVE_COUNT + m];
+        sl = kt.slice_move[slice * CUBE3_MOVE_COUNT + m];
+
+        if (kt.slice_twist_prune[sl * TWIST_COUNT + t] >= togo) continue;
+        if (kt.slice_flip_prune [sl * FLIP_COUNT  + f] >= togo) continue;
+
+        s->moves[depth] = m;
+        length = search_phase1(s, t, f, sl, depth + 1, togo - 1);
+        if (length >= 0) return length;
+    }
+
+    return -1;
+}
+
+static int start_phase2(Kociemba_Search *s, int depth)
+{
+    Cube3 c;
+    int i, cperm, eperm, sperm, togo, length;
+
+    c = s->cube;
+    for (i = 0; i < depth; i++)
+        c = cube3_apply_move(c, s->moves[i]);
+
+    cperm = get_perm(c.cp, CORNER_COUNT);
+    eperm = get_perm(c.ep, 8);
+    sperm = get_perm(&c.ep[8], 4);
+
+    togo = kt.cperm_sperm_prune[cperm * SPERM_COUNT + sperm];
+    if (kt.eperm_sperm_prune[eperm * SPERM_COUNT + sperm] > togo)
+        togo = kt.eperm_sperm_prune[eperm * SPERM_COUNT + sperm];
+
+    for (; depth + togo <= s->max_length; togo++) {
+        length = search_phase2(s, cperm, eperm, sperm, depth, togo);
+        if (length >= 0) return length;
+    }
+
+    return -1;
+}
+
+static int search_phase2(Kociemba_Search *s, int cperm, int eperm, int sperm, int depth, int togo)
+{
+    int i, m, cp, ep, sp, length;
+
+    if (togo == 0) {
+        if (cperm != 0 || eperm != 0 || sperm != 0) return -1;
+        return depth;
+    }
+
+    for (i = 0; i < PHASE2_MOVE_COUNT; i++) {
+        m = PHASE2_MOVES[i];
+        if (skip_move(s, depth, m)) continue;
+
+        cp = kt.cperm_move[cperm * PHASE2_MOVE_COUNT + i];
+        ep = kt.eperm_move[eperm * PHASE2_MOVE_COUNT + i];
+        sp = kt.sperm_move[sperm * PHASE2_MOVE_COUNT + i];
+
+        if (kt.cperm_sperm_prune[cp * SPERM_COUNT + sp] >= togo) continue;
+        if (kt.eperm_sperm_prune[ep * SPERM_COUNT + sp] >= togo) continue;
+
+        s->moves[depth] = m;
+        length = search_phase2(s, cp, ep, sp, depth + 1, togo - 1);
+        if (length >= 0) return length;
+    }
+
+    return -1;
+}
+
+// don't turn the same face twice in a row and turn opposite faces only in one order
+static int skip_move(const Kociemba_Search *s, int depth, int move)
+{
+    int face, last;
+
+    if (depth == 0) return 0;
+
+    face = move / ROTATION_COUNT;
+    last = s->moves[depth-1] / ROTATION_COUNT;
+
+    if (face == last) return 1;
+    if (face == (int) face_opposite(last) && face < last) return 1;
+
+    return 0;
+}
+
+static void init_tables(void)
+{
+    Cube3 c, d;
+    int i, m;
+
+    log_info("Generating two-phase solver tables...");
+
+    cube3_init();
+
+    kt.twist_move = (uint16_t *) malloc(TWIST_COUNT * CUBE3_MOVE_COUNT  * sizeof (uint16_t));
+    kt.flip_move  = (uint16_t *) malloc(FLIP_COUNT  * CUBE3_MOVE_COUNT  * sizeof (uint16_t));
+    kt.slice_move = (uint16_t *) malloc(SLICE_COUNT * CUBE3_MOVE_COUNT  * sizeof (uint16_t));
+    kt.cperm_move = (uint16_t *) malloc(CPERM_COUNT * PHASE2_MOVE_COUNT * sizeof (uint16_t));
+    kt.eperm_move = (uint16_t *) malloc(EPERM_COUNT * PHASE2_MOVE_COUNT * sizeof (uint16_t));
+    kt.sperm_move = (uint16_t *) malloc(SPERM_COUNT * PHASE2_MOVE_COUNT * sizeof (uint16_t));
+
+    kt.slice_twist_prune = (uint8_t *) malloc(SLICE_COUNT * TWIST_COUNT * sizeof (uint8_t));
+    kt.slice_flip_prune  = (uint8_t *) malloc(SLICE_COUNT * FLIP_COUNT  * sizeof (uint8_t));
+    kt.cperm_sperm_prune = (uint8_t *) malloc(CPERM_COUNT * SPERM_COUNT * sizeof (uint8_t));
+    kt.eperm_sperm_prune = (uint8_t *) malloc(EPERM_COUNT * SPERM_COUNT * sizeof (uint8_t));
+
+    if (kt.twist_move == NULL || kt.flip_move == NULL || kt.slice_move == NULL ||
+        kt.cperm_move == NULL || kt.eperm_move == NULL || kt.sperm_move == NULL ||
+        kt.slice_twist_prune == NULL || kt.slice_flip_prune  == NULL ||
+        kt.cperm_sperm_prune == NULL || kt.eperm_sperm_prune == NULL) {
+        log_error_and_exit(1, "Failed to allocate memory for two-phase solver tables");
+    }
+
+    for (m = 0; m < CUBE3_MOVE_COUNT; m++)
+        kt.is_phase2_move[m] = 0;
+    for (m = 0; m < PHASE2_MOVE_COUNT; m++)
+        kt.is_phase2_move[PHASE2_MOVES[m]] = 1;
+
+    // phase 1 move tables
+    for (i = 0; i < TWIST_COUNT; i++) {
+        c = cube3_solved();
+        set_twist(&c, i);
+        for (m = 0; m < CUBE3_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, m);
+            kt.twist_move[i*CUBE3_MOVE_COUNT + m] = get_twist(&d);
+        }
+    }
+    for (i = 0; i < FLIP_COUNT; i++) {
+        c = cube3_solved();
+        set_flip(&c, i);
+        for (m = 0; m < CUBE3_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, m);
+            kt.flip_move[i*CUBE3_MOVE_COUNT + m] = get_flip(&d);
+        }
+    }
+    for (i = 0; i < SLICE_COUNT; i++) {
+        c = cube3_solved();
+        set_slice(&c, i);
+        for (m = 0; m < CUBE3_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, m);
+            kt.slice_move[i*CUBE3_MOVE_COUNT + m] = get_slice(&d);
+        }
+    }
+
+    // phase 2 move tables
+    for (i = 0; i < CPERM_COUNT; i++) {
+        c = cube3_solved();
+        set_perm(c.cp, CORNER_COUNT, i, 0);
+        for (m = 0; m < PHASE2_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, PHASE2_MOVES[m]);
+            kt.cperm_move[i*PHASE2_MOVE_COUNT + m] = get_perm(d.cp, CORNER_COUNT);
+        }
+    }
+    for (i = 0; i < EPERM_COUNT; i++) {
+        c = cube3_solved();
+        set_perm(c.ep, 8, i, 0);
+        for (m = 0; m < PHASE2_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, PHASE2_MOVES[m]);
+            kt.eperm_move[i*PHASE2_MOVE_COUNT + m] = get_perm(d.ep, 8);
+        }
+    }
+    for (i = 0; i < SPERM_COUNT; i++) {
+        c = cube3_solved();
+        set_perm(&c.ep[8], 4, i, 8);
+        for (m = 0; m < PHASE2_MOVE_COUNT; m++) {
+            d = cube3_apply_move(c, PHASE2_MOVES[m]);
+            kt.sperm_move[i*PHASE2_MOVE_COUNT + m] = get_perm(&d.ep[8], 4);
+        }
+    }
+
+    build_pruning_table(kt.slice_twist_prune, SLICE_COUNT, TWIST_COUNT, kt.slice_move, kt.twist_move, CUBE3_MOVE_COUNT, SLICE_SOLVED * TWIST_COUNT);
+    build_pruning_table(kt.slice_flip_prune,  SLICE_COUNT, FLIP_COUNT,  kt.slice_move, kt.flip_move,  CUBE3_MOVE_COUNT, SLICE_SOLVED * FLIP_COUNT);
+    build_pruning_table(kt.cperm_sperm_prune, CPERM_COUNT, SPERM_COUNT, kt.cperm_move, kt.sperm_move, PHASE2_MOVE_COUNT, 0);
+    build_pruning_table(kt.eperm_sperm_prune, EPERM_COUNT, SPERM_COUNT, kt.eperm_move, kt.sperm_move, PHASE2_MOVE_COUNT, 0);
+
+    log_info("Finished generating two-phase solver tables");
+}
\ No newline at end of file
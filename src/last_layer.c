@@ -0,0 +1,449 @@
+#include "last_layer.h"
+
+#include "logging.h"
+#include "move.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+// number of pieces in the up layer, they sit in the first positions of the corners and edges
+#define LAYER_PIECES 4
+
+#define OLL_CASE_MAX  64
+#define ZBLL_CASE_MAX 512
+#define PLL_CASE_MAX  32
+#define CASE_NAME_LENGTH 24
+
+#define NO_CASE 0xFFFF
+
+// orientation of the up layer corners, named after the OLL cases with oriented edges
+typedef enum {
+    CORNERS_O,
+    CORNERS_S,
+    CORNERS_AS,
+    CORNERS_H,
+    CORNERS_PI,
+    CORNERS_U,
+    CORNERS_T,
+    CORNERS_L,
+
+    CORNER_SET_COUNT,
+} Corner_Set;
+
+// positions of the oriented edges
+typedef enum {
+    EDGES_CROSS,
+    EDGES_LINE,
+    EDGES_ANGLE,
+    EDGES_DOT,
+
+    EDGE_SHAPE_COUNT,
+} Edge_Shape;
+
+typedef struct {
+    const char *name;
+    const char *algorithm;
+} Named_Case;
+
+static const char *CORNER_SET_NAMES[CORNER_SET_COUNT] = {"O", "S", "AS", "H", "Pi", "U", "T", "L"};
+static const char *EDGE_SHAPE_NAMES[EDGE_SHAPE_COUNT] = {"cross", "line", "angle", "dot"};
+
+// algorithms that solve the corner sets, the remaining sets are told apart by the twisted corners
+static const Named_Case CORNER_SET_CASES[] = {
+    {"S",  "R U R' U R U2 R'"},
+    {"AS", "R U2 R' U' R U' R'"},
+    {"H",  "R U R' U R U' R' U R U2 R'"},
+    {"U",  "R2 D R' U2 R D' R' U2 R'"},
+};
+
+// algorithms that solve the PLL cases, only outer layer moves so they work on Cube3
+static const Named_Case PLL_CASES[] = {
+    {"Aa", "R' F R' B2 R F' R' B2 R2"},
+    {"Ab", "R B' R F2 R' B R F2 R2"},
+    {"E",  "R B' R' F R B R' F' R B R' F R B' R' F'"},
+    {"F",  "R' U' F' R U R' U' R' F R2 U' R' U' R U R' U R"},
+    {"Ga", "R2 U R' U R' U' R U' R2 D U' R' U R D'"},
+    {"Gb", "R' U' R U D' R2 U R' U R U' R U' R2 D"},
+    {"Gc", "R2 U' R U' R U R' U R2 D' U R U' R' D"},
+    {"Gd", "R U R' U' D R2 U' R U' R' U R' U R2 D'"},
+    {"H",  "R2 U2 R U2 R2 U2 R2 U2 R U2 R2"},
+    {"Ja", "R' U L' U2 R U' R' U2 R L"},
+    {"Jb", "R U R' F' R U R' U' R' F R2 U' R'"},
+    {"Na", "R U R' U R U R' F' R U R' U' R' F R2 U' R' U2 R U' R'"},
+    {"Nb", "R' U R U' R' F' U' F R U R' F R' F' R U' R"},
+    {"Ra", "R U' R' U' R U R D R' U' R D' R' U2 R'"},
+    {"Rb", "R2 F R U R U' R' F' R U2 R' U2 R"},
+    {"T",  "R U R' U' R' F R2 U' R' U' R U R' F'"},
+    {"Ua", "R U' R U R U R U' R' U' R2"},
+    {"Ub", "R2 U R U R' U' R' U' R' U R'"},
+    {"V",  "R' U R' U' B' R' B2 U' B' U B' R B R"},
+    {"Y",  "F R U' R' U' R U R' F' R U R' U' R' F R F'"},
+    {"Z",  "R' U' R U' R U R U' R' U R U R2 U' R'"},
+};
+
+static int initialized = 0;
+
+// up layer turns, auf[k] is k clockwise quarter turns
+static Cube3 auf[4];
+
+// perfect hash -> number of the case within its stage
+static uint16_t orientation_case[LAST_LAYER_ORIENTATION_COUNT];
+static uint16_t permutation_case[LAST_LAYER_PERMUTATION_COUNT];
+
+static int corner_set_key[CORNER_SET_COUNT];
+
+static int oll_count, zbll_count, pll_count;
+static char oll_names [OLL_CASE_MAX ][CASE_NAME_LENGTH];
+static char zbll_names[ZBLL_CASE_MAX][CASE_NAME_LENGTH];
+static char pll_names [PLL_CASE_MAX ][CASE_NAME_LENGTH];
+
+static void init_corner_sets(void);
+static void init_orientation_cases(void);
+static void init_permutation_cases(void);
+static void init_pll_names(void);
+static int  case_from_algorithm(const char *algorithm, Cube3 *c);
+static int  is_last_layer(const Cube3 *c);
+static Corner_Set corner_set(const Cube3 *c);
+static Edge_Shape edge_shape(const Cube3 *c);
+static int  corner_key(const uint8_t *co);
+static int  rank(const uint8_t *p);
+static void unrank(uint8_t *p, int r);
+
+// Enumerates every up layer state once and gives all states that only differ by turns of the
+// up layer before and after the same case number, so recognizing is a single table lookup.
+void last_layer_init(void)
+{
+    int k;
+
+    if (initialized) return;
+
+    cube3_init();
+
+    auf[0] = cube3_solved();
+    for (k = 1; k < 4; k++)
+        auf[k] = cube3_apply_move(auf[k-1], FACE_UP * ROTATION_COUNT + ROTATION_CW);
+
+    init_corner_sets();
+    init_orientation_cases();
+    init_permutation_cases();
+    init_pll_names();
+
+    log_info("Generated %d OLL, %d ZBLL and %d PLL cases", oll_count, zbll_count, pll_count);
+    initialized = 1;
+}
+
+// Reads the case of a 3x3x3 cube with solved first two layers, the cost doesn't depend on the state.
+Last_Layer_Case last_layer_recognize(const Cube_State *s)
+{
+    Last_Layer_Case llc = {LAST_LAYER_NONE, 0};
+    Cube3 c;
+    int f, i, oriented;
+
+    if (!initialized || s == NULL || s->n != 3) return llc;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (s->stickers[cube_state_sticker_index(3, f, 1, 1)] != f) return llc;
+    }
+
+    if (!cube3_from_state(s, &c) || !is_last_layer(&c) || cube3_is_solved(&c)) return llc;
+
+    oriented = 1;
+    for (i = 0; i < LAYER_PIECES; i++) {
+        if (c.eo[i] != 0) oriented = 0;
+    }
+
+    if (!oriented) {
+        llc.stage = LAST_LAYER_OLL;
+        llc.index = orientation_case[last_layer_orientation_index(&c)];
+        return llc;
+    }
+
+    llc.stage = corner_set(&c) == CORNERS_O ? LAST_LAYER_PLL : LAST_LAYER_ZBLL;
+    llc.index = permutation_case[last_layer_permutation_index(&c)];
+
+    return llc;
+}
+
+const char *last_layer_case_name(Last_Layer_Case c)
+{
+    switch (c.stage) {
+        case LAST_LAYER_OLL:  return c.index < oll_count  ? oll_names [c.index] : "";
+        case LAST_LAYER_ZBLL: return c.index < zbll_count ? zbll_names[c.index] : "";
+        case LAST_LAYER_PLL:  return c.index < pll_count  ? pll_names [c.index] : "";
+        default:              return "";
+    }
+}
+
+int last_layer_orientation_index(const Cube3 *c)
+{
+    return (c->co[0] + 3*c->co[1] + 9*c->co[2]) * 8 + c->eo[0] + 2*c->eo[1] + 4*c->eo[2];
+}
+
+int last_layer_permutation_index(const Cube3 *c)
+{
+    return (rank(c->cp) * 27 + c->co[0] + 3*c->co[1] + 9*c->co[2]) * 24 + rank(c->ep);
+}
+
+
+static void init_corner_sets(void)
+{
+    Cube3 c;
+    size_t i;
+    int k;
+
+    corner_set_key[CORNERS_O] = 0;
+    for (k = CORNERS_S; k < CORNER_SET_COUNT; k++)
+        corner_set_key[k] = -1;
+
+    for (i = 0; i < sizeof (CORNER_SET_CASES) / sizeof (CORNER_SET_CASES[0]); i++) {
+        for (k = 0; k < CORNER_SET_COUNT; k++) {
+            if (strcmp(CORNER_SET_NAMES[k], CORNER_SET_CASES[i].name) == 0) break;
+        }
+
+        if (k < CORNER_SET_COUNT && case_from_algorithm(CORNER_SET_CASES[i].algorithm, &c))
+            corner_set_key[k] = corner_key(c.co);
+        else
+            log_error("Algorithm of corner set %s doesn't give a last layer case", CORNER_SET_CASES[i].name);
+    }
+}
+
+static void init_orientation_cases(void)
+{
+    int counts[EDGE_SHAPE_COUNT][CORNER_SET_COUNT] = {0};
+    int numbers[EDGE_SHAPE_COUNT][CORNER_SET_COUNT] = {0};
+    uint8_t shapes[OLL_CASE_MAX], sets[OLL_CASE_MAX];
+    Cube3 c, v;
+    int i, a, b, k, sum;
+
+    for (i = 0; i < LAST_LAYER_ORIENTATION_COUNT; i++)
+        orientation_case[i] = NO_CASE;
+
+    oll_count = 0;
+    for (i = 0; i < LAST_LAYER_ORIENTATION_COUNT; i++) {
+        if (orientation_case[i] != NO_CASE) continue;
+
+        c = cube3_solved();
+        sum = 0;
+        for (k = 0; k < LAYER_PIECES - 1; k++) {
+            c.co[k] = i / 8 / (k == 0 ? 1 : k == 1 ? 3 : 9) % 3;
+            sum += c.co[k];
+        }
+        c.co[LAYER_PIECES - 1] = (3 - sum % 3) % 3;
+
+        sum = 0;
+        for (k = 0; k < LAYER_PIECES - 1; k++) {
+            c.eo[k] = (i % 8 >> k) & 1;
+            sum += c.eo[k];
+        }
+        c.eo[LAYER_PIECES - 1] = sum % 2;
+
+        // oriented edges are ZBLL or PLL cases
+        if (edge_shape(&c) == EDGES_CROSS || oll_count == OLL_CASE_MAX) continue;
+
+        for (a = 0; a < 4; a++) {
+            for (b = 0; b < 4; b++) {
+                v = cube3_multiply(cube3_multiply(auf[b], c), auf[a]);
+                orientation_case[last_layer_orientation_index(&v)] = oll_count;
+            }
+        }
+
+        shapes[oll_count] = edge_shape(&c);
+        sets[oll_count] = corner_set(&c);
+        counts[shapes[oll_count]][sets[oll_count]]++;
+        oll_count++;
+    }
+
+    // cases are named after the oriented edges and the corners, a number tells apart the rest
+    for (i = 0; i < oll_count; i++) {
+        k = ++numbers[shapes[i]][sets[i]];
+        if (counts[shapes[i]][sets[i]] > 1)
+            snprintf(oll_names[i], CASE_NAME_LENGTH, "OLL %s %s %d", EDGE_SHAPE_NAMES[shapes[i]], CORNER_SET_NAMES[sets[i]], k);
+        else
+            snprintf(oll_names[i], CASE_NAME_LENGTH, "OLL %s %s", EDGE_SHAPE_NAMES[shapes[i]], CORNER_SET_NAMES[sets[i]]);
+    }
+}
+
+static void init_permutation_cases(void)
+{
+    int numbers[CORNER_SET_COUNT] = {0};
+    Cube3 c, v;
+    Corner_Set set;
+    uint16_t number;
+    int i, a, b, k, sum;
+
+    for (i = 0; i < LAST_LAYER_PERMUTATION_COUNT; i++)
+        permutation_case[i] = NO_CASE;
+
+    zbll_count = 0;
+    pll_count = 0;
+    for (i = 0; i < LAST_LAYER_PERMUTATION_COUNT; i++) {
+        if (permutation_case[i] != NO_CASE) continue;
+
+        c = cube3_solved();
+        unrank(c.ep, i % 24);
+        unrank(c.cp, i / (24 * 27));
+
+        sum = 0;
+        for (k = 0; k < LAYER_PIECES - 1; k++) {
+            c.co[k] = i / 24 % 27 / (k == 0 ? 1 : k == 1 ? 3 : 9) % 3;
+            sum += c.co[k];
+        }
+        c.co[LAYER_PIECES - 1] = (3 - sum % 3) % 3;
+
+        if (cube3_corner_parity(&c) != cube3_edge_parity(&c)) continue;
+
+        set = corner_set(&c);
+        if (set == CORNERS_O) {
+            if (pll_count == PLL_CASE_MAX) continue;
+            number = pll_count++;
+            // the state that only needs an up layer turn comes first
+            if (number == 0) snprintf(pll_names[number], CASE_NAME_LENGTH, "AUF");
+            else             snprintf(pll_names[number], CASE_NAME_LENGTH, "PLL %d", number);
+        } else {
+            if (zbll_count == ZBLL_CASE_MAX) continue;
+            number = zbll_count++;
+            snprintf(zbll_names[number], CASE_NAME_LENGTH, "ZBLL %s %d", CORNER_SET_NAMES[set], ++numbers[set]);
+        }
+
+        for (a = 0; a < 4; a++) {
+            for (b = 0; b < 4; b++) {
+                v = cube3_multiply(cube3_multiply(auf[b], c), auf[a]);
+                permutation_case[last_layer_permutation_index(&v)] = number;
+            }
+        }
+    }
+}
+
+static void init_pll_names(void)
+{
+    Cube3 c;
+    uint16_t number;
+    size_t i;
+
+    for (i = 0; i < sizeof (PLL_CASES) / sizeof (PLL_CASES[0]); i++) {
+        if (!case_from_algorithm(PLL_CASES[i].algorithm, &c) || corner_set(&c) != CORNERS_O || edge_shape(&c) != EDGES_CROSS) {
+            log_error("Algorithm of PLL %s doesn't give a PLL case", PLL_CASES[i].name);
+            continue;
+        }
+
+        number = permutation_case[last_layer_permutation_index(&c)];
+        if (number != NO_CASE && number < pll_count)
+            snprintf(pll_names[number], CASE_NAME_LENGTH, "PLL %s", PLL_CASES[i].name);
+    }
+}
+
+// the case the algorithm solves, that is the inverse of the algorithm applied to a solved cube
+static int case_from_algorithm(const char *algorithm, Cube3 *c)
+{
+    Rubiks_Cube_Move *moves;
+    size_t count, i;
+    int ok;
+
+    if (!moves_from_string(algorithm, &moves, &count)) return 0;
+
+    ok = 1;
+    *c = cube3_solved();
+    for (i = count; ok && i > 0; i--) {
+        if (moves[i-1].slice != 0) ok = 0;
+        else *c = cube3_apply_move(*c, moves[i-1].face * ROTATION_COUNT + ROTATION_CW - moves[i-1].rot);
+    }
+
+    free(moves);
+    return ok && is_last_layer(c);
+}
+
+// only the up layer pieces are out of place
+static int is_last_layer(const Cube3 *c)
+{
+    int i;
+
+    for (i = LAYER_PIECES; i < CORNER_COUNT; i++) {
+        if (c->cp[i] != i || c->co[i] != 0) return 0;
+    }
+    for (i = LAYER_PIECES; i < EDGE_COUNT; i++) {
+        if (c->ep[i] != i || c->eo[i] != 0) return 0;
+    }
+
+    return 1;
+}
+
+static Corner_Set corner_set(const Cube3 *c)
+{
+    int k, key, twisted;
+
+    key = corner_key(c->co);
+    for (k = 0; k < CORNER_SET_COUNT; k++) {
+        if (corner_set_key[k] == key) return k;
+    }
+
+    twisted = 0;
+    for (k = 0; k < LAYER_PIECES; k++) {
+        if (c->co[k] != 0) twisted++;
+    }
+
+    if (twisted == 4) return CORNERS_PI;
+    // the up layer corners are ordered around the layer, the two twisted corners are adjacent or diagonal
+    if ((c->co[0] != 0) == (c->co[2] != 0)) return CORNERS_L;
+    return CORNERS_T;
+}
+
+static Edge_Shape edge_shape(const Cube3 *c)
+{
+    int flipped;
+
+    flipped = c->eo[0] + c->eo[1] + c->eo[2] + c->eo[3];
+    if (flipped == 0) return EDGES_CROSS;
+    if (flipped == 4) return EDGES_DOT;
+    return c->eo[0] == c->eo[2] ? EDGES_LINE : EDGES_ANGLE;
+}
+
+// corner orientations of the up layer read from every corner, the smallest one is the same for every turn of the layer
+static int corner_key(const uint8_t *co)
+{
+    int k, key, min;
+
+    min = -1;
+    for (k = 0; k < LAYER_PIECES; k++) {
+        key = co[k] * 27 + co[(k+1) % 4] * 9 + co[(k+2) % 4] * 3 + co[(k+3) % 4];
+        if (min < 0 || key < min) min = key;
+    }
+
+    return min;
+}
+
+// lehmer code of the first 4 elements of a permutation
+static int rank(const uint8_t *p)
+{
+    int i, j, smaller, r;
+
+    r = 0;
+    for (i = 0; i < LAYER_PIECES; i++) {
+        smaller = 0;
+        for (j = i+1; j < LAYER_PIECES; j++) {
+            if (p[j] < p[i]) smaller++;
+        }
+        r = r * (LAYER_PIECES - i) + smaller;
+    }
+
+    return r;
+}
+
+static void unrank(uint8_t *p, int r)
+{
+    int i, j, digits[LAYER_PIECES], used[LAYER_PIECES] = {0};
+
+    for (i = LAYER_PIECES - 1; i >= 0; i--) {
+        digits[i] = r % (LAYER_PIECES - i);
+        r /= LAYER_PIECES - i;
+    }
+
+    // the digit is the number of smaller elements that are not used yet
+    for (i = 0; i < LAYER_PIECES; i++) {
+        for (j = 0; used[j] || digits[i] > 0; j++) {
+            if (!used[j]) digits[i]--;
+        }
+        used[j] = 1;
+        p[i] = j;
+    }
+}
\ No newline at end of file
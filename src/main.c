@@ -1,35 +1,49 @@
+#include "alg_db.h"
 #include "animation.h"
 #include "camera.h"
+#include "cli.h"
 #include "config.h"
 #include "cube.h"
 #include "font.h"
+#include "gl_state.h"
 #include "logging.h"
+#include "render_queue.h"
 #include "smath.h"
 #include "window.h"
 
+#include <inttypes.h>
 #include <string.h>
 
 void key_callback(int key, int action, int mods);
 void window_size_callback(int width, int height);
 
 void render_frame(void);
+int  replay_capture(int argc, char **argv);
 
 // global variables
 Config conf;
-Mat4 proj, view_proj, ortho;
+Mat4 proj, ortho;
+float elapsed;
 Camera *cam;
 Rubiks_Cube *rc;
+Alg_Db *algs;
 Animation text_opacity_anim;
 float text_opacity;
 char move[3] = {0};
 
-int main(void)
+int main(int argc, char **argv)
 {
     conf = config_default();
 
     set_logging_level (conf.logging_level);
     set_logging_stream(conf.logging_stream);
 
+    // replaying needs a window, the other commands run without one
+    if (argc > 1 && strcmp(argv[1], "replay") == 0)
+        return replay_capture(argc - 2, &argv[2]);
+    if (argc > 1)
+        return cli_main(argc, argv);
+
     window_init(conf.default_window_width, conf.default_window_height, "Rubiks Cube Simulation", conf.fullscreen);
     window_set_key_callback(key_callback);
     window_set_size_callback(window_size_callback);
@@ -48,7 +62,6 @@ int main(void)
         0.0f, window_get_height(), 
         conf.nearZ, conf.farZ
     );
-    text_set_projection_matrix(ortho);
 
     cam = camera(
         conf.cam_target,
@@ -61,14 +74,25 @@ int main(void)
     camera_set_animation_easing_func(cam, CAM_ANIM_ALL, conf.cam_anim_efunc);
 
     rc = rubiks_cube(&conf.rcconf);
+    // the simulation works without algorithms, so a missing database is fine
+    algs = alg_db_open(conf.alg_db_path);
+    if (conf.resume_snapshot && rc->state != NULL)
+        rubiks_cube_load_state(rc, conf.snapshot_path);
+    if (conf.session_path != NULL && rc->state != NULL)
+        rc->recorder = session_writer(conf.session_path, rc->state, 0, conf.session_checkpoint_interval);
 
     font_load("fonts/open-sans-latin-400-normal.ttf");
     set_active_font(0);
 
     window_main_loop(render_frame);
-
+    gl_state_report();
+    render_queue_free();
 
     camera_free(cam);
+    alg_db_close(algs);
+    if (conf.resume_snapshot && rc->state != NULL)
+        rubiks_cube_save_state(rc, conf.snapshot_path);
+    session_writer_close(rc->recorder);
     rubiks_cube_free(rc);
     window_close();
     return 0;
@@ -397,30 +421,92 @@ void key_callback(int key, int action, int mods)
 
         rubiks_cube_rotate_slice(rc, FACE_FRONT, ROTATION_CCW, 1);
     }
+
+
+    if (key  == conf.keys[KEY_SOLVE].key &&
+        mods == conf.keys[KEY_SOLVE].mod && action == KEY_PRESS) {
+
+        rubiks_cube_solve(rc);
+    }
+
+    // facelet string from the clipboard, see cube_state_from_facelets()
+    if (key  == conf.keys[KEY_IMPORT_STATE].key &&
+        mods == conf.keys[KEY_IMPORT_STATE].mod && action == KEY_PRESS) {
+
+        const char *facelets = window_get_clipboard();
+        if (facelets != NULL) rubiks_cube_import_facelets(rc, facelets);
+    }
+
+    if (key  == conf.keys[KEY_SAVE_STATE].key &&
+        mods == conf.keys[KEY_SAVE_STATE].mod && action == KEY_PRESS) {
+
+        rubiks_cube_save_state(rc, conf.snapshot_path);
+    }
+    if (key  == conf.keys[KEY_LOAD_STATE].key &&
+        mods == conf.keys[KEY_LOAD_STATE].mod && action == KEY_PRESS) {
+
+        rubiks_cube_load_state(rc, conf.snapshot_path);
+    }
+
+    if (key  == conf.keys[KEY_TOGGLE_CAPTURE].key &&
+        mods == conf.keys[KEY_TOGGLE_CAPTURE].mod && action == KEY_PRESS) {
+
+        if (render_queue_is_capturing()) render_queue_capture_end();
+        else render_queue_capture_begin(conf.render_capture_path);
+    }
+
+    // single moves are animated and can be repeated by holding the key, jumps are shown instantly
+    if (key  == conf.keys[KEY_UNDO].key &&
+        mods == conf.keys[KEY_UNDO].mod && action != KEY_RELEASE) {
+
+        rubiks_cube_undo(rc, 1);
+    }
+    if (key  == conf.keys[KEY_REDO].key &&
+        mods == conf.keys[KEY_REDO].mod && action != KEY_RELEASE) {
+
+        rubiks_cube_redo(rc, 1);
+    }
+    if (key  == conf.keys[KEY_UNDO_ALL].key &&
+        mods == conf.keys[KEY_UNDO_ALL].mod && action == KEY_PRESS) {
+
+        rubiks_cube_undo(rc, SIZE_MAX);
+    }
+    if (key  == conf.keys[KEY_REDO_ALL].key &&
+        mods == conf.keys[KEY_REDO_ALL].mod && action == KEY_PRESS) {
+
+        rubiks_cube_redo(rc, SIZE_MAX);
+    }
 }
 
 void window_size_callback(int width, int height)
 {
     mat4_perspective_resize(&proj, (float)width / (float) height);
-    view_proj = mat4_mul(proj, camera_get_view_matrix(cam));
-
     ortho = mat4_ortho(0.0f, width, 0.0f, height, conf.nearZ, conf.farZ);
-    text_set_projection_matrix(ortho);
 }
 
 // TODO: maybe split updating and rendering into separate functions
 // and implement a function update_frame inside window.c
 void render_frame(void)
 {
+    Shader_Camera camera_block;
     float dt;
     dt = window_get_frame_time();
+    elapsed += dt;
 
     rubiks_cube_update(rc, dt);
     camera_update(cam, dt);
-    view_proj = mat4_mul(proj, camera_get_view_matrix(cam));
+
+    // shared by every program, the draws only set their own uniforms
+    camera_block = (Shader_Camera) {
+        .view   = camera_get_view_matrix(cam),
+        .proj   = proj,
+        .screen = ortho,
+        .time   = elapsed,
+    };
+    shader_update_block(SHADER_BLOCK_CAMERA, &camera_block, sizeof (camera_block));
 
     window_clear();
-    rubiks_cube_draw(rc, view_proj);
+    rubiks_cube_draw(rc);
 
     int ww, wh;
     ww = window_get_width();
@@ -437,6 +523,54 @@ void render_frame(void)
     tc = color_from_hex(0xFF4412FF);
     render_text(tp, ts, tc, text);
 
+    if (rc->hint != NULL) {
+        char hint_text[64] = {0};
+        char next[MOVE_STRING_LENGTH];
+        Hint h = hint_solver_get(rc->hint);
+
+        switch (h.status) {
+            case HINT_SOLVED:
+                strcpy(hint_text, "Solved");
+            break;
+            case HINT_FOUND:
+                move_to_string(h.next, next, sizeof (next));
+                snprintf(hint_text, sizeof (hint_text), "Next: %s (%" PRIu64 " to solve)", next, h.length);
+            break;
+            case HINT_FAILED:
+                strcpy(hint_text, "No solution");
+            break;
+            default:
+                strcpy(hint_text, "Searching...");
+            break;
+        }
+
+        tw = get_text_width(ts, hint_text);
+        tp = vec2(ww - tw - ww*0.01, ww*0.01 + th);
+        render_text(tp, ts, tc, hint_text);
+    }
+
+    // the lookup is a hash of the stickers and a table access, cheap enough for every frame
+    if (algs != NULL && rc->state != NULL) {
+        static const char *PRE_AUF[4]  = {"", "U ", "U2 ", "U' "};
+        static const char *POST_AUF[4] = {"", " U", " U2", " U'"};
+        const Alg_Db_Entry *entries;
+        char alg[128] = {0};
+        char alg_text[192] = {0};
+        size_t count = alg_db_solving(algs, rc->state, &entries);
+
+        if (count > 0) {
+            alg_db_format(algs, entries[0].algorithm, alg, sizeof (alg));
+            if (count > 1)
+                snprintf(alg_text, sizeof (alg_text), "%s%s%s (%zu more)", PRE_AUF[entries[0].pre_auf], alg, POST_AUF[entries[0].post_auf], count - 1);
+            else
+                snprintf(alg_text, sizeof (alg_text), "%s%s%s", PRE_AUF[entries[0].pre_auf], alg, POST_AUF[entries[0].post_auf]);
+
+            tw = get_text_width(ts, alg_text);
+            tp = vec2(ww - tw - ww*0.01, ww*0.01 + 2.5f*th);
+            render_text(tp, ts, tc, alg_text);
+        }
+    }
+
     update_animation(&text_opacity_anim, dt);
     if (animation_is_running(&text_opacity_anim)) {
         ts = ww*4e-4;
@@ -446,4 +580,46 @@ void render_frame(void)
         tc = color_from_rgba(255, 68, 18, text_opacity);
         render_text(tp, ts, tc, move);
     }
+
+    // the case stays visible below the move until the next move changes it
+    if (rc->last_layer.stage != LAST_LAYER_NONE) {
+        char case_text[32] = {0};
+        snprintf(case_text, sizeof (case_text), "%s", last_layer_case_name(rc->last_layer));
+
+        ts = ww*2.5e-4;
+        tw = get_text_width(ts, case_text);
+        tp = vec2((ww - tw)*0.5f, wh*0.8);
+        tc = color_from_hex(0xFF4412FF);
+        render_text(tp, ts, tc, case_text);
+    }
+
+    render_queue_flush();
+}
+
+// Renders the frames of a capture without the simulation and logs how long they took.
+int replay_capture(int argc, char **argv)
+{
+    Render_Capture *capture;
+    long repeats;
+
+    repeats = argc == 2 ? atol(argv[1]) : 10;
+    if (argc < 1 || argc > 2 || repeats <= 0) {
+        log_error("Usage: replay <file> [repeats]");
+        return 1;
+    }
+
+    window_init(conf.default_window_width, conf.default_window_height, "Rubiks Cube Simulation - Replay", 0);
+    // the replay clears with the color of the last clear
+    window_set_clear_color(conf.background_color);
+    window_clear();
+
+    capture = render_capture_load(argv[0]);
+    if (capture != NULL) {
+        render_capture_benchmark(capture, (uint64_t) repeats);
+        gl_state_report();
+        render_capture_free(capture);
+    }
+
+    window_close();
+    return capture != NULL ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "move.h"
+
+#include "logging.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char FACE_TO_CHAR[FACE_COUNT] = {
+    [FACE_FRONT] = 'F',
+    [FACE_UP]    = 'U',
+    [FACE_LEFT]  = 'L',
+    [FACE_BACK]  = 'B',
+    [FACE_DOWN]  = 'D',
+    [FACE_RIGHT] = 'R',
+};
+
+static const char *ROTATION_TO_STRING[ROTATION_COUNT] = {
+    [ROTATION_CCW] = "'",
+    [ROTATION_180] = "2",
+    [ROTATION_CW]  = "",
+};
+
+// face the middle slice of odd cubes is named after, like M follows L, indexed by the axis face % 3
+static const Rubiks_Cube_Face MIDDLE_FACE[3] = {
+    [FACE_FRONT] = FACE_FRONT,
+    [FACE_UP]    = FACE_DOWN,
+    [FACE_LEFT]  = FACE_LEFT,
+};
+
+// a move as counter clockwise quarter turns of a layer, layers of the same axis are identified by the same face if n is known
+typedef struct {
+    uint8_t  face;
+    uint32_t slice;
+    uint8_t  quarters;
+} Move_Layer;
+
+static Move_Layer move_layer(Rubiks_Cube_Move m, uint64_t n);
+static Rubiks_Cube_Move layer_move(Move_Layer l, uint64_t n);
+static int layer_less(Move_Layer a, Move_Layer b);
+
+Rubiks_Cube_Move rubiks_cube_move(Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice)
+{
+    return (Rubiks_Cube_Move) {
+        .face  = (uint8_t) face,
+        .rot   = (uint8_t) rot,
+        .slice = (uint32_t) slice,
+    };
+}
+
+Rubiks_Cube_Move move_inverse(Rubiks_Cube_Move m)
+{
+    m.rot = ROTATION_CW - m.rot;
+    return m;
+}
+
+// Packs a move into slice << 5 | face << 2 | rotation, outer layer moves fit into a single byte.
+uint64_t move_pack(Rubiks_Cube_Move m)
+{
+    return (uint64_t) m.slice << 5 | (uint64_t) m.face << 2 | m.rot;
+}
+
+Rubiks_Cube_Move move_unpack(uint64_t code)
+{
+    return rubiks_cube_move((code >> 2) & 7, code & 3, code >> 5);
+}
+
+Rubiks_Cube_Face face_opposite(Rubiks_Cube_Face face)
+{
+    return (face + 3) % FACE_COUNT;
+}
+
+// reverses the order of the moves and inverts every single one
+void moves_invert(Rubiks_Cube_Move *moves, size_t count)
+{
+    size_t i;
+    Rubiks_Cube_Move tmp;
+
+    for (i = 0; i < count / 2; i++) {
+        tmp = moves[i];
+        moves[i] = move_inverse(moves[count-1-i]);
+        moves[count-1-i] = move_inverse(tmp);
+    }
+
+    if (count % 2 == 1)
+        moves[count/2] = move_inverse(moves[count/2]);
+}
+
+// Removes redundant moves in place and returns the new number of moves. Moves on the same axis commute,
+// so every run of them is merged into at most one turn per layer, turns that cancel out are dropped and
+// the remaining ones are sorted by layer, which gives equal sequences the same canonical form.
+// With the side length n, turns of the opposite faces are recognized as the same layer too (R is 3L' on a 3x3x3)
+// and every layer is named after the closer face. Pass 0 if n is unknown.
+size_t moves_optimize(Rubiks_Cube_Move *moves, size_t count, uint64_t n)
+{
+    size_t i, j, out, run;
+    Move_Layer l, other;
+
+    // moves[run..out) is the trailing run of moves on one axis, it is kept merged and sorted
+    out = 0;
+    run = 0;
+    for (i = 0; i < count; i++) {
+        l = move_layer(moves[i], n);
+
+        if (out > run && moves[out-1].face % 3 != moves[i].face % 3)
+            run = out;
+
+        for (j = run; j < out; j++) {
+            other = move_layer(moves[j], n);
+            if (other.face == l.face && other.slice == l.slice) break;
+        }
+
+        if (j < out) {
+            l.quarters = (l.quarters + other.quarters) % 4;
+            memmove(&moves[j], &moves[j+1], (out - j - 1) * sizeof (Rubiks_Cube_Move));
+            out--;
+        }
+
+        if (l.quarters != 0) {
+            for (j = out; j > run && layer_less(l, move_layer(moves[j-1], n)); j--)
+                moves[j] = moves[j-1];
+            moves[j] = layer_move(l, n);
+            out++;
+        }
+
+        // the run cancelled out completely, so the run before it can continue
+        if (out == run && out > 0) {
+            run = out - 1;
+            while (run > 0 && moves[run-1].face % 3 == moves[out-1].face % 3)
+                run--;
+        }
+    }
+
+    return out;
+}
+
+// SiGN notation, the outer layer is written as "F", inner layers are prefixed with their layer number like "3F"
+int move_to_string(Rubiks_Cube_Move m, char *buf, size_t length)
+{
+    if (m.face >= FACE_COUNT || m.rot >= ROTATION_COUNT) {
+        return snprintf(buf, length, "?");
+    }
+
+    if (m.slice == 0)
+        return snprintf(buf, length, "%c%s", FACE_TO_CHAR[m.face], ROTATION_TO_STRING[m.rot]);
+
+    return snprintf(buf, length, "%" PRIu32 "%c%s", m.slice + 1, FACE_TO_CHAR[m.face], ROTATION_TO_STRING[m.rot]);
+}
+
+// Parses a single move in SiGN notation like "F", "3R'" or "U2". Returns the number of characters read or 0 if str doesn't start with a move.
+int move_from_string(const char *str, Rubiks_Cube_Move *m)
+{
+    uint64_t layer;
+    int i, f;
+
+    i = 0;
+    layer = 0;
+    while (isdigit((unsigned char) str[i])) {
+        layer = layer * 10 + (str[i] - '0');
+        if (layer > UINT32_MAX) return 0;
+        i++;
+    }
+    if (i > 0 && layer == 0) return 0;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (FACE_TO_CHAR[f] == str[i]) break;
+    }
+    if (f == FACE_COUNT) return 0;
+    i++;
+
+    m->face  = f;
+    m->slice = layer > 0 ? layer - 1 : 0;
+    m->rot   = ROTATION_CW;
+
+    if (str[i] == '2') {
+        m->rot = ROTATION_180;
+        i++;
+        // F2' is the same as F2
+        if (str[i] == '\'') i++;
+    } else if (str[i] == '\'') {
+        m->rot = ROTATION_CCW;
+        i++;
+    }
+
+    return i;
+}
+
+// Formats moves separated by spaces. The returned string has to be freed by the caller.
+char *moves_to_string(const Rubiks_Cube_Move *moves, size_t count)
+{
+    char *str;
+    size_t i, length;
+
+    str = (char *) malloc(count * MOVE_STRING_LENGTH + 1);
+    if (str == NULL) {
+        log_error("Failed to allocate memory for %zu moves", count);
+        return NULL;
+    }
+
+    length = 0;
+    str[0] = '\0';
+    for (i = 0; i < count; i++) {
+        if (i > 0) str[length++] = ' ';
+        length += move_to_string(moves[i], &str[length], MOVE_STRING_LENGTH);
+    }
+
+    return str;
+}
+
+// Parses moves separated by whitespace. On success *moves has to be freed by the caller.
+int moves_from_string(const char *str, Rubiks_Cube_Move **moves, size_t *count)
+{
+    Rubiks_Cube_Move *m;
+    size_t capacity, i;
+    int read;
+
+    *moves = NULL;
+    *count = 0;
+
+    // every move has at least one character and is followed by a space
+    capacity = strlen(str) / 2 + 1;
+    m = (Rubiks_Cube_Move *) malloc(capacity * sizeof (Rubiks_Cube_Move));
+    if (m == NULL) {
+        log_error("Failed to allocate memory for moves");
+        return 0;
+    }
+
+    i = 0;
+    while (*str != '\0') {
+        if (isspace((unsigned char) *str)) {
+            str++;
+            continue;
+        }
+
+        read = move_from_string(str, &m[i]);
+        if (read == 0 || (str[read] != '\0' && !isspace((unsigned char) str[read]))) {
+            log_warning("Invalid move at \"%.16s\"", str);
+            free(m);
+            return 0;
+        }
+
+        str += read;
+        i++;
+    }
+
+    *moves = m;
+    *count = i;
+
+    return 1;
+}
+
+
+static Move_Layer move_layer(Rubiks_Cube_Move m, uint64_t n)
+{
+    // a counter clockwise turn of a face is a clockwise turn of the same layer seen from the opposite face
+    if (n > 0 && m.face >= 3 && m.slice < n)
+        return (Move_Layer) {m.face - 3, n - 1 - m.slice, ROTATION_COUNT - m.rot};
+
+    return (Move_Layer) {m.face, m.slice, m.rot + 1};
+}
+
+static Rubiks_Cube_Move layer_move(Move_Layer l, uint64_t n)
+{
+    uint64_t opposite;
+
+    if (n == 0 || l.face >= 3 || l.slice >= n)
+        return rubiks_cube_move(l.face, l.quarters - 1, l.slice);
+
+    opposite = n - 1 - l.slice;
+    if (opposite < l.slice || (opposite == l.slice && MIDDLE_FACE[l.face] != l.face))
+        return rubiks_cube_move(face_opposite(l.face), ROTATION_COUNT - l.quarters, opposite);
+
+    return rubiks_cube_move(l.face, l.quarters - 1, l.slice);
+}
+
+static int layer_less(Move_Layer a, Move_Layer b)
+{
+    if (a.face != b.face) return a.face < b.face;
+    return a.slice < b.slice;
+}
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "packed_state.h"
+
+#include "logging.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+// a row or column of a face, walked from (row, col) in steps of (drow, dcol)
+typedef struct {
+    Rubiks_Cube_Face face;
+    uint64_t row, col;
+    int drow, dcol;
+} Packed_Line;
+
+static Packed_State *packed_state_alloc(uint64_t n);
+static int  alloc_scratch(Packed_State *p);
+static void read_row(const Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint8_t *stickers);
+static void write_row(Packed_State *p, Rubiks_Cube_Face face, uint64_t row, const uint8_t *stickers);
+static void read_line(const Packed_State *p, Packed_Line l, uint8_t *stickers);
+static void write_line(Packed_State *p, Packed_Line l, const uint8_t *stickers);
+static Packed_Line sticker_line(uint64_t n, uint64_t first, uint64_t second);
+static void rotate_face(Packed_State *p, Rubiks_Cube_Face face, int quarters);
+
+Packed_State *packed_state(uint64_t n)
+{
+    Packed_State *p;
+
+    p = packed_state_alloc(n);
+    if (p == NULL) return NULL;
+
+    p->words = (uint64_t *) malloc(FACE_COUNT * n * p->row_words * sizeof (uint64_t));
+    if (p->words == NULL) {
+        log_error("Failed to allocate %" PRIu64 " bytes for packed stickers", FACE_COUNT * n * p->row_words * sizeof (uint64_t));
+        packed_state_free(p);
+        return NULL;
+    }
+
+    packed_state_reset(p);
+
+    return p;
+}
+
+// Keeps the stickers in a file that is mapped into memory, so the cube can be bigger than the memory
+// and is still there the next time. An existing file of the same side length is continued, otherwise
+// the file is created with a solved cube. Files that are not empty and do not start with PACKED_STATE_MAGIC
+// are never overwritten.
+Packed_State *packed_state_map(const char *path, uint64_t n)
+{
+#ifdef _WIN32
+    (void) n;
+    log_error("Mapping packed stickers from \'%s\' is not supported on windows", path);
+    return NULL;
+#else
+    Packed_State *p;
+    Packed_State_Header header = {0};
+    struct stat st;
+    size_t size;
+    void *data;
+    char magic[sizeof (header.magic)];
+    int fd, fresh;
+
+    p = packed_state_alloc(n);
+    if (p == NULL) return NULL;
+
+    size = sizeof (Packed_State_Header) + FACE_COUNT * n * p->row_words * sizeof (uint64_t);
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        log_error("Failed to open packed stickers \'%s\': %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        packed_state_free(p);
+        return NULL;
+    }
+
+    if (st.st_size > 0 && (pread(fd, magic, sizeof (magic), 0) != (ssize_t) sizeof (magic) ||
+                           memcmp(magic, PACKED_STATE_MAGIC, sizeof (magic)) != 0)) {
+        log_error("\'%s\' exists and does not hold packed stickers, refusing to overwrite it", path);
+        close(fd);
+        packed_state_free(p);
+        return NULL;
+    }
+
+    fresh = (size_t) st.st_size != size;
+    if (fresh && (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0)) {
+        log_error("Failed to resize \'%s\' to %zu bytes: %s", path, size, strerror(errno));
+        close(fd);
+        packed_state_free(p);
+        return NULL;
+    }
+
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        log_error("Failed to map packed stickers \'%s\': %s", path, strerror(errno));
+        packed_state_free(p);
+        return NULL;
+    }
+
+    p->mapping = data;
+    p->mapping_size = size;
+    p->words = (uint64_t *) ((uint8_t *) data + sizeof (Packed_State_Header));
+
+    memcpy(header.magic, PACKED_STATE_MAGIC, sizeof (header.magic));
+    header.version   = PACKED_STATE_VERSION;
+    header.n         = n;
+    header.row_words = p->row_words;
+
+    if (!fresh && memcmp(data, &header, sizeof (header)) != 0) fresh = 1;
+    if (fresh) {
+        memcpy(data, &header, sizeof (header));
+        packed_state_reset(p);
+        log_info("Created %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube in \'%s\'", n, n, n, path);
+    } else {
+        log_info("Continuing %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube from \'%s\'", n, n, n, path);
+    }
+
+    return p;
+#endif
+}
+
+void packed_state_free(Packed_State *p)
+{
+    if (p == NULL) return;
+
+#ifndef _WIN32
+    if (p->mapping != NULL) munmap(p->mapping, p->mapping_size);
+    else
+#endif
+    if (p->words != NULL) free(p->words);
+
+    if (p->ring != NULL) free(p->ring);
+    if (p->line != NULL) free(p->line);
+    free(p);
+}
+
+void packed_state_reset(Packed_State *p)
+{
+    uint64_t f, r, w, word;
+    int i;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        word = 0;
+        for (i = 0; i < PACKED_STATE_STICKERS_PER_WORD; i++)
+            word |= f << (3 * i);
+
+        for (r = 0; r < p->n; r++) {
+            for (w = 0; w < p->row_words; w++)
+                p->words[(f * p->n + r) * p->row_words + w] = word;
+        }
+    }
+}
+
+int packed_state_is_solved(const Packed_State *p)
+{
+    uint64_t f, r, i;
+    uint8_t color;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        // every sticker of a solved face has the color of the first one
+        color = packed_state_get(p, f, 0, 0);
+        for (r = 0; r < p->n; r++) {
+            read_row(p, f, r, p->line);
+            for (i = 0; i < p->n; i++) {
+                if (p->line[i] != color) return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+uint8_t packed_state_get(const Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint64_t col)
+{
+    uint64_t word;
+
+    word = p->words[(face * p->n + row) * p->row_words + col / PACKED_STATE_STICKERS_PER_WORD];
+    return (word >> (3 * (col % PACKED_STATE_STICKERS_PER_WORD))) & 7;
+}
+
+void packed_state_set(Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint64_t col, uint8_t sticker)
+{
+    uint64_t *word;
+    int shift;
+
+    word  = &p->words[(face * p->n + row) * p->row_words + col / PACKED_STATE_STICKERS_PER_WORD];
+    shift = 3 * (col % PACKED_STATE_STICKERS_PER_WORD);
+    *word = (*word & ~((uint64_t) 7 << shift)) | (uint64_t) sticker << shift;
+}
+
+// Same move as cube_state_rotate_slice(). The four rows and columns of the slice are unpacked into
+// scratch memory first and written to where they move, a face of the slice is rotated in place.
+void packed_state_rotate_slice(Packed_State *p, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot, uint64_t slice)
+{
+    Packed_Line src[4], dst[4];
+    Rubiks_Cube_Move m;
+    uint64_t n, first, second, moved;
+    int f, count, i;
+
+    n = p->n;
+
+    if (face >= FACE_COUNT || rot >= ROTATION_COUNT) {
+        log_warning("Invalid move (face %d, rotation %d), skipping", (int) face, (int) rot);
+        return;
+    }
+    if (slice >= n) {
+        log_warning("Slice index is out of range %" PRIu64 " >= %" PRIu64 ", skipping move", slice, n);
+        return;
+    }
+
+    m = rubiks_cube_move(face, rot, slice);
+
+    count = 0;
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (f == (int) face || f == (int) face_opposite(face)) {
+            // only the outer layers turn a whole face, where its first sticker goes tells by how much
+            if (n == 1) continue;
+            first = cube_state_sticker_index(n, f, 0, 0);
+            moved = cube_state_move_sticker(n, first, m);
+
+            if      (moved == cube_state_sticker_index(n, f, n-1, 0))   rotate_face(p, f, 1);
+            else if (moved == cube_state_sticker_index(n, f, n-1, n-1)) rotate_face(p, f, 2);
+            else if (moved == cube_state_sticker_index(n, f, 0, n-1))   rotate_face(p, f, 3);
+            continue;
+        }
+
+        // the first two stickers of the face in the slice give the line and where it moves to
+        first  = cube_state_slice_sticker(n, face, slice, f, 0);
+        second = cube_state_slice_sticker(n, face, slice, f, n > 1 ? 1 : 0);
+        src[count] = sticker_line(n, first, second);
+        dst[count] = sticker_line(n, cube_state_move_sticker(n, first, m), cube_state_move_sticker(n, second, m));
+        count++;
+    }
+
+    for (i = 0; i < count; i++)
+        read_line(p, src[i], &p->ring[i * n]);
+    for (i = 0; i < count; i++)
+        write_line(p, dst[i], &p->ring[i * n]);
+}
+
+void packed_state_apply_move(Packed_State *p, Rubiks_Cube_Move m)
+{
+    packed_state_rotate_slice(p, m.face, m.rot, m.slice);
+}
+
+int packed_state_to_state(const Packed_State *p, Cube_State *s)
+{
+    uint64_t f, r;
+
+    if (s->n != p->n) {
+        log_error("Cannot unpack a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube into a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state",
+                  p->n, p->n, p->n, s->n, s->n, s->n);
+        return 0;
+    }
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (r = 0; r < p->n; r++)
+            read_row(p, f, r, &s->stickers[cube_state_sticker_index(p->n, f, r, 0)]);
+    }
+
+    return 1;
+}
+
+int packed_state_from_state(Packed_State *p, const Cube_State *s)
+{
+    uint64_t f, r;
+
+    if (s->n != p->n) {
+        log_error("Cannot pack a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state into a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " cube",
+                  s->n, s->n, s->n, p->n, p->n, p->n);
+        return 0;
+    }
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (r = 0; r < p->n; r++)
+            write_row(p, f, r, &s->stickers[cube_state_sticker_index(p->n, f, r, 0)]);
+    }
+
+    return 1;
+}
+
+
+static Packed_State *packed_state_alloc(uint64_t n)
+{
+    Packed_State *p;
+
+    if (n == 0 || n > UINT32_MAX) {
+        log_error("Cannot create packed cube with side length %" PRIu64, n);
+        return NULL;
+    }
+
+    p = (Packed_State *) calloc(1, sizeof (Packed_State));
+    if (p == NULL) {
+        log_error("Failed to allocate memory for packed cube");
+        return NULL;
+    }
+
+    p->n = n;
+    p->row_words = (n + PACKED_STATE_STICKERS_PER_WORD - 1) / PACKED_STATE_STICKERS_PER_WORD;
+
+    if (!alloc_scratch(p)) {
+        packed_state_free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+static int alloc_scratch(Packed_State *p)
+{
+    // rows are unpacked a word at a time, so the scratch rows are rounded up to whole words
+    p->ring = (uint8_t *) malloc(4 * p->n);
+    p->line = (uint8_t *) malloc(p->row_words * PACKED_STATE_STICKERS_PER_WORD);
+    if (p->ring == NULL || p->line == NULL) {
+        log_error("Failed to allocate scratch memory for packed cube");
+        return 0;
+    }
+
+    return 1;
+}
+
+// Unpacks a row word by word, the shifts of one word do not depend on each other and are vectorized.
+static void read_row(const Packed_State *p, Rubiks_Cube_Face face, uint64_t row, uint8_t *stickers)
+{
+    const uint64_t *words;
+    uint64_t w, word, count;
+    int i;
+
+    words = &p->words[(face * p->n + row) * p->row_words];
+    for (w = 0; w < p->row_words; w++) {
+        word  = words[w];
+        count = p->n - w * PACKED_STATE_STICKERS_PER_WORD;
+
+        if (count >= PACKED_STATE_STICKERS_PER_WORD) {
+            for (i = 0; i < PACKED_STATE_STICKERS_PER_WORD; i++)
+                stickers[i] = (word >> (3 * i)) & 7;
+        } else {
+            for (i = 0; i < (int) count; i++)
+                stickers[i] = (word >> (3 * i)) & 7;
+        }
+        stickers += PACKED_STATE_STICKERS_PER_WORD;
+    }
+}
+
+static void write_row(Packed_State *p, Rubiks_Cube_Face face, uint64_t row, const uint8_t *stickers)
+{
+    uint64_t *words;
+    uint64_t w, word, count;
+    int i;
+
+    words = &p->words[(face * p->n + row) * p->row_words];
+    for (w = 0; w < p->row_words; w++) {
+        word  = 0;
+        count = p->n - w * PACKED_STATE_STICKERS_PER_WORD;
+
+        if (count >= PACKED_STATE_STICKERS_PER_WORD) {
+            for (i = 0; i < PACKED_STATE_STICKERS_PER_WORD; i++)
+                word |= (uint64_t) (stickers[i] & 7) << (3 * i);
+        } else {
+            for (i = 0; i < (int) count; i++)
+                word |= (uint64_t) (stickers[i] & 7) << (3 * i);
+        }
+        words[w] = word;
+        stickers += PACKED_STATE_STICKERS_PER_WORD;
+    }
+}
+
+// Rows are copied as a whole and reversed if needed, columns go sticker by sticker.
+static void read_line(const Packed_State *p, Packed_Line l, uint8_t *stickers)
+{
+    uint64_t i, r, c;
+
+    if (l.drow == 0) {
+        read_row(p, l.face, l.row, p->line);
+        if (l.dcol > 0) memcpy(stickers, p->line, p->n);
+        else for (i = 0; i < p->n; i++) stickers[i] = p->line[p->n-1-i];
+        return;
+    }
+
+    for (i = 0, r = l.row, c = l.col; i < p->n; i++, r += l.drow)
+        stickers[i] = packed_state_get(p, l.face, r, c);
+}
+
+static void write_line(Packed_State *p, Packed_Line l, const uint8_t *stickers)
+{
+    uint64_t i, r, c;
+
+    if (l.drow == 0) {
+        if (l.dcol > 0) memcpy(p->line, stickers, p->n);
+        else for (i = 0; i < p->n; i++) p->line[p->n-1-i] = stickers[i];
+        write_row(p, l.face, l.row, p->line);
+        return;
+    }
+
+    for (i = 0, r = l.row, c = l.col; i < p->n; i++, r += l.drow)
+        packed_state_set(p, l.face, r, c, stickers[i]);
+}
+
+// line through two neighbouring stickers of a face, a single sticker is a row
+static Packed_Line sticker_line(uint64_t n, uint64_t first, uint64_t second)
+{
+    Packed_Line l;
+    uint64_t r2, c2;
+
+    l.face = first / (n*n);
+    l.row  = (first % (n*n)) / n;
+    l.col  = first % n;
+    r2 = (second % (n*n)) / n;
+    c2 = second % n;
+
+    l.drow = (r2 > l.row) - (r2 < l.row);
+    l.dcol = (c2 > l.col) - (c2 < l.col);
+    if (l.drow == 0 && l.dcol == 0) l.dcol = 1;
+
+    return l;
+}
+
+// Turns the stickers of a face counter clockwise as seen from outside, a quarter turn moves (r, c) to (n-1-c, r).
+// Half turns reverse and swap whole rows, quarter turns cycle four stickers at a time.
+static void rotate_face(Packed_State *p, Rubiks_Cube_Face face, int quarters)
+{
+    uint64_t n, r, c, i;
+    uint8_t a, b, d, e;
+
+    n = p->n;
+
+    if (quarters == 2) {
+        for (r = 0; r < (n + 1) / 2; r++) {
+            read_row(p, face, r, p->ring);
+            read_row(p, face, n-1-r, &p->ring[n]);
+            for (i = 0; i < n; i++) p->line[i] = p->ring[n + n-1-i];
+            write_row(p, face, r, p->line);
+            for (i = 0; i < n; i++) p->line[i] = p->ring[n-1-i];
+            write_row(p, face, n-1-r, p->line);
+        }
+        return;
+    }
+
+    for (r = 0; r < n / 2; r++) {
+        for (c = 0; c < (n + 1) / 2; c++) {
+            a = packed_state_get(p, face, r, c);
+            b = packed_state_get(p, face, n-1-c, r);
+            d = packed_state_get(p, face, n-1-r, n-1-c);
+            e = packed_state_get(p, face, c, n-1-r);
+
+            if (quarters == 1) {
+                packed_state_set(p, face, n-1-c, r, a);
+                packed_state_set(p, face, n-1-r, n-1-c, b);
+                packed_state_set(p, face, c, n-1-r, d);
+                packed_state_set(p, face, r, c, e);
+            } else {
+                packed_state_set(p, face, r, c, b);
+                packed_state_set(p, face, n-1-c, r, d);
+                packed_state_set(p, face, n-1-r, n-1-c, e);
+                packed_state_set(p, face, c, n-1-r, a);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "permutation.h"
+
+#include "logging.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+static uint64_t gcd(uint64_t a, uint64_t b);
+
+// identity permutation of a NxNxN cube
+Permutation *permutation(uint64_t n)
+{
+    Permutation *p;
+    uint64_t i;
+
+    if (n == 0) {
+        log_error("Cannot create permutation with side length 0");
+        return NULL;
+    }
+
+    p = (Permutation *) calloc(1, sizeof (Permutation));
+    if (p == NULL) {
+        log_error("Failed to allocate memory for permutation");
+        return NULL;
+    }
+
+    p->n = n;
+    p->size = FACE_COUNT * n * n;
+
+    // a slice has at most 2*n*n + 4*n stickers, the positions and the sources of all of them have to fit
+    p->src            = (uint64_t *) malloc(p->size * sizeof (uint64_t));
+    p->scratch        = (uint64_t *) malloc((p->size + 8*n) * sizeof (uint64_t));
+    p->scratch_colors = (uint8_t *)  malloc(p->size * sizeof (uint8_t));
+    if (p->src == NULL || p->scratch == NULL || p->scratch_colors == NULL) {
+        log_error("Failed to allocate memory for a permutation of %" PRIu64 " stickers", p->size);
+        permutation_free(p);
+        return NULL;
+    }
+
+    for (i = 0; i < p->size; i++)
+        p->src[i] = i;
+
+    return p;
+}
+
+Permutation *permutation_copy(const Permutation *p)
+{
+    Permutation *c;
+
+    c = permutation(p->n);
+    if (c == NULL) return NULL;
+
+    memcpy(c->src, p->src, p->size * sizeof (uint64_t));
+
+    return c;
+}
+
+// Compiles the moves into one permutation, each move only touches the stickers of its slice.
+Permutation *permutation_compile(uint64_t n, const Rubiks_Cube_Move *moves, size_t count)
+{
+    Permutation *p;
+    size_t i;
+
+    p = permutation(n);
+    if (p == NULL) return NULL;
+
+    for (i = 0; i < count; i++)
+        permutation_apply_move(p, moves[i]);
+
+    return p;
+}
+
+// appends m to the sequence of p
+void permutation_apply_move(Permutation *p, Rubiks_Cube_Move m)
+{
+    uint64_t *stickers, *sources, count, i;
+
+    if (m.face >= FACE_COUNT || m.rot >= ROTATION_COUNT || m.slice >= p->n) {
+        log_warning("Invalid move (face %d, rotation %d, slice %" PRIu32 "), skipping", (int) m.face, (int) m.rot, m.slice);
+        return;
+    }
+
+    stickers = p->scratch;
+    count = cube_state_slice_stickers(p->n, m.face, m.slice, stickers);
+    sources = &p->scratch[count];
+
+    for (i = 0; i < count; i++)
+        sources[i] = p->src[stickers[i]];
+
+    for (i = 0; i < count; i++)
+        p->src[cube_state_move_sticker(p->n, stickers[i], m)] = sources[i];
+}
+
+// p becomes p followed by q, p and q may be the same
+void permutation_compose(Permutation *p, const Permutation *q)
+{
+    uint64_t i;
+
+    for (i = 0; i < p->size; i++)
+        p->scratch[i] = p->src[q->src[i]];
+
+    memcpy(p->src, p->scratch, p->size * sizeof (uint64_t));
+}
+
+void permutation_invert(Permutation *p)
+{
+    uint64_t i;
+
+    for (i = 0; i < p->size; i++)
+        p->scratch[p->src[i]] = i;
+
+    memcpy(p->src, p->scratch, p->size * sizeof (uint64_t));
+}
+
+// Raises p to the power k by repeated squaring, a negative k applies the inverse. Returns 0 if memory runs out.
+int permutation_power(Permutation *p, int64_t k)
+{
+    Permutation *base;
+    uint64_t e, i;
+
+    if (k < 0) permutation_invert(p);
+    e = k < 0 ? -(uint64_t) k : (uint64_t) k;
+
+    base = permutation_copy(p);
+    if (base == NULL) return 0;
+
+    for (i = 0; i < p->size; i++)
+        p->src[i] = i;
+
+    while (e > 0) {
+        if (e & 1) permutation_compose(p, base);
+        e >>= 1;
+        if (e > 0) permutation_compose(base, base);
+    }
+
+    permutation_free(base);
+
+    return 1;
+}
+
+void permutation_apply(Permutation *p, Cube_State *s)
+{
+    uint64_t i;
+
+    if (s->n != p->n) {
+        log_warning("Cannot apply permutation of a %" PRIu64 "x%" PRIu64 " cube to a %" PRIu64 "x%" PRIu64 " cube", p->n, p->n, s->n, s->n);
+        return;
+    }
+
+    memcpy(p->scratch_colors, s->stickers, p->size * sizeof (uint8_t));
+    for (i = 0; i < p->size; i++)
+        s->stickers[i] = p->scratch_colors[p->src[i]];
+}
+
+int permutation_is_identity(const Permutation *p)
+{
+    uint64_t i;
+
+    for (i = 0; i < p->size; i++) {
+        if (p->src[i] != i) return 0;
+    }
+
+    return 1;
+}
+
+// Writes the length of every cycle that moves stickers into lengths, which may be NULL or has to hold size/2 entries.
+// Returns the number of those cycles.
+uint64_t permutation_cycles(const Permutation *p, uint64_t *lengths)
+{
+    uint8_t *visited;
+    uint64_t i, j, length, count;
+
+    visited = (uint8_t *) calloc(p->size, sizeof (uint8_t));
+    if (visited == NULL) {
+        log_error("Failed to allocate memory for the cycle decomposition");
+        return 0;
+    }
+
+    count = 0;
+    for (i = 0; i < p->size; i++) {
+        if (visited[i]) continue;
+
+        length = 0;
+        for (j = i; !visited[j]; j = p->src[j]) {
+            visited[j] = 1;
+            length++;
+        }
+
+        if (length > 1) {
+            if (lengths != NULL) lengths[count] = length;
+            count++;
+        }
+    }
+
+    free(visited);
+
+    return count;
+}
+
+// Number of times the sequence has to be applied to return to the start, the least common multiple
+// of the cycle lengths. Returns 0 if it doesn't fit into 64 bits or memory runs out.
+// On cubes with more than one center per face the colors can repeat earlier since centers of one color look alike.
+uint64_t permutation_order(const Permutation *p)
+{
+    uint64_t *lengths, count, order, g, i;
+
+    lengths = (uint64_t *) malloc((p->size / 2) * sizeof (uint64_t));
+    if (lengths == NULL) {
+        log_error("Failed to allocate memory for the cycle lengths");
+        return 0;
+    }
+
+    count = permutation_cycles(p, lengths);
+
+    order = 1;
+    for (i = 0; i < count; i++) {
+        g = gcd(order, lengths[i]);
+        if (order / g > UINT64_MAX / lengths[i]) {
+            log_warning("Order of the permutation does not fit into 64 bits");
+            order = 0;
+            break;
+        }
+        order = order / g * lengths[i];
+    }
+
+    free(lengths);
+
+    return order;
+}
+
+void permutation_free(Permutation *p)
+{
+    if (p == NULL) return;
+
+    if (p->src != NULL)
+        free(p->src);
+
+    if (p->scratch != NULL)
+        free(p->scratch);
+
+    if (p->scratch_colors != NULL)
+        free(p->scratch_colors);
+
+    free(p);
+}
+
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
\ No newline at end of file
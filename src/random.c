@@ -0,0 +1,92 @@
+#include "random.h"
+
+static uint64_t rotl(uint64_t x, int k);
+static uint64_t splitmix64(uint64_t *x);
+
+// the state is filled with splitmix64 as recommended by the authors, so any seed (even 0) is fine
+void random_seed(Random *r, uint64_t seed)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        r->s[i] = splitmix64(&seed);
+}
+
+uint64_t random_next(Random *r)
+{
+    uint64_t result, t;
+
+    result = rotl(r->s[1] * 5, 7) * 9;
+    t = r->s[1] << 17;
+
+    r->s[2] ^= r->s[0];
+    r->s[3] ^= r->s[1];
+    r->s[1] ^= r->s[2];
+    r->s[0] ^= r->s[3];
+
+    r->s[2] ^= t;
+    r->s[3] = rotl(r->s[3], 45);
+
+    return result;
+}
+
+// Uniform number in [0, bound), Lemire's multiply and reject avoids the bias of a plain modulo.
+uint64_t random_below(Random *r, uint64_t bound)
+{
+    __uint128_t m;
+    uint64_t low, threshold;
+
+    if (bound == 0) return 0;
+
+    m = (__uint128_t) random_next(r) * bound;
+    low = (uint64_t) m;
+    if (low < bound) {
+        threshold = -bound % bound;
+        while (low < threshold) {
+            m = (__uint128_t) random_next(r) * bound;
+            low = (uint64_t) m;
+        }
+    }
+
+    return (uint64_t) (m >> 64);
+}
+
+// advances the generator by 2^128 steps, the skipped numbers can be used by another thread
+void random_jump(Random *r)
+{
+    static const uint64_t JUMP[4] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+    uint64_t s[4] = {0};
+    int i, b;
+
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (JUMP[i] & (uint64_t) 1 << b) {
+                s[0] ^= r->s[0];
+                s[1] ^= r->s[1];
+                s[2] ^= r->s[2];
+                s[3] ^= r->s[3];
+            }
+            random_next(r);
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+        r->s[i] = s[i];
+}
+
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z;
+
+    z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+    return z ^ (z >> 31);
+}
\ No newline at end of file
@@ -0,0 +1,714 @@
+#include "reduction.h"
+
+#include "cube3.h"
+#include "kociemba.h"
+#include "logging.h"
+#include "thistlethwaite.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+
+// Solves a NxNxN cube in the following order:
+//  1. odd cubes: bring the middle centers home with middle slice moves
+//  2. solve corners and middle edges like a 3x3x3 with the two-phase solver (or Thistlethwaite's algorithm)
+//  3. solve every orbit of wing edges with pure 3-cycles, an odd orbit is fixed with one inner slice turn first
+//  4. solve every orbit of centers with pure 3-cycles
+// Every 3-cycle is a conjugated commutator that leaves the rest of the cube untouched, so solved
+// pieces stay solved and no parity algorithms are needed.
+
+#define ORBIT_SIZE     24
+#define TRIPLE_COUNT   (ORBIT_SIZE * ORBIT_SIZE * ORBIT_SIZE)
+#define MAX_LAYERS     4
+#define MAX_GENERATORS (CUBE3_MOVE_COUNT + MAX_LAYERS * 3 * ROTATION_COUNT)
+#define SEED_LENGTH    8
+#define MAX_SETUP      64
+
+#ifdef SOLVER_THISTLETHWAITE
+#   define SKELETON_MAX_LENGTH THISTLETHWAITE_MAX_LENGTH
+#else
+#   define SKELETON_MAX_LENGTH KOCIEMBA_MAX_LENGTH
+#endif
+
+#define TRIPLE_ROOT       -1
+#define TRIPLE_UNVISITED  -2
+
+typedef struct {
+    Rubiks_Cube_Move *items;
+    size_t count;
+    size_t capacity;
+} Move_List;
+
+// A set of 24 stickers that can be permuted into each other. For wing orbits every position also has a partner sticker.
+typedef struct {
+    uint64_t n;
+    int wing;
+
+    uint64_t stickers[ORBIT_SIZE];
+    uint64_t partners[ORBIT_SIZE];
+
+    // generator g moves position i to position perms[g][i]
+    Rubiks_Cube_Move generators[MAX_GENERATORS];
+    uint8_t perms[MAX_GENERATORS][ORBIT_SIZE];
+    int generator_count;
+
+    // a 3-cycle of the orbit and its inverse
+    Rubiks_Cube_Move seeds[2][SEED_LENGTH];
+
+    // tree of conjugated seeds, indexed by the ordered triple a*24*24 + b*24 + c of the cycle a -> b -> c
+    int16_t parent[TRIPLE_COUNT];
+    uint8_t generator[TRIPLE_COUNT];
+    uint8_t seed[TRIPLE_COUNT];
+    int16_t queue[TRIPLE_COUNT];
+} Orbit;
+
+static int  solve_middle_centers(Cube_State *w, Move_List *l);
+static int  solve_skeleton(Cube_State *w, Move_List *l);
+static int  solve_wings(Cube_State *w, Move_List *l, Orbit *o, uint64_t k);
+static int  solve_centers(Cube_State *w, Move_List *l, Orbit *o, uint64_t r, uint64_t c, uint8_t *visited);
+static int  orbit_init(Orbit *o, uint64_t n, uint64_t sticker, int wing, const uint64_t *layers, int layer_count);
+static int  orbit_try_seed(Orbit *o, const Rubiks_Cube_Move *seed);
+static void orbit_build_cycles(Orbit *o);
+static int  orbit_cycle(Orbit *o, Cube_State *w, Move_List *l, int a, int b, int c);
+static int  orbit_index(const Orbit *o, uint64_t sticker);
+static uint64_t partner_sticker(uint64_t n, uint64_t sticker);
+static void commutator(Rubiks_Cube_Move *seq, Rubiks_Cube_Move a, Rubiks_Cube_Move x, Rubiks_Cube_Move y);
+static int  move_list_push(Move_List *l, Rubiks_Cube_Move m);
+static int  move_list_apply(Move_List *l, Cube_State *w, Rubiks_Cube_Move m);
+static int  is_cancelled(const atomic_int *cancel);
+static void init_skeleton_solver(void);
+
+static pthread_once_t skeleton_solver_once = PTHREAD_ONCE_INIT;
+
+// Generates the tables of the 3x3x3 solver, safe to call from multiple threads.
+void reduction_init(void)
+{
+    pthread_once(&skeleton_solver_once, init_skeleton_solver);
+}
+
+// Finds moves that solve s. On success *moves has to be freed by the caller.
+int reduction_solve(const Cube_State *s, Rubiks_Cube_Move **moves, size_t *count)
+{
+    return reduction_solve_cancellable(s, moves, count, NULL);
+}
+
+// Like reduction_solve(), but gives up and returns 0 without a solution as soon as *cancel is set.
+// The flag is checked between the solved orbits, cancel may be NULL.
+int reduction_solve_cancellable(const Cube_State *s, Rubiks_Cube_Move **moves, size_t *count, const atomic_int *cancel)
+{
+    Cube_State *w;
+    Move_List l = {0};
+    Orbit *o;
+    uint8_t *visited;
+    uint64_t n, k, r, c;
+    int ok;
+
+    *moves = NULL;
+    *count = 0;
+
+    n = s->n;
+
+    reduction_init();
+
+    w = cube_state_copy(s);
+    o = (Orbit *) malloc(sizeof (Orbit));
+    visited = (uint8_t *) calloc(n * n, sizeof (uint8_t));
+    if (w == NULL || o == NULL || visited == NULL) {
+        log_error("Failed to allocate memory for the solver");
+        cube_state_free(w);
+        if (o != NULL) free(o);
+        if (visited != NULL) free(visited);
+        return 0;
+    }
+
+    ok = 1;
+
+    if (n % 2 == 1 && n > 1)
+        ok = solve_middle_centers(w, &l);
+
+    if (ok && n > 1 && !is_cancelled(cancel))
+        ok = solve_skeleton(w, &l);
+
+    for (k = 1; ok && 2*k + 1 < n && !is_cancelled(cancel); k++)
+        ok = solve_wings(w, &l, o, k);
+
+    for (r = 1; ok && r < n-1 && !is_cancelled(cancel); r++) {
+        for (c = 1; ok && c < n-1 && !is_cancelled(cancel); c++) {
+            if (visited[r*n + c]) continue;
+            if (n % 2 == 1 && r == n/2 && c == n/2) continue;
+
+            ok = solve_centers(w, &l, o, r, c, visited);
+        }
+    }
+
+    if (ok && is_cancelled(cancel)) {
+        ok = 0;
+    } else if (ok && !cube_state_is_solved(w)) {
+        log_error("Solver finished without solving the cube");
+        ok = 0;
+    }
+
+    cube_state_free(w);
+    free(o);
+    free(visited);
+
+    if (!ok) {
+        if (l.items != NULL) free(l.items);
+        return 0;
+    }
+
+    // the stages are solved independently, so moves at their borders can often be merged
+    *moves = l.items;
+    *count = moves_optimize(l.items, l.count, n);
+
+    return 1;
+}
+
+
+// the middle centers can only be moved by the three middle slices, a search depth of 2 is enough for every orientation
+static int solve_middle_centers(Cube_State *w, Move_List *l)
+{
+    static const Rubiks_Cube_Face faces[3] = {FACE_LEFT, FACE_DOWN, FACE_FRONT};
+    Rubiks_Cube_Move m1, m2;
+    uint64_t n, mid, f;
+    int i, j, solved;
+
+    n = w->n;
+    mid = n / 2;
+
+    for (i = -1; i < 3 * ROTATION_COUNT; i++) {
+        for (j = -1; j < 3 * ROTATION_COUNT; j++) {
+            m1 = rubiks_cube_move(faces[(i < 0 ? 0 : i) / ROTATION_COUNT], (i < 0 ? 0 : i) % ROTATION_COUNT, mid);
+            m2 = rubiks_cube_move(faces[(j < 0 ? 0 : j) / ROTATION_COUNT], (j < 0 ? 0 : j) % ROTATION_COUNT, mid);
+
+            if (i >= 0) cube_state_apply_move(w, m1);
+            if (j >= 0) cube_state_apply_move(w, m2);
+
+            solved = 1;
+            for (f = 0; f < FACE_COUNT; f++) {
+                if (w->stickers[cube_state_sticker_index(n, f, mid, mid)] != f) solved = 0;
+            }
+
+            if (solved) {
+                if (i >= 0 && !move_list_push(l, m1)) return 0;
+                if (j >= 0 && !move_list_push(l, m2)) return 0;
+                return 1;
+            }
+
+            if (j >= 0) cube_state_apply_move(w, move_inverse(m2));
+            if (i >= 0) cube_state_apply_move(w, move_inverse(m1));
+        }
+    }
+
+    log_error("Failed to solve the middle centers, the cube is not solvable");
+    return 0;
+}
+
+// Solves corners and middle edges. Even cubes have no middle edges, the edges are treated as solved
+// and an odd corner permutation is fixed with a quarter turn first.
+static int solve_skeleton(Cube_State *w, Move_List *l)
+{
+    Rubiks_Cube_Move solution[SKELETON_MAX_LENGTH];
+    Cube3 c;
+    int i, length;
+
+    if (!cube3_from_state(w, &c)) {
+        log_error("Failed to read corners and edges, the cube is not solvable");
+        return 0;
+    }
+
+    if (w->n % 2 == 0 && cube3_corner_parity(&c)) {
+        if (!move_list_apply(l, w, rubiks_cube_move(FACE_UP, ROTATION_CW, 0))) return 0;
+        cube3_from_state(w, &c);
+    }
+
+#ifdef SOLVER_THISTLETHWAITE
+    length = thistlethwaite_solve(&c, solution);
+#else
+    length = kociemba_solve(&c, KOCIEMBA_MAX_LENGTH, solution);
+#endif
+    if (length < 0) return 0;
+
+    for (i = 0; i < length; i++) {
+        if (!move_list_apply(l, w, solution[i])) return 0;
+    }
+
+    return 1;
+}
+
+static int solve_wings(Cube_State *w, Move_List *l, Orbit *o, uint64_t k)
+{
+    Rubiks_Cube_Move seed[SEED_LENGTH];
+    uint64_t n, layers[2];
+    int i, j, u, a, y, x, found, parity;
+    int home[FACE_COUNT][FACE_COUNT], piece[ORBIT_SIZE], where[ORBIT_SIZE];
+
+    n = w->n;
+    layers[0] = k;
+    layers[1] = n-1-k;
+
+    // the wing on the front edge of the up face
+    if (!orbit_init(o, n, cube_state_sticker_index(n, FACE_UP, n-1, k), 1, layers, 2)) return 0;
+
+    // [s, X Y X'] with an inner slice s and outer layer turns X, Y
+    found = 0;
+    for (a = 0; !found && a < 2; a++) {
+        for (x = 0; !found && x < 2; x++) {
+            for (y = 0; !found && y < 4; y++) {
+                commutator(seed,
+                    rubiks_cube_move(FACE_LEFT, a ? ROTATION_CW : ROTATION_CCW, k),
+                    rubiks_cube_move(FACE_UP,   x ? ROTATION_CW : ROTATION_CCW, 0),
+                    rubiks_cube_move(y < 2 ? FACE_RIGHT : FACE_LEFT, y % 2 ? ROTATION_CW : ROTATION_CCW, 0));
+                found = orbit_try_seed(o, seed);
+            }
+        }
+    }
+    if (!found) {
+        log_error("Failed to find a 3-cycle for wing orbit %" PRIu64, k);
+        return 0;
+    }
+
+    orbit_build_cycles(o);
+
+    for (i = 0; i < FACE_COUNT * FACE_COUNT; i++)
+        home[i / FACE_COUNT][i % FACE_COUNT] = -1;
+    for (i = 0; i < ORBIT_SIZE; i++)
+        home[o->stickers[i] / (n*n)][o->partners[i] / (n*n)] = i;
+
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        piece[i] = home[w->stickers[o->stickers[i]]][w->stickers[o->partners[i]]];
+        if (piece[i] < 0) {
+            log_error("Found an invalid wing edge, the cube is not solvable");
+            return 0;
+        }
+    }
+
+    // 3-cycles are even permutations, an inner slice quarter turn swaps the parity of the orbit
+    parity = 0;
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        for (j = i+1; j < ORBIT_SIZE; j++) {
+            if (piece[i] > piece[j]) parity ^= 1;
+        }
+    }
+    if (parity) {
+        if (!move_list_apply(l, w, rubiks_cube_move(FACE_LEFT, ROTATION_CW, k))) return 0;
+        for (i = 0; i < ORBIT_SIZE; i++)
+            piece[i] = home[w->stickers[o->stickers[i]]][w->stickers[o->partners[i]]];
+    }
+
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        if (piece[i] < 0) return 0;
+        where[piece[i]] = i;
+    }
+
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        if (piece[i] == i) continue;
+
+        // move the piece of i home, the piece at i goes to another unsolved position
+        j = where[i];
+        for (u = 0; u < ORBIT_SIZE; u++) {
+            if (u == i || u == j || piece[u] == u) continue;
+            if (o->parent[(j*ORBIT_SIZE + i)*ORBIT_SIZE + u] != TRIPLE_UNVISITED) break;
+        }
+        if (u == ORBIT_SIZE) {
+            log_error("Failed to find a 3-cycle for wing orbit %" PRIu64, k);
+            return 0;
+        }
+
+        if (!orbit_cycle(o, w, l, j, i, u)) return 0;
+
+        a = piece[u];
+        piece[u] = piece[i];
+        piece[i] = i;
+        piece[j] = a;
+        where[piece[u]] = u;
+        where[piece[j]] = j;
+        where[i] = i;
+    }
+
+    return 1;
+}
+
+static int solve_centers(Cube_State *w, Move_List *l, Orbit *o, uint64_t r, uint64_t c, uint8_t *visited)
+{
+    Rubiks_Cube_Move seed[SEED_LENGTH];
+    uint64_t n, b, layers[MAX_LAYERS], tmp, row, col;
+    int i, j, u, a, x, bi, found, layer_count, best_j, best_u, score;
+    int protect[ORBIT_SIZE];
+    uint8_t color[ORBIT_SIZE], want[ORBIT_SIZE];
+
+    n = w->n;
+
+    layer_count = 0;
+    layers[layer_count++] = r;
+    if (n-1-r != r) layers[layer_count++] = n-1-r;
+    if (c != r && c != n-1-r) {
+        layers[layer_count++] = c;
+        if (n-1-c != c) layers[layer_count++] = n-1-c;
+    }
+
+    if (!orbit_init(o, n, cube_state_sticker_index(n, FACE_UP, r, c), 0, layers, layer_count)) return 0;
+
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        if (o->stickers[i] / (n*n) != FACE_UP) continue;
+        tmp = o->stickers[i] % (n*n);
+        row = tmp / n;
+        col = tmp % n;
+        visited[row*n + col] = 1;
+    }
+
+    // [s, U t U'] with inner slices s and t
+    found = 0;
+    for (bi = 0; !found && bi < 2; bi++) {
+        b = bi ? n-1-r : r;
+        if (b == c) continue;
+
+        for (a = 0; !found && a < 2; a++) {
+            for (x = 0; !found && x < 2; x++) {
+                commutator(seed,
+                    rubiks_cube_move(FACE_LEFT, a ? ROTATION_CW : ROTATION_CCW, c),
+                    rubiks_cube_move(FACE_UP,   x ? ROTATION_CW : ROTATION_CCW, 0),
+                    rubiks_cube_move(FACE_LEFT, ROTATION_CW, b));
+                found = orbit_try_seed(o, seed);
+            }
+        }
+    }
+    if (!found) {
+        log_error("Failed to find a 3-cycle for center orbit (%" PRIu64 ", %" PRIu64 ")", r, c);
+        return 0;
+    }
+
+    orbit_build_cycles(o);
+
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        color[i] = w->stickers[o->stickers[i]];
+        want[i]  = o->stickers[i] / (n*n);
+        protect[i] = 0;
+    }
+
+    // positions are sorted by face, once the first five faces are done the last one is solved as well
+    for (i = 0; i < ORBIT_SIZE - 4; i++) {
+        protect[i] = 1;
+        if (color[i] == want[i]) continue;
+
+        best_j = -1;
+        best_u = -1;
+        score = -1;
+        for (j = 0; j < ORBIT_SIZE; j++) {
+            if (protect[j] || color[j] != want[i]) continue;
+
+            for (u = 0; u < ORBIT_SIZE; u++) {
+                if (protect[u] || u == j) continue;
+                if (o->parent[(j*ORBIT_SIZE + i)*ORBIT_SIZE + u] == TRIPLE_UNVISITED) continue;
+
+                // prefer cycles that also solve u and don't break j
+                a = (color[j] != want[j]) + 2*(color[i] == want[u]) + (color[u] != want[u]);
+                if (a > score) {
+                    score = a;
+                    best_j = j;
+                    best_u = u;
+                }
+            }
+        }
+        if (best_j < 0) {
+            log_error("Failed to find a 3-cycle for center orbit (%" PRIu64 ", %" PRIu64 ")", r, c);
+            return 0;
+        }
+
+        if (!orbit_cycle(o, w, l, best_j, i, best_u)) return 0;
+
+        a = color[best_u];
+        color[best_u] = color[i];
+        color[i] = color[best_j];
+        color[best_j] = a;
+    }
+
+    return 1;
+}
+
+// collects the orbit of sticker and the moves that act on it, layers are the inner slice indices that touch the orbit
+static int orbit_init(Orbit *o, uint64_t n, uint64_t sticker, int wing, const uint64_t *layers, int layer_count)
+{
+    static const Rubiks_Cube_Face faces[3] = {FACE_FRONT, FACE_UP, FACE_LEFT};
+    uint64_t s, t;
+    int i, j, g, count, f, r;
+
+    o->n = n;
+    o->wing = wing;
+
+    o->generator_count = 0;
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (r = 0; r < ROTATION_COUNT; r++)
+            o->generators[o->generator_count++] = rubiks_cube_move(f, r, 0);
+    }
+    for (i = 0; i < layer_count; i++) {
+        for (f = 0; f < 3; f++) {
+            for (r = 0; r < ROTATION_COUNT; r++)
+                o->generators[o->generator_count++] = rubiks_cube_move(faces[f], r, layers[i]);
+        }
+    }
+
+    o->stickers[0] = sticker;
+    count = 1;
+    for (i = 0; i < count; i++) {
+        for (g = 0; g < o->generator_count; g++) {
+            t = cube_state_move_sticker(n, o->stickers[i], o->generators[g]);
+            for (j = 0; j < count; j++) {
+                if (o->stickers[j] == t) break;
+            }
+            if (j < count) continue;
+
+            if (count == ORBIT_SIZE) {
+                log_error("Orbit of sticker %" PRIu64 " has more than %d stickers", sticker, ORBIT_SIZE);
+                return 0;
+            }
+            o->stickers[count++] = t;
+        }
+    }
+    if (count != ORBIT_SIZE) {
+        log_error("Orbit of sticker %" PRIu64 " has only %d stickers", sticker, count);
+        return 0;
+    }
+
+    // sort by sticker index, this groups the positions by face
+    for (i = 1; i < ORBIT_SIZE; i++) {
+        s = o->stickers[i];
+        for (j = i; j > 0 && o->stickers[j-1] > s; j--)
+            o->stickers[j] = o->stickers[j-1];
+        o->stickers[j] = s;
+    }
+
+    for (i = 0; i < ORBIT_SIZE; i++)
+        o->partners[i] = wing ? partner_sticker(n, o->stickers[i]) : o->stickers[i];
+
+    for (g = 0; g < o->generator_count; g++) {
+        for (i = 0; i < ORBIT_SIZE; i++)
+            o->perms[g][i] = orbit_index(o, cube_state_move_sticker(n, o->stickers[i], o->generators[g]));
+    }
+
+    return 1;
+}
+
+// Accepts seed if it is a pure 3-cycle of the orbit. Every sticker of the cube is traced through the
+// seed, which is cheap compared to solving the orbit.
+static int orbit_try_seed(Orbit *o, const Rubiks_Cube_Move *seed)
+{
+    uint64_t n, s, t, moved;
+    int i, a, b, c, perm[ORBIT_SIZE];
+
+    n = o->n;
+
+    moved = 0;
+    for (s = 0; s < FACE_COUNT*n*n; s++) {
+        t = s;
+        for (i = 0; i < SEED_LENGTH; i++)
+            t = cube_state_move_sticker(n, t, seed[i]);
+        if (t != s) moved++;
+    }
+    if (moved != (o->wing ? 6 : 3)) return 0;
+
+    a = -1;
+    for (i = 0; i < ORBIT_SIZE; i++) {
+        t = o->stickers[i];
+        for (s = 0; s < SEED_LENGTH; s++)
+            t = cube_state_move_sticker(n, t, seed[s]);
+        perm[i] = orbit_index(o, t);
+        if (perm[i] < 0) return 0;
+        if (perm[i] != i) a = i;
+    }
+    if (a < 0) return 0;
+
+    b = perm[a];
+    c = perm[b];
+    if (perm[c] != a) return 0;
+
+    memcpy(o->seeds[0], seed, SEED_LENGTH * sizeof (Rubiks_Cube_Move));
+    memcpy(o->seeds[1], seed, SEED_LENGTH * sizeof (Rubiks_Cube_Move));
+    moves_invert(o->seeds[1], SEED_LENGTH);
+
+    for (i = 0; i < TRIPLE_COUNT; i++)
+        o->parent[i] = TRIPLE_UNVISITED;
+
+    // the cycle a -> b -> c can be written starting at any of its elements, the inverse seed runs backwards
+    o->parent[(a*ORBIT_SIZE + b)*ORBIT_SIZE + c] = TRIPLE_ROOT; o->seed[(a*ORBIT_SIZE + b)*ORBIT_SIZE + c] = 0;
+    o->parent[(b*ORBIT_SIZE + c)*ORBIT_SIZE + a] = TRIPLE_ROOT; o->seed[(b*ORBIT_SIZE + c)*ORBIT_SIZE + a] = 0;
+    o->parent[(c*ORBIT_SIZE + a)*ORBIT_SIZE + b] = TRIPLE_ROOT; o->seed[(c*ORBIT_SIZE + a)*ORBIT_SIZE + b] = 0;
+    o->parent[(a*ORBIT_SIZE + c)*ORBIT_SIZE + b] = TRIPLE_ROOT; o->seed[(a*ORBIT_SIZE + c)*ORBIT_SIZE + b] = 1;
+    o->parent[(c*ORBIT_SIZE + b)*ORBIT_SIZE + a] = TRIPLE_ROOT; o->seed[(c*ORBIT_SIZE + b)*ORBIT_SIZE + a] = 1;
+    o->parent[(b*ORBIT_SIZE + a)*ORBIT_SIZE + c] = TRIPLE_ROOT; o->seed[(b*ORBIT_SIZE + a)*ORBIT_SIZE + c] = 1;
+
+    return 1;
+}
+
+// Breadth first search over all 3-cycles of the orbit. If the sequence Q cycles a -> b -> c, then g' Q g
+// cycles g(a) -> g(b) -> g(c).
+static void orbit_build_cycles(Orbit *o)
+{
+    int i, g, head, tail, a, b, c, t;
+
+    head = 0;
+    tail = 0;
+    for (i = 0; i < TRIPLE_COUNT; i++) {
+        if (o->parent[i] == TRIPLE_ROOT) o->queue[tail++] = i;
+    }
+
+    while (head < tail) {
+        i = o->queue[head++];
+        a = i / (ORBIT_SIZE*ORBIT_SIZE);
+        b = (i / ORBIT_SIZE) % ORBIT_SIZE;
+        c = i % ORBIT_SIZE;
+
+        for (g = 0; g < o->generator_count; g++) {
+            t = (o->perms[g][a]*ORBIT_SIZE + o->perms[g][b])*ORBIT_SIZE + o->perms[g][c];
+            if (o->parent[t] != TRIPLE_UNVISITED) continue;
+
+            o->parent[t] = i;
+            o->generator[t] = g;
+            o->seed[t] = o->seed[i];
+            o->queue[tail++] = t;
+        }
+    }
+}
+
+// cycles the stickers at positions a -> b -> c, emits the moves and applies the cycle to w
+static int orbit_cycle(Orbit *o, Cube_State *w, Move_List *l, int a, int b, int c)
+{
+    Rubiks_Cube_Move setup[MAX_SETUP];
+    uint8_t tmp;
+    int i, t, depth;
+
+    t = (a*ORBIT_SIZE + b)*ORBIT_SIZE + c;
+    if (o->parent[t] == TRIPLE_UNVISITED) return 0;
+
+    depth = 0;
+    for (i = t; o->parent[i] != TRIPLE_ROOT; i = o->parent[i]) {
+        if (depth == MAX_SETUP) return 0;
+        setup[depth++] = move_inverse(o->generators[o->generator[i]]);
+    }
+
+    for (i = 0; i < depth; i++) {
+        if (!move_list_push(l, setup[i])) return 0;
+    }
+    for (i = 0; i < SEED_LENGTH; i++) {
+        if (!move_list_push(l, o->seeds[o->seed[t]][i])) return 0;
+    }
+    for (i = depth-1; i >= 0; i--) {
+        if (!move_list_push(l, move_inverse(setup[i]))) return 0;
+    }
+
+    tmp = w->stickers[o->stickers[c]];
+    w->stickers[o->stickers[c]] = w->stickers[o->stickers[b]];
+    w->stickers[o->stickers[b]] = w->stickers[o->stickers[a]];
+    w->stickers[o->stickers[a]] = tmp;
+
+    if (o->wing) {
+        tmp = w->stickers[o->partners[c]];
+        w->stickers[o->partners[c]] = w->stickers[o->partners[b]];
+        w->stickers[o->partners[b]] = w->stickers[o->partners[a]];
+        w->stickers[o->partners[a]] = tmp;
+    }
+
+    return 1;
+}
+
+static int orbit_index(const Orbit *o, uint64_t sticker)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = ORBIT_SIZE - 1;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (o->stickers[mid] == sticker) return mid;
+        if (o->stickers[mid] < sticker) lo = mid + 1;
+        else hi = mid - 1;
+    }
+
+    return -1;
+}
+
+// the other sticker of an edge cubie
+static uint64_t partner_sticker(uint64_t n, uint64_t sticker)
+{
+    uint64_t x, y, z, t, px, py, pz;
+    int f;
+
+    cube_state_sticker_cubie(n, sticker, &x, &y, &z);
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if ((uint64_t) f == sticker / (n*n)) continue;
+
+        // the cubie lies on face f if its sticker there maps back to the same cubie
+        t = cube_state_sticker_at(n, f, x, y, z);
+        cube_state_sticker_cubie(n, t, &px, &py, &pz);
+        if (px == x && py == y && pz == z) return t;
+    }
+
+    return sticker;
+}
+
+// writes the commutator [a, x y x'] = a x y x' a' x y' x'
+static void commutator(Rubiks_Cube_Move *seq, Rubiks_Cube_Move a, Rubiks_Cube_Move x, Rubiks_Cube_Move y)
+{
+    seq[0] = a;
+    seq[1] = x;
+    seq[2] = y;
+    seq[3] = move_inverse(x);
+    seq[4] = move_inverse(a);
+    seq[5] = x;
+    seq[6] = move_inverse(y);
+    seq[7] = move_inverse(x);
+}
+
+// appends m and merges it with the previous move if both turn the same slice
+static int move_list_push(Move_List *l, Rubiks_Cube_Move m)
+{
+    Rubiks_Cube_Move *last;
+    Rubiks_Cube_Move *items;
+    int quarter_turns;
+
+    if (l->count > 0) {
+        last = &l->items[l->count - 1];
+        if (last->face == m.face && last->slice == m.slice) {
+            quarter_turns = (last->rot + 1 + m.rot + 1) % 4;
+            if (quarter_turns == 0) l->count--;
+            else last->rot = quarter_turns - 1;
+            return 1;
+        }
+    }
+
+    if (l->count == l->capacity) {
+        l->capacity = l->capacity == 0 ? 256 : 2 * l->capacity;
+        items = (Rubiks_Cube_Move *) realloc(l->items, l->capacity * sizeof (Rubiks_Cube_Move));
+        if (items == NULL) {
+            log_error("Failed to allocate memory for %zu moves", l->capacity);
+            return 0;
+        }
+        l->items = items;
+    }
+
+    l->items[l->count++] = m;
+
+    return 1;
+}
+
+static int move_list_apply(Move_List *l, Cube_State *w, Rubiks_Cube_Move m)
+{
+    cube_state_apply_move(w, m);
+    return move_list_push(l, m);
+}
+
+static int is_cancelled(const atomic_int *cancel)
+{
+    return cancel != NULL && atomic_load_explicit(cancel, memory_order_relaxed);
+}
+
+static void init_skeleton_solver(void)
+{
+#ifdef SOLVER_THISTLETHWAITE
+    thistlethwaite_init();
+#else
+    kociemba_init();
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,1327 @@
+#include "render_queue.h"
+
+#include "gl_state.h"
+#include "logging.h"
+#include "stream_buffer.h"
+#include "util.h"
+
+#include <errno.h>
+#include <float.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_ATTRIBUTES 16
+#define MAX_SHADERS    4
+
+typedef enum {
+    OBJECT_PROGRAM,
+    OBJECT_UNIFORM,
+    OBJECT_BUFFER,
+    OBJECT_VERTEX_ARRAY,
+    OBJECT_TEXTURE,
+} Object_Kind;
+
+// payload of the chunks, see render_queue.h
+typedef struct {
+    uint32_t index;
+    int32_t size;
+    uint32_t type;
+    uint32_t normalized;
+    uint32_t integer;
+    int32_t stride;
+    uint32_t buffer;
+    uint32_t reserved;
+    uint64_t offset;
+} Render_Attribute;
+
+typedef struct {
+    uint32_t id;
+    int32_t width, height;
+    uint32_t internal_format, format;
+    uint32_t min_filter, mag_filter, wrap_s, wrap_t;
+} Render_Texture;
+
+typedef struct {
+    uint64_t command_count;
+    uint64_t uniform_count;
+    uint64_t block_count;
+    uint64_t uniform_data_count;
+    uint64_t buffer_update_count;
+    uint64_t stream_size;
+} Render_Frame_Counts;
+
+typedef union {
+    GLfloat f[16];
+    GLint   i[16];
+} Uniform_Value;
+
+typedef struct {
+    uint8_t *data;
+    size_t size, capacity;
+} Byte_Buffer;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size, pos;
+} Reader;
+
+typedef struct {
+    FILE *file;
+    Render_Object_Map seen;     // objects already written
+    Render_Object_Map changed;  // buffers changed since the last frame, written again if they were seen
+    Byte_Buffer chunk;
+    uint64_t frames;
+} Capture_Writer;
+
+static Render_Frame queue;
+static Capture_Writer writer;
+
+// streamed vertices and uniform blocks of every frame, created by the first use
+static Stream_Buffer stream;
+static GLint uniform_alignment;
+
+// offset of the streamed vertices of every command in the stream buffer, only valid during execute()
+static uint32_t *stream_offsets;
+static size_t stream_offset_capacity;
+
+static void *grow(void *array, size_t *capacity, size_t count, size_t size);
+static int  append_stream(const void *data, uint32_t size, uint32_t *offset);
+static uint64_t sort_key(Render_Pass pass, GLuint program, GLuint texture, float depth);
+static int  compare_commands(const void *a, const void *b);
+static int  compare_objects(const void *a, const void *b);
+static void add_uniform(Shader_Uniform u, GLenum type, const float *val, uint32_t count);
+static int  write_stream(const Render_Frame *f);
+static void execute(const Render_Frame *f);
+static void set_pass_state(Render_Pass pass);
+static void set_uniforms(const Render_Frame *f, const Render_Uniform_Block *b);
+static void frame_free(Render_Frame *f);
+static double now(void);
+
+static Render_Object *map_find(const Render_Object_Map *m, uint32_t kind, uint32_t scope, uint32_t id);
+static int  map_add(Render_Object_Map *m, uint32_t kind, uint32_t scope, uint32_t id, uint32_t replay);
+static int  uniform_kind(GLenum type);
+
+static void *put_space(Byte_Buffer *b, size_t size);
+static int  put(Byte_Buffer *b, const void *data, size_t size);
+static int  put_u32(Byte_Buffer *b, uint32_t v);
+static int  write_chunk(Render_Chunk_Type type);
+static int  capture_frame(const Render_Frame *f);
+static int  capture_program(GLuint program);
+static int  capture_buffer(GLuint buffer);
+static int  write_buffer(GLuint buffer);
+static int  capture_vertex_array(GLuint vertex_array);
+static int  capture_texture(GLuint texture);
+
+static const void *take(Reader *r, size_t size);
+static int  take_u32(Reader *r, uint32_t *v);
+static int  load_program(Render_Capture *c, Reader *r);
+static int  load_buffer(Render_Capture *c, Reader *r);
+static int  load_vertex_array(Render_Capture *c, Reader *r);
+static int  load_texture(Render_Capture *c, Reader *r);
+static int  load_frame(Render_Capture *c, Reader *r);
+static int  remap(const Render_Capture *c, uint32_t kind, GLuint *id);
+
+// Starts a block of uniforms of prog, the following render_queue_uniform_*() calls add to it.
+// Returns the block for Render_Command.uniforms, 0 if it could not be created.
+uint32_t render_queue_begin_uniforms(Shader_Program *prog)
+{
+    Render_Uniform_Block *blocks;
+
+    blocks = grow(queue.blocks, &queue.block_capacity, queue.block_count + 1, sizeof (Render_Uniform_Block));
+    if (blocks == NULL) {
+        log_error("Failed to allocate memory for uniform block");
+        return 0;
+    }
+    queue.blocks = blocks;
+
+    queue.blocks[queue.block_count] = (Render_Uniform_Block) {prog->id, (uint32_t) queue.uniform_count, 0};
+    return (uint32_t) ++queue.block_count;
+}
+
+void render_queue_uniform_mat4(Shader_Uniform u, const float *val)
+{
+    add_uniform(u, GL_FLOAT_MAT4, val, 16);
+}
+
+void render_queue_uniform_color(Shader_Uniform u, Color col)
+{
+    float val[4] = {col.r, col.g, col.b, col.a};
+
+    add_uniform(u, GL_FLOAT_VEC4, val, 4);
+}
+
+void render_queue_uniform_uint(Shader_Uniform u, uint32_t val)
+{
+    float f;
+
+    memcpy(&f, &val, sizeof (f));
+    add_uniform(u, GL_UNSIGNED_INT, &f, 1);
+}
+
+// Nothing is drawn until render_queue_flush(). Depth is the distance in [0, 1] used to sort opaque commands front to back.
+void render_queue_submit(Render_Pass pass, float depth, Render_Command cmd)
+{
+    Render_Command *commands;
+
+    commands = grow(queue.commands, &queue.command_capacity, queue.command_count + 1, sizeof (Render_Command));
+    if (commands == NULL) {
+        log_error("Failed to allocate memory for render command, it is dropped");
+        return;
+    }
+    queue.commands = commands;
+
+    cmd.key = sort_key(pass, cmd.program, cmd.texture, depth);
+    cmd.sequence = (uint32_t) queue.command_count;
+    queue.commands[queue.command_count++] = cmd;
+}
+
+// Like render_queue_submit(), the vertices are copied and written to the stream buffer when the queue is flushed.
+// The vertex array has to read its attributes from render_queue_stream_buffer() at offsets within one vertex.
+void render_queue_submit_stream(Render_Pass pass, float depth, Render_Command cmd, const void *vertices, uint32_t size)
+{
+    if (cmd.stream_stride <= 0) {
+        log_error("Streamed render command has no vertex stride, it is dropped");
+        return;
+    }
+    if (!append_stream(vertices, size, &cmd.stream_offset)) {
+        log_error("Failed to allocate memory for streamed vertices, render command is dropped");
+        return;
+    }
+    cmd.stream_size = size;
+
+    render_queue_submit(pass, depth, cmd);
+}
+
+// Sets the contents of the uniform block at binding for this frame.
+void render_queue_update_buffer(GLuint binding, const void *data, uint32_t size)
+{
+    Render_Buffer_Update *updates;
+    uint32_t offset;
+
+    updates = grow(queue.buffer_updates, &queue.buffer_update_capacity, queue.buffer_update_count + 1, sizeof (Render_Buffer_Update));
+    if (updates != NULL) queue.buffer_updates = updates;
+    if (updates == NULL || !append_stream(data, size, &offset)) {
+        log_error("Failed to allocate memory for uniform buffer update");
+        return;
+    }
+
+    queue.buffer_updates[queue.buffer_update_count++] = (Render_Buffer_Update) {binding, offset, size};
+}
+
+// Buffer streamed vertices are drawn from, every frame writes to a different part of it. Returns 0 if it could not be created.
+GLuint render_queue_stream_buffer(void)
+{
+    if (stream.buffer == 0) {
+        if (!stream_buffer(&stream, RENDER_STREAM_REGION_SIZE)) return 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    }
+
+    return stream.buffer;
+}
+
+// Sorts and executes the commands of the frame, and writes them to the capture if one is running.
+void render_queue_flush(void)
+{
+    qsort(queue.commands, queue.command_count, sizeof (Render_Command), compare_commands);
+
+    if (writer.file != NULL && !capture_frame(&queue)) {
+        log_error("Failed to capture frame, stopping the capture");
+        render_queue_capture_end();
+    }
+
+    execute(&queue);
+
+    queue.command_count = 0;
+    queue.uniform_count = 0;
+    queue.block_count = 0;
+    queue.uniform_data_count = 0;
+    queue.buffer_update_count = 0;
+    queue.stream_size = 0;
+}
+
+void render_queue_free(void)
+{
+    render_queue_capture_end();
+    frame_free(&queue);
+    stream_buffer_free(&stream);
+
+    free(stream_offsets);
+    stream_offsets = NULL;
+    stream_offset_capacity = 0;
+
+    free(writer.seen.objects);
+    free(writer.changed.objects);
+    free(writer.chunk.data);
+    memset(&writer, 0, sizeof (writer));
+}
+
+// Every flushed frame is written to path until render_queue_capture_end().
+int render_queue_capture_begin(const char *path)
+{
+    Render_Capture_Header header = {0};
+    GLint viewport[4];
+    int i;
+
+    render_queue_capture_end();
+
+    writer.file = fopen(path, "wb");
+    if (writer.file == NULL) {
+        log_error("Failed to open capture \'%s\': %s", path, strerror(errno));
+        return 0;
+    }
+
+    memcpy(header.magic, RENDER_CAPTURE_MAGIC, sizeof (header.magic));
+    header.version = RENDER_CAPTURE_VERSION;
+    header.stream_buffer = render_queue_stream_buffer();
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    for (i = 0; i < 4; i++)
+        header.viewport[i] = viewport[i];
+
+    if (fwrite(&header, sizeof (header), 1, writer.file) != 1) {
+        log_error("Failed to write capture \'%s\': %s", path, strerror(errno));
+        fclose(writer.file);
+        writer.file = NULL;
+        return 0;
+    }
+
+    writer.seen.count = 0;
+    writer.changed.count = 0;
+    writer.frames = 0;
+    log_info("Capturing render commands to \'%s\'", path);
+    return 1;
+}
+
+void render_queue_capture_end(void)
+{
+    if (writer.file == NULL) return;
+
+    if (fclose(writer.file) != 0) log_error("Failed to finish capture: %s", strerror(errno));
+    else log_info("Captured %" PRIu64 " frames", writer.frames);
+    writer.file = NULL;
+}
+
+int render_queue_is_capturing(void)
+{
+    return writer.file != NULL;
+}
+
+// Has to be called after changing the contents of a buffer that is drawn from, so a running capture
+// stores them again. Buffers that are only filled when they are created do not need it.
+void render_queue_buffer_changed(GLuint buffer)
+{
+    if (writer.file == NULL || map_find(&writer.changed, OBJECT_BUFFER, 0, buffer) != NULL) return;
+
+    if (!map_add(&writer.changed, OBJECT_BUFFER, 0, buffer, 0)) {
+        log_error("Failed to allocate memory for changed buffer, stopping the capture");
+        render_queue_capture_end();
+    }
+}
+
+// Reads a capture and creates its GL objects, needs a current GL context.
+Render_Capture *render_capture_load(const char *path)
+{
+    const Render_Capture_Header *header;
+    const Render_Chunk *chunk;
+    Render_Capture *c;
+    Reader r, payload;
+    void *data;
+    size_t size;
+    int mapped, ok, i;
+
+    data = map_file(path, &size, &mapped);
+    if (data == NULL) {
+        log_error("Failed to map capture \'%s\': %s", path, strerror(errno));
+        return NULL;
+    }
+
+    r = (Reader) {(const uint8_t *) data, size, 0};
+    header = take(&r, sizeof (Render_Capture_Header));
+    if (header == NULL || memcmp(header->magic, RENDER_CAPTURE_MAGIC, sizeof (header->magic)) != 0 ||
+        header->version != RENDER_CAPTURE_VERSION) {
+        log_error("\'%s\' is not a render capture of version %d", path, RENDER_CAPTURE_VERSION);
+        unmap_file(data, size, mapped);
+        return NULL;
+    }
+
+    c = (Render_Capture *) calloc(1, sizeof (Render_Capture));
+    if (c == NULL) {
+        log_error("Failed to allocate memory for render capture");
+        unmap_file(data, size, mapped);
+        return NULL;
+    }
+    for (i = 0; i < 4; i++)
+        c->viewport[i] = header->viewport[i];
+
+    // the replay streams into its own buffer
+    ok = render_queue_stream_buffer() != 0 && map_add(&c->objects, OBJECT_BUFFER, 0, header->stream_buffer, stream.buffer);
+    while (ok && r.pos < r.size) {
+        chunk = take(&r, sizeof (Render_Chunk));
+        payload.data = take(&r, chunk != NULL ? chunk->size : 0);
+        if (chunk == NULL || payload.data == NULL) {
+            ok = 0;
+            break;
+        }
+        payload.size = chunk->size;
+        payload.pos = 0;
+
+        switch (chunk->type) {
+            case RENDER_CHUNK_PROGRAM:      ok = load_program(c, &payload);      break;
+            case RENDER_CHUNK_BUFFER:       ok = load_buffer(c, &payload);       break;
+            case RENDER_CHUNK_VERTEX_ARRAY: ok = load_vertex_array(c, &payload); break;
+            case RENDER_CHUNK_TEXTURE:      ok = load_texture(c, &payload);      break;
+            case RENDER_CHUNK_FRAME:        ok = load_frame(c, &payload);        break;
+            default:
+                log_warning("Skipping unknown chunk %" PRIu32 " of capture", chunk->type);
+            break;
+        }
+    }
+    unmap_file(data, size, mapped);
+
+    if (!ok) {
+        log_error("Capture \'%s\' is corrupted", path);
+        render_capture_free(c);
+        return NULL;
+    }
+
+    log_info("Loaded %zu frames from capture \'%s\'", c->frame_count, path);
+    return c;
+}
+
+// Executes every frame of the capture repeats times and logs the frame times. The GPU is waited for
+// after every frame, so the times include the whole rendering but not presenting it.
+void render_capture_benchmark(Render_Capture *c, uint64_t repeats)
+{
+    const Render_Buffer_Upload *u;
+    double start, t, total, min, max;
+    uint64_t r, frames, commands;
+    size_t i, k;
+
+    if (c->frame_count == 0 || repeats == 0) {
+        log_warning("Nothing to replay");
+        return;
+    }
+
+    glViewport(c->viewport[0], c->viewport[1], c->viewport[2], c->viewport[3]);
+
+    total = max = 0.0;
+    min = DBL_MAX;
+    commands = 0;
+    for (r = 0; r < repeats; r++) {
+        k = 0;
+        for (i = 0; i < c->frame_count; i++) {
+            // the live frame uploaded them before it was flushed, so they are not part of the frame time
+            for (; k < c->upload_count && c->uploads[k].frame <= i; k++) {
+                u = &c->uploads[k];
+                gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, u->buffer);
+                glBufferData(GL_COPY_WRITE_BUFFER, u->size, u->data, u->usage);
+            }
+
+            start = now();
+
+            gl_state_depth_mask(GL_TRUE);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            execute(&c->frames[i]);
+            glFinish();
+
+            t = now() - start;
+            total += t;
+            if (t < min) min = t;
+            if (t > max) max = t;
+            commands += c->frames[i].command_count;
+            gl_state_end_frame();
+        }
+    }
+
+    frames = repeats * c->frame_count;
+    log_info("Replayed %" PRIu64 " frames, %.1f commands per frame", frames, (double) commands / frames);
+    log_info("Frame time avg %.3f ms, min %.3f ms, max %.3f ms", 1e3 * total / frames, 1e3 * min, 1e3 * max);
+}
+
+void render_capture_free(Render_Capture *c)
+{
+    Render_Object *o;
+    size_t i;
+
+    if (c == NULL) return;
+
+    for (i = 0; i < c->frame_count; i++)
+        frame_free(&c->frames[i]);
+    free(c->frames);
+
+    for (i = 0; i < c->upload_count; i++)
+        free(c->uploads[i].data);
+    free(c->uploads);
+
+    for (i = 0; i < c->objects.count; i++) {
+        o = &c->objects.objects[i];
+        switch (o->kind) {
+            case OBJECT_PROGRAM:      gl_state_delete_program(o->replay);      break;
+            case OBJECT_BUFFER:       if (o->replay != stream.buffer) gl_state_delete_buffer(o->replay); break;
+            case OBJECT_VERTEX_ARRAY: gl_state_delete_vertex_array(o->replay); break;
+            case OBJECT_TEXTURE:      gl_state_delete_texture(o->replay);      break;
+            default: break;
+        }
+    }
+    free(c->objects.objects);
+    free(c);
+}
+
+
+// Returns array with room for count elements, or NULL without touching array if out of memory.
+static void *grow(void *array, size_t *capacity, size_t count, size_t size)
+{
+    size_t c;
+
+    if (count <= *capacity) return array;
+
+    c = *capacity == 0 ? 64 : *capacity;
+    while (c < count) c *= 2;
+
+    array = realloc(array, c * size);
+    if (array != NULL) *capacity = c;
+    return array;
+}
+
+// copies data to the end of the stream of the queue
+static int append_stream(const void *data, uint32_t size, uint32_t *offset)
+{
+    uint8_t *stream;
+
+    stream = grow(queue.stream, &queue.stream_capacity, queue.stream_size + size, 1);
+    if (stream == NULL) return 0;
+    queue.stream = stream;
+
+    memcpy(queue.stream + queue.stream_size, data, size);
+    *offset = (uint32_t) queue.stream_size;
+    queue.stream_size += size;
+    return 1;
+}
+
+// pass | program | texture | depth, names are truncated since they only group the commands
+static uint64_t sort_key(Render_Pass pass, GLuint program, GLuint texture, float depth)
+{
+    uint32_t d;
+
+    // non negative floats compare like their bits
+    if (!(depth > 0.0f)) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    memcpy(&d, &depth, sizeof (d));
+
+    return (uint64_t) pass << 60 | (uint64_t) (program & 0xFFF) << 48 | (uint64_t) (texture & 0xFFFF) << 32 | d;
+}
+
+static int compare_commands(const void *a, const void *b)
+{
+    const Render_Command *x, *y;
+
+    x = (const Render_Command *) a;
+    y = (const Render_Command *) b;
+
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
+
+static int compare_objects(const void *a, const void *b)
+{
+    const Render_Object *x, *y;
+
+    x = (const Render_Object *) a;
+    y = (const Render_Object *) b;
+
+    if (x->kind  != y->kind)  return (x->kind  > y->kind)  - (x->kind  < y->kind);
+    if (x->scope != y->scope) return (x->scope > y->scope) - (x->scope < y->scope);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// adds to the last block, uniforms without a block are ignored
+static void add_uniform(Shader_Uniform u, GLenum type, const float *val, uint32_t count)
+{
+    Render_Uniform *uniforms;
+    float *data;
+
+    if (queue.block_count == 0) return;
+
+    uniforms = grow(queue.uniforms, &queue.uniform_capacity, queue.uniform_count + 1, sizeof (Render_Uniform));
+    if (uniforms != NULL) queue.uniforms = uniforms;
+    data = grow(queue.uniform_data, &queue.uniform_data_capacity, queue.uniform_data_count + count, sizeof (float));
+    if (data != NULL) queue.uniform_data = data;
+    if (uniforms == NULL || data == NULL) {
+        log_error("Failed to allocate memory for uniform");
+        return;
+    }
+
+    memcpy(queue.uniform_data + queue.uniform_data_count, val, count * sizeof (float));
+    queue.uniforms[queue.uniform_count++] = (Render_Uniform) {u.location, type, (uint32_t) queue.uniform_data_count};
+    queue.uniform_data_count += count;
+    queue.blocks[queue.block_count - 1].count++;
+}
+
+// Writes the uniform blocks and streamed vertices of the frame at once and binds the uniform blocks.
+// Returns 0 if there is no stream buffer, data that does not fit is skipped with a warning.
+static int write_stream(const Render_Frame *f)
+{
+    const Render_Buffer_Update *u;
+    uint32_t *offsets, offset;
+    size_t i, dropped;
+
+    if (render_queue_stream_buffer() == 0) return 0;
+
+    if (f->command_count > stream_offset_capacity) {
+        offsets = grow(stream_offsets, &stream_offset_capacity, f->command_count, sizeof (uint32_t));
+        if (offsets == NULL) {
+            log_error("Failed to allocate memory for stream offsets, frame is dropped");
+            return 0;
+        }
+        stream_offsets = offsets;
+    }
+
+    dropped = 0;
+    for (i = 0; i < f->buffer_update_count; i++) {
+        u = &f->buffer_updates[i];
+        offset = stream_buffer_write(&stream, f->stream + u->offset, u->size, (uint32_t) uniform_alignment);
+        if (offset == STREAM_BUFFER_FULL) dropped++;
+        else gl_state_bind_buffer_range(u->binding, stream.buffer, offset, u->size);
+    }
+
+    for (i = 0; i < f->command_count; i++) {
+        if (f->commands[i].stream_size == 0) continue;
+
+        stream_offsets[i] = stream_buffer_write(&stream, f->stream + f->commands[i].stream_offset,
+                                                f->commands[i].stream_size, (uint32_t) f->commands[i].stream_stride);
+        if (stream_offsets[i] == STREAM_BUFFER_FULL) dropped++;
+    }
+
+    if (dropped > 0) log_warning("%zu streamed uploads did not fit into the stream buffer", dropped);
+
+    stream_buffer_commit(&stream);
+    return 1;
+}
+
+// Commands are expected to be sorted, state is only set when it differs from the previous command.
+static void execute(const Render_Frame *f)
+{
+    const Render_Command *c;
+    Render_Pass pass;
+    GLuint program;
+    uint32_t block;
+    size_t i;
+
+    if (!write_stream(f)) return;
+
+    pass = RENDER_PASS_COUNT;
+    program = 0;
+    block = 0;
+
+    for (i = 0; i < f->command_count; i++) {
+        c = &f->commands[i];
+
+        if ((Render_Pass) (c->key >> 60) != pass) {
+            pass = (Render_Pass) (c->key >> 60);
+            set_pass_state(pass);
+        }
+        if (i == 0 || c->program != program) {
+            program = c->program;
+            gl_state_use_program(program);
+            block = 0;
+        }
+        if (c->uniforms != 0 && c->uniforms != block) {
+            block = c->uniforms;
+            set_uniforms(f, &f->blocks[block - 1]);
+        }
+
+        // the vertices did not fit into the stream buffer
+        if (c->stream_size > 0 && stream_offsets[i] == STREAM_BUFFER_FULL) continue;
+
+        gl_state_bind_vertex_array(c->vertex_array);
+        if (c->texture != 0)
+            gl_state_bind_texture(0, c->texture);
+
+        if (c->index_type != 0)      glDrawElements(c->mode, c->count, c->index_type, NULL);
+        else if (c->stream_size > 0) glDrawArrays(c->mode, stream_offsets[i] / c->stream_stride, c->count);
+        else                         glDrawArrays(c->mode, 0, c->count);
+    }
+
+    stream_buffer_end_frame(&stream);
+}
+
+static void set_pass_state(Render_Pass pass)
+{
+    switch (pass) {
+        case RENDER_PASS_OPAQUE:
+            gl_state_enable(GL_CULL_FACE, 1);
+            gl_state_enable(GL_DEPTH_TEST, 1);
+            gl_state_enable(GL_BLEND, 0);
+            gl_state_depth_func(GL_LESS);
+            gl_state_depth_mask(GL_TRUE);
+        break;
+        case RENDER_PASS_OVERLAY:
+            gl_state_enable(GL_CULL_FACE, 0);
+            gl_state_enable(GL_DEPTH_TEST, 0);
+            gl_state_enable(GL_BLEND, 1);
+            gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+        default:
+        break;
+    }
+}
+
+static void set_uniforms(const Render_Frame *f, const Render_Uniform_Block *b)
+{
+    const Render_Uniform *u;
+    uint32_t i, val;
+
+    for (i = 0; i < b->count; i++) {
+        u = &f->uniforms[b->first + i];
+        switch (u->type) {
+            case GL_FLOAT_MAT4: glUniformMatrix4fv(u->location, 1, GL_FALSE, f->uniform_data + u->offset); break;
+            case GL_FLOAT_VEC4: glUniform4fv(u->location, 1, f->uniform_data + u->offset);                break;
+            case GL_UNSIGNED_INT:
+                memcpy(&val, f->uniform_data + u->offset, sizeof (val));
+                glUniform1ui(u->location, val);
+            break;
+            default: break;
+        }
+    }
+}
+
+static void frame_free(Render_Frame *f)
+{
+    free(f->commands);
+    free(f->uniforms);
+    free(f->blocks);
+    free(f->uniform_data);
+    free(f->buffer_updates);
+    free(f->stream);
+    memset(f, 0, sizeof (Render_Frame));
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Render_Object *map_find(const Render_Object_Map *m, uint32_t kind, uint32_t scope, uint32_t id)
+{
+    Render_Object key = {kind, scope, id, 0};
+
+    if (m->count == 0) return NULL;
+    return (Render_Object *) bsearch(&key, m->objects, m->count, sizeof (Render_Object), compare_objects);
+}
+
+static int map_add(Render_Object_Map *m, uint32_t kind, uint32_t scope, uint32_t id, uint32_t replay)
+{
+    Render_Object o = {kind, scope, id, replay};
+    Render_Object *objects;
+    size_t lo, hi, mid;
+
+    objects = grow(m->objects, &m->capacity, m->count + 1, sizeof (Render_Object));
+    if (objects == NULL) return 0;
+    m->objects = objects;
+
+    // first object not less than o
+    lo = 0;
+    hi = m->count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (compare_objects(&m->objects[mid], &o) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    memmove(&m->objects[lo + 1], &m->objects[lo], (m->count - lo) * sizeof (Render_Object));
+    m->objects[lo] = o;
+    m->count++;
+    return 1;
+}
+
+// 1 for float uniforms, 2 for integer uniforms, 0 for the ones that are not captured
+static int uniform_kind(GLenum type)
+{
+    switch (type) {
+        case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4: case GL_FLOAT_MAT4:
+            return 1;
+        case GL_INT: case GL_BOOL: case GL_SAMPLER_2D:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static void *put_space(Byte_Buffer *b, size_t size)
+{
+    uint8_t *data;
+
+    data = grow(b->data, &b->capacity, b->size + size, 1);
+    if (data == NULL) return NULL;
+    b->data = data;
+
+    b->size += size;
+    return b->data + b->size - size;
+}
+
+static int put(Byte_Buffer *b, const void *data, size_t size)
+{
+    void *space;
+
+    space = put_space(b, size);
+    if (space == NULL) return 0;
+    if (size > 0) memcpy(space, data, size);
+    return 1;
+}
+
+static int put_u32(Byte_Buffer *b, uint32_t v)
+{
+    return put(b, &v, sizeof (v));
+}
+
+// writes the chunk built in writer.chunk and empties it
+static int write_chunk(Render_Chunk_Type type)
+{
+    Render_Chunk chunk = {0};
+    int ok;
+
+    chunk.type = type;
+    chunk.size = writer.chunk.size;
+
+    ok = fwrite(&chunk, sizeof (chunk), 1, writer.file) == 1 &&
+         (writer.chunk.size == 0 || fwrite(writer.chunk.data, writer.chunk.size, 1, writer.file) == 1);
+    if (!ok) log_error("Failed to write capture: %s", strerror(errno));
+
+    writer.chunk.size = 0;
+    return ok;
+}
+
+static int capture_frame(const Render_Frame *f)
+{
+    Render_Frame_Counts counts;
+    const Render_Command *c;
+    size_t i;
+    int ok;
+
+    // buffers that were not written yet are written with their current contents below
+    ok = 1;
+    for (i = 0; ok && i < writer.changed.count; i++) {
+        if (map_find(&writer.seen, OBJECT_BUFFER, 0, writer.changed.objects[i].id) != NULL)
+            ok = write_buffer(writer.changed.objects[i].id);
+    }
+    writer.changed.count = 0;
+
+    for (i = 0; ok && i < f->command_count; i++) {
+        c = &f->commands[i];
+        ok = capture_program(c->program) && capture_vertex_array(c->vertex_array) &&
+             (c->texture == 0 || capture_texture(c->texture));
+    }
+    if (!ok) return 0;
+
+    counts = (Render_Frame_Counts) {
+        f->command_count, f->uniform_count, f->block_count, f->uniform_data_count, f->buffer_update_count, f->stream_size
+    };
+    writer.chunk.size = 0;
+    ok = put(&writer.chunk, &counts, sizeof (counts)) &&
+         put(&writer.chunk, f->commands, f->command_count * sizeof (Render_Command)) &&
+         put(&writer.chunk, f->uniforms, f->uniform_count * sizeof (Render_Uniform)) &&
+         put(&writer.chunk, f->blocks, f->block_count * sizeof (Render_Uniform_Block)) &&
+         put(&writer.chunk, f->uniform_data, f->uniform_data_count * sizeof (float)) &&
+         put(&writer.chunk, f->buffer_updates, f->buffer_update_count * sizeof (Render_Buffer_Update)) &&
+         put(&writer.chunk, f->stream, f->stream_size);
+    if (!ok || !write_chunk(RENDER_CHUNK_FRAME)) return 0;
+
+    writer.frames++;
+    return 1;
+}
+
+// The shaders stay attached to the program after linking, so their sources can still be read.
+static int capture_program(GLuint program)
+{
+    GLuint shaders[MAX_SHADERS];
+    GLsizei shader_count, length;
+    GLint type, source_length, uniform_count, block_count, binding, size, location, i;
+    GLenum uniform_type;
+    Uniform_Value value;
+    char name[256];
+    char *source;
+    int ok;
+
+    if (map_find(&writer.seen, OBJECT_PROGRAM, 0, program) != NULL) return 1;
+
+    glGetAttachedShaders(program, MAX_SHADERS, &shader_count, shaders);
+
+    writer.chunk.size = 0;
+    ok = put_u32(&writer.chunk, program) && put_u32(&writer.chunk, (uint32_t) shader_count);
+    for (i = 0; ok && i < shader_count; i++) {
+        glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+        glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &source_length);
+
+        source = (char *) malloc(source_length > 0 ? source_length : 1);
+        if (source == NULL) return 0;
+        length = 0;
+        if (source_length > 0) glGetShaderSource(shaders[i], source_length, &length, source);
+
+        ok = put_u32(&writer.chunk, (uint32_t) type) && put_u32(&writer.chunk, (uint32_t) length) &&
+             put(&writer.chunk, source, length);
+        free(source);
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    ok = ok && put_u32(&writer.chunk, (uint32_t) uniform_count);
+    for (i = 0; ok && i < uniform_count; i++) {
+        glGetActiveUniform(program, i, sizeof (name), &length, &size, &uniform_type, name);
+        location = glGetUniformLocation(program, name);
+
+        memset(&value, 0, sizeof (value));
+        if (location >= 0 && uniform_kind(uniform_type) == 1) glGetUniformfv(program, location, value.f);
+        if (location >= 0 && uniform_kind(uniform_type) == 2) glGetUniformiv(program, location, value.i);
+
+        ok = put_u32(&writer.chunk, (uint32_t) location) && put_u32(&writer.chunk, uniform_type) &&
+             put_u32(&writer.chunk, (uint32_t) length) && put(&writer.chunk, name, length) &&
+             put(&writer.chunk, &value, sizeof (value));
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+    ok = ok && put_u32(&writer.chunk, (uint32_t) block_count);
+    for (i = 0; ok && i < block_count; i++) {
+        glGetActiveUniformBlockName(program, i, sizeof (name), &length, name);
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+
+        ok = put_u32(&writer.chunk, (uint32_t) length) && put(&writer.chunk, name, length) &&
+             put_u32(&writer.chunk, (uint32_t) binding);
+    }
+
+    return ok && write_chunk(RENDER_CHUNK_PROGRAM) && map_add(&writer.seen, OBJECT_PROGRAM, 0, program, 0);
+}
+
+// The contents are captured the first time the buffer is used, changes later on by capture_frame().
+static int capture_buffer(GLuint buffer)
+{
+    // the replay streams into its own buffer, see render_capture_load()
+    if (buffer == stream.buffer || map_find(&writer.seen, OBJECT_BUFFER, 0, buffer) != NULL) return 1;
+
+    return write_buffer(buffer) && map_add(&writer.seen, OBJECT_BUFFER, 0, buffer, 0);
+}
+
+static int write_buffer(GLuint buffer)
+{
+    GLint size, usage;
+    uint64_t size64;
+    void *data;
+
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+    size64 = (uint64_t) size;
+
+    writer.chunk.size = 0;
+    if (!put_u32(&writer.chunk, buffer) || !put_u32(&writer.chunk, (uint32_t) usage) ||
+        !put(&writer.chunk, &size64, sizeof (size64)))
+        return 0;
+
+    data = put_space(&writer.chunk, size);
+    if (data == NULL) return 0;
+    if (size > 0) glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, data);
+
+    return write_chunk(RENDER_CHUNK_BUFFER);
+}
+
+static int capture_vertex_array(GLuint vertex_array)
+{
+    Render_Attribute attributes[MAX_ATTRIBUTES];
+    GLint max_attributes, enabled, value, element_buffer;
+    GLvoid *pointer;
+    uint32_t count;
+    GLint i;
+
+    if (map_find(&writer.seen, OBJECT_VERTEX_ARRAY, 0, vertex_array) != NULL) return 1;
+
+    gl_state_bind_vertex_array(vertex_array);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_buffer);
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attributes);
+    if (max_attributes > MAX_ATTRIBUTES) max_attributes = MAX_ATTRIBUTES;
+
+    count = 0;
+    for (i = 0; i < max_attributes; i++) {
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        if (!enabled) continue;
+
+        memset(&attributes[count], 0, sizeof (Render_Attribute));
+        attributes[count].index = i;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &value);           attributes[count].size = value;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &value);           attributes[count].type = value;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &value);     attributes[count].normalized = value;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &value);        attributes[count].integer = value;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &value);         attributes[count].stride = value;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &value); attributes[count].buffer = value;
+        glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+        attributes[count].offset = (uint64_t) (uintptr_t) pointer;
+        count++;
+    }
+
+    // the buffers have to be loaded before the vertex array using them
+    for (i = 0; i < (GLint) count; i++) {
+        if (attributes[i].buffer != 0 && !capture_buffer(attributes[i].buffer)) return 0;
+    }
+    if (element_buffer != 0 && !capture_buffer(element_buffer)) return 0;
+
+    writer.chunk.size = 0;
+    if (!put_u32(&writer.chunk, vertex_array) || !put_u32(&writer.chunk, (uint32_t) element_buffer) ||
+        !put_u32(&writer.chunk, count) || !put(&writer.chunk, attributes, count * sizeof (Render_Attribute)))
+        return 0;
+
+    return write_chunk(RENDER_CHUNK_VERTEX_ARRAY) && map_add(&writer.seen, OBJECT_VERTEX_ARRAY, 0, vertex_array, 0);
+}
+
+static int capture_texture(GLuint texture)
+{
+    Render_Texture t = {0};
+    GLint value;
+    size_t size;
+    void *data;
+
+    if (map_find(&writer.seen, OBJECT_TEXTURE, 0, texture) != NULL) return 1;
+
+    gl_state_bind_texture(0, texture);
+    t.id = texture;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &t.width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &t.height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &value); t.internal_format = value;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &value);              t.min_filter = value;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &value);              t.mag_filter = value;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &value);                  t.wrap_s = value;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &value);                  t.wrap_t = value;
+    t.format = t.internal_format == GL_RED || t.internal_format == GL_R8 ? GL_RED : GL_RGBA;
+    size = (size_t) t.width * t.height * (t.format == GL_RED ? 1 : 4);
+
+    writer.chunk.size = 0;
+    if (!put(&writer.chunk, &t, sizeof (t))) return 0;
+    data = put_space(&writer.chunk, size);
+    if (data == NULL) return 0;
+
+    // rows are stored without padding
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (size > 0) glGetTexImage(GL_TEXTURE_2D, 0, t.format, GL_UNSIGNED_BYTE, data);
+
+    return write_chunk(RENDER_CHUNK_TEXTURE) && map_add(&writer.seen, OBJECT_TEXTURE, 0, texture, 0);
+}
+
+static const void *take(Reader *r, size_t size)
+{
+    const void *p;
+
+    if (size > r->size - r->pos) return NULL;
+
+    p = r->data + r->pos;
+    r->pos += size;
+    return p;
+}
+
+static int take_u32(Reader *r, uint32_t *v)
+{
+    const void *p;
+
+    p = take(r, sizeof (*v));
+    if (p == NULL) return 0;
+
+    memcpy(v, p, sizeof (*v));
+    return 1;
+}
+
+static int load_program(Render_Capture *c, Reader *r)
+{
+    GLuint program, shader, block_index;
+    GLint success, location, length;
+    uint32_t id, shader_count, uniform_count, block_count, binding, type, size, i;
+    const char *source, *name;
+    char buf[256];
+    Uniform_Value value;
+    const void *p;
+    int32_t captured_location;
+
+    if (!take_u32(r, &id) || !take_u32(r, &shader_count)) return 0;
+
+    program = glCreateProgram();
+    if (!map_add(&c->objects, OBJECT_PROGRAM, 0, id, program)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    for (i = 0; i < shader_count; i++) {
+        if (!take_u32(r, &type) || !take_u32(r, &size) || (source = take(r, size)) == NULL) return 0;
+
+        length = (GLint) size;
+        shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, &length);
+        glCompileShader(shader);
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof (buf), NULL, buf);
+            log_error("Failed to compile captured shader: %s", buf);
+        }
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof (buf), NULL, buf);
+        log_error("Failed to link captured program: %s", buf);
+        return 0;
+    }
+
+    // uniforms keep their values in the program, set them to what they were when captured
+    gl_state_use_program(program);
+    if (!take_u32(r, &uniform_count)) return 0;
+    for (i = 0; i < uniform_count; i++) {
+        if (!take_u32(r, (uint32_t *) &captured_location) || !take_u32(r, &type) || !take_u32(r, &size) ||
+            size >= sizeof (buf) || (name = take(r, size)) == NULL || (p = take(r, sizeof (value))) == NULL)
+            return 0;
+
+        memcpy(buf, name, size);
+        buf[size] = '\0';
+        memcpy(&value, p, sizeof (value));
+
+        location = glGetUniformLocation(program, buf);
+        if (captured_location < 0 || location < 0) continue;
+        if (!map_add(&c->objects, OBJECT_UNIFORM, id, (uint32_t) captured_location, (uint32_t) location)) return 0;
+
+        switch (type) {
+            case GL_FLOAT:      glUniform1fv(location, 1, value.f);                 break;
+            case GL_FLOAT_VEC2: glUniform2fv(location, 1, value.f);                 break;
+            case GL_FLOAT_VEC3: glUniform3fv(location, 1, value.f);                 break;
+            case GL_FLOAT_VEC4: glUniform4fv(location, 1, value.f);                 break;
+            case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, value.f); break;
+            case GL_INT: case GL_BOOL: case GL_SAMPLER_2D:
+                glUniform1iv(location, 1, value.i);
+            break;
+            default:
+            break;
+        }
+    }
+
+    if (!take_u32(r, &block_count)) return 0;
+    for (i = 0; i < block_count; i++) {
+        if (!take_u32(r, &size) || size >= sizeof (buf) || (name = take(r, size)) == NULL || !take_u32(r, &binding))
+            return 0;
+
+        memcpy(buf, name, size);
+        buf[size] = '\0';
+
+        block_index = glGetUniformBlockIndex(program, buf);
+        if (block_index != GL_INVALID_INDEX) glUniformBlockBinding(program, block_index, binding);
+    }
+
+    return 1;
+}
+
+// A buffer stored again only gets new contents, so the vertex arrays using it stay valid.
+static int load_buffer(Render_Capture *c, Reader *r)
+{
+    Render_Buffer_Upload *uploads;
+    Render_Object *o;
+    uint32_t id, usage;
+    uint64_t size;
+    const void *p, *data;
+    void *copy;
+    GLuint buffer;
+
+    if (!take_u32(r, &id) || !take_u32(r, &usage) || (p = take(r, sizeof (size))) == NULL) return 0;
+    memcpy(&size, p, sizeof (size));
+    if ((data = take(r, size)) == NULL) return 0;
+
+    o = map_find(&c->objects, OBJECT_BUFFER, 0, id);
+    if (o != NULL) {
+        buffer = o->replay;
+    } else {
+        glGenBuffers(1, &buffer);
+        if (!map_add(&c->objects, OBJECT_BUFFER, 0, id, buffer)) {
+            glDeleteBuffers(1, &buffer);
+            return 0;
+        }
+    }
+
+    uploads = grow(c->uploads, &c->upload_capacity, c->upload_count + 1, sizeof (Render_Buffer_Upload));
+    if (uploads == NULL) return 0;
+    c->uploads = uploads;
+
+    copy = malloc(size + 1);
+    if (copy == NULL) return 0;
+    memcpy(copy, data, size);
+    c->uploads[c->upload_count++] = (Render_Buffer_Upload) {buffer, usage, c->frame_count, size, copy};
+    return 1;
+}
+
+static int load_vertex_array(Render_Capture *c, Reader *r)
+{
+    Render_Attribute a;
+    uint32_t id, element_buffer, count, i;
+    GLuint vertex_array;
+    const void *p;
+
+    if (!take_u32(r, &id) || !take_u32(r, &element_buffer) || !take_u32(r, &count)) return 0;
+
+    glGenVertexArrays(1, &vertex_array);
+    if (!map_add(&c->objects, OBJECT_VERTEX_ARRAY, 0, id, vertex_array)) {
+        glDeleteVertexArrays(1, &vertex_array);
+        return 0;
+    }
+
+    gl_state_bind_vertex_array(vertex_array);
+    for (i = 0; i < count; i++) {
+        if ((p = take(r, sizeof (a))) == NULL) return 0;
+        memcpy(&a, p, sizeof (a));
+        if (!remap(c, OBJECT_BUFFER, &a.buffer)) return 0;
+
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, a.buffer);
+        if (a.integer)
+            glVertexAttribIPointer(a.index, a.size, a.type, a.stride, (void *) (uintptr_t) a.offset);
+        else
+            glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, (void *) (uintptr_t) a.offset);
+        glEnableVertexAttribArray(a.index);
+    }
+
+    if (element_buffer != 0) {
+        if (!remap(c, OBJECT_BUFFER, &element_buffer)) return 0;
+        gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+    }
+
+    return 1;
+}
+
+static int load_texture(Render_Capture *c, Reader *r)
+{
+    Render_Texture t;
+    const void *p, *data;
+    GLuint texture;
+
+    if ((p = take(r, sizeof (t))) == NULL) return 0;
+    memcpy(&t, p, sizeof (t));
+    if (t.width < 0 || t.height < 0) return 0;
+    if ((data = take(r, (size_t) t.width * t.height * (t.format == GL_RED ? 1 : 4))) == NULL) return 0;
+
+    glGenTextures(1, &texture);
+    if (!map_add(&c->objects, OBJECT_TEXTURE, 0, t.id, texture)) {
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+
+    gl_state_bind_texture(0, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, t.internal_format, t.width, t.height, 0, t.format, GL_UNSIGNED_BYTE, data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, t.min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, t.mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, t.wrap_s);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t.wrap_t);
+    return 1;
+}
+
+// The frame is stored with the names and uniform locations of the replay.
+static int load_frame(Render_Capture *c, Reader *r)
+{
+    Render_Frame_Counts counts;
+    Render_Frame *frames, f = {0};
+    Render_Uniform_Block *b;
+    Render_Command *cmd;
+    Render_Object *o;
+    const void *p;
+    size_t i, k, size;
+    int ok;
+
+    if ((p = take(r, sizeof (counts))) == NULL) return 0;
+    memcpy(&counts, p, sizeof (counts));
+
+    frames = grow(c->frames, &c->frame_capacity, c->frame_count + 1, sizeof (Render_Frame));
+    if (frames == NULL) return 0;
+    c->frames = frames;
+
+    f.command_count      = f.command_capacity      = counts.command_count;
+    f.uniform_count      = f.uniform_capacity      = counts.uniform_count;
+    f.block_count        = f.block_capacity        = counts.block_count;
+    f.uniform_data_count = f.uniform_data_capacity = counts.uniform_data_count;
+    f.buffer_update_count = f.buffer_update_capacity = counts.buffer_update_count;
+    f.stream_size        = f.stream_capacity       = counts.stream_size;
+
+    f.commands     = (Render_Command *) malloc(f.command_count * sizeof (Render_Command) + 1);
+    f.uniforms     = (Render_Uniform *) malloc(f.uniform_count * sizeof (Render_Uniform) + 1);
+    f.blocks       = (Render_Uniform_Block *) malloc(f.block_count * sizeof (Render_Uniform_Block) + 1);
+    f.uniform_data = (float *) malloc(f.uniform_data_count * sizeof (float) + 1);
+    f.buffer_updates = (Render_Buffer_Update *) malloc(f.buffer_update_count * sizeof (Render_Buffer_Update) + 1);
+    f.stream       = (uint8_t *) malloc(f.stream_size + 1);
+
+    ok = f.commands != NULL && f.uniforms != NULL && f.blocks != NULL && f.uniform_data != NULL &&
+         f.buffer_updates != NULL && f.stream != NULL;
+    if (ok && (p = take(r, f.command_count * sizeof (Render_Command))) != NULL)
+        memcpy(f.commands, p, f.command_count * sizeof (Render_Command));
+    else ok = 0;
+    if (ok && (p = take(r, f.uniform_count * sizeof (Render_Uniform))) != NULL)
+        memcpy(f.uniforms, p, f.uniform_count * sizeof (Render_Uniform));
+    else ok = 0;
+    if (ok && (p = take(r, f.block_count * sizeof (Render_Uniform_Block))) != NULL)
+        memcpy(f.blocks, p, f.block_count * sizeof (Render_Uniform_Block));
+    else ok = 0;
+    if (ok && (p = take(r, f.uniform_data_count * sizeof (float))) != NULL)
+        memcpy(f.uniform_data, p, f.uniform_data_count * sizeof (float));
+    else ok = 0;
+    if (ok && (p = take(r, f.buffer_update_count * sizeof (Render_Buffer_Update))) != NULL)
+        memcpy(f.buffer_updates, p, f.buffer_update_count * sizeof (Render_Buffer_Update));
+    else ok = 0;
+    if (ok && (p = take(r, f.stream_size)) != NULL)
+        memcpy(f.stream, p, f.stream_size);
+    else ok = 0;
+
+    // uniform locations belong to the captured program, so they are mapped before the program is
+    for (i = 0; ok && i < f.block_count; i++) {
+        b = &f.blocks[i];
+        if ((uint64_t) b->first + b->count > f.uniform_count) ok = 0;
+        for (k = 0; ok && k < b->count; k++) {
+            o = map_find(&c->objects, OBJECT_UNIFORM, b->program, (uint32_t) f.uniforms[b->first + k].location);
+            f.uniforms[b->first + k].location = o != NULL ? (GLint) o->replay : -1;
+            switch (f.uniforms[b->first + k].type) {
+                case GL_FLOAT_MAT4: size = 16; break;
+                case GL_FLOAT_VEC4: size =  4; break;
+                default:            size =  1; break;
+            }
+            if ((uint64_t) f.uniforms[b->first + k].offset + size > f.uniform_data_count) ok = 0;
+        }
+        ok = ok && remap(c, OBJECT_PROGRAM, &b->program);
+    }
+
+    for (i = 0; ok && i < f.buffer_update_count; i++)
+        ok = (uint64_t) f.buffer_updates[i].offset + f.buffer_updates[i].size <= f.stream_size;
+
+    for (i = 0; ok && i < f.command_count; i++) {
+        cmd = &f.commands[i];
+        ok = cmd->uniforms <= f.block_count &&
+             (uint64_t) cmd->stream_offset + cmd->stream_size <= f.stream_size &&
+             (cmd->stream_size == 0 || cmd->stream_stride > 0) &&
+             remap(c, OBJECT_PROGRAM, &cmd->program) &&
+             remap(c, OBJECT_VERTEX_ARRAY, &cmd->vertex_array) &&
+             (cmd->texture == 0 || remap(c, OBJECT_TEXTURE, &cmd->texture));
+    }
+
+    if (!ok) {
+        frame_free(&f);
+        return 0;
+    }
+
+    c->frames[c->frame_count++] = f;
+    return 1;
+}
+
+// replaces a captured name with the one of the replay, fails if the object was not loaded before
+static int remap(const Render_Capture *c, uint32_t kind, GLuint *id)
+{
+    Render_Object *o;
+
+    o = map_find(&c->objects, kind, 0, *id);
+    if (o == NULL) {
+        log_error("Capture uses object %u before it is stored", *id);
+        return 0;
+    }
+
+    *id = o->replay;
+    return 1;
+}
\ No newline at end of file
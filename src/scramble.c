@@ -0,0 +1,352 @@
+#include "scramble.h"
+
+#include "cube2.h"
+#include "cube3.h"
+#include "kociemba.h"
+#include "logging.h"
+#include "thistlethwaite.h"
+#include "util.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// scrambles a thread generates before it writes them out
+#define BULK_CHUNK_SIZE 256
+
+typedef struct {
+    FILE *out;
+    uint64_t n;
+    uint64_t count;
+    Random random;      // unused stream of chunk, every chunk has the stream of the seed jumped once per chunk
+    uint64_t chunk;
+
+    atomic_uint_fast64_t *next;     // next scramble that is not claimed yet, shared by all threads
+    pthread_mutex_t *write_lock;
+    pthread_cond_t *written_cond;
+    uint64_t *written;              // scrambles written so far, the chunks are written in order
+    int ok;
+} Bulk_Worker;
+
+static Cube3 random_cube2(Random *r);
+static Cube3 random_cube3(Random *r);
+static void shuffle(Random *r, uint8_t *a, int count);
+static void *bulk_thread(void *arg);
+
+// Random state scramble for the 2x2x2 and 3x3x3, a random move scramble for every other size.
+// On success *moves has to be freed by the caller.
+int scramble(Random *r, uint64_t n, Rubiks_Cube_Move **moves, size_t *count)
+{
+    if (n == 2 || n == 3)
+        return scramble_random_state(r, n, moves, count);
+
+    *count = scramble_length(n);
+    *moves = (Rubiks_Cube_Move *) malloc(*count * sizeof (Rubiks_Cube_Move));
+    if (*moves == NULL) {
+        log_error("Failed to allocate memory for %zu moves", *count);
+        return 0;
+    }
+
+    *count = scramble_random_moves(r, n, *count, *moves);
+
+    return 1;
+}
+
+// Picks every solvable state of the 2x2x2 or 3x3x3 with the same probability and returns the inverse of its solution.
+// The 2x2x2 gets an optimal solution, the 3x3x3 one of the 3x3x3 solver the reduction solver uses as well.
+int scramble_random_state(Random *r, uint64_t n, Rubiks_Cube_Move **moves, size_t *count)
+{
+    Rubiks_Cube_Move solution[THISTLETHWAITE_MAX_LENGTH];   // the longest solution of every solver
+    Cube3 c;
+    int length;
+
+    if (n != 2 && n != 3) {
+        log_error("Random state scrambles are only available for the 2x2x2 and 3x3x3, not for %" PRIu64 "x%" PRIu64, n, n);
+        return 0;
+    }
+
+    if (n == 2) {
+        c = random_cube2(r);
+        length = cube2_solve(&c, solution);
+    } else {
+        c = random_cube3(r);
+#ifdef SOLVER_THISTLETHWAITE
+        length = thistlethwaite_solve(&c, solution);
+#else
+        length = kociemba_solve(&c, KOCIEMBA_MAX_LENGTH, solution);
+#endif
+    }
+    if (length < 0) return 0;
+
+    *moves = (Rubiks_Cube_Move *) malloc(length * sizeof (Rubiks_Cube_Move) + 1);
+    if (*moves == NULL) {
+        log_error("Failed to allocate memory for %d moves", length);
+        return 0;
+    }
+
+    memcpy(*moves, solution, length * sizeof (Rubiks_Cube_Move));
+    *count = (size_t) length;
+    moves_invert(*moves, *count);
+
+    return 1;
+}
+
+// Random moves where no move can be merged with or cancel the moves since the last change of axis:
+// moves of the same axis always turn layers in increasing order. Every layer is named after its closer face.
+size_t scramble_random_moves(Random *r, uint64_t n, size_t length, Rubiks_Cube_Move *moves)
+{
+    uint64_t layer, last_layer;
+    int axis, last_axis;
+    size_t i;
+
+    last_axis = -1;
+    last_layer = 0;
+    for (i = 0; i < length; i++) {
+        do {
+            axis  = (int) random_below(r, 3);
+            layer = random_below(r, n);
+        } while (axis == last_axis && layer <= last_layer);
+
+        // faces 0 to 2 are the three axes, layers are counted from them
+        moves[i] = rubiks_cube_move(axis, random_below(r, ROTATION_COUNT), layer);
+        moves_optimize(&moves[i], 1, n);
+
+        last_axis  = axis;
+        last_layer = layer;
+    }
+
+    return length;
+}
+
+// length of a random move scramble, the same as the WCA uses for the 4x4x4 to 7x7x7
+uint64_t scramble_length(uint64_t n)
+{
+    return n < 4 ? 20 : 20 * (n - 2);
+}
+
+// Writes count scrambles line by line to out, spread over thread_count threads (every core if it is 0 or less).
+// Every chunk of scrambles has its own random stream and the chunks are written in order, so the output
+// only depends on the seed and not on the number of threads.
+int scramble_bulk(FILE *out, uint64_t n, uint64_t count, uint64_t seed, int thread_count)
+{
+    Bulk_Worker *workers;
+    pthread_t *threads;
+    pthread_mutex_t write_lock;
+    pthread_cond_t written_cond;
+    atomic_uint_fast64_t next;
+    uint64_t written;
+    Random r;
+    int i, started, ok;
+
+    if (n == 0) {
+        log_error("Cannot scramble a cube with side length 0");
+        return 0;
+    }
+
+    if (thread_count <= 0)
+        thread_count = cpu_count();
+
+    // generate the tables before the threads wait for them
+    if (n == 2) cube2_init();
+#ifdef SOLVER_THISTLETHWAITE
+    if (n == 3) thistlethwaite_init();
+#else
+    if (n == 3) kociemba_init();
+#endif
+
+    workers = (Bulk_Worker *) calloc(thread_count, sizeof (Bulk_Worker));
+    threads = (pthread_t *) calloc(thread_count, sizeof (pthread_t));
+    if (workers == NULL || threads == NULL) {
+        log_error("Failed to allocate memory for %d scramble threads", thread_count);
+        if (workers != NULL) free(workers);
+        if (threads != NULL) free(threads);
+        return 0;
+    }
+
+    pthread_mutex_init(&write_lock, NULL);
+    pthread_cond_init(&written_cond, NULL);
+    atomic_init(&next, 0);
+    written = 0;
+    random_seed(&r, seed);
+
+    for (started = 0; started < thread_count; started++) {
+        workers[started] = (Bulk_Worker) {
+            .out = out,
+            .n = n,
+            .count = count,
+            .random = r,
+            .chunk = 0,
+            .next = &next,
+            .write_lock = &write_lock,
+            .written_cond = &written_cond,
+            .written = &written,
+            .ok = 1,
+        };
+
+        if (pthread_create(&threads[started], NULL, bulk_thread, &workers[started]) != 0) {
+            log_error("Failed to start scramble thread");
+            break;
+        }
+    }
+
+    ok = started > 0;
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && workers[i].ok;
+    }
+
+    pthread_cond_destroy(&written_cond);
+    pthread_mutex_destroy(&write_lock);
+    free(workers);
+    free(threads);
+
+    return ok;
+}
+
+
+// The 2x2x2 has no centers, so the DBL corner stays solved and the cube is turned as a whole around it.
+// Every state of the other corners is solvable, the edges are solved.
+static Cube3 random_cube2(Random *r)
+{
+    uint8_t corners[CORNER_COUNT - 1] = {
+        CORNER_URF, CORNER_UFL, CORNER_ULB, CORNER_UBR, CORNER_DFR, CORNER_DLF, CORNER_DRB,
+    };
+    Cube3 c;
+    int i, sum;
+
+    c = cube3_solved();
+
+    shuffle(r, corners, CORNER_COUNT - 1);
+    for (i = 0; i < CORNER_COUNT - 1; i++)
+        c.cp[i < CORNER_DBL ? i : CORNER_DRB] = corners[i];
+
+    for (i = 0, sum = 0; i < CORNER_DBL; i++) {
+        c.co[i] = (uint8_t) random_below(r, 3);
+        sum += c.co[i];
+    }
+    c.co[CORNER_DRB] = (3 - sum % 3) % 3;
+
+    return c;
+}
+
+static Cube3 random_cube3(Random *r)
+{
+    Cube3 c;
+    int i, sum;
+    uint8_t tmp;
+
+    c = cube3_solved();
+
+    shuffle(r, c.cp, CORNER_COUNT);
+    for (i = 0, sum = 0; i < CORNER_COUNT - 1; i++) {
+        c.co[i] = (uint8_t) random_below(r, 3);
+        sum += c.co[i];
+    }
+    c.co[CORNER_COUNT - 1] = (3 - sum % 3) % 3;
+
+    shuffle(r, c.ep, EDGE_COUNT);
+    for (i = 0, sum = 0; i < EDGE_COUNT - 1; i++) {
+        c.eo[i] = (uint8_t) random_below(r, 2);
+        sum += c.eo[i];
+    }
+    c.eo[EDGE_COUNT - 1] = sum % 2;
+
+    // swapping two edges maps the states with wrong parity one to one onto the solvable ones, so they stay uniform
+    if (cube3_corner_parity(&c) != cube3_edge_parity(&c)) {
+        tmp = c.ep[0];
+        c.ep[0] = c.ep[1];
+        c.ep[1] = tmp;
+    }
+
+    return c;
+}
+
+// Fisher-Yates shuffle
+static void shuffle(Random *r, uint8_t *a, int count)
+{
+    int i, j;
+    uint8_t tmp;
+
+    for (i = count - 1; i > 0; i--) {
+        j = (int) random_below(r, i + 1);
+        tmp = a[i];
+        a[i] = a[j];
+        a[j] = tmp;
+    }
+}
+
+static void *bulk_thread(void *arg)
+{
+    Bulk_Worker *w;
+    Rubiks_Cube_Move *moves;
+    size_t count, length, capacity;
+    uint64_t start, end, i;
+    char *buf, *str, *b;
+    Random r;
+
+    w = (Bulk_Worker *) arg;
+
+    buf = NULL;
+    capacity = 0;
+    for (;;) {
+        start = atomic_fetch_add(w->next, BULK_CHUNK_SIZE);
+        if (start >= w->count) break;
+        end = start + BULK_CHUNK_SIZE < w->count ? start + BULK_CHUNK_SIZE : w->count;
+
+        // a thread only claims later chunks, so its stream is only ever jumped forward
+        for (; w->chunk < start / BULK_CHUNK_SIZE; w->chunk++)
+            random_jump(&w->random);
+        r = w->random;
+
+        length = 0;
+        for (i = start; w->ok && i < end; i++) {
+            if (!scramble(&r, w->n, &moves, &count)) {
+                w->ok = 0;
+                break;
+            }
+
+            str = moves_to_string(moves, count);
+            free(moves);
+            if (str == NULL) {
+                w->ok = 0;
+                break;
+            }
+
+            while (w->ok && length + strlen(str) + 2 > capacity) {
+                capacity = capacity == 0 ? 4096 : 2 * capacity;
+                b = (char *) realloc(buf, capacity);
+                if (b == NULL) {
+                    log_error("Failed to allocate memory for scrambles");
+                    w->ok = 0;
+                } else {
+                    buf = b;
+                }
+            }
+
+            if (w->ok) {
+                memcpy(&buf[length], str, strlen(str));
+                length += strlen(str);
+                buf[length++] = '\n';
+            }
+            free(str);
+        }
+
+        // the chunks before are claimed already, so their threads always get to write them,
+        // a failed chunk is passed on as well so the threads waiting for it do not block forever
+        pthread_mutex_lock(w->write_lock);
+        while (*w->written != start)
+            pthread_cond_wait(w->written_cond, w->write_lock);
+        if (length > 0) fwrite(buf, 1, length, w->out);
+        *w->written = end;
+        pthread_cond_broadcast(w->written_cond);
+        pthread_mutex_unlock(w->write_lock);
+
+        if (!w->ok) break;
+    }
+
+    if (buf != NULL) free(buf);
+
+    return NULL;
+}
\ No newline at end of file
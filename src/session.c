@@ -0,0 +1,432 @@
+#include "session.h"
+
+#include "logging.h"
+#include "util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+static int  write_bytes(Session_Writer *w, const void *bytes, size_t length);
+static int  write_varint(Session_Writer *w, uint64_t value);
+static int  write_checkpoint(Session_Writer *w, uint64_t delta);
+static int  read_varint(const uint8_t *data, uint64_t end, uint64_t *offset, uint64_t *value);
+static int  read_index(Session_Reader *r);
+static int  recover_index(Session_Reader *r);
+
+// Starts a recording with start as the first checkpoint, time is the timestamp of start in milliseconds.
+// A checkpoint_interval of 0 only writes the checkpoints at the start and for replaced states.
+Session_Writer *session_writer(const char *path, const Cube_State *start, uint64_t time, uint32_t checkpoint_interval)
+{
+    Session_Writer *w;
+    Session_Header header = {0};
+
+    w = (Session_Writer *) calloc(1, sizeof (Session_Writer));
+    if (w == NULL) {
+        log_error("Failed to allocate memory for session writer");
+        return NULL;
+    }
+
+    w->state  = cube_state_copy(start);
+    w->packed = (uint8_t *) malloc(cube_state_packed_size(start->n));
+    if (w->state == NULL || w->packed == NULL) {
+        log_error("Failed to allocate memory for the session state");
+        cube_state_free(w->state);
+        if (w->packed != NULL) free(w->packed);
+        free(w);
+        return NULL;
+    }
+
+    w->f = fopen(path, "wb");
+    if (w->f == NULL) {
+        log_error("Failed to create session \'%s\': %s", path, strerror(errno));
+        cube_state_free(w->state);
+        free(w->packed);
+        free(w);
+        return NULL;
+    }
+
+    w->interval = checkpoint_interval;
+    w->time = time;
+
+    memcpy(header.magic, SESSION_MAGIC, sizeof (header.magic));
+    header.version = SESSION_VERSION;
+    header.n = start->n;
+    header.checkpoint_interval = checkpoint_interval;
+
+    if (!write_bytes(w, &header, sizeof (header)) || !write_checkpoint(w, 0)) {
+        session_writer_close(w);
+        return NULL;
+    }
+
+    log_info("Recording session to \'%s\'", path);
+
+    return w;
+}
+
+// Appends a move, times before the previous record are moved to the previous record.
+int session_writer_move(Session_Writer *w, Rubiks_Cube_Move m, uint64_t time)
+{
+    uint64_t delta;
+
+    if (m.face >= FACE_COUNT || m.rot >= ROTATION_COUNT || m.slice >= w->state->n) {
+        log_warning("Invalid move, not recording it");
+        return 0;
+    }
+
+    delta = time > w->time ? time - w->time : 0;
+    if (!write_varint(w, delta << 1) || !write_varint(w, move_pack(m))) return 0;
+
+    cube_state_apply_move(w->state, m);
+    w->time += delta;
+    w->move_count++;
+    w->since_checkpoint++;
+
+    if (w->interval > 0 && w->since_checkpoint >= w->interval)
+        return write_checkpoint(w, 0);
+
+    return 1;
+}
+
+// Records a state that did not come from a move, like an imported one.
+int session_writer_checkpoint(Session_Writer *w, const Cube_State *s, uint64_t time)
+{
+    uint64_t delta;
+
+    if (s->n != w->state->n) {
+        log_error("Cannot record a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state in a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " session",
+                  s->n, s->n, s->n, w->state->n, w->state->n, w->state->n);
+        return 0;
+    }
+
+    delta = time > w->time ? time - w->time : 0;
+    memcpy(w->state->stickers, s->stickers, FACE_COUNT * s->n * s->n * sizeof (uint8_t));
+    w->time += delta;
+
+    return write_checkpoint(w, delta);
+}
+
+// Writes the index and frees the writer, returns 0 if anything of the session could not be written.
+int session_writer_close(Session_Writer *w)
+{
+    Session_Footer footer = {0};
+    static const uint8_t zeros[8] = {0};
+    int ok;
+
+    if (w == NULL) return 1;
+
+    footer.records_end      = w->offset;
+    footer.index_offset     = (w->offset + 7) & ~(uint64_t) 7;
+    footer.checkpoint_count = w->checkpoint_count;
+    footer.move_count       = w->move_count;
+    footer.duration         = w->time;
+    memcpy(footer.magic, SESSION_FOOTER_MAGIC, sizeof (footer.magic));
+
+    ok = w->checkpoint_count > 0 &&
+         write_bytes(w, zeros, footer.index_offset - w->offset) &&
+         write_bytes(w, w->checkpoints, w->checkpoint_count * sizeof (Session_Checkpoint)) &&
+         write_bytes(w, &footer, sizeof (footer));
+
+    if (fclose(w->f) != 0) {
+        log_error("Failed to close session: %s", strerror(errno));
+        ok = 0;
+    }
+    if (ok) log_info("Recorded %" PRIu64 " moves with %zu checkpoints", w->move_count, w->checkpoint_count);
+
+    if (w->checkpoints != NULL) free(w->checkpoints);
+    cube_state_free(w->state);
+    free(w->packed);
+    free(w);
+
+    return ok;
+}
+
+Session_Reader *session_reader_open(const char *path)
+{
+    Session_Reader *r;
+    void *data;
+
+    r = (Session_Reader *) calloc(1, sizeof (Session_Reader));
+    if (r == NULL) {
+        log_error("Failed to allocate memory for session reader");
+        return NULL;
+    }
+
+    data = map_file(path, &r->size, &r->mapped);
+    if (data == NULL) {
+        log_error("Failed to map session \'%s\': %s", path, strerror(errno));
+        free(r);
+        return NULL;
+    }
+    r->data = (const uint8_t *) data;
+    r->header = (const Session_Header *) data;
+
+    if (r->size < sizeof (Session_Header) || memcmp(r->header->magic, SESSION_MAGIC, sizeof (r->header->magic)) != 0 ||
+        r->header->version != SESSION_VERSION || r->header->n == 0 || r->header->n > UINT32_MAX) {
+        log_error("\'%s\' is not a session of version %d", path, SESSION_VERSION);
+        session_reader_close(r);
+        return NULL;
+    }
+
+    if (!read_index(r)) {
+        log_warning("Session \'%s\' was not closed, rebuilding its index", path);
+        if (!recover_index(r)) {
+            log_error("Session \'%s\' is corrupted", path);
+            session_reader_close(r);
+            return NULL;
+        }
+    }
+
+    return r;
+}
+
+void session_reader_close(Session_Reader *r)
+{
+    if (r == NULL) return;
+
+    unmap_file((void *) r->data, r->size, r->mapped);
+    if (r->recovered != NULL) free(r->recovered);
+    free(r);
+}
+
+// Sets s to the state at time, after every record up to and including time. Only the moves since the
+// last checkpoint before time are replayed. c is left behind the last record, so the session can be
+// replayed from there with session_reader_next().
+int session_reader_seek(const Session_Reader *r, uint64_t time, Cube_State *s, Session_Cursor *c)
+{
+    const Session_Checkpoint *cp;
+    Session_Cursor next;
+    uint64_t lo, hi, mid, tag, offset;
+    Rubiks_Cube_Move m;
+
+    if (s->n != r->header->n) {
+        log_error("Cannot seek a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " session with a %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state",
+                  r->header->n, r->header->n, r->header->n, s->n, s->n, s->n);
+        return 0;
+    }
+
+    // last checkpoint not after time, the first one if time is before the session
+    lo = 0;
+    hi = r->checkpoint_count;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (r->checkpoints[mid].time <= time) lo = mid;
+        else hi = mid;
+    }
+
+    cp = &r->checkpoints[lo];
+    if (cp->offset + cube_state_packed_size(s->n) > r->end || !cube_state_unpack(s, &r->data[cp->offset])) {
+        log_error("Session checkpoint %" PRIu64 " is corrupted", lo);
+        return 0;
+    }
+    c->offset = cp->offset + cube_state_packed_size(s->n);
+    c->time   = cp->time;
+    c->move   = cp->move;
+
+    for (;;) {
+        offset = c->offset;
+        if (offset >= r->end || !read_varint(r->data, r->end, &offset, &tag) || c->time + (tag >> 1) > time)
+            break;
+
+        next = *c;
+        if (!session_reader_next(r, &next, s, &m)) return 0;
+        *c = next;
+    }
+
+    return 1;
+}
+
+// Applies the next move to s and returns it in m, checkpoints on the way replace s.
+// Returns 0 at the end of the session.
+int session_reader_next(const Session_Reader *r, Session_Cursor *c, Cube_State *s, Rubiks_Cube_Move *m)
+{
+    uint64_t offset, tag, code, size;
+
+    size = cube_state_packed_size(s->n);
+    for (;;) {
+        offset = c->offset;
+        if (offset >= r->end) return 0;
+
+        if (!read_varint(r->data, r->end, &offset, &tag)) break;
+
+        if (tag & 1) {
+            if (offset + size > r->end || !cube_state_unpack(s, &r->data[offset])) break;
+            c->offset = offset + size;
+            c->time += tag >> 1;
+            continue;
+        }
+
+        if (!read_varint(r->data, r->end, &offset, &code)) break;
+        *m = move_unpack(code);
+        if (m->face >= FACE_COUNT || m->rot >= ROTATION_COUNT || m->slice >= s->n || (code >> 5) != m->slice) break;
+
+        cube_state_apply_move(s, *m);
+        c->offset = offset;
+        c->time += tag >> 1;
+        c->move++;
+        return 1;
+    }
+
+    log_error("Session record at byte %" PRIu64 " is corrupted", c->offset);
+    return 0;
+}
+
+
+static int write_bytes(Session_Writer *w, const void *bytes, size_t length)
+{
+    if (length > 0 && fwrite(bytes, 1, length, w->f) != length) {
+        log_error("Failed to write session: %s", strerror(errno));
+        return 0;
+    }
+
+    w->offset += length;
+    return 1;
+}
+
+// LEB128, seven bits per byte starting with the lowest ones, the high bit marks that more bytes follow
+static int write_varint(Session_Writer *w, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t length;
+
+    length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    bytes[length++] = (uint8_t) value;
+
+    return write_bytes(w, bytes, length);
+}
+
+static int write_checkpoint(Session_Writer *w, uint64_t delta)
+{
+    Session_Checkpoint *cp;
+    size_t capacity;
+
+    if (w->checkpoint_count == w->checkpoint_capacity) {
+        capacity = w->checkpoint_capacity == 0 ? 64 : 2 * w->checkpoint_capacity;
+        cp = (Session_Checkpoint *) realloc(w->checkpoints, capacity * sizeof (Session_Checkpoint));
+        if (cp == NULL) {
+            log_error("Failed to allocate memory for %zu session checkpoints", capacity);
+            return 0;
+        }
+        w->checkpoints = cp;
+        w->checkpoint_capacity = capacity;
+    }
+
+    cube_state_pack(w->state, w->packed);
+    if (!write_varint(w, delta << 1 | 1)) return 0;
+
+    cp = &w->checkpoints[w->checkpoint_count];
+    cp->offset = w->offset;
+    cp->time   = w->time;
+    cp->move   = w->move_count;
+
+    if (!write_bytes(w, w->packed, cube_state_packed_size(w->state->n))) return 0;
+
+    w->checkpoint_count++;
+    w->since_checkpoint = 0;
+
+    return 1;
+}
+
+static int read_varint(const uint8_t *data, uint64_t end, uint64_t *offset, uint64_t *value)
+{
+    uint64_t o;
+    int shift;
+
+    *value = 0;
+    for (o = *offset, shift = 0; o < end && shift < 64; o++, shift += 7) {
+        *value |= (uint64_t) (data[o] & 0x7f) << shift;
+        if (!(data[o] & 0x80)) {
+            *offset = o + 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_index(Session_Reader *r)
+{
+    const Session_Footer *footer;
+    uint64_t i;
+
+    if (r->size < sizeof (Session_Header) + sizeof (Session_Footer)) return 0;
+
+    footer = (const Session_Footer *) &r->data[r->size - sizeof (Session_Footer)];
+    if (memcmp(footer->magic, SESSION_FOOTER_MAGIC, sizeof (footer->magic)) != 0 ||
+        footer->index_offset % 8 != 0 || footer->checkpoint_count == 0 ||
+        footer->records_end < sizeof (Session_Header) || footer->records_end > footer->index_offset ||
+        footer->index_offset > r->size - sizeof (Session_Footer) ||
+        footer->checkpoint_count > (r->size - sizeof (Session_Footer) - footer->index_offset) / sizeof (Session_Checkpoint))
+        return 0;
+
+    r->checkpoints      = (const Session_Checkpoint *) &r->data[footer->index_offset];
+    r->checkpoint_count = footer->checkpoint_count;
+    r->move_count       = footer->move_count;
+    r->duration         = footer->duration;
+    r->end              = footer->records_end;
+
+    // seeking relies on the checkpoints being sorted
+    for (i = 1; i < r->checkpoint_count; i++) {
+        if (r->checkpoints[i].time < r->checkpoints[i-1].time || r->checkpoints[i].offset <= r->checkpoints[i-1].offset)
+            return 0;
+    }
+
+    return 1;
+}
+
+// Scans the records of a session without footer, a record cut off at the end is dropped.
+static int recover_index(Session_Reader *r)
+{
+    Session_Checkpoint *cp;
+    size_t capacity;
+    uint64_t offset, end, tag, code, time, moves, size;
+
+    size = cube_state_packed_size(r->header->n);
+    offset = sizeof (Session_Header);
+    end = offset;
+    time = moves = 0;
+    capacity = 0;
+    r->checkpoint_count = 0;
+
+    while (offset < r->size && read_varint(r->data, r->size, &offset, &tag)) {
+        if (tag & 1) {
+            if (offset + size > r->size) break;
+
+            if (r->checkpoint_count == capacity) {
+                capacity = capacity == 0 ? 64 : 2 * capacity;
+                cp = (Session_Checkpoint *) realloc(r->recovered, capacity * sizeof (Session_Checkpoint));
+                if (cp == NULL) {
+                    log_error("Failed to allocate memory for %zu session checkpoints", capacity);
+                    return 0;
+                }
+                r->recovered = cp;
+            }
+
+            time += tag >> 1;
+            r->recovered[r->checkpoint_count++] = (Session_Checkpoint) {
+                .offset = offset,
+                .time   = time,
+                .move   = moves,
+            };
+            offset += size;
+        } else {
+            if (!read_varint(r->data, r->size, &offset, &code)) break;
+            time += tag >> 1;
+            moves++;
+        }
+
+        end = offset;
+        r->duration = time;
+        r->move_count = moves;
+    }
+
+    r->checkpoints = r->recovered;
+    r->end = end;
+
+    return r->checkpoint_count > 0;
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "shader.h"
 
+#include "gl_state.h"
 #include "logging.h"
+#include "render_queue.h"
 #include "util.h"
 
 #include <malloc.h>
@@ -8,16 +10,22 @@
 
 GLint compile_shader(GLint type, const char *shader_path, GLuint *shader);
 
+static const char *BLOCK_NAMES[SHADER_BLOCK_COUNT] = {
+    [SHADER_BLOCK_CAMERA]  = "Camera",
+    [SHADER_BLOCK_PALETTE] = "Palette",
+};
+
 Shader_Program *shader_new(const char *vertex_path, const char *fragment_path)
 {
     Shader_Program *prog;
-    GLuint vertex_shader, fragment_shader;
+    GLuint vertex_shader, fragment_shader, block_index;
     GLint success;
     char info_log[512];
+    int i;
 
     log_info("Creating shader program...");
 
-    prog = (Shader_Program *) malloc(sizeof (Shader_Program));
+    prog = (Shader_Program *) calloc(1, sizeof (Shader_Program));
     if (prog == NULL) {
         log_error("Failed to allocate memory for shader program");
         return NULL;
@@ -54,95 +62,109 @@ Shader_Program *shader_new(const char *vertex_path, const char *fragment_path)
     }
     log_info("Finished linking shaders to shader program");
 
+    for (i = 0; i < SHADER_BLOCK_COUNT; i++) {
+        block_index = glGetUniformBlockIndex(prog->id, BLOCK_NAMES[i]);
+        if (block_index != GL_INVALID_INDEX) glUniformBlockBinding(prog->id, block_index, i);
+    }
+
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
 
-    prog->uniform_count = 0;
-
     log_info("Finished creating shader program");
 
     return prog;
 }
 
-void shader_register_uniform(Shader_Program *prog, const char *name)
+// Looks up the location of a uniform and checks that it has the given type, like GL_FLOAT_MAT4.
+// Registering the same name again returns the same handle.
+Shader_Uniform shader_register_uniform(Shader_Program *prog, const char *name, GLenum type)
 {
-    size_t i;
+    Shader_Uniform u, *uniforms;
+    char **names, active_name[256];
+    GLint count, size, i;
+    GLenum active_type;
+    size_t k, capacity;
+
+    for (k = 0; k < prog->uniform_count; k++) {
+        if (strcmp(prog->uniform_names[k], name) == 0) return prog->uniforms[k];
+    }
 
     log_info("Registering uniform \'%s\'...", name);
 
-    i = prog->uniform_count;
-    if (i + 1 >= SHADER_MAX_UNIFORMS) {
-        log_warning("Cannot register uniform \'%s\'. Shader class only supports up to %d uniforms", name, SHADER_MAX_UNIFORMS);
-        return;
+    u.location = glGetUniformLocation(prog->id, name);
+    u.type = type;
+
+    if (u.location < 0) {
+        log_warning("Uniform \'%s\' is not used by the shader program", name);
+    } else {
+        glGetProgramiv(prog->id, GL_ACTIVE_UNIFORMS, &count);
+        for (i = 0; i < count; i++) {
+            glGetActiveUniform(prog->id, i, sizeof (active_name), NULL, &size, &active_type, active_name);
+            if (strcmp(active_name, name) == 0 && active_type != type)
+                log_error("Uniform \'%s\' has type 0x%x, expected 0x%x", name, active_type, type);
+        }
     }
 
-    strncpy(prog->uniform_strings[i], name, SHADER_MAX_UNIFORM_NAME_LENGTH);
+    if (prog->uniform_count == prog->uniform_capacity) {
+        capacity = prog->uniform_capacity == 0 ? 8 : 2 * prog->uniform_capacity;
+        uniforms = (Shader_Uniform *) realloc(prog->uniforms, capacity * sizeof (Shader_Uniform));
+        if (uniforms != NULL) prog->uniforms = uniforms;
+        names = (char **) realloc(prog->uniform_names, capacity * sizeof (char *));
+        if (names != NULL) prog->uniform_names = names;
+
+        if (uniforms == NULL || names == NULL) {
+            log_error("Failed to allocate memory for %zu uniforms", capacity);
+            return u;
+        }
+        prog->uniform_capacity = capacity;
+    }
 
-    prog->uniform_locations[i] = glGetUniformLocation(prog->id, name);
-    prog->uniform_count++;
+    prog->uniform_names[prog->uniform_count] = strdup(name);
+    if (prog->uniform_names[prog->uniform_count] == NULL) {
+        log_error("Failed to allocate memory for uniform name \'%s\'", name);
+        return u;
+    }
+    prog->uniforms[prog->uniform_count++] = u;
 
     log_info("Finished registering uniform");
+
+    return u;
 }
 
-void shader_set_uniform_mat4(Shader_Program *prog, const char *name, float *val, GLboolean transpose)
+void shader_set_uniform_mat4(Shader_Program *prog, Shader_Uniform u, const float *val, GLboolean transpose)
 {
-    size_t i;
-
-    for (i = 0; i < prog->uniform_count; i++) {
-        if (strcmp(name, prog->uniform_strings[i]) == 0) break;
-    }
-
-    if (i >= prog->uniform_count) {
-        log_error("Unknown Uniform %s", name);
-    }
-
-    glUseProgram(prog->id);
-    glUniformMatrix4fv(prog->uniform_locations[i], 1, transpose, val);
+    shader_bind(prog);
+    glUniformMatrix4fv(u.location, 1, transpose, val);
 }
 
-void shader_set_uniform_color(Shader_Program *prog, const char *name, Color col)
+void shader_set_uniform_float(Shader_Program *prog, Shader_Uniform u, float val)
 {
-    size_t i;
-
-    for (i = 0; i < prog->uniform_count; i++) {
-        if (strcmp(name, prog->uniform_strings[i]) == 0) break;
-    }
-
-    if (i >= prog->uniform_count) {
-        log_error("Unknown Uniform %s", name);
-    }
-
-    glUseProgram(prog->id);
-    glUniform4f(prog->uniform_locations[i], col.r, col.g, col.b, col.a);
+    shader_bind(prog);
+    glUniform1f(u.location, val);
 }
 
-void shader_set_uniform_sampler2D(Shader_Program *prog, const char *name, unsigned int textureID)
+void shader_set_uniform_color(Shader_Program *prog, Shader_Uniform u, Color col)
 {
-    size_t i;
-
-    for (i = 0; i < prog->uniform_count; i++) {
-        if (strcmp(name, prog->uniform_strings[i]) == 0) break;
-    }
-
-    if (i >= prog->uniform_count) {
-        log_error("Unknown Uniform %s", name);
-    }
+    shader_bind(prog);
+    glUniform4f(u.location, col.r, col.g, col.b, col.a);
+}
 
-    glUseProgram(prog->id);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glUniform1i(prog->uniform_locations[i], 0);   
+// Samplers read from a texture unit, the texture itself is bound to the unit with glBindTexture().
+void shader_set_uniform_sampler2D(Shader_Program *prog, Shader_Uniform u, GLint texture_unit)
+{
+    shader_bind(prog);
+    glUniform1i(u.location, texture_unit);
 }
 
 void shader_bind(Shader_Program *prog)
 {
-    glUseProgram(prog->id);
+    gl_state_use_program(prog->id);
 }
 
 void shader_unbind(Shader_Program *prog)
 {
     (void) prog;
-    glUseProgram(0);
+    gl_state_use_program(0);
 }
 
 
@@ -178,8 +200,21 @@ GLint compile_shader(GLint type, const char *shader_path, GLuint *shader)
 
 void shader_free(Shader_Program *prog)
 {
+    size_t i;
+
     if (prog == NULL) return;
 
-    glDeleteProgram(prog->id);
+    gl_state_delete_program(prog->id);
+
+    for (i = 0; i < prog->uniform_count; i++)
+        free(prog->uniform_names[i]);
+    if (prog->uniforms != NULL) free(prog->uniforms);
+    if (prog->uniform_names != NULL) free(prog->uniform_names);
     free(prog);
+}
+
+// The data is written to the stream buffer of the render queue when it is flushed, before the first draw of the frame.
+void shader_update_block(Shader_Block block, const void *data, size_t size)
+{
+    render_queue_update_buffer(block, data, (uint32_t) size);
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "snapshot.h"
+
+#include "logging.h"
+#include "util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t crc32(const uint8_t *data, uint64_t length);
+
+// The snapshot is written next to path first and then renamed, so an old snapshot is never half overwritten.
+int snapshot_save(const char *path, const Cube_State *s)
+{
+    Snapshot_Header header = {0};
+    uint8_t *data;
+    char *tmp;
+    size_t length;
+    int ok;
+
+    length = strlen(path);
+    tmp  = (char *) malloc(length + 5);
+    data = (uint8_t *) malloc(sizeof (Snapshot_Header) + cube_state_packed_size(s->n));
+    if (tmp == NULL || data == NULL) {
+        log_error("Failed to allocate memory for snapshot");
+        if (tmp != NULL) free(tmp);
+        if (data != NULL) free(data);
+        return 0;
+    }
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.n = s->n;
+    header.size = cube_state_packed_size(s->n);
+
+    cube_state_pack(s, data + sizeof (Snapshot_Header));
+    header.checksum = crc32(data + sizeof (Snapshot_Header), header.size);
+    memcpy(data, &header, sizeof (header));
+
+    memcpy(tmp, path, length);
+    memcpy(tmp + length, ".tmp", 5);
+
+    ok = write_file(tmp, (const char *) data, sizeof (Snapshot_Header) + header.size);
+#ifdef _WIN32
+    // rename does not replace existing files on windows
+    if (ok) remove(path);
+#endif
+    if (ok && rename(tmp, path) != 0) {
+        log_error("Failed to replace snapshot \'%s\': %s", path, strerror(errno));
+        remove(tmp);
+        ok = 0;
+    }
+    if (ok) log_info("Saved %" PRIu64 "x%" PRIu64 "x%" PRIu64 " state to \'%s\'", s->n, s->n, s->n, path);
+
+    free(tmp);
+    free(data);
+    return ok;
+}
+
+Cube_State *snapshot_load(const char *path)
+{
+    const Snapshot_Header *header;
+    const uint8_t *packed;
+    Cube_State *s;
+    void *data;
+    size_t size;
+    int mapped;
+
+    data = map_file(path, &size, &mapped);
+    if (data == NULL) {
+        if (errno == ENOENT) log_info("No snapshot at \'%s\'", path);
+        else log_error("Failed to map snapshot \'%s\': %s", path, strerror(errno));
+        return NULL;
+    }
+
+    header = (const Snapshot_Header *) data;
+    packed = (const uint8_t *) data + sizeof (Snapshot_Header);
+    s = NULL;
+
+    if (size < sizeof (Snapshot_Header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof (header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION) {
+        log_error("\'%s\' is not a snapshot of version %d", path, SNAPSHOT_VERSION);
+    } else if (header->n == 0 || header->n > UINT32_MAX || header->size != cube_state_packed_size(header->n) ||
+               header->size > size - sizeof (Snapshot_Header) || crc32(packed, header->size) != header->checksum) {
+        log_error("Snapshot \'%s\' is corrupted", path);
+    } else {
+        s = cube_state(header->n);
+        if (s != NULL && !cube_state_unpack(s, packed)) {
+            log_error("Snapshot \'%s\' has invalid stickers", path);
+            cube_state_free(s);
+            s = NULL;
+        }
+    }
+
+    unmap_file(data, size, mapped);
+    return s;
+}
+
+
+// CRC-32 as used by zlib, reflected polynomial 0xEDB88320
+static uint32_t crc32(const uint8_t *data, uint64_t length)
+{
+    uint32_t table[256], crc;
+    uint64_t i;
+    int k;
+
+    for (i = 0; i < 256; i++) {
+        crc = (uint32_t) i;
+        for (k = 0; k < 8; k++)
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        table[i] = crc;
+    }
+
+    crc = 0xFFFFFFFFu;
+    for (i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
\ No newline at end of file
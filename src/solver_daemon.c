@@ -0,0 +1,497 @@
+#include "solver_daemon.h"
+
+#include "cube_state.h"
+#include "logging.h"
+#include "move.h"
+#include "reduction.h"
+#include "util.h"
+#include "validate.h"
+
+#ifdef _WIN32
+
+int solver_daemon_run(const char *socket_path, int worker_count)
+{
+    (void) socket_path; (void) worker_count;
+    log_error("The solver daemon is not supported on Windows");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// longest accepted request, enough for the facelets or a long scramble of a big cube
+#define MAX_REQUEST_LENGTH (1 << 20)
+#define READ_CHUNK_SIZE    4096
+
+typedef struct {
+    int fd;
+    pthread_mutex_t write_lock;
+
+    // the reader and every queued job hold a reference, protected by the daemon lock
+    int refs;
+} Connection;
+
+typedef struct Job {
+    Connection *conn;
+    char *request;
+    uint64_t received_ns;
+    struct Job *next;
+} Job;
+
+typedef struct {
+    int listen_fd;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  job_available;
+    Job *head, *tail;
+    uint64_t pending;
+    int stop;
+
+    // counters, protected by lock
+    uint64_t solved;
+    uint64_t failed;
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t start_ns;
+} Solver_Daemon;
+
+static Solver_Daemon sd;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void *worker_thread(void *arg);
+static void *reader_thread(void *arg);
+static int  is_stats_request(const char *request);
+static void handle_request(Connection *conn, const char *request, uint64_t received_ns);
+static char *solve_request(const char *command, const char *args, int *ok);
+static char *stats_response(void);
+static void connection_release(Connection *conn);
+static int  write_response(Connection *conn, const char *id, const char *status, const char *body);
+static int  write_all(int fd, const char *buf, size_t length);
+static uint64_t now_ns(void);
+static void signal_handler(int sig);
+
+int solver_daemon_run(const char *socket_path, int worker_count)
+{
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    pthread_t *workers;
+    pthread_t reader;
+    Connection *conn;
+    int fd, i;
+
+    if (strlen(socket_path) >= sizeof (addr.sun_path)) {
+        log_error("Socket path %s is too long", socket_path);
+        return 1;
+    }
+
+    if (worker_count <= 0)
+        worker_count = cpu_count();
+
+    // load all tables once, the workers only read them afterwards
+    reduction_init();
+
+    memset(&sd, 0, sizeof (sd));
+    pthread_mutex_init(&sd.lock, NULL);
+    pthread_cond_init(&sd.job_available, NULL);
+    sd.start_ns = now_ns();
+
+    sd.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sd.listen_fd < 0) {
+        log_error("Failed to create socket: %s", strerror(errno));
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+
+    if (bind(sd.listen_fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen(sd.listen_fd, 16) < 0) {
+        log_error("Failed to listen on %s: %s", socket_path, strerror(errno));
+        close(sd.listen_fd);
+        return 1;
+    }
+
+    // clients that disconnect early must not kill the daemon, SIGINT and SIGTERM shut it down
+    signal(SIGPIPE, SIG_IGN);
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT,  &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    workers = (pthread_t *) malloc(worker_count * sizeof (pthread_t));
+    if (workers == NULL) {
+        log_error("Failed to allocate memory for %d workers", worker_count);
+        close(sd.listen_fd);
+        unlink(socket_path);
+        return 1;
+    }
+    for (i = 0; i < worker_count; i++)
+        pthread_create(&workers[i], NULL, worker_thread, NULL);
+
+    log_info("Solver daemon listening on %s with %d workers", socket_path, worker_count);
+
+    while (!stop_requested) {
+        fd = accept(sd.listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR) log_warning("Failed to accept connection: %s", strerror(errno));
+            continue;
+        }
+
+        conn = (Connection *) calloc(1, sizeof (Connection));
+        if (conn == NULL) {
+            log_error("Failed to allocate memory for connection");
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->refs = 1;
+        pthread_mutex_init(&conn->write_lock, NULL);
+
+        if (pthread_create(&reader, NULL, reader_thread, conn) != 0) {
+            log_error("Failed to create reader thread");
+            connection_release(conn);
+            continue;
+        }
+        pthread_detach(reader);
+    }
+
+    log_info("Shutting down solver daemon");
+
+    pthread_mutex_lock(&sd.lock);
+    sd.stop = 1;
+    pthread_cond_broadcast(&sd.job_available);
+    pthread_mutex_unlock(&sd.lock);
+
+    for (i = 0; i < worker_count; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+
+    close(sd.listen_fd);
+    unlink(socket_path);
+
+    return 0;
+}
+
+
+static void *worker_thread(void *arg)
+{
+    Job *job;
+
+    (void) arg;
+
+    for (;;) {
+        pthread_mutex_lock(&sd.lock);
+        while (sd.head == NULL && !sd.stop)
+            pthread_cond_wait(&sd.job_available, &sd.lock);
+
+        if (sd.head == NULL) {
+            pthread_mutex_unlock(&sd.lock);
+            return NULL;
+        }
+
+        job = sd.head;
+        sd.head = job->next;
+        if (sd.head == NULL) sd.tail = NULL;
+        sd.pending--;
+        pthread_mutex_unlock(&sd.lock);
+
+        handle_request(job->conn, job->request, job->received_ns);
+
+        connection_release(job->conn);
+        free(job->request);
+        free(job);
+    }
+}
+
+// splits the incoming data into lines, STATS is answered right away, everything else goes to the workers
+static void *reader_thread(void *arg)
+{
+    Connection *conn;
+    Job *job;
+    char *buf, *line, *end, *tmp;
+    size_t length, capacity, start;
+    ssize_t r;
+
+    conn = (Connection *) arg;
+
+    capacity = READ_CHUNK_SIZE;
+    length = 0;
+    buf = (char *) malloc(capacity);
+
+    while (buf != NULL) {
+        if (length + READ_CHUNK_SIZE > capacity) {
+            if (capacity >= MAX_REQUEST_LENGTH) {
+                write_response(conn, "-", "ERR", "request too long");
+                break;
+            }
+            capacity *= 2;
+            tmp = (char *) realloc(buf, capacity);
+            if (tmp == NULL) break;
+            buf = tmp;
+        }
+
+        r = read(conn->fd, &buf[length], READ_CHUNK_SIZE);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        length += r;
+
+        start = 0;
+        while ((end = memchr(&buf[start], '\n', length - start)) != NULL) {
+            *end = '\0';
+            line = &buf[start];
+            start = end - buf + 1;
+
+            if (end > line && end[-1] == '\r') end[-1] = '\0';
+            if (*line == '\0') continue;
+
+            if (is_stats_request(line)) {
+                handle_request(conn, line, now_ns());
+                continue;
+            }
+
+            job = (Job *) malloc(sizeof (Job));
+            if (job == NULL || (job->request = strdup(line)) == NULL) {
+                if (job != NULL) free(job);
+                log_error("Failed to allocate memory for request");
+                continue;
+            }
+            job->conn = conn;
+            job->received_ns = now_ns();
+            job->next = NULL;
+
+            pthread_mutex_lock(&sd.lock);
+            conn->refs++;
+            if (sd.tail != NULL) sd.tail->next = job;
+            else sd.head = job;
+            sd.tail = job;
+            sd.pending++;
+            pthread_cond_signal(&sd.job_available);
+            pthread_mutex_unlock(&sd.lock);
+        }
+
+        memmove(buf, &buf[start], length - start);
+        length -= start;
+    }
+
+    if (buf != NULL) free(buf);
+
+    // no more requests, pending jobs still answer on the connection
+    shutdown(conn->fd, SHUT_RD);
+    connection_release(conn);
+
+    return NULL;
+}
+
+static int is_stats_request(const char *request)
+{
+    char id[64], command[16];
+
+    return sscanf(request, "%63s %15s", id, command) == 2 && strcmp(command, "STATS") == 0;
+}
+
+static void handle_request(Connection *conn, const char *request, uint64_t received_ns)
+{
+    char id[64], command[16], *body;
+    const char *args;
+    uint64_t latency;
+    int n, ok;
+
+    n = 0;
+    if (sscanf(request, "%63s %15s %n", id, command, &n) < 2) {
+        write_response(conn, "-", "ERR", "expected <id> <command> [arguments]");
+        return;
+    }
+    args = &request[n];
+
+    if (strcmp(command, "STATS") == 0) {
+        body = stats_response();
+        write_response(conn, id, body != NULL ? "OK" : "ERR", body != NULL ? body : "out of memory");
+        if (body != NULL) free(body);
+        return;
+    }
+
+    body = solve_request(command, args, &ok);
+    write_response(conn, id, ok ? "OK" : "ERR", body != NULL ? body : "out of memory");
+    if (body != NULL) free(body);
+
+    latency = now_ns() - received_ns;
+
+    pthread_mutex_lock(&sd.lock);
+    if (ok) sd.solved++;
+    else sd.failed++;
+    sd.latency_total_ns += latency;
+    if (latency > sd.latency_max_ns) sd.latency_max_ns = latency;
+    pthread_mutex_unlock(&sd.lock);
+}
+
+// returns the response body, *ok tells if it is a solution or an error message
+static char *solve_request(const char *command, const char *args, int *ok)
+{
+    Cube_State *s;
+    Rubiks_Cube_Move *moves;
+    size_t count, i;
+    char *solution, *body;
+    const char *reason;
+    int n, read;
+
+    *ok = 0;
+    s = NULL;
+
+    if (strcmp(command, "SOLVE") == 0) {
+        s = cube_state_from_facelets(args);
+        if (s == NULL) return strdup("invalid facelets");
+        if (s->n > SOLVER_DAEMON_MAX_N) {
+            cube_state_free(s);
+            return strdup("cube is too large");
+        }
+
+        if (!validate_state(s, &reason)) {
+            cube_state_free(s);
+            body = (char *) malloc(strlen(reason) + 32);
+            if (body != NULL) sprintf(body, "impossible state: %s", reason);
+            return body;
+        }
+    } else if (strcmp(command, "SCRAMBLE") == 0) {
+        if (sscanf(args, "%d %n", &n, &read) < 1 || n <= 0) return strdup("expected <n> <moves...>");
+        if (n > SOLVER_DAEMON_MAX_N) return strdup("cube is too large");
+
+        if (!moves_from_string(&args[read], &moves, &count)) return strdup("invalid moves");
+        for (i = 0; i < count; i++) {
+            if (moves[i].slice >= (uint64_t) n) {
+                free(moves);
+                return strdup("move outside the cube");
+            }
+        }
+
+        s = cube_state(n);
+        if (s != NULL) cube_state_apply_moves(s, moves, count);
+        free(moves);
+        if (s == NULL) return strdup("out of memory");
+    } else {
+        return strdup("unknown command");
+    }
+
+    if (!reduction_solve(s, &moves, &count)) {
+        cube_state_free(s);
+        return strdup("cube is not solvable");
+    }
+    cube_state_free(s);
+
+    solution = moves_to_string(moves, count);
+    free(moves);
+    if (solution == NULL) return NULL;
+
+    body = (char *) malloc(strlen(solution) + 32);
+    if (body != NULL) {
+        sprintf(body, "%zu%s%s", count, count > 0 ? " " : "", solution);
+        *ok = 1;
+    }
+    free(solution);
+
+    return body;
+}
+
+static char *stats_response(void)
+{
+    uint64_t solved, failed, pending, total, max, elapsed;
+    char *body;
+
+    pthread_mutex_lock(&sd.lock);
+    solved  = sd.solved;
+    failed  = sd.failed;
+    pending = sd.pending;
+    total   = sd.latency_total_ns;
+    max     = sd.latency_max_ns;
+    pthread_mutex_unlock(&sd.lock);
+
+    elapsed = now_ns() - sd.start_ns;
+
+    body = (char *) malloc(256);
+    if (body == NULL) return NULL;
+
+    snprintf(body, 256, "solved=%" PRIu64 " failed=%" PRIu64 " pending=%" PRIu64 " avg_ms=%.3f max_ms=%.3f solves_per_sec=%.3f",
+        solved, failed, pending,
+        solved + failed > 0 ? total / 1e6 / (solved + failed) : 0.0,
+        max / 1e6,
+        elapsed > 0 ? (solved + failed) / (elapsed / 1e9) : 0.0);
+
+    return body;
+}
+
+static void connection_release(Connection *conn)
+{
+    int refs;
+
+    pthread_mutex_lock(&sd.lock);
+    refs = --conn->refs;
+    pthread_mutex_unlock(&sd.lock);
+
+    if (refs > 0) return;
+
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->write_lock);
+    free(conn);
+}
+
+// responses of different workers must not interleave, so a line is written at once
+static int write_response(Connection *conn, const char *id, const char *status, const char *body)
+{
+    char *line;
+    size_t length;
+    int ok;
+
+    length = strlen(id) + strlen(status) + strlen(body) + 3;
+    line = (char *) malloc(length + 1);
+    if (line == NULL) return 0;
+    sprintf(line, "%s %s %s\n", id, status, body);
+
+    pthread_mutex_lock(&conn->write_lock);
+    ok = write_all(conn->fd, line, length);
+    pthread_mutex_unlock(&conn->write_lock);
+
+    free(line);
+    return ok;
+}
+
+static int write_all(int fd, const char *buf, size_t length)
+{
+    ssize_t w;
+
+    while (length > 0) {
+        w = write(fd, buf, length);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        buf += w;
+        length -= w;
+    }
+
+    return 1;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void signal_handler(int sig)
+{
+    (void) sig;
+    stop_requested = 1;
+}
+
+#endif // _WIN32
\ No newline at end of file
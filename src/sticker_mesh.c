@@ -0,0 +1,331 @@
+#include "sticker_mesh.h"
+
+#include "cubie_config.h"
+#include "gl_state.h"
+#include "logging.h"
+#include "render_queue.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+// axis of the normal of every face (x, y, z) and whether it points along or against the axis
+static const int FACE_AXIS[FACE_COUNT] = {2, 1, 0, 2, 1, 0};
+static const int FACE_SIGN[FACE_COUNT] = {1, 1, -1, -1, -1, 1};
+
+static void mark_sticker(Sticker_Mesh *m, uint64_t sticker);
+static void mesh_tile(Sticker_Mesh *m, const uint8_t *stickers, Sticker_Tile *t);
+static void add_quad(Sticker_Mesh *m, Sticker_Tile *t, uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, uint8_t color);
+static float cell_edge(Sticker_Mesh *m, uint64_t i);
+static int  grow_buffers(Sticker_Mesh *m);
+
+// half is the distance of the faces from the center, pitch the distance between two cubies
+// and scale the one the vertex positions are divided by. Returns 0 on failure.
+int sticker_mesh(Sticker_Mesh *m, uint64_t n, float half, float pitch, float scale)
+{
+    Sticker_Tile *t;
+    uint64_t f, r, c, quads;
+
+    *m = (Sticker_Mesh) {0};
+    m->n = n;
+    m->half = half;
+    m->pitch = pitch;
+    m->scale = scale;
+
+    m->tiles_per_side = (n + STICKER_TILE_SIZE - 1) / STICKER_TILE_SIZE;
+    m->tile_count = FACE_COUNT * m->tiles_per_side * m->tiles_per_side;
+
+    m->tiles  = (Sticker_Tile *) calloc(m->tile_count, sizeof (Sticker_Tile));
+    m->verts  = (Sticker_Vertex *) malloc(FACE_COUNT * n * n * 4 * sizeof (Sticker_Vertex));
+    m->merged = (uint8_t *) malloc(STICKER_TILE_SIZE * STICKER_TILE_SIZE);
+    if (m->tiles == NULL || m->verts == NULL || m->merged == NULL) {
+        log_error("Failed to allocate memory for the sticker mesh");
+        sticker_mesh_free(m);
+        return 0;
+    }
+
+    // a checkerboard cannot be merged at all, so every tile has room for one quad per sticker
+    t = m->tiles;
+    quads = 0;
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (r = 0; r < n; r += STICKER_TILE_SIZE) {
+            for (c = 0; c < n; c += STICKER_TILE_SIZE) {
+                t->face = f;
+                t->row  = r;
+                t->col  = c;
+                t->rows = n - r < STICKER_TILE_SIZE ? n - r : STICKER_TILE_SIZE;
+                t->cols = n - c < STICKER_TILE_SIZE ? n - c : STICKER_TILE_SIZE;
+                t->first_quad = quads;
+                t->dirty = 1;
+
+                quads += t->rows * t->cols;
+                t++;
+            }
+        }
+    }
+    m->dirty = 1;
+
+    // 16 bit indices are enough up to about 50x50x50
+    m->index_type = quads * 4 <= UINT16_MAX + 1 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    glGenVertexArrays(1, &m->vao);
+    glGenBuffers(1, &m->vbo);
+    glGenBuffers(1, &m->ebo);
+    if (m->vao == 0 || m->vbo == 0 || m->ebo == 0) {
+        log_error("Failed to create buffers for the sticker mesh");
+        sticker_mesh_free(m);
+        return 0;
+    }
+
+    gl_state_bind_vertex_array(m->vao);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, m->vbo);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m->ebo);
+    sticker_vertex_attributes();
+
+    log_debug("Split the faces into %" PRIu64 " sticker tiles", m->tile_count);
+
+    return 1;
+}
+
+// Marks the tiles holding stickers of the slice, they are meshed again by the next sticker_mesh_update().
+void sticker_mesh_mark_slice(Sticker_Mesh *m, Rubiks_Cube_Face face, uint64_t slice)
+{
+    uint64_t f, i, t, tiles;
+
+    tiles = m->tiles_per_side * m->tiles_per_side;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        // parallel faces only change if the slice is their outer layer, then they are turned completely
+        if (f == face || f == face_opposite(face)) {
+            if (slice != (f == face ? 0 : m->n - 1)) continue;
+
+            for (t = f * tiles; t < (f + 1) * tiles; t++)
+                m->tiles[t].dirty = 1;
+            m->dirty = 1;
+            continue;
+        }
+
+        for (i = 0; i < m->n; i++)
+            mark_sticker(m, cube_state_slice_sticker(m->n, face, slice, f, i));
+    }
+}
+
+void sticker_mesh_mark_all(Sticker_Mesh *m)
+{
+    uint64_t t;
+
+    for (t = 0; t < m->tile_count; t++)
+        m->tiles[t].dirty = 1;
+    m->dirty = 1;
+}
+
+// Meshes the dirty tiles and uploads the quads from the first tile that changed on with a single call.
+void sticker_mesh_update(Sticker_Mesh *m, const Cube_State *s)
+{
+    Sticker_Tile *t;
+    uint64_t i, quads, first;
+
+    if (!m->dirty) return;
+    m->dirty = 0;
+
+    // a tile is packed again if it was meshed again or a tile before it changed its number of quads
+    quads = 0;
+    first = UINT64_MAX;
+    for (i = 0; i < m->tile_count; i++) {
+        t = &m->tiles[i];
+        if (t->dirty) {
+            mesh_tile(m, s->stickers, t);
+            if (first == UINT64_MAX) first = quads;
+        }
+        if (t->packed_quad != quads && first == UINT64_MAX) first = quads;
+
+        t->packed_quad = quads;
+        quads += t->quad_count;
+    }
+    m->quad_count = quads;
+
+    if (m->quad_count > m->quad_capacity) {
+        if (!grow_buffers(m)) {
+            m->index_count = 0;
+            return;
+        }
+        first = 0;
+    }
+    m->index_count = (GLsizei) (m->quad_count * 6);
+    if (first >= m->quad_count) return;
+
+    for (i = 0; i < m->tile_count; i++) {
+        t = &m->tiles[i];
+        if (t->packed_quad < first || t->quad_count == 0) continue;
+
+        memcpy(m->packed + t->packed_quad * 4, m->verts + t->first_quad * 4, t->quad_count * 4 * sizeof (Sticker_Vertex));
+    }
+
+    gl_state_bind_vertex_array(m->vao);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, m->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, first * 4 * sizeof (Sticker_Vertex), (m->quad_count - first) * 4 * sizeof (Sticker_Vertex),
+                    m->packed + first * 4);
+    render_queue_buffer_changed(m->vbo);
+}
+
+void sticker_mesh_free(Sticker_Mesh *m)
+{
+    if (m->vao != 0) gl_state_delete_vertex_array(m->vao);
+    if (m->vbo != 0) gl_state_delete_buffer(m->vbo);
+    if (m->ebo != 0) gl_state_delete_buffer(m->ebo);
+    if (m->tiles != NULL)
+        free(m->tiles);
+    if (m->verts != NULL)
+        free(m->verts);
+    if (m->packed != NULL)
+        free(m->packed);
+    if (m->merged != NULL)
+        free(m->merged);
+
+    *m = (Sticker_Mesh) {0};
+}
+
+
+static void mark_sticker(Sticker_Mesh *m, uint64_t sticker)
+{
+    uint64_t f, r, c;
+
+    f = sticker / (m->n * m->n);
+    r = sticker % (m->n * m->n) / m->n;
+    c = sticker % m->n;
+
+    m->tiles[(f * m->tiles_per_side + r / STICKER_TILE_SIZE) * m->tiles_per_side + c / STICKER_TILE_SIZE].dirty = 1;
+    m->dirty = 1;
+}
+
+// Greedy meshing, every sticker that is not part of a quad yet starts a new one. The quad takes the
+// same colored stickers to the right, then the rows below as long as they are the same over its whole width.
+static void mesh_tile(Sticker_Mesh *m, const uint8_t *stickers, Sticker_Tile *t)
+{
+    const uint8_t *face;
+    uint64_t r, c, w, h, i, j;
+    uint8_t color;
+
+    face = stickers + t->face * m->n * m->n + t->row * m->n + t->col;
+    memset(m->merged, 0, t->rows * t->cols);
+    t->quad_count = 0;
+    t->dirty = 0;
+
+    for (r = 0; r < t->rows; r++) {
+        for (c = 0; c < t->cols; c++) {
+            if (m->merged[r * t->cols + c]) continue;
+            color = face[r * m->n + c];
+
+            for (w = 1; c + w < t->cols; w++) {
+                if (m->merged[r * t->cols + c + w] || face[r * m->n + c + w] != color) break;
+            }
+
+            for (h = 1; r + h < t->rows; h++) {
+                for (j = 0; j < w; j++) {
+                    if (m->merged[(r + h) * t->cols + c + j] || face[(r + h) * m->n + c + j] != color) break;
+                }
+                if (j < w) break;
+            }
+
+            for (i = 0; i < h; i++)
+                memset(m->merged + (r + i) * t->cols + c, 1, w);
+
+            add_quad(m, t, t->row + r, t->col + c, h, w, color);
+        }
+    }
+}
+
+// Covers the cells of the stickers from row, col to row + rows - 1, col + cols - 1 of the face of the tile.
+static void add_quad(Sticker_Mesh *m, Sticker_Tile *t, uint64_t row, uint64_t col, uint64_t rows, uint64_t cols, uint8_t color)
+{
+    Sticker_Vertex *v;
+    uint64_t p[2][3], lo[3], hi[3];
+    int axis, sign, u, w, k;
+    float plane[3];
+
+    // the corners of the quad are the cells of the first and the last sticker
+    cube_state_sticker_cubie(m->n, cube_state_sticker_index(m->n, t->face, row, col), &p[0][0], &p[0][1], &p[0][2]);
+    cube_state_sticker_cubie(m->n, cube_state_sticker_index(m->n, t->face, row + rows - 1, col + cols - 1), &p[1][0], &p[1][1], &p[1][2]);
+    for (k = 0; k < 3; k++) {
+        lo[k] = p[0][k] < p[1][k] ? p[0][k] : p[1][k];
+        hi[k] = (p[0][k] > p[1][k] ? p[0][k] : p[1][k]) + 1;
+    }
+
+    // counterclock-wise seen from outside, u x w points along the axis
+    axis = FACE_AXIS[t->face];
+    sign = FACE_SIGN[t->face];
+    u = (axis + 1) % 3;
+    w = (axis + 2) % 3;
+    if (sign < 0) {
+        k = u;
+        u = w;
+        w = k;
+    }
+
+    v = m->verts + (t->first_quad + t->quad_count++) * 4;
+    plane[axis] = sign * m->half;
+    color += COLOR_FRONT;
+
+    plane[u] = cell_edge(m, lo[u]); plane[w] = cell_edge(m, lo[w]);
+    v[0] = sticker_vertex(vec3(plane[0], plane[1], plane[2]), m->scale, color, (uint16_t) lo[u], (uint16_t) lo[w]);
+    plane[u] = cell_edge(m, hi[u]); plane[w] = cell_edge(m, lo[w]);
+    v[1] = sticker_vertex(vec3(plane[0], plane[1], plane[2]), m->scale, color, (uint16_t) hi[u], (uint16_t) lo[w]);
+    plane[u] = cell_edge(m, hi[u]); plane[w] = cell_edge(m, hi[w]);
+    v[2] = sticker_vertex(vec3(plane[0], plane[1], plane[2]), m->scale, color, (uint16_t) hi[u], (uint16_t) hi[w]);
+    plane[u] = cell_edge(m, lo[u]); plane[w] = cell_edge(m, hi[w]);
+    v[3] = sticker_vertex(vec3(plane[0], plane[1], plane[2]), m->scale, color, (uint16_t) lo[u], (uint16_t) hi[w]);
+}
+
+// coordinate of the start of cubie i along an axis, the end of the last cubie is the face of the cube
+static float cell_edge(Sticker_Mesh *m, uint64_t i)
+{
+    return i == m->n ? m->half : -m->half + (float) i * m->pitch;
+}
+
+// Every quad uses the same 6 indices of its 4 vertices, so the index buffer only changes when it has to grow.
+// The vertex buffer grows along with it and is left empty, the caller uploads every quad again.
+static int grow_buffers(Sticker_Mesh *m)
+{
+    Sticker_Vertex *packed;
+    void *indices;
+    uint64_t capacity, max, q, k, size;
+    uint32_t quad[6] = {0, 1, 2, 0, 2, 3};
+
+    max = FACE_COUNT * m->n * m->n;
+    capacity = m->quad_capacity == 0 ? 256 : 2 * m->quad_capacity;
+    while (capacity < m->quad_count) capacity *= 2;
+    if (capacity > max) capacity = max;
+
+    packed = (Sticker_Vertex *) realloc(m->packed, capacity * 4 * sizeof (Sticker_Vertex));
+    if (packed == NULL) {
+        log_error("Failed to allocate memory for %" PRIu64 " quads of the sticker mesh", capacity);
+        return 0;
+    }
+    m->packed = packed;
+
+    size = m->index_type == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t);
+    indices = malloc(capacity * 6 * size);
+    if (indices == NULL) {
+        log_error("Failed to allocate memory for %" PRIu64 " quads of the sticker mesh", capacity);
+        return 0;
+    }
+
+    for (q = 0; q < capacity; q++) {
+        for (k = 0; k < 6; k++) {
+            if (m->index_type == GL_UNSIGNED_SHORT) ((uint16_t *) indices)[q * 6 + k] = (uint16_t) (q * 4 + quad[k]);
+            else                                    ((uint32_t *) indices)[q * 6 + k] = (uint32_t) (q * 4 + quad[k]);
+        }
+    }
+
+    gl_state_bind_vertex_array(m->vao);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, capacity * 6 * size, indices, GL_STATIC_DRAW);
+    free(indices);
+    render_queue_buffer_changed(m->ebo);
+
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, m->vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * 4 * sizeof (Sticker_Vertex), NULL, GL_DYNAMIC_DRAW);
+
+    m->quad_capacity = capacity;
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "stream_buffer.h"
+
+#include "gl_state.h"
+#include "logging.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <string.h>
+
+// how long a fence is waited for at once, the wait is repeated until it is signaled
+#define FENCE_TIMEOUT_NS 1000000000ull
+
+static void wait_fence(GLsync *fence);
+
+// Creates the buffer, region_size is the most a single frame can write. Returns 0 on failure.
+int stream_buffer(Stream_Buffer *sb, uint32_t region_size)
+{
+    GLbitfield flags;
+
+    *sb = (Stream_Buffer) {0};
+    sb->region_size = region_size;
+
+    glGenBuffers(1, &sb->buffer);
+    if (sb->buffer == 0) {
+        log_error("Failed to create stream buffer");
+        return 0;
+    }
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, sb->buffer);
+
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr) region_size * STREAM_BUFFER_REGIONS, NULL, flags);
+        sb->mapped = (uint8_t *) glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr) region_size * STREAM_BUFFER_REGIONS, flags);
+        if (sb->mapped != NULL) {
+            log_info("Created persistently mapped stream buffer with %d regions of %" PRIu32 " bytes", STREAM_BUFFER_REGIONS, region_size);
+            return 1;
+        }
+
+        // storage is immutable, so the fallback needs a new buffer
+        log_warning("Failed to map stream buffer persistently, falling back to orphaning");
+        gl_state_delete_buffer(sb->buffer);
+        glGenBuffers(1, &sb->buffer);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, sb->buffer);
+    }
+
+    sb->staging = (uint8_t *) malloc(region_size);
+    if (sb->staging == NULL) {
+        log_error("Failed to allocate memory for stream buffer");
+        stream_buffer_free(sb);
+        return 0;
+    }
+    glBufferData(GL_ARRAY_BUFFER, region_size, NULL, GL_STREAM_DRAW);
+
+    log_info("Created orphaned stream buffer of %" PRIu32 " bytes", region_size);
+    return 1;
+}
+
+// Copies data into the region of the frame at a multiple of alignment, which does not have to be a power of two.
+// Returns the offset in the buffer, or STREAM_BUFFER_FULL if the frame wrote too much already.
+uint32_t stream_buffer_write(Stream_Buffer *sb, const void *data, uint32_t size, uint32_t alignment)
+{
+    uint64_t base, offset;
+
+    // the staging copy always starts at the beginning of the buffer
+    base = sb->mapped != NULL ? (uint64_t) sb->region * sb->region_size : 0;
+
+    offset = base + sb->offset;
+    if (alignment > 1) offset = (offset + alignment - 1) / alignment * alignment;
+    if (offset + size > base + sb->region_size) return STREAM_BUFFER_FULL;
+
+    if (sb->mapped != NULL) memcpy(sb->mapped + offset, data, size);
+    else                    memcpy(sb->staging + offset, data, size);
+    sb->offset = (uint32_t) (offset + size - base);
+
+    return (uint32_t) offset;
+}
+
+// Makes the writes of the frame visible to the following draws, coherent mappings need nothing.
+void stream_buffer_commit(Stream_Buffer *sb)
+{
+    if (sb->mapped != NULL || sb->offset == 0) return;
+
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, sb->buffer);
+    glBufferData(GL_ARRAY_BUFFER, sb->region_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sb->offset, sb->staging);
+}
+
+// Call after the last draw using the writes of the frame, waits only if the GPU is a whole ring behind.
+void stream_buffer_end_frame(Stream_Buffer *sb)
+{
+    if (sb->mapped != NULL) {
+        sb->fences[sb->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        sb->region = (sb->region + 1) % STREAM_BUFFER_REGIONS;
+        wait_fence(&sb->fences[sb->region]);
+    }
+
+    sb->offset = 0;
+}
+
+void stream_buffer_free(Stream_Buffer *sb)
+{
+    int i;
+
+    for (i = 0; i < STREAM_BUFFER_REGIONS; i++) {
+        if (sb->fences[i] != NULL) glDeleteSync(sb->fences[i]);
+    }
+
+    if (sb->mapped != NULL) {
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, sb->buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    if (sb->buffer != 0)
+        gl_state_delete_buffer(sb->buffer);
+
+    free(sb->staging);
+    *sb = (Stream_Buffer) {0};
+}
+
+
+static void wait_fence(GLsync *fence)
+{
+    GLenum result;
+
+    if (*fence == NULL) return;
+
+    do {
+        result = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    if (result == GL_WAIT_FAILED) log_warning("Failed to wait for stream buffer fence");
+
+    glDeleteSync(*fence);
+    *fence = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "symmetry.h"
+
+#include "logging.h"
+
+#include <inttypes.h>
+#include <malloc.h>
+
+// the six permutations of the axes, the identity comes first so symmetry 0 is the identity
+static const int AXIS_PERMUTATIONS[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0},
+};
+static const int AXIS_PERMUTATION_PARITY[6] = {1, -1, -1, 1, 1, -1};
+
+static void transform(const int8_t m[3][3], const int64_t v[3], int64_t out[3]);
+static int  compare_conjugates(const Cube_Symmetry *cs, const Cube_State *s, int a, int b);
+
+// builds the tables for a NxNxN cube, the memory needed grows with 48*6*n*n
+Cube_Symmetry *cube_symmetry(uint64_t n)
+{
+    Cube_Symmetry *cs;
+    int64_t pos[3], normal[3], p[3], q[3];
+    uint64_t x, y, z, i;
+    int s, t, perm, signs, r, c, f, det;
+
+    if (n == 0) {
+        log_error("Cannot create symmetry tables with side length 0");
+        return NULL;
+    }
+
+    cs = (Cube_Symmetry *) calloc(1, sizeof (Cube_Symmetry));
+    if (cs == NULL) {
+        log_error("Failed to allocate memory for symmetry tables");
+        return NULL;
+    }
+
+    cs->n = n;
+    cs->size = FACE_COUNT * n * n;
+    cs->src = (uint64_t *) malloc(SYMMETRY_COUNT * cs->size * sizeof (uint64_t));
+    if (cs->src == NULL) {
+        log_error("Failed to allocate memory for the symmetry tables of %" PRIu64 " stickers", cs->size);
+        free(cs);
+        return NULL;
+    }
+
+    for (s = 0; s < SYMMETRY_COUNT; s++) {
+        perm  = s / 8;
+        signs = s % 8;
+
+        det = AXIS_PERMUTATION_PARITY[perm];
+        for (r = 0; r < 3; r++) {
+            for (c = 0; c < 3; c++)
+                cs->matrix[s][r][c] = 0;
+
+            cs->matrix[s][r][AXIS_PERMUTATIONS[perm][r]] = (signs >> r) & 1 ? -1 : 1;
+            if ((signs >> r) & 1) det = -det;
+        }
+        cs->mirror[s] = det < 0;
+
+        for (f = 0; f < FACE_COUNT; f++) {
+            cube_state_face_normal(f, normal);
+            transform(cs->matrix[s], normal, q);
+            cs->colors[s][f] = cube_state_face_from_normal(q);
+        }
+
+        // move every sticker around the center of the cube, coordinates are doubled to keep them integral
+        for (i = 0; i < cs->size; i++) {
+            cube_state_sticker_cubie(n, i, &x, &y, &z);
+            pos[0] = 2*(int64_t)x - (int64_t)(n-1);
+            pos[1] = 2*(int64_t)y - (int64_t)(n-1);
+            pos[2] = 2*(int64_t)z - (int64_t)(n-1);
+            cube_state_face_normal(i / (n*n), normal);
+
+            transform(cs->matrix[s], pos, p);
+            transform(cs->matrix[s], normal, q);
+
+            cs->src[s*cs->size + cube_state_sticker_at(n, cube_state_face_from_normal(q),
+                (uint64_t)((p[0] + (int64_t)(n-1)) / 2),
+                (uint64_t)((p[1] + (int64_t)(n-1)) / 2),
+                (uint64_t)((p[2] + (int64_t)(n-1)) / 2))] = i;
+        }
+    }
+
+    // the inverse of a signed permutation matrix is its transpose
+    for (s = 0; s < SYMMETRY_COUNT; s++) {
+        for (t = 0; t < SYMMETRY_COUNT; t++) {
+            for (r = 0; r < 9; r++) {
+                if (cs->matrix[s][r/3][r%3] != cs->matrix[t][r%3][r/3]) break;
+            }
+            if (r == 9) cs->inverse[s] = t;
+        }
+    }
+
+    return cs;
+}
+
+// writes the state conjugated by sym into out, which has to have the same size and must not be s
+void cube_symmetry_apply(const Cube_Symmetry *cs, int sym, const Cube_State *s, Cube_State *out)
+{
+    const uint64_t *src;
+    uint64_t i;
+
+    src = &cs->src[sym * cs->size];
+    for (i = 0; i < cs->size; i++)
+        out->stickers[i] = cs->colors[sym][s->stickers[src[i]]];
+}
+
+// The move m seen through sym, applying it to the conjugated state gives the conjugate of the state after m.
+// Solutions of a conjugated state are mapped back with the inverse symmetry.
+Rubiks_Cube_Move cube_symmetry_move(const Cube_Symmetry *cs, int sym, Rubiks_Cube_Move m)
+{
+    m.face = cs->colors[sym][m.face];
+    if (cs->mirror[sym]) m = move_inverse(m);
+
+    return m;
+}
+
+// Writes the smallest conjugate of s into out and returns the symmetry it was conjugated with.
+// Symmetric states share the same canonical state, so it can be used as key for caches and tables.
+// Conjugates are compared lazily, most of them differ after a few stickers.
+int cube_symmetry_canonical(const Cube_Symmetry *cs, const Cube_State *s, Cube_State *out)
+{
+    int sym, best;
+
+    best = 0;
+    for (sym = 1; sym < SYMMETRY_COUNT; sym++) {
+        if (compare_conjugates(cs, s, sym, best) < 0)
+            best = sym;
+    }
+
+    cube_symmetry_apply(cs, best, s, out);
+
+    return best;
+}
+
+void cube_symmetry_free(Cube_Symmetry *cs)
+{
+    if (cs == NULL) return;
+
+    if (cs->src != NULL)
+        free(cs->src);
+
+    free(cs);
+}
+
+
+static void transform(const int8_t m[3][3], const int64_t v[3], int64_t out[3])
+{
+    int r;
+
+    for (r = 0; r < 3; r++)
+        out[r] = m[r][0]*v[0] + m[r][1]*v[1] + m[r][2]*v[2];
+}
+
+static int compare_conjugates(const Cube_Symmetry *cs, const Cube_State *s, int a, int b)
+{
+    const uint64_t *src_a, *src_b;
+    uint64_t i;
+    uint8_t ca, cb;
+
+    src_a = &cs->src[a * cs->size];
+    src_b = &cs->src[b * cs->size];
+    for (i = 0; i < cs->size; i++) {
+        ca = cs->colors[a][s->stickers[src_a[i]]];
+        cb = cs->colors[b][s->stickers[src_b[i]]];
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
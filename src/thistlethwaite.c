@@ -0,0 +1,333 @@
+#include "thistlethwaite.h"
+
+#include "logging.h"
+#include "smath.h"
+
+#include <pthread.h>
+
+// Thistlethwaite's algorithm, every phase moves the cube into a smaller subgroup:
+//  G0 = <U, D, L, R, F, B>
+//  G1 = <U, D, L, R, F2, B2>       edges are oriented
+//  G2 = <U, D, L2, R2, F2, B2>     corners are oriented, UD-slice edges are in the UD-slice
+//  G3 = <U2, D2, L2, R2, F2, B2>   corners are in the half turn group, every edge is in its slice
+//  G4 = {solved}
+// The distance tables are complete, so every phase is solved optimally by always turning
+// towards a coordinate whose distance is one smaller.
+
+#define CORNER_GROUP_SIZE 96
+#define M_SLICE_SOLVED    49
+
+#define MOVE(face, rot) ((face) * ROTATION_COUNT + (rot))
+
+static const int PHASE1_MOVES[] = {
+    MOVE(FACE_FRONT, ROTATION_CCW), MOVE(FACE_FRONT, ROTATION_180), MOVE(FACE_FRONT, ROTATION_CW),
+    MOVE(FACE_UP,    ROTATION_CCW), MOVE(FACE_UP,    ROTATION_180), MOVE(FACE_UP,    ROTATION_CW),
+    MOVE(FACE_LEFT,  ROTATION_CCW), MOVE(FACE_LEFT,  ROTATION_180), MOVE(FACE_LEFT,  ROTATION_CW),
+    MOVE(FACE_BACK,  ROTATION_CCW), MOVE(FACE_BACK,  ROTATION_180), MOVE(FACE_BACK,  ROTATION_CW),
+    MOVE(FACE_DOWN,  ROTATION_CCW), MOVE(FACE_DOWN,  ROTATION_180), MOVE(FACE_DOWN,  ROTATION_CW),
+    MOVE(FACE_RIGHT, ROTATION_CCW), MOVE(FACE_RIGHT, ROTATION_180), MOVE(FACE_RIGHT, ROTATION_CW),
+};
+
+static const int PHASE2_MOVES[] = {
+    MOVE(FACE_FRONT, ROTATION_180),
+    MOVE(FACE_UP,    ROTATION_CCW), MOVE(FACE_UP,    ROTATION_180), MOVE(FACE_UP,    ROTATION_CW),
+    MOVE(FACE_LEFT,  ROTATION_CCW), MOVE(FACE_LEFT,  ROTATION_180), MOVE(FACE_LEFT,  ROTATION_CW),
+    MOVE(FACE_BACK,  ROTATION_180),
+    MOVE(FACE_DOWN,  ROTATION_CCW), MOVE(FACE_DOWN,  ROTATION_180), MOVE(FACE_DOWN,  ROTATION_CW),
+    MOVE(FACE_RIGHT, ROTATION_CCW), MOVE(FACE_RIGHT, ROTATION_180), MOVE(FACE_RIGHT, ROTATION_CW),
+};
+
+static const int PHASE3_MOVES[] = {
+    MOVE(FACE_FRONT, ROTATION_180),
+    MOVE(FACE_UP,    ROTATION_CCW), MOVE(FACE_UP,    ROTATION_180), MOVE(FACE_UP,    ROTATION_CW),
+    MOVE(FACE_LEFT,  ROTATION_180),
+    MOVE(FACE_BACK,  ROTATION_180),
+    MOVE(FACE_DOWN,  ROTATION_CCW), MOVE(FACE_DOWN,  ROTATION_180), MOVE(FACE_DOWN,  ROTATION_CW),
+    MOVE(FACE_RIGHT, ROTATION_180),
+};
+
+static const int PHASE4_MOVES[] = {
+    MOVE(FACE_FRONT, ROTATION_180),
+    MOVE(FACE_UP,    ROTATION_180),
+    MOVE(FACE_LEFT,  ROTATION_180),
+    MOVE(FACE_BACK,  ROTATION_180),
+    MOVE(FACE_DOWN,  ROTATION_180),
+    MOVE(FACE_RIGHT, ROTATION_180),
+};
+
+// sorted ranks of the corner permutations that can be reached with half turns
+static uint16_t corner_group[CORNER_GROUP_SIZE];
+static pthread_once_t corner_group_once = PTHREAD_ONCE_INIT;
+
+static int perm_rank(const uint8_t *p, int count);
+static void perm_unrank(uint8_t *p, int count, int rank);
+static int binomial(int n, int k);
+static int corner_group_index(const uint8_t *cp);
+static void init_corner_group(void);
+
+// safe to call from multiple threads
+void thistlethwaite_init(void)
+{
+    pthread_once(&corner_group_once, init_corner_group);
+}
+
+int thistlethwaite_phase_size(int phase)
+{
+    switch (phase) {
+        case 0: return THISTLETHWAITE_PHASE1_SIZE;
+        case 1: return THISTLETHWAITE_PHASE2_SIZE;
+        case 2: return THISTLETHWAITE_PHASE3_SIZE;
+        case 3: return THISTLETHWAITE_PHASE4_SIZE;
+        default: return 0;
+    }
+}
+
+int thistlethwaite_phase_moves(int phase, const int **moves)
+{
+    switch (phase) {
+        case 0: *moves = PHASE1_MOVES; return ARRAY_LENGTH(PHASE1_MOVES);
+        case 1: *moves = PHASE2_MOVES; return ARRAY_LENGTH(PHASE2_MOVES);
+        case 2: *moves = PHASE3_MOVES; return ARRAY_LENGTH(PHASE3_MOVES);
+        case 3: *moves = PHASE4_MOVES; return ARRAY_LENGTH(PHASE4_MOVES);
+        default: *moves = NULL; return 0;
+    }
+}
+
+// The coordinate of c in phase, c has to be in the group the phase starts from.
+int thistlethwaite_coordinate(const Cube3 *c, int phase)
+{
+    uint8_t p[4];
+    int i, k, x, y;
+
+    switch (phase) {
+        case 0:
+            x = 0;
+            for (i = 0; i < EDGE_COUNT - 1; i++)
+                x = 2*x + c->eo[i];
+            return x;
+
+        case 1:
+            x = 0;
+            for (i = 0; i < CORNER_COUNT - 1; i++)
+                x = 3*x + c->co[i];
+
+            y = 0;
+            for (i = 0, k = 0; i < EDGE_COUNT; i++) {
+                if (c->ep[i] >= EDGE_FR) y += binomial(i, ++k);
+            }
+            return x * 495 + y;
+
+        case 2:
+            // the M-slice edges UF, UB, DF and DB have odd indices
+            y = 0;
+            for (i = 0, k = 0; i < EDGE_FR; i++) {
+                if (c->ep[i] % 2 == 1) y += binomial(i, ++k);
+            }
+            return perm_rank(c->cp, CORNER_COUNT) * 70 + y;
+
+        case 3:
+            x = corner_group_index(c->cp);
+            for (i = 0; i < 4; i++) p[i] = c->ep[2*i] / 2;
+            x = x * 24 + perm_rank(p, 4);
+            for (i = 0; i < 4; i++) p[i] = c->ep[2*i + 1] / 2;
+            x = x * 24 + perm_rank(p, 4);
+            for (i = 0; i < 4; i++) p[i] = c->ep[EDGE_FR + i] - EDGE_FR;
+            return x * 24 + perm_rank(p, 4);
+
+        default:
+            return 0;
+    }
+}
+
+int thistlethwaite_is_goal(const Cube3 *c, int phase)
+{
+    switch (phase) {
+        case 0: return thistlethwaite_coordinate(c, 0) == 0;
+        case 1: return thistlethwaite_coordinate(c, 1) == 494;
+        case 2: return corner_group_index(c->cp) >= 0 && thistlethwaite_coordinate(c, 2) % 70 == M_SLICE_SOLVED;
+        case 3: return cube3_is_solved(c);
+        default: return 0;
+    }
+}
+
+int thistlethwaite_corner_group_size(void)
+{
+    return CORNER_GROUP_SIZE;
+}
+
+// writes the corner permutation with the given index in the half turn group into cp
+int thistlethwaite_corner_group_perm(int index, uint8_t *cp)
+{
+    thistlethwaite_init();
+    if (index < 0 || index >= CORNER_GROUP_SIZE) return 0;
+
+    perm_unrank(cp, CORNER_COUNT, corner_group[index]);
+    return 1;
+}
+
+#ifndef THISTLETHWAITE_GENERATOR
+
+static const uint8_t *TABLES[THISTLETHWAITE_PHASE_COUNT] = {
+    thistlethwaite_table_phase1,
+    thistlethwaite_table_phase2,
+    thistlethwaite_table_phase3,
+    thistlethwaite_table_phase4,
+};
+
+static int table_get(int phase, int coordinate)
+{
+    return (TABLES[phase][coordinate / 4] >> (2 * (coordinate % 4))) & 3;
+}
+
+// Writes a solution into moves, which has to hold THISTLETHWAITE_MAX_LENGTH moves.
+// Returns the length of the solution or -1 if the cube is invalid.
+int thistlethwaite_solve(const Cube3 *c, Rubiks_Cube_Move *moves)
+{
+    Cube3 cur, next;
+    const int *phase_moves;
+    int phase, count, length, distance, i, steps, quarter_turns;
+
+    if (!cube3_is_valid(c)) {
+        log_error("Cannot solve cube, the cube is not solvable");
+        return -1;
+    }
+
+    thistlethwaite_init();
+
+    cur = *c;
+    length = 0;
+
+    for (phase = 0; phase < THISTLETHWAITE_PHASE_COUNT; phase++) {
+        count = thistlethwaite_phase_moves(phase, &phase_moves);
+
+        for (steps = 0; !thistlethwaite_is_goal(&cur, phase); steps++) {
+            distance = table_get(phase, thistlethwaite_coordinate(&cur, phase));
+
+            for (i = 0; i < count; i++) {
+                next = cube3_apply_move(cur, phase_moves[i]);
+                if (table_get(phase, thistlethwaite_coordinate(&next, phase)) == (distance + 2) % 3) break;
+            }
+            if (i == count || steps == THISTLETHWAITE_MAX_LENGTH) {
+                log_error("Distance table of phase %d is inconsistent", phase + 1);
+                return -1;
+            }
+
+            cur = next;
+
+            // the first move of a phase can merge with the last move of the previous one
+            if (length > 0 && moves[length-1].face == phase_moves[i] / ROTATION_COUNT) {
+                quarter_turns = (moves[length-1].rot + 1 + phase_moves[i] % ROTATION_COUNT + 1) % 4;
+                if (quarter_turns == 0) length--;
+                else moves[length-1].rot = quarter_turns - 1;
+            } else {
+                moves[length++] = cube3_move(phase_moves[i]);
+            }
+        }
+    }
+
+    return length;
+}
+
+#endif // THISTLETHWAITE_GENERATOR
+
+
+static int perm_rank(const uint8_t *p, int count)
+{
+    int i, j, smaller, rank;
+
+    rank = 0;
+    for (i = 0; i < count; i++) {
+        smaller = 0;
+        for (j = i+1; j < count; j++) {
+            if (p[j] < p[i]) smaller++;
+        }
+        rank = rank * (count - i) + smaller;
+    }
+
+    return rank;
+}
+
+static void perm_unrank(uint8_t *p, int count, int rank)
+{
+    int i, j, digits[CORNER_COUNT], used[CORNER_COUNT] = {0};
+
+    for (i = count - 1; i >= 0; i--) {
+        digits[i] = rank % (count - i);
+        rank /= count - i;
+    }
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; used[j] || digits[i] > 0; j++) {
+            if (!used[j]) digits[i]--;
+        }
+        used[j] = 1;
+        p[i] = j;
+    }
+}
+
+static int binomial(int n, int k)
+{
+    int i, r;
+
+    if (k > n) return 0;
+
+    r = 1;
+    for (i = 1; i <= k; i++)
+        r = r * (n - k + i) / i;
+
+    return r;
+}
+
+static int corner_group_index(const uint8_t *cp)
+{
+    int lo, hi, mid, rank;
+
+    thistlethwaite_init();
+
+    rank = perm_rank(cp, CORNER_COUNT);
+    lo = 0;
+    hi = CORNER_GROUP_SIZE - 1;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (corner_group[mid] == rank) return mid;
+        if (corner_group[mid] < rank) lo = mid + 1;
+        else hi = mid - 1;
+    }
+
+    return -1;
+}
+
+static void init_corner_group(void)
+{
+    Cube3 queue[CORNER_GROUP_SIZE], c;
+    int head, count, i, m, rank;
+
+    cube3_init();
+
+    queue[0] = cube3_solved();
+    corner_group[0] = perm_rank(queue[0].cp, CORNER_COUNT);
+    count = 1;
+
+    for (head = 0; head < count; head++) {
+        for (m = 0; m < (int) ARRAY_LENGTH(PHASE4_MOVES); m++) {
+            c = cube3_apply_move(queue[head], PHASE4_MOVES[m]);
+            rank = perm_rank(c.cp, CORNER_COUNT);
+
+            for (i = 0; i < count; i++) {
+                if (corner_group[i] == rank) break;
+            }
+            if (i < count) continue;
+
+            queue[count] = c;
+            corner_group[count++] = rank;
+        }
+    }
+
+    // insertion sort, binary search is used for lookups
+    for (i = 1; i < count; i++) {
+        rank = corner_group[i];
+        for (m = i; m > 0 && corner_group[m-1] > rank; m--)
+            corner_group[m] = corner_group[m-1];
+        corner_group[m] = rank;
+    }
+}
\ No newline at end of file
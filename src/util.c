@@ -7,6 +7,15 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
 char *read_file(const char *path)
 {
     FILE *f;
@@ -163,3 +172,81 @@ int append_file(const char *path, const char *content, size_t length)
     fclose(f);
     return 1;
 }
+
+// Maps a file read-only into memory, where mmap is not available the file is read into a buffer instead.
+// Returns NULL with errno set if the file cannot be opened, empty files cannot be mapped.
+void *map_file(const char *path, size_t *size, int *mapped)
+{
+    void *data;
+#ifdef _WIN32
+    FILE *f;
+    long length;
+
+    f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    data = length > 0 ? malloc(length) : NULL;
+    if (data == NULL || fread(data, length, 1, f) != 1) {
+        if (data != NULL) free(data);
+        fclose(f);
+        errno = EIO;
+        return NULL;
+    }
+    fclose(f);
+
+    *size = length;
+    *mapped = 0;
+#else
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        errno = EIO;
+        return NULL;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    *size = st.st_size;
+    *mapped = 1;
+#endif
+
+    return data;
+}
+
+void unmap_file(void *data, size_t size, int mapped)
+{
+    if (data == NULL) return;
+
+#ifndef _WIN32
+    if (mapped) munmap(data, size);
+    else
+#endif
+    free(data);
+}
+
+// number of online processors, at least 1
+int cpu_count(void)
+{
+    int count;
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (int) info.dwNumberOfProcessors;
+#else
+    count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return count > 0 ? count : 1;
+}
\ No newline at end of file
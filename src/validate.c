@@ -0,0 +1,346 @@
+#include "validate.h"
+
+#include "cube3.h"
+
+#include <malloc.h>
+#include <string.h>
+
+// whole cube rotation that brings the given face to up, the rotation is applied to every slice
+static const struct {
+    Rubiks_Cube_Face face;
+    Rubiks_Cube_Rotation rot;
+} UP_ROTATION[FACE_COUNT] = {
+    [FACE_FRONT] = {FACE_RIGHT, ROTATION_CW},
+    [FACE_UP]    = {FACE_UP,    ROTATION_COUNT},
+    [FACE_LEFT]  = {FACE_FRONT, ROTATION_CW},
+    [FACE_BACK]  = {FACE_RIGHT, ROTATION_CCW},
+    [FACE_DOWN]  = {FACE_RIGHT, ROTATION_180},
+    [FACE_RIGHT] = {FACE_FRONT, ROTATION_CCW},
+};
+
+// rotation around up that brings the given face to front
+static const Rubiks_Cube_Rotation FRONT_ROTATION[FACE_COUNT] = {
+    [FACE_FRONT] = ROTATION_COUNT,
+    [FACE_LEFT]  = ROTATION_CCW,
+    [FACE_BACK]  = ROTATION_180,
+    [FACE_RIGHT] = ROTATION_CW,
+};
+
+static int check_colors(const Cube_State *s, const char **reason);
+static int check_centers(const Cube_State *s, const char **reason);
+static int check_wings(const Cube_State *s, const char **reason);
+static int check_cube3(const Cube_State *s, const char **reason);
+static int align_middle_centers(Cube_State *s);
+static void rotate_cube(Cube_State *s, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot);
+static int edge_index(uint8_t a, uint8_t b);
+
+int validate_state(const Cube_State *s, const char **reason)
+{
+    Cube_State *aligned;
+    const char *r;
+    int ok;
+
+    if (reason == NULL) reason = &r;
+    *reason = NULL;
+
+    if (!check_colors(s, reason) || !check_centers(s, reason) || !check_wings(s, reason))
+        return 0;
+
+    // the middle centers only move with the middle slices, which is the same as a cube rotation
+    // and moves of the outer layers. Rotating the cube so they are at home allows reading the
+    // middle edges with the usual 3x3x3 orientation.
+    aligned = cube_state_copy(s);
+    if (aligned == NULL) {
+        *reason = "out of memory";
+        return 0;
+    }
+
+    ok = 1;
+    if (s->n % 2 == 1 && !align_middle_centers(aligned)) {
+        *reason = "middle centers are in an impossible arrangement";
+        ok = 0;
+    }
+
+    if (ok && s->n >= 2)
+        ok = check_cube3(aligned, reason);
+
+    cube_state_free(aligned);
+    return ok;
+}
+
+
+// every color has to appear n*n times
+static int check_colors(const Cube_State *s, const char **reason)
+{
+    uint64_t counts[FACE_COUNT] = {0};
+    uint64_t i, n;
+    int f;
+
+    n = s->n;
+    for (i = 0; i < FACE_COUNT * n * n; i++) {
+        if (s->stickers[i] >= FACE_COUNT) {
+            *reason = "invalid color";
+            return 0;
+        }
+        counts[s->stickers[i]]++;
+    }
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (counts[f] != n * n) {
+            *reason = "a color does not appear n*n times";
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Centers stay in their orbit, which is made up of the 4 positions a face turn moves them to
+// on all 6 faces. Each orbit has to contain every color 4 times, the middle centers are skipped.
+static int check_centers(const Cube_State *s, const char **reason)
+{
+    uint8_t *counts;
+    uint64_t n, f, r, c, key, rot, t, k;
+    int ok;
+
+    n = s->n;
+    if (n < 4) return 1;
+
+    counts = (uint8_t *) calloc(n * n * FACE_COUNT, sizeof (uint8_t));
+    if (counts == NULL) {
+        *reason = "out of memory";
+        return 0;
+    }
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        for (r = 1; r < n - 1; r++) {
+            for (c = 1; c < n - 1; c++) {
+                if (n % 2 == 1 && r == n / 2 && c == n / 2) continue;
+
+                // smallest of the positions (r, c) has on a face turn
+                key = r * n + c;
+                k = r;
+                t = c;
+                for (rot = 0; rot < 3; rot++) {
+                    uint64_t tmp = k;
+                    k = t;
+                    t = n - 1 - tmp;
+                    if (k * n + t < key) key = k * n + t;
+                }
+
+                counts[key * FACE_COUNT + s->stickers[cube_state_sticker_index(n, f, r, c)]]++;
+            }
+        }
+    }
+
+    ok = 1;
+    for (k = 0; ok && k < n * n * FACE_COUNT; k++) {
+        if (counts[k] != 0 && counts[k] != 4) ok = 0;
+    }
+    if (!ok) *reason = "center orbit does not contain every color 4 times";
+
+    free(counts);
+    return ok;
+}
+
+// Wings (the edge pieces of cubes larger than 3x3x3) stay in the orbit made up of the positions
+// k and n-1-k along the 12 edges. They can't be flipped, the orientation of the two stickers
+// relative to the edge center is the same wherever the wing goes. That makes the color pair and
+// its handedness unique in the orbit and a position shows every wing of its orbit at most once.
+static int check_wings(const Cube_State *s, const char **reason)
+{
+    uint32_t *seen;
+    uint64_t n, i, x, y, z, t, orbit, sa, sb;
+    int64_t p[3], u[3], v[3], o[3], det;
+    int axis, free_axis, f, g, e, extremes;
+    uint8_t a, b;
+    int ok;
+
+    n = s->n;
+    if (n < 4) return 1;
+
+    seen = (uint32_t *) calloc((n - 2) / 2, sizeof (uint32_t));
+    if (seen == NULL) {
+        *reason = "out of memory";
+        return 0;
+    }
+
+    ok = 1;
+    for (i = 0; ok && i < FACE_COUNT * n * n; i++) {
+        f = i / (n * n);
+        cube_state_sticker_cubie(n, i, &x, &y, &z);
+        p[0] = 2 * (int64_t) x - (int64_t) (n - 1);
+        p[1] = 2 * (int64_t) y - (int64_t) (n - 1);
+        p[2] = 2 * (int64_t) z - (int64_t) (n - 1);
+
+        extremes = 0;
+        free_axis = 0;
+        for (axis = 0; axis < 3; axis++) {
+            if (p[axis] == (int64_t) (n - 1) || p[axis] == -(int64_t) (n - 1)) extremes++;
+            else free_axis = axis;
+        }
+        if (extremes != 2) continue;
+
+        t = free_axis == 0 ? x : free_axis == 1 ? y : z;
+        if (n % 2 == 1 && t == n / 2) continue;
+
+        // the other sticker of the wing, every wing is only looked at from its smaller face
+        cube_state_face_normal(f, u);
+        memset(v, 0, sizeof (v));
+        for (axis = 0; axis < 3; axis++) {
+            if (axis != free_axis && u[axis] == 0) v[axis] = p[axis] > 0 ? 1 : -1;
+        }
+        g = cube_state_face_from_normal(v);
+        if (g < f) continue;
+
+        sa = i;
+        sb = cube_state_sticker_at(n, g, x, y, z);
+        a = s->stickers[sa];
+        b = s->stickers[sb];
+
+        e = edge_index(a, b);
+        if (e < 0) {
+            *reason = "edge with impossible colors";
+            ok = 0;
+            break;
+        }
+
+        // handedness, the normals are taken in the order of the colors and the offset to the edge center
+        if (a > b) {
+            memcpy(o, u, sizeof (o));
+            memcpy(u, v, sizeof (u));
+            memcpy(v, o, sizeof (v));
+        }
+        memset(o, 0, sizeof (o));
+        o[free_axis] = p[free_axis];
+        det = u[0] * (v[1] * o[2] - v[2] * o[1])
+            - u[1] * (v[0] * o[2] - v[2] * o[0])
+            + u[2] * (v[0] * o[1] - v[1] * o[0]);
+
+        orbit = (t < n - 1 - t ? t : n - 1 - t) - 1;
+        e = 2 * e + (det > 0);
+        if (seen[orbit] & (1u << e)) {
+            *reason = "wing appears twice";
+            ok = 0;
+            break;
+        }
+        seen[orbit] |= 1u << e;
+    }
+
+    free(seen);
+    return ok;
+}
+
+// Corners need a valid permutation and a twist sum divisible by 3. For odd side lengths the
+// middle edges need a valid permutation, an even flip sum and the same parity as the corners.
+// Even side lengths have no fixed reference for the parity, every corner permutation is possible.
+static int check_cube3(const Cube_State *s, const char **reason)
+{
+    Cube3 c;
+    int i, seen, twist, flip;
+
+    if (!cube3_from_state(s, &c)) {
+        *reason = "corner or edge with impossible colors";
+        return 0;
+    }
+
+    seen = 0;
+    twist = 0;
+    for (i = 0; i < CORNER_COUNT; i++) {
+        seen |= 1 << c.cp[i];
+        twist += c.co[i];
+    }
+    if (seen != (1 << CORNER_COUNT) - 1) {
+        *reason = "corner appears twice";
+        return 0;
+    }
+    if (twist % 3 != 0) {
+        *reason = "corner twist sum is not divisible by 3";
+        return 0;
+    }
+
+    if (s->n % 2 == 0) return 1;
+
+    seen = 0;
+    flip = 0;
+    for (i = 0; i < EDGE_COUNT; i++) {
+        seen |= 1 << c.ep[i];
+        flip += c.eo[i];
+    }
+    if (seen != (1 << EDGE_COUNT) - 1) {
+        *reason = "edge appears twice";
+        return 0;
+    }
+    if (flip % 2 != 0) {
+        *reason = "edge flip sum is odd";
+        return 0;
+    }
+    if (cube3_corner_parity(&c) != cube3_edge_parity(&c)) {
+        *reason = "corner and edge permutation parity differ";
+        return 0;
+    }
+
+    return 1;
+}
+
+// rotates the cube so every middle center is at home, returns 0 if that is impossible
+static int align_middle_centers(Cube_State *s)
+{
+    uint64_t n, m;
+    int f;
+
+    n = s->n;
+    m = n / 2;
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (s->stickers[cube_state_sticker_index(n, f, m, m)] == FACE_UP) break;
+    }
+    if (f == FACE_COUNT) return 0;
+    if (UP_ROTATION[f].rot != ROTATION_COUNT)
+        rotate_cube(s, UP_ROTATION[f].face, UP_ROTATION[f].rot);
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (s->stickers[cube_state_sticker_index(n, f, m, m)] == FACE_FRONT) break;
+    }
+    if (f == FACE_COUNT || f == FACE_UP || f == FACE_DOWN) return 0;
+    if (FRONT_ROTATION[f] != ROTATION_COUNT)
+        rotate_cube(s, FACE_UP, FRONT_ROTATION[f]);
+
+    for (f = 0; f < FACE_COUNT; f++) {
+        if (s->stickers[cube_state_sticker_index(n, f, m, m)] != f) return 0;
+    }
+
+    return 1;
+}
+
+static void rotate_cube(Cube_State *s, Rubiks_Cube_Face face, Rubiks_Cube_Rotation rot)
+{
+    uint64_t slice;
+
+    for (slice = 0; slice < s->n; slice++)
+        cube_state_rotate_slice(s, face, rot, slice);
+}
+
+// index of the edge between two adjacent faces, -1 if the faces are equal or opposite
+static int edge_index(uint8_t a, uint8_t b)
+{
+    int i, j, e;
+
+    if (a > b) {
+        uint8_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+    if (a == b || (a + 3) % FACE_COUNT == b) return -1;
+
+    e = 0;
+    for (i = 0; i < FACE_COUNT; i++) {
+        for (j = i + 1; j < FACE_COUNT; j++) {
+            if ((i + 3) % FACE_COUNT == j) continue;
+            if (i == a && j == b) return e;
+            e++;
+        }
+    }
+
+    return -1;
+}
\ No newline at end of file
@@ -1,11 +1,59 @@
 #include "vertex.h"
 
-Cube_Vertex cube_vertex(Vec3 pos, Color col)
+#include <math.h>
+#include <stddef.h>
+
+static int16_t quantize(float v);
+
+Cube_Vertex cube_vertex(Vec3 pos, float scale, uint8_t col)
+{
+    return (Cube_Vertex) {{quantize(pos.x / scale), quantize(pos.y / scale), quantize(pos.z / scale)}, col, 0};
+}
+
+// Describes Cube_Vertex in the bound GL_ARRAY_BUFFER to the bound vertex array.
+void cube_vertex_attributes(void)
+{
+    glVertexAttribPointer(CUBE_VERTEX_POS, 3, GL_SHORT, GL_TRUE, sizeof (Cube_Vertex), (void *) offsetof(Cube_Vertex, pos));
+    glEnableVertexAttribArray(CUBE_VERTEX_POS);
+
+    glVertexAttribIPointer(CUBE_VERTEX_COL, 1, GL_UNSIGNED_BYTE, sizeof (Cube_Vertex), (void *) offsetof(Cube_Vertex, col));
+    glEnableVertexAttribArray(CUBE_VERTEX_COL);
+}
+
+// inverse of cube_vertex(), scale has to be the same
+Vec3 cube_vertex_position(Cube_Vertex v, float scale)
+{
+    return vec3_scale(vec3(v.pos[0], v.pos[1], v.pos[2]), scale / 32767.0f);
+}
+
+Sticker_Vertex sticker_vertex(Vec3 pos, float scale, uint8_t col, uint16_t u, uint16_t v)
+{
+    return (Sticker_Vertex) {{quantize(pos.x / scale), quantize(pos.y / scale), quantize(pos.z / scale)}, col, 0, {u, v}};
+}
+
+// Describes Sticker_Vertex in the bound GL_ARRAY_BUFFER to the bound vertex array.
+void sticker_vertex_attributes(void)
 {
-    return (Cube_Vertex) {pos, col};
+    glVertexAttribPointer(STICKER_VERTEX_POS, 3, GL_SHORT, GL_TRUE, sizeof (Sticker_Vertex), (void *) offsetof(Sticker_Vertex, pos));
+    glEnableVertexAttribArray(STICKER_VERTEX_POS);
+
+    glVertexAttribIPointer(STICKER_VERTEX_COL, 1, GL_UNSIGNED_BYTE, sizeof (Sticker_Vertex), (void *) offsetof(Sticker_Vertex, col));
+    glEnableVertexAttribArray(STICKER_VERTEX_COL);
+
+    glVertexAttribPointer(STICKER_VERTEX_CELL, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof (Sticker_Vertex), (void *) offsetof(Sticker_Vertex, cell));
+    glEnableVertexAttribArray(STICKER_VERTEX_CELL);
 }
 
 Font_Vertex font_vertex(Vec2 pos, Vec2 tex)
 {
     return (Font_Vertex) {pos, tex};
+}
+
+
+static int16_t quantize(float v)
+{
+    if (v >  1.0f) v =  1.0f;
+    if (v < -1.0f) v = -1.0f;
+
+    return (int16_t) roundf(v * 32767.0f);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "glad/gl.h"
 #include "GLFW/glfw3.h"
+#include "gl_state.h"
 #include "logging.h"
 #include "util.h"
 
@@ -221,6 +222,8 @@ void window_set_clear_color(Color c)
 void window_clear(void)
 {
     glClearColor(window.clear_color.r, window.clear_color.g, window.clear_color.b, window.clear_color.a);
+    // the depth buffer is only cleared if writing to it is enabled
+    gl_state_depth_mask(GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
@@ -240,6 +243,7 @@ void window_main_loop(Render_Function render_frame)
             // Poll events and swap buffers in background
             glfwPollEvents();
             glfwSwapBuffers(window.win);
+            gl_state_end_frame();
 
             window.frame_time = now - last_time;
             last_time = now;
@@ -258,6 +262,12 @@ void window_set_fps(int fps)
     else window.min_frame_time = 1.f / (float) fps;
 }
 
+// NULL if the clipboard is empty or doesn't contain text
+const char *window_get_clipboard(void)
+{
+    return glfwGetClipboardString(window.win);
+}
+
 void window_close(void)
 {
     glfwDestroyWindow(window.win);
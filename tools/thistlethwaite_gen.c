@@ -0,0 +1,250 @@
+// Generates the distance tables of the Thistlethwaite solver as a C source file.
+// Usage: thistlethwaite_gen <output.c>
+
+#include "cube3.h"
+#include "logging.h"
+#include "thistlethwaite.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define UNVISITED 0xFF
+
+static void set_coordinate(Cube3 *c, int phase, int coordinate);
+static void set_combination(uint8_t *positions, int count, int k, int rank);
+static void set_perm(uint8_t *p, int count, int rank);
+static int  binomial(int n, int k);
+static uint8_t *generate_table(int phase);
+static int  write_table(FILE *f, const char *name, const uint8_t *dist, int size);
+
+int main(int argc, char **argv)
+{
+    static const char *names[THISTLETHWAITE_PHASE_COUNT] = {
+        "thistlethwaite_table_phase1",
+        "thistlethwaite_table_phase2",
+        "thistlethwaite_table_phase3",
+        "thistlethwaite_table_phase4",
+    };
+    uint8_t *dist;
+    FILE *f;
+    int phase;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output.c>\n", argv[0]);
+        return 1;
+    }
+
+    thistlethwaite_init();
+
+    f = fopen(argv[1], "w");
+    if (f == NULL) {
+        log_error("Failed to open %s for writing", argv[1]);
+        return 1;
+    }
+
+    fprintf(f, "// generated by tools/thistlethwaite_gen.c, do not edit\n\n");
+    fprintf(f, "#include \"thistlethwaite.h\"\n");
+
+    for (phase = 0; phase < THISTLETHWAITE_PHASE_COUNT; phase++) {
+        dist = generate_table(phase);
+        if (dist == NULL || !write_table(f, names[phase], dist, thistlethwaite_phase_size(phase))) {
+            fclose(f);
+            return 1;
+        }
+        free(dist);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+
+// sets any cube with the given coordinate, the parts the coordinate doesn't describe stay solved
+static void set_coordinate(Cube3 *c, int phase, int coordinate)
+{
+    uint8_t positions[EDGE_COUNT], p[4];
+    int i, j, k, sum;
+
+    *c = cube3_solved();
+
+    switch (phase) {
+        case 0:
+            sum = 0;
+            for (i = EDGE_COUNT - 2; i >= 0; i--) {
+                c->eo[i] = coordinate % 2;
+                sum += c->eo[i];
+                coordinate /= 2;
+            }
+            c->eo[EDGE_COUNT - 1] = sum % 2;
+        break;
+
+        case 1:
+            set_combination(positions, EDGE_COUNT, 4, coordinate % 495);
+            for (i = 0, j = 0, k = EDGE_FR; i < EDGE_COUNT; i++)
+                c->ep[i] = positions[i] ? k++ : j++;
+
+            coordinate /= 495;
+            sum = 0;
+            for (i = CORNER_COUNT - 2; i >= 0; i--) {
+                c->co[i] = coordinate % 3;
+                sum += c->co[i];
+                coordinate /= 3;
+            }
+            c->co[CORNER_COUNT - 1] = (3 - sum % 3) % 3;
+        break;
+
+        case 2:
+            // odd edges go to the chosen positions
+            set_combination(positions, EDGE_FR, 4, coordinate % 70);
+            for (i = 0, j = 0, k = 1; i < EDGE_FR; i++) {
+                if (positions[i]) { c->ep[i] = k; k += 2; }
+                else              { c->ep[i] = j; j += 2; }
+            }
+            set_perm(c->cp, CORNER_COUNT, coordinate / 70);
+        break;
+
+        case 3:
+            set_perm(p, 4, coordinate % 24);
+            for (i = 0; i < 4; i++) c->ep[EDGE_FR + i] = EDGE_FR + p[i];
+            coordinate /= 24;
+
+            set_perm(p, 4, coordinate % 24);
+            for (i = 0; i < 4; i++) c->ep[2*i + 1] = 2*p[i] + 1;
+            coordinate /= 24;
+
+            set_perm(p, 4, coordinate % 24);
+            for (i = 0; i < 4; i++) c->ep[2*i] = 2*p[i];
+            coordinate /= 24;
+
+            thistlethwaite_corner_group_perm(coordinate, c->cp);
+        break;
+    }
+}
+
+// marks k of count positions, the inverse of the combination rank used by the coordinates
+static void set_combination(uint8_t *positions, int count, int k, int rank)
+{
+    int i;
+
+    memset(positions, 0, count);
+    for (i = count - 1; k > 0; i--) {
+        if (binomial(i, k) <= rank) {
+            rank -= binomial(i, k);
+            positions[i] = 1;
+            k--;
+        }
+    }
+}
+
+static void set_perm(uint8_t *p, int count, int rank)
+{
+    int i, j, digits[CORNER_COUNT], used[CORNER_COUNT] = {0};
+
+    for (i = count - 1; i >= 0; i--) {
+        digits[i] = rank % (count - i);
+        rank /= count - i;
+    }
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; used[j] || digits[i] > 0; j++) {
+            if (!used[j]) digits[i]--;
+        }
+        used[j] = 1;
+        p[i] = j;
+    }
+}
+
+static int binomial(int n, int k)
+{
+    int i, r;
+
+    if (k > n) return 0;
+
+    r = 1;
+    for (i = 1; i <= k; i++)
+        r = r * (n - k + i) / i;
+
+    return r;
+}
+
+// breadth first search from every goal coordinate of the phase
+static uint8_t *generate_table(int phase)
+{
+    Cube3 c, next;
+    const int *moves;
+    uint8_t *dist;
+    int size, count, depth, filled, i, m, x, n;
+
+    size  = thistlethwaite_phase_size(phase);
+    count = thistlethwaite_phase_moves(phase, &moves);
+
+    dist = (uint8_t *) malloc(size);
+    if (dist == NULL) {
+        log_error("Failed to allocate memory for the distance table of phase %d", phase + 1);
+        return NULL;
+    }
+    memset(dist, UNVISITED, size);
+
+    if (phase == 2) {
+        // every corner permutation of the half turn group is a goal
+        n = thistlethwaite_corner_group_size();
+        for (i = 0; i < n; i++) {
+            c = cube3_solved();
+            thistlethwaite_corner_group_perm(i, c.cp);
+            dist[thistlethwaite_coordinate(&c, phase)] = 0;
+        }
+    } else {
+        c = cube3_solved();
+        dist[thistlethwaite_coordinate(&c, phase)] = 0;
+    }
+
+    filled = 1;
+    for (depth = 0; filled > 0; depth++) {
+        filled = 0;
+        for (i = 0; i < size; i++) {
+            if (dist[i] != depth) continue;
+
+            set_coordinate(&c, phase, i);
+            for (m = 0; m < count; m++) {
+                next = cube3_apply_move(c, moves[m]);
+                x = thistlethwaite_coordinate(&next, phase);
+                if (dist[x] != UNVISITED) continue;
+
+                dist[x] = depth + 1;
+                filled++;
+            }
+        }
+    }
+
+    log_info("Generated distance table of phase %d, maximal distance is %d", phase + 1, depth - 1);
+
+    return dist;
+}
+
+// packs the distances modulo 3 into 2 bits each and writes them as a string literal
+static int write_table(FILE *f, const char *name, const uint8_t *dist, int size)
+{
+    int i, j, bytes, b;
+
+    bytes = THISTLETHWAITE_TABLE_BYTES(size);
+
+    fprintf(f, "\nconst uint8_t %s[THISTLETHWAITE_TABLE_BYTES(%d)] =\n\"", name, size);
+
+    for (i = 0; i < bytes; i++) {
+        b = 0;
+        for (j = 0; j < 4 && 4*i + j < size; j++)
+            b |= (dist[4*i + j] == UNVISITED ? 3 : dist[4*i + j] % 3) << (2*j);
+        if (j < 4) b |= (0xFF << (2*j)) & 0xFF;
+
+        // octal escapes always have three digits so they can't swallow a following digit
+        if (b >= 0x20 && b < 0x7F && b != '"' && b != '\\' && b != '?') fputc(b, f);
+        else fprintf(f, "\\%03o", b);
+
+        if (i % 64 == 63 && i + 1 < bytes) fprintf(f, "\"\n\"");
+    }
+
+    fprintf(f, "\";\n");
+
+    return !ferror(f);
+}
\ No newline at end of file